@@ -29,7 +29,9 @@
  *
  * Just create a Game.h and a Game.cpp (you can copy/paste the included Game.h and Game.cpp file if you want to) and create your
  * game state classes that inherit from the ENGINE::GameState class. You implement the gamestates by filling in the functions
- * for Initialize() and Execute() and Destroy() and then you are pretty much finished with that.\n\n
+ * for Initialize() and Execute() and Destroy() and then you are pretty much finished with that.
+ * The engine calls Execute() at a fixed rate (60 times per second unless you change it with MainSystemSingleton::SetUpdateRate()),
+ * so your game runs at the same speed on every machine. If you want to draw at the full frame rate, override Update() and Render() as well.\n\n
  *
  * There will be tutorials for how to get started using ged101, both a breakout-type game and a mini-rpg walk around will be
  * covered in detail from the start to the finish of creating 2 working game demos.\n\n
@@ -51,6 +51,15 @@ ts->AddRange("mountain", 6,
 	new ImageResource("mountain.png", 64, 0, 16, 16),
 	new ImageResource("mountain.png", 80, 0, 16, 16));
 
+ * \endcode
+ * 
+ * A whole spritesheet can also be added at once. The file is loaded a single time and cut into tiles.
+ * When every tile has been added, pack the tileset into an atlas so that the renderer draws every tile from one image.
+ * \code
+// adds lava0 lava1 lava2 ... from a sheet of 16x16 tiles
+ts->AddSheet("lava", "lava.png", 16, 16);
+// pack all the tiles into a single image
+ts->BuildAtlas();
  * \endcode
  * 
  * \section Example1Section2 Creating a TileMap
@@ -96,6 +105,28 @@ GraphicsDevice->BeginScene();
 worldRenderer->Render();
 
 GraphicsDevice->EndScene();
+ * \endcode
+ *
+ * \section Example1Section3b Scrolling a large TileMap
+ * Only the tiles that can be seen through the renderer's viewport are drawn, so a map may be much larger than the screen.
+ * Move the camera to scroll around the map. The camera is the pixel position in the world that appears at the upper-left of the viewport.
+ * \code
+// draw the map into a 320x240 window in the middle of the display
+worldRenderer->SetViewport(160, 120, 320, 240);
+// scroll 2 pixels to the right every frame
+worldRenderer->ScrollCamera(2, 0);
+worldRenderer->Render();
+ * \endcode
+ *
+ * \section Example1Section3c Caching a static TileMap
+ * A CachedTileMapRenderer draws each chunk of the map into its own image once, and then blits whole chunks.
+ * Chunks are only drawn again after tiles inside of them change through the TileMap.
+ * \code
+// cache chunks of 32x32 tiles, using at most 8MB of memory
+CachedTileMapRenderer* cachedRenderer = new CachedTileMapRenderer(world, ts, display, 32, 8 * 1024 * 1024);
+cachedRenderer->Render();
+// only the chunk holding tile 5,5 is drawn again on the next Render()
+world->SetValue(5, 5, 2);
  * \endcode
  *
  * \section Example1Section4 Cleaning up after ourselves
@@ -112,6 +143,7 @@ delete ts;
  * \sa ENGINE::TileMap
  * \sa ENGINE::Tileset
  * \sa ENGINE::TileMapRenderer
+ * \sa ENGINE::CachedTileMapRenderer
  * \sa ENGINE::ImageResource
  * \sa ENGINE::ColorRGB
  * \sa ENGINE::GraphicsDeviceSingleton
@@ -63,9 +63,17 @@ namespace ENGINE
 		/**
 		 * Call this to advance the animation frames.\n
 		 * frames will only advance if the frame counter is > the current frame's delay time
+		 * Each call counts as one unit of time, so call this once per fixed step of the main loop to get the same speed on every machine.
 		 */
 		void Update();
 		
+		/**
+		 * Advances the animation by an amount of time. 
+		 * More than one frame is skipped if the time is longer than the delay of the current frame.
+		 * @param elapsed is the amount of time that has passed, in the same units as the delays of the frames
+		 */
+		void Update(float elapsed);
+		
 		/**
 		 * Gets the current frame
 		 */
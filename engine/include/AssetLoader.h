@@ -0,0 +1,432 @@
+
+// CODESTYLE: v2.0
+
+// AssetLoader.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Decodes image and sound files on worker threads while the game keeps running
+
+#ifndef __ASSETLOADER_H__
+#define __ASSETLOADER_H__
+
+/**
+ * \file AssetLoader.h
+ * \brief Asynchronous Asset Loading Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Threading.h"
+#include "ImageResource.h"
+#include "Audio_OGG.h"
+
+namespace ENGINE
+{
+	//! the most worker threads that the asset loader will start
+	const unsigned int ASSET_LOADER_MAX_THREADS = 8;
+	
+	//! the color of the empty part of the default loading progress bar
+	const int ASSET_LOADER_PROGRESS_BACK_COLOR = 0x404040;
+	
+	//! the color of the filled part of the default loading progress bar
+	const int ASSET_LOADER_PROGRESS_FORE_COLOR = 0xC0C0C0;
+	
+	/**
+	 * \enum AssetRequestType
+	 * \brief the kinds of files that the asset loader can load
+	 */
+	enum AssetRequestType
+	{
+		//! an image file, which ends up in the ENGINE::ImageCacheSingleton
+		AssetRequest_Image,
+		//! an OGG file, which ends up in an ENGINE::AudioSampleResource_OGG
+		AssetRequest_Sample
+	};
+	
+	/**
+	 * \enum AssetRequestState
+	 * \brief the steps that a request goes through
+	 */
+	enum AssetRequestState
+	{
+		//! waiting for a worker thread
+		AssetRequest_Queued,
+		//! a worker thread is decoding the file
+		AssetRequest_Decoding,
+		//! the file is decoded, and waits for AssetLoaderSingleton::Update() to finish it on the main thread
+		AssetRequest_Decoded,
+		//! the asset can be used
+		AssetRequest_Ready,
+		//! the file could not be loaded
+		AssetRequest_Failed
+	};
+	
+	/**
+	 * \class AssetRequest
+	 * \brief A file that was handed to the asset loader, and the asset that it turns into
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Requests are made and deleted by the ENGINE::AssetLoaderSingleton. Give every request back with
+	 * AssetLoaderSingleton::ReleaseRequest() when you are done with it.
+	 */
+	class AssetRequest
+	{
+	public:
+		/**
+		 * \return the kind of file that is being loaded
+		 */
+		AssetRequestType GetType();
+		
+		/**
+		 * \return the step that the request is at
+		 */
+		AssetRequestState GetState();
+		
+		/**
+		 * \return true if the asset is ready, or the file could not be loaded
+		 */
+		bool IsDone();
+		
+		/**
+		 * \return the name of the file that is being loaded
+		 */
+		const char* GetFileName();
+		
+		/**
+		 * Gets the loaded image. The image belongs to the ENGINE::ImageCacheSingleton, and the request holds a reference to it
+		 * until it is released, so acquire the image from the cache as well to keep it after releasing the request.
+		 * \return a pointer to the image, or 0 if it is not ready or this is not an image request
+		 */
+		ImageResource* GetImage();
+		
+		/**
+		 * Takes the loaded audio sample over. The caller must delete it.
+		 * \return a pointer to the audio sample, or 0 if it is not ready, was already taken, or this is not a sample request
+		 */
+		AudioSampleResource_OGG* TakeSample();
+	
+	private:
+		// the asset loader is the only class that changes the requests
+		friend class AssetLoaderSingleton;
+		
+		/**
+		 * constructor is hidden because the requests are made by the asset loader
+		 */
+		AssetRequest(AssetRequestType type, const char* fileName);
+		
+		/**
+		 * destructor is hidden because the requests are deleted by the asset loader
+		 */
+		~AssetRequest();
+		
+		/**
+		 * hidden copy constructor
+		 */
+		AssetRequest(const AssetRequest& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const AssetRequest& operator=(const AssetRequest& rhs);
+		
+		/**
+		 * \var type_
+		 * \brief the kind of file that is being loaded
+		 */
+		AssetRequestType type_;
+		
+		/**
+		 * \var state_
+		 * \brief the step that the request is at
+		 */
+		volatile AssetRequestState state_;
+		
+		/**
+		 * \var fileName_
+		 * \brief the name of the file that is being loaded
+		 */
+		std::string fileName_;
+		
+		/**
+		 * \var decoded_
+		 * \brief true if a worker thread decoded the file, false if it has to be loaded on the main thread instead
+		 */
+		bool decoded_;
+		
+		/**
+		 * \var released_
+		 * \brief true if the request was released while a worker thread was still decoding it
+		 */
+		bool released_;
+		
+		/**
+		 * \var pixels_
+		 * \brief the decoded pixels of an image request
+		 */
+		ImagePixelData pixels_;
+		
+		/**
+		 * \var samples_
+		 * \brief the decoded sound of a sample request
+		 */
+		AudioSampleData samples_;
+		
+		/**
+		 * \var image_
+		 * \brief the loaded image
+		 */
+		ImageResource* image_;
+		
+		/**
+		 * \var sample_
+		 * \brief the loaded audio sample, until it is taken
+		 */
+		AudioSampleResource_OGG* sample_;
+	}; // end class
+	
+	/**
+	 * \class AssetLoaderSingleton
+	 * \brief Decodes image and sound files on worker threads while the game keeps running
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Decoding PNG and OGG files takes most of the time of loading a game. The asset loader hands the files to a
+	 * fixed pool of worker threads that decode them into memory at the same time. Allegro may only be used from the
+	 * main thread, so the decoded pixels and sound are turned into images and audio samples by AssetLoaderSingleton::Update(),
+	 * which the main thread calls.\n
+	 * Requests must be made from the main thread. The workers are started by the first request.\n
+	 * After every GameState::Initialize() the ENGINE::GameStateManagerSingleton keeps calling AssetLoaderSingleton::Update()
+	 * until the files that the state asked for are loaded, and shows the progress with GameState::RenderLoading().
+	 * So a state only needs to request its files in GameState::Initialize(), and pick them up when it first runs.\n
+	 * There is a MACRO defined called AssetLoader that is just an alias to calling the
+	 * AssetLoaderSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 * \code
+	 * void MyState::Initialize()
+	 * {
+	 * 	backgroundRequest_ = AssetLoader->RequestImage("data/background.png");
+	 * 	jumpRequest_ = AssetLoader->RequestSample("data/jump.ogg");
+	 * }
+	 * ...
+	 * background_ = ImageCache->Acquire("data/background.png");
+	 * jumpSound_ = jumpRequest_->TakeSample();
+	 * AssetLoader->ReleaseRequest(backgroundRequest_);
+	 * AssetLoader->ReleaseRequest(jumpRequest_);
+	 * \endcode
+	 */
+	class AssetLoaderSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the asset loader singleton class instance
+		 */
+		static AssetLoaderSingleton* GetInstance();
+		
+		/**
+		 * Sets the number of worker threads. This only has an effect before the first request is made.
+		 * @param threadCount is the number of worker threads, up to ASSET_LOADER_MAX_THREADS.
+		 * The default of 0 uses one thread less than the number of processors, so the main thread keeps a processor.
+		 */
+		void SetThreadCount(unsigned int threadCount);
+		
+		/**
+		 * \return the number of worker threads that are running, or 0 if they have not been started yet
+		 */
+		unsigned int GetThreadCount();
+		
+		/**
+		 * Starts loading an image file. When it is ready, the image is in the ENGINE::ImageCacheSingleton.
+		 * @param fileName is the name of the file that holds the image
+		 * \return the request, which must be released with AssetLoaderSingleton::ReleaseRequest()
+		 */
+		AssetRequest* RequestImage(const char* fileName);
+		
+		/**
+		 * Starts loading an OGG file into an audio sample.
+		 * @param fileName is the name of the file that holds the sound
+		 * \return the request, which must be released with AssetLoaderSingleton::ReleaseRequest()
+		 */
+		AssetRequest* RequestSample(const char* fileName);
+		
+		/**
+		 * Gives a request back. An audio sample that was not taken is deleted, and the reference to an image is released.
+		 * A request that is still loading is deleted once it is done.
+		 */
+		void ReleaseRequest(AssetRequest* request);
+		
+		/**
+		 * Turns the decoded files into images and audio samples. This must be called from the main thread.
+		 * \return the number of requests that were finished
+		 */
+		unsigned int Update();
+		
+		/**
+		 * Waits until a worker thread has decoded a file, or the time runs out
+		 * @param milliseconds is the longest time to wait
+		 * \return true if a file was decoded, false if the time ran out
+		 */
+		bool WaitForDecoded(unsigned int milliseconds);
+		
+		/**
+		 * Finishes every request before returning. This must be called from the main thread.
+		 */
+		void WaitForAll();
+		
+		/**
+		 * \return true if there are requests that are not finished
+		 */
+		bool IsLoading();
+		
+		/**
+		 * \return the number of requests that are not finished
+		 */
+		unsigned int GetPendingCount();
+		
+		/**
+		 * \return how much of the current batch of requests is finished, from 0.0 to 1.0.
+		 * A new batch starts with the first request made after all the earlier ones were finished.
+		 */
+		float GetProgress();
+		
+		/**
+		 * Draws a simple progress bar across the middle of an image
+		 * @param target is the image to draw on
+		 * @param progress is how much of the bar to fill, from 0.0 to 1.0
+		 */
+		void DrawProgressBar(ImageResource* target, float progress);
+		
+		/**
+		 * stops the worker threads and deletes every request
+		 */
+		~AssetLoaderSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		AssetLoaderSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		AssetLoaderSingleton(const AssetLoaderSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const AssetLoaderSingleton& operator=(const AssetLoaderSingleton& rhs);
+		
+		/**
+		 * starts the worker threads if they are not running
+		 */
+		void Start();
+		
+		/**
+		 * stops the worker threads
+		 */
+		void Stop();
+		
+		/**
+		 * queues a new request for the worker threads
+		 */
+		AssetRequest* Queue(AssetRequestType type, const char* fileName);
+		
+		/**
+		 * the function of the worker threads
+		 */
+		static void Run(void* data);
+		
+		/**
+		 * decodes the file of a request; called on a worker thread
+		 */
+		static void Decode(AssetRequest* request);
+		
+		/**
+		 * turns the decoded file of a request into its asset; called on the main thread
+		 */
+		void Finish(AssetRequest* request);
+		
+		/**
+		 * frees everything that a request holds and deletes it
+		 */
+		void Destroy(AssetRequest* request);
+		
+		/**
+		 * \var threads_
+		 * \brief the worker threads
+		 */
+		Thread* threads_[ASSET_LOADER_MAX_THREADS];
+		
+		/**
+		 * \var threadCount_
+		 * \brief the number of worker threads that are running
+		 */
+		unsigned int threadCount_;
+		
+		/**
+		 * \var requestedThreadCount_
+		 * \brief the number of worker threads to start; 0 picks the number from the processor count
+		 */
+		unsigned int requestedThreadCount_;
+		
+		/**
+		 * \var queue_
+		 * \brief the requests that are waiting for a worker thread
+		 */
+		std::deque<AssetRequest*> queue_;
+		
+		/**
+		 * \var decoded_
+		 * \brief the requests that are waiting to be finished on the main thread
+		 */
+		std::vector<AssetRequest*> decoded_;
+		
+		/**
+		 * \var mutex_
+		 * \brief held while the queues are changed
+		 */
+		Mutex mutex_;
+		
+		/**
+		 * \var workEvent_
+		 * \brief wakes up a worker thread when there is work
+		 */
+		ThreadEvent workEvent_;
+		
+		/**
+		 * \var decodedEvent_
+		 * \brief wakes up the main thread when a file was decoded
+		 */
+		ThreadEvent decodedEvent_;
+		
+		/**
+		 * \var running_
+		 * \brief 1 while the worker threads should keep running
+		 */
+		volatile int running_;
+		
+		/**
+		 * \var requestedCount_
+		 * \brief the number of requests in the current batch
+		 */
+		unsigned int requestedCount_;
+		
+		/**
+		 * \var finishedCount_
+		 * \brief the number of requests in the current batch that are finished
+		 */
+		unsigned int finishedCount_;
+	}; // end class
+
+/**
+ * \def AssetLoader
+ * \brief an alias for the AssetLoaderSingleton::GetInstance() function to make your code clean.
+ */
+#define AssetLoader AssetLoaderSingleton::GetInstance()
+} // end namespace
+#endif
+
+
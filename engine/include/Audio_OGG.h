@@ -30,6 +30,25 @@ namespace ENGINE
 	//! size of the audio data buffer
 	const unsigned int AUDIORESOURCE_OGG_BUFFER_SIZE 	= 1024 * 64;
 	
+	/**
+	 * \struct AudioSampleData
+	 * \brief the sound of an OGG file after decoding, before it is turned into an Allegro SAMPLE
+	 * \ingroup AudioGroup
+	 */
+	struct AudioSampleData
+	{
+		//! the number of bits per sample; always 16
+		int bits;
+		//! 1 if the sound has two channels, 0 if it has one
+		int stereo;
+		//! the sampling rate in samples per second
+		int frequency;
+		//! the length of the sound in samples
+		unsigned long length;
+		//! the unsigned 16 bit samples, with the channels interleaved; allocated with malloc, and freed by the owner of the data
+		void* data;
+	};
+	
 	/**
 	 * \class AudioSampleResource_OGG
 	 * \brief A class for using short audio samples in the OGG format
@@ -49,6 +68,23 @@ namespace ENGINE
 		 */
 		bool Load(const char* fileName);
 		
+		/**
+		 * Creates the audio sample from decoded sound. This must be called from the main thread.
+		 * @param samples is the decoded sound, such as from AudioSampleResource_OGG::Decode(). The audio sample takes over
+		 * the sound data, and samples.data is set to 0.
+		 * \return true if the audio sample was created, and false otherwise.
+		 */
+		bool Create(AudioSampleData& samples);
+		
+		/**
+		 * Decodes an OGG file into memory without using Allegro, so it may be called from any thread.
+		 * Pass the result to AudioSampleResource_OGG::Create() on the main thread to make an audio sample of it.
+		 * @param fileName is the name of the file that holds the audio sample data to decode.
+		 * @param samples is filled in with the decoded sound. The caller must free samples.data if it is not passed on.
+		 * \return true if the file was decoded, and false otherwise.
+		 */
+		static bool Decode(const char* fileName, AudioSampleData& samples);
+		
 		/**
 		 * Starts playing an audio sample at the specified frequency, volume, and pan settings.
 		 * @param volume ranges from 0 (minimum volume) to 255 (maximum volume)
@@ -0,0 +1,256 @@
+
+// CODESTYLE: v2.0
+
+// CachedTileMapRenderer.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: A TileMapRenderer that keeps prerendered chunks of the map in offscreen images
+
+/**
+ * \file CachedTileMapRenderer.h
+ * \brief Tile-Based Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __CACHEDTILEMAPRENDERER_H__
+#define __CACHEDTILEMAPRENDERER_H__
+
+#include <map>
+#include <list>
+
+#include "TileMap.h"
+#include "TileMapRenderer.h"
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	class ImageResource;
+	
+	//! the default width and height of a cached chunk in tiles
+	const int TILEMAP_CACHE_DEFAULT_CHUNK_SIZE = 16;
+	
+	//! the default amount of memory that the cached chunks may use in bytes
+	const unsigned int TILEMAP_CACHE_DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+	
+	/**
+	 * \class CachedTileMapRenderer
+	 * \brief A TileMapRenderer that keeps prerendered chunks of the map in offscreen images
+	 * \ingroup TileBasedGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The map is split into square chunks of tiles. The first time that a chunk is visible it is
+	 * rendered once into its own image, and from then on each frame only needs a single large blit per
+	 * visible chunk instead of one small blit per tile.\n
+	 * The renderer listens to its TileMap, so a chunk is only rendered again after a tile inside of it has changed.
+	 * When the chunks use more memory than the budget allows, the chunks that have gone the longest without being
+	 * seen are released.\n
+	 * If the images of the tileset change, call CachedTileMapRenderer::InvalidateAll().
+	 * The renderer must be deleted before the tile map that it renders.
+	 */
+	class CachedTileMapRenderer : public TileMapRenderer, public TileMapListener
+	{
+	public:
+	
+		/**
+		 * default constructor
+		 */
+		CachedTileMapRenderer();
+		
+		/**
+		 * alternate constructor to initialize all properties of the class at once
+		 * @param tileMap is the tilemap to render
+		 * @param tileSet is the tileset with which to render
+		 * @param target is the image buffer onto which the map is to be rendered
+		 * @param chunkSize is the width and height of a chunk in tiles
+		 * @param memoryBudget is the amount of memory in bytes that the cached chunks may use
+		 */
+		CachedTileMapRenderer(
+			TileMap* tileMap, 
+			Tileset* tileSet, 
+			ImageResource* target, 
+			int chunkSize = TILEMAP_CACHE_DEFAULT_CHUNK_SIZE, 
+			unsigned int memoryBudget = TILEMAP_CACHE_DEFAULT_MEMORY_BUDGET);
+		
+		/**
+		 * releases all of the cached chunks, and stops listening to the tilemap
+		 */
+		virtual ~CachedTileMapRenderer();
+		
+		/**
+		 * Sets the tilemap and releases all of the cached chunks
+		 * @param tileMap is the tilemap to render
+		 */
+		virtual void SetTileMap(TileMap* tileMap);
+		
+		/**
+		 * Sets the tileset and marks all of the cached chunks to be rendered again
+		 * @param tileSet is the tileset with which to render
+		 */
+		virtual void SetTileset(Tileset* tileSet);
+		
+		/**
+		 * Sets the size of a chunk and releases all of the cached chunks
+		 * @param chunkSize is the width and height of a chunk in tiles
+		 */
+		void SetChunkSize(int chunkSize);
+		
+		/**
+		 * Sets the amount of memory that the cached chunks may use.
+		 * The chunks that are visible in the current frame are never released, even if they are over the budget.
+		 * @param memoryBudget is the amount of memory in bytes
+		 */
+		void SetMemoryBudget(unsigned int memoryBudget);
+		
+		/**
+		 * Marks all of the cached chunks to be rendered again the next time that they are visible
+		 */
+		void InvalidateAll();
+		
+		/**
+		 * Releases all of the cached chunks
+		 */
+		void Flush();
+		
+		/**
+		 * \return the width and height of a chunk in tiles
+		 */
+		int GetChunkSize();
+		
+		/**
+		 * \return the amount of memory in bytes that the cached chunks may use
+		 */
+		unsigned int GetMemoryBudget();
+		
+		/**
+		 * \return the amount of memory in bytes that the cached chunks are using
+		 */
+		unsigned int GetMemoryUsed();
+		
+		/**
+		 * \return the number of chunks that are cached
+		 */
+		unsigned int GetChunkCount();
+		
+		/**
+		 * Renders the visible chunks, rendering any chunks that are not cached or have changed first
+		 */
+		virtual void Render();
+		
+		/**
+		 * Marks the chunks that hold the changed tiles to be rendered again
+		 */
+		virtual void OnTilesChanged(TileMap* tileMap, int x, int y, int width, int height);
+		
+	private:
+	
+		/**
+		 * \struct Chunk
+		 * \brief a single cached chunk of the map
+		 */
+		struct Chunk
+		{
+			//! the prerendered tiles of the chunk
+			ImageResource* image;
+			//! the amount of memory used by the image in bytes
+			unsigned int bytes;
+			//! true if the image needs to be rendered again
+			bool dirty;
+			//! the last frame that the chunk was visible in
+			unsigned int lastFrame;
+			//! the position of the chunk in the least recently used list
+			std::list<int>::iterator lruPosition;
+		};
+		
+		//! STL map of chunk keys to chunks
+		typedef std::map<int, Chunk> ChunkSTLMap;
+		
+		//! STL iterator for a map of chunk keys to chunks
+		typedef std::map<int, Chunk>::iterator ChunkSTLMapIterator;
+		
+		/**
+		 * \return the key of the chunk at the given chunk coordinate
+		 */
+		int GetChunkKey(int chunkX, int chunkY);
+		
+		/**
+		 * Gets a chunk, creating and rendering it if needed
+		 * @param chunkX is the X coordinate of the chunk in chunks
+		 * @param chunkY is the Y coordinate of the chunk in chunks
+		 * \return a pointer to the chunk
+		 */
+		Chunk* AcquireChunk(int chunkX, int chunkY);
+		
+		/**
+		 * Renders the tiles of a chunk into its image
+		 */
+		void RenderChunk(Chunk* chunk, int chunkX, int chunkY);
+		
+		/**
+		 * Releases the least recently seen chunks until the memory budget is met
+		 */
+		void EvictChunks();
+		
+		/**
+		 * hidden copy constructor
+		 */
+		CachedTileMapRenderer(const CachedTileMapRenderer& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const CachedTileMapRenderer& operator=(const CachedTileMapRenderer& rhs);
+		
+		/**
+		 * \var chunks_
+		 * \brief the cached chunks
+		 */
+		ChunkSTLMap chunks_;
+		
+		/**
+		 * \var lru_
+		 * \brief the keys of the cached chunks, from the most recently seen to the least recently seen
+		 */
+		std::list<int> lru_;
+		
+		/**
+		 * \var chunkSize_
+		 * \brief the width and height of a chunk in tiles
+		 */
+		int chunkSize_;
+		
+		/**
+		 * \var memoryBudget_
+		 * \brief the amount of memory in bytes that the cached chunks may use
+		 */
+		unsigned int memoryBudget_;
+		
+		/**
+		 * \var memoryUsed_
+		 * \brief the amount of memory in bytes that the cached chunks are using
+		 */
+		unsigned int memoryUsed_;
+		
+		/**
+		 * \var frame_
+		 * \brief counts the calls to CachedTileMapRenderer::Render()
+		 */
+		unsigned int frame_;
+		
+		/**
+		 * \var cachedTileWidth_
+		 * \brief the width of a tile when the chunks were rendered
+		 */
+		int cachedTileWidth_;
+		
+		/**
+		 * \var cachedTileHeight_
+		 * \brief the height of a tile when the chunks were rendered
+		 */
+		int cachedTileHeight_;
+	}; // end class
+
+} // end namespace
+#endif
+
+
+
@@ -25,6 +25,13 @@
  * \li Generic Messages - messages are logged to a file, and the program continues.
  * \sa DEBUG::DebugReport_Fatal, DEBUG::DebugReport_Error, DEBUG::DebugReport_Warning, DEBUG::DebugReport_Message
  * \n\n
+ * Reports are not written by the thread that makes them. They are queued, and a background thread writes them
+ * to the files a few times per second, so reporting from inside the game loop does not stall the frame.
+ * A fatal error writes everything that is queued before the program exits, and the queue is also written when the
+ * program exits normally.\n
+ * A line of code that keeps reporting in a loop is limited to DEBUG::DBGREP_MAX_REPORTS_PER_SECOND reports per second;
+ * the rest are counted, and the count is added to the next report from that line that gets through.
+ * \n\n
  * The use of the classes should be restricted to using only the MACROs in your code.
  * \sa LogFatal, LogError, LogWarning, LogMessage
  */
@@ -57,6 +64,21 @@ namespace DEBUG
 	//! the maximum report length is limited to 4096 characters
 	const unsigned int DBGREP_MAX_REPORT_LENGTH = 0x1000; 
 	
+	//! the background thread writes the queued reports at least this often, in milliseconds
+	const unsigned int DBGREP_FLUSH_INTERVAL = 250;
+	
+	//! the background thread is woken up early when this many reports are queued
+	const int DBGREP_WAKE_THRESHOLD = 64;
+	
+	//! reports are dropped when this many are waiting to be written
+	const int DBGREP_MAX_QUEUED_REPORTS = 0x1000;
+	
+	//! the most reports with the same text that one line of code can make in one second; errors and fatal errors are never limited
+	const int DBGREP_MAX_REPORTS_PER_SECOND = 8;
+	
+	//! the number of slots used to count repeated reports
+	const unsigned int DBGREP_RATE_LIMIT_SLOTS = 256;
+	
 	/**
 	 * \class DebugReportInfo
 	 * \brief A helper class that gives the functionality of a printf-style error reporting function. 
@@ -117,6 +139,14 @@ namespace DEBUG
 		void PrintSimpleMessage(const char* message, ...);
 		
 	private:
+		/**
+		 * Counts a report against the limit of its line of code and text.
+		 * @param text is the formatted text of the report, so that different reports from the same line are counted apart
+		 * @param suppressed is set to the number of the same reports that were dropped since the last one that got through
+		 * \return true if the report should be made, false if the same report has already been made too many times this second
+		 */
+		bool CheckRateLimit(const char* text, unsigned int& suppressed);
+		
 		/**
 		 * hidden copy constructor
 		 */
@@ -143,7 +173,7 @@ namespace DEBUG
 	 * \ingroup DebugGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
 	 *
-	 * The DebugReport class only exposes the static DebugReport::Log() function.
+	 * The DebugReport class only exposes the static DebugReport::Log() and DebugReport::Flush() functions.
 	 * Instances of the DebugReport class cannot be made.
 	 * Example use: DebugReport::Log(DEBUG::DebugReport_Fatal, "Engine::Initialize()", "Could not Initialize the Engine!");
 	 */
@@ -162,6 +192,12 @@ namespace DEBUG
 			ReportSeverityLevel severity = DebugReport_Warning,
 			const char* location = "",
 			const char* message = "");
+		
+		/**
+		 * Writes every queued report to the files before returning.
+		 * This happens on its own a few times per second, when a fatal error is reported, and when the program exits.
+		 */
+		static void Flush();
 
 	private:
 		/**
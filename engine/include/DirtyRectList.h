@@ -0,0 +1,147 @@
+
+// CODESTYLE: v2.0
+
+// DirtyRectList.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: A list of the changed regions of an image that merges overlapping regions
+
+/**
+ * \file DirtyRectList.h
+ * \brief Dirty Rectangle Tracking Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __DIRTYRECTLIST_H__
+#define __DIRTYRECTLIST_H__
+
+#include <vector>
+
+namespace ENGINE
+{
+	//! the most rectangles that a DirtyRectList holds before they are merged into one rectangle around all of them
+	const unsigned int DIRTY_RECT_LIST_MAX_RECTS = 64;
+	
+	/**
+	 * \struct DirtyRect
+	 * \brief a single changed region of an image
+	 * \ingroup GraphicsGroup
+	 */
+	struct DirtyRect
+	{
+		//! the X coordinate of the upper-left corner of the region in pixels
+		int x;
+		//! the Y coordinate of the upper-left corner of the region in pixels
+		int y;
+		//! the width of the region in pixels
+		int width;
+		//! the height of the region in pixels
+		int height;
+	};
+	
+	/**
+	 * \class DirtyRectList
+	 * \brief A list of the changed regions of an image that merges overlapping regions
+	 * \ingroup GraphicsGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Every rectangle that is added is clipped to the bounds of the list, and then merged with any rectangles
+	 * that it overlaps or touches, so the rectangles in the list never overlap and no pixel is counted twice.\n
+	 * If more than DIRTY_RECT_LIST_MAX_RECTS rectangles build up, they are all merged into a single rectangle.
+	 */
+	class DirtyRectList
+	{
+	public:
+		/**
+		 * constructor
+		 * @param width is the width of the tracked image in pixels
+		 * @param height is the height of the tracked image in pixels
+		 */
+		DirtyRectList(int width, int height);
+		
+		/**
+		 * destructor
+		 */
+		~DirtyRectList();
+		
+		/**
+		 * Sets the size of the tracked image and removes all rectangles from the list
+		 * @param width is the width of the tracked image in pixels
+		 * @param height is the height of the tracked image in pixels
+		 */
+		void SetBounds(int width, int height);
+		
+		/**
+		 * Adds a changed region to the list
+		 * @param x is the X coordinate of the upper-left corner of the region
+		 * @param y is the Y coordinate of the upper-left corner of the region
+		 * @param width is the width of the region in pixels
+		 * @param height is the height of the region in pixels
+		 */
+		void Add(int x, int y, int width, int height);
+		
+		/**
+		 * Marks the entire tracked image as changed
+		 */
+		void AddAll();
+		
+		/**
+		 * Removes all rectangles from the list
+		 */
+		void Clear();
+		
+		/**
+		 * \return the number of rectangles in the list
+		 */
+		unsigned int GetCount();
+		
+		/**
+		 * \return a pointer to the rectangle at the specified index, or 0 if the index is not valid
+		 */
+		DirtyRect* Get(unsigned int index);
+		
+		/**
+		 * \return the total number of pixels covered by the rectangles in the list
+		 */
+		unsigned int GetPixelCount();
+		
+	private:
+		/**
+		 * Merges every rectangle into a single rectangle around all of them
+		 */
+		void Collapse();
+		
+		/**
+		 * hidden copy constructor
+		 */
+		DirtyRectList(const DirtyRectList& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const DirtyRectList& operator=(const DirtyRectList& rhs);
+		
+		/**
+		 * \var rects_
+		 * \brief the rectangles in the list
+		 */
+		std::vector<DirtyRect> rects_;
+		
+		/**
+		 * \var width_
+		 * \brief the width of the tracked image in pixels
+		 */
+		int width_;
+		
+		/**
+		 * \var height_
+		 * \brief the height of the tracked image in pixels
+		 */
+		int height_;
+	}; // end class
+
+} // end namespace
+#endif
+
+
+
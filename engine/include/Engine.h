@@ -20,6 +20,12 @@
 
 // graphics module
 #include "ImageResource.h"
+#include "DirtyRectList.h"
+#include "PixelKernels.h"
+#include "SpriteBatch.h"
+#include "RenderQueue.h"
+#include "ImageCache.h"
+#include "AssetLoader.h"
 #include "ImageList.h"
 #include "BitmapFont.h"
 #include "AnimationFrame.h"
@@ -33,16 +39,24 @@
 
 // object module
 #include "GameObject.h"
+#include "GameObjectArena.h"
 #include "GameObjectGroup.h"
 #include "GameObjectGroupManager.h"
+#include "EntityWorld.h"
+#include "SpatialHash.h"
 
 // system module
 #include "GameTimer.h"
 #include "GameStateManager.h"
 #include "NameDirectory.h"
+#include "Threading.h"
+#include "JobSystem.h"
+#include "VirtualFileSystem.h"
 
 // debugging module
 #include "DebugReport.h"
+#include "Profiler.h"
+#include "TraceCapture.h"
 
 // scene module
 #include "Scene.h"
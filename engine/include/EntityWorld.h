@@ -0,0 +1,638 @@
+// CODESTYLE: v2.0
+
+// EntityWorld.h
+// Project: Game Engine Design 101 Project (ENGINE)
+// Author: Richard Marks
+// Purpose: stores entities as plain components in dense arrays, for objects that there are too many of to be GameObjects
+
+/**
+ * \file EntityWorld.h
+ * \brief Game Object Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __ENTITYWORLD_H__
+#define __ENTITYWORLD_H__
+
+#include <vector>
+
+namespace ENGINE
+{
+	/**
+	 * \typedef EntityHandle
+	 * \brief identifies an entity of an EntityWorld; the low bits are the index of the entity, and the high bits count how
+	 * many times that index has been used, so that a handle to a destroyed entity never finds the entity that replaced it
+	 */
+	typedef unsigned int EntityHandle;
+	
+	//! the number of bits of an EntityHandle that hold the index of the entity
+	const unsigned int ENTITY_INDEX_BITS = 20;
+	
+	//! masks the index of the entity out of an EntityHandle
+	const unsigned int ENTITY_INDEX_MASK = (1 << ENTITY_INDEX_BITS) - 1;
+	
+	//! the most entities that an EntityWorld can hold at once
+	const unsigned int ENTITY_MAX_COUNT = 1 << ENTITY_INDEX_BITS;
+	
+	//! the largest generation that fits in the high bits of an EntityHandle; the generation starts over at 1 after it
+	const unsigned int ENTITY_MAX_GENERATION = (1 << (32 - ENTITY_INDEX_BITS)) - 1;
+	
+	//! a handle that is never given to an entity
+	const EntityHandle ENTITY_NULL = 0;
+	
+	//! marks an entity that has no component in a ComponentPool
+	const unsigned int ENTITY_NO_COMPONENT = 0xFFFFFFFF;
+	
+	// forward declare classes that we need
+	class EntityWorld;
+	
+	/**
+	 * \typedef EntitySystemFunction
+	 * \brief a system that EntityWorld::CallUpdate() or EntityWorld::CallRender() runs over the components of a world
+	 */
+	typedef void (*EntitySystemFunction)(EntityWorld* world, void* data);
+	
+	/**
+	 * Hands out the next component type ID; use GetComponentTypeID() instead
+	 * \return a number that no component type has yet
+	 */
+	unsigned int NextComponentTypeID();
+	
+	/**
+	 * \return the ID of the component type \a T, which is the index of its pool in every EntityWorld.
+	 * The IDs are handed out the first time that each type is used, on the main thread.
+	 */
+	template <typename T>
+	unsigned int GetComponentTypeID()
+	{
+		static unsigned int typeID = NextComponentTypeID();
+		return typeID;
+	}
+	
+	/**
+	 * \class ComponentPoolBase
+	 * \brief The part of a ComponentPool that does not depend on the type of the components
+	 * \ingroup ObjectGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The pool is a sparse set. The entities that have the component are packed into a dense array, in the same order
+	 * as the components, and a sparse array that is indexed by the index of the entity gives the position of each one.
+	 */
+	class ComponentPoolBase
+	{
+	public:
+		/**
+		 * class destructor
+		 */
+		virtual ~ComponentPoolBase()
+		{
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Removes the component of an entity, moving the last component into its place
+		 * @param entity is the entity whose component is removed; nothing happens if it has none
+		 */
+		virtual void Remove(EntityHandle entity) = 0;
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return the position of the component of \a entity in the dense arrays, or ENTITY_NO_COMPONENT if it has none
+		 */
+		unsigned int Find(EntityHandle entity) const
+		{
+			unsigned int index = entity & ENTITY_INDEX_MASK;
+			if (index >= sparse_.size())
+			{
+				return ENTITY_NO_COMPONENT;
+			}
+			
+			// a destroyed entity that had the same index does not count
+			unsigned int position = sparse_[index];
+			return ((ENTITY_NO_COMPONENT != position) && (entities_[position] == entity)) ? position : ENTITY_NO_COMPONENT;
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return true if \a entity has a component in this pool
+		 */
+		bool Has(EntityHandle entity) const
+		{
+			return ENTITY_NO_COMPONENT != Find(entity);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return the number of components in the pool
+		 */
+		unsigned int GetCount() const
+		{
+			return static_cast<unsigned int>(entities_.size());
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return the dense array of the entities that have a component, in the same order as the components, or 0 if there are none
+		 */
+		const EntityHandle* GetEntities() const
+		{
+			return (entities_.empty()) ? 0 : &entities_[0];
+		};
+	
+	protected:
+		/**
+		 * Adds \a entity to the end of the dense array
+		 * \return the position of the entity in the dense array
+		 */
+		unsigned int Insert(EntityHandle entity)
+		{
+			unsigned int index = entity & ENTITY_INDEX_MASK;
+			if (index >= sparse_.size())
+			{
+				sparse_.resize(index + 1, ENTITY_NO_COMPONENT);
+			}
+			
+			sparse_[index] = static_cast<unsigned int>(entities_.size());
+			entities_.push_back(entity);
+			return sparse_[index];
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Moves the last entity of the dense array into \a position and drops the last one
+		 */
+		void Erase(unsigned int position)
+		{
+			EntityHandle last = entities_.back();
+			
+			sparse_[entities_[position] & ENTITY_INDEX_MASK] = ENTITY_NO_COMPONENT;
+			if (last != entities_[position])
+			{
+				entities_[position] = last;
+				sparse_[last & ENTITY_INDEX_MASK] = position;
+			}
+			entities_.pop_back();
+		};
+		
+		/**
+		 * \var entities_
+		 * \brief the dense array of the entities that have a component
+		 */
+		std::vector<EntityHandle> entities_;
+		
+		/**
+		 * \var sparse_
+		 * \brief the position of the component of each entity index in the dense arrays, or ENTITY_NO_COMPONENT
+		 */
+		std::vector<unsigned int> sparse_;
+	}; // end class
+	
+	/**
+	 * \class ComponentPool
+	 * \brief A template class that keeps the components of one type packed together in a dense array
+	 * \ingroup ObjectGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Every component type has its own pool, so the components of a world are laid out as a structure of arrays;
+	 * a system that moves the entities reads the positions and the velocities as two tightly packed arrays, and never
+	 * touches the rest of the data of the entities. Components should be plain structures that are cheap to copy,
+	 * because removing one moves the last component of the pool into its place.
+	 */
+	template <typename T>
+	class ComponentPool : public ComponentPoolBase
+	{
+	public:
+		/**
+		 * Gives an entity a component, or replaces the one that it has
+		 * @param entity is the entity to add the component to
+		 * @param component is copied into the pool
+		 * \return a pointer to the component in the pool, which is good until a component is added to or removed from the pool
+		 */
+		T* Add(EntityHandle entity, const T& component)
+		{
+			unsigned int position = Find(entity);
+			if (ENTITY_NO_COMPONENT != position)
+			{
+				components_[position] = component;
+				return &components_[position];
+			}
+			
+			Insert(entity);
+			components_.push_back(component);
+			return &components_.back();
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return a pointer to the component of \a entity, or 0 if it has none
+		 */
+		T* Get(EntityHandle entity)
+		{
+			unsigned int position = Find(entity);
+			return (ENTITY_NO_COMPONENT != position) ? &components_[position] : 0;
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Removes the component of an entity, moving the last component into its place
+		 * @param entity is the entity whose component is removed; nothing happens if it has none
+		 */
+		virtual void Remove(EntityHandle entity)
+		{
+			unsigned int position = Find(entity);
+			if (ENTITY_NO_COMPONENT == position)
+			{
+				return;
+			}
+			
+			Erase(position);
+			if (position != components_.size() - 1)
+			{
+				components_[position] = components_.back();
+			}
+			components_.pop_back();
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return the dense array of the components, in the same order as GetEntities(), or 0 if there are none
+		 */
+		T* GetComponents()
+		{
+			return (components_.empty()) ? 0 : &components_[0];
+		};
+	
+	private:
+		/**
+		 * \var components_
+		 * \brief the dense array of the components
+		 */
+		std::vector<T> components_;
+	}; // end class
+	
+	/**
+	 * \struct EntitySystem
+	 * \brief a system function that a world runs every frame, with the data that is passed to it
+	 * \ingroup ObjectGroup
+	 */
+	struct EntitySystem
+	{
+		//! the function to call
+		EntitySystemFunction function;
+		//! passed to the function
+		void* data;
+	};
+	
+	/**
+	 * \class EntityWorld
+	 * \brief stores entities as plain components in dense arrays, for objects that there are too many of to be GameObjects
+	 * \ingroup ObjectGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * A GameObjectGroup keeps a pointer to every object, and calls three virtual functions on each of them every frame,
+	 * which is fine for the player and a few enemies but not for twenty thousand bullets. An entity of a world is only
+	 * a handle, and its data lives in components, which are plain structures kept in a ComponentPool for each type.
+	 * Systems are ordinary functions that walk the dense arrays of the components that they need:
+	 * \code
+struct Position { float x, y; };
+struct Velocity { float x, y; };
+
+static void Move(EntityHandle entity, Position& position, Velocity& velocity)
+{
+	position.x += velocity.x;
+	position.y += velocity.y;
+}
+
+static void MoveSystem(EntityWorld* world, void* data)
+{
+	world->ForEach<Position, Velocity>(Move);
+}
+
+groupManager->CreateNamedWorld("bullets");
+EntityWorld* bullets = groupManager->GetNamedWorld("bullets");
+bullets->AddUpdateSystem(MoveSystem, 0);
+
+EntityHandle bullet = bullets->CreateEntity();
+bullets->AddComponent(bullet, position);
+bullets->AddComponent(bullet, velocity);
+	 * \endcode
+	 * Handles stay valid until the entity is destroyed, and never find another entity afterwards. Components must not be
+	 * added to or removed from a pool while a ForEach() walks it, so systems destroy entities with
+	 * EntityWorld::QueueDestroyEntity(), and CallUpdate() destroys them after the last system has run.
+	 * GameObjectGroupManager updates and renders its worlds after its groups, so GameObjects keep working next to them.
+	 */
+	class EntityWorld
+	{
+	public:
+	
+		/**
+		 * class constructor
+		 */
+		EntityWorld();
+		
+		/**
+		 * class destructor
+		 */
+		~EntityWorld();
+		
+		/**
+		 * Creates an entity without any components
+		 * \return the handle of the entity, or ENTITY_NULL if the world already holds ENTITY_MAX_COUNT entities
+		 */
+		EntityHandle CreateEntity();
+		
+		/**
+		 * Destroys an entity and all of its components straight away
+		 * @param entity is the entity to destroy; nothing happens if it is not alive
+		 */
+		void DestroyEntity(EntityHandle entity);
+		
+		/**
+		 * Destroys an entity at the end of the next CallUpdate(), so that systems can destroy entities while they walk the components
+		 * @param entity is the entity to destroy
+		 */
+		void QueueDestroyEntity(EntityHandle entity);
+		
+		/**
+		 * Destroys the entities that were given to QueueDestroyEntity()
+		 */
+		void DestroyQueuedEntities();
+		
+		/**
+		 * \return true if \a entity has been created and not destroyed
+		 */
+		bool IsAlive(EntityHandle entity) const;
+		
+		/**
+		 * \return the number of entities that are alive
+		 */
+		unsigned int GetEntityCount() const;
+		
+		/**
+		 * Adds a system that CallUpdate() runs, after the systems that were added before it
+		 * @param function is the system
+		 * @param data is passed to the system
+		 */
+		void AddUpdateSystem(EntitySystemFunction function, void* data);
+		
+		/**
+		 * Adds a system that CallRender() runs, after the systems that were added before it
+		 * @param function is the system
+		 * @param data is passed to the system
+		 */
+		void AddRenderSystem(EntitySystemFunction function, void* data);
+		
+		/**
+		 * Runs the update systems, and then destroys the entities that were queued for destruction
+		 */
+		void CallUpdate();
+		
+		/**
+		 * Runs the render systems
+		 */
+		void CallRender();
+		
+		/**
+		 * Gives an entity a component, or replaces the one that it has
+		 * @param entity is the entity to add the component to; it must be alive
+		 * @param component is copied into the pool of its type
+		 * \return a pointer to the component, which is good until a component of the same type is added or removed
+		 */
+		template <typename T>
+		T* AddComponent(EntityHandle entity, const T& component = T())
+		{
+			return GetPool<T>()->Add(entity, component);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return a pointer to the component of type \a T of an entity, or 0 if it has none
+		 */
+		template <typename T>
+		T* GetComponent(EntityHandle entity)
+		{
+			return GetPool<T>()->Get(entity);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return true if an entity has a component of type \a T
+		 */
+		template <typename T>
+		bool HasComponent(EntityHandle entity)
+		{
+			return GetPool<T>()->Has(entity);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Removes the component of type \a T of an entity
+		 */
+		template <typename T>
+		void RemoveComponent(EntityHandle entity)
+		{
+			GetPool<T>()->Remove(entity);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * \return the pool of the components of type \a T, which is created the first time that it is asked for
+		 */
+		template <typename T>
+		ComponentPool<T>* GetPool()
+		{
+			unsigned int typeID = GetComponentTypeID<T>();
+			if (typeID >= pools_.size())
+			{
+				pools_.resize(typeID + 1, 0);
+			}
+			if (0 == pools_[typeID])
+			{
+				pools_[typeID] = new ComponentPool<T>;
+			}
+			return static_cast<ComponentPool<T>*>(pools_[typeID]);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Calls \a function(entity, a) for every entity that has a component of type \a A
+		 * @param function is a function or a function object; a function object can be inlined into the loop
+		 */
+		template <typename A, typename Function>
+		void ForEach(Function function)
+		{
+			ComponentPool<A>* poolA = GetPool<A>();
+			
+			unsigned int count = poolA->GetCount();
+			const EntityHandle* entities = poolA->GetEntities();
+			A* componentsA = poolA->GetComponents();
+			for (unsigned int index = 0; index < count; index++)
+			{
+				function(entities[index], componentsA[index]);
+			}
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Calls \a function(entity, a, b) for every entity that has components of the types \a A and \a B.
+		 * The smaller of the two pools is walked, and the other one is looked up.
+		 * @param function is a function or a function object; a function object can be inlined into the loop
+		 */
+		template <typename A, typename B, typename Function>
+		void ForEach(Function function)
+		{
+			ComponentPool<A>* poolA = GetPool<A>();
+			ComponentPool<B>* poolB = GetPool<B>();
+			
+			if (poolA->GetCount() <= poolB->GetCount())
+			{
+				unsigned int count = poolA->GetCount();
+				const EntityHandle* entities = poolA->GetEntities();
+				A* componentsA = poolA->GetComponents();
+				for (unsigned int index = 0; index < count; index++)
+				{
+					B* componentB = poolB->Get(entities[index]);
+					if (0 != componentB)
+					{
+						function(entities[index], componentsA[index], *componentB);
+					}
+				}
+			}
+			else
+			{
+				unsigned int count = poolB->GetCount();
+				const EntityHandle* entities = poolB->GetEntities();
+				B* componentsB = poolB->GetComponents();
+				for (unsigned int index = 0; index < count; index++)
+				{
+					A* componentA = poolA->Get(entities[index]);
+					if (0 != componentA)
+					{
+						function(entities[index], *componentA, componentsB[index]);
+					}
+				}
+			}
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Calls \a function(entity, a, b, c) for every entity that has components of the types \a A, \a B and \a C.
+		 * The pool of \a A is walked, so it should be the smallest of the three.
+		 * @param function is a function or a function object; a function object can be inlined into the loop
+		 */
+		template <typename A, typename B, typename C, typename Function>
+		void ForEach(Function function)
+		{
+			ComponentPool<A>* poolA = GetPool<A>();
+			ComponentPool<B>* poolB = GetPool<B>();
+			ComponentPool<C>* poolC = GetPool<C>();
+			
+			unsigned int count = poolA->GetCount();
+			const EntityHandle* entities = poolA->GetEntities();
+			A* componentsA = poolA->GetComponents();
+			for (unsigned int index = 0; index < count; index++)
+			{
+				B* componentB = poolB->Get(entities[index]);
+				C* componentC = poolC->Get(entities[index]);
+				if ((0 != componentB) && (0 != componentC))
+				{
+					function(entities[index], componentsA[index], *componentB, *componentC);
+				}
+			}
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Handles the creation of an instance of this class
+		 * \return an allocated pointer to a new instance of the EntityWorld class
+		 */
+		static EntityWorld* Create();
+		
+		/**
+		 * Handles the memory release of an instance of this class
+		 * @param worldInstance is a pointer to an EntityWorld class instance allocated by the EntityWorld::Create() function
+		 */
+		static void Destroy(EntityWorld* worldInstance);
+	
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		EntityWorld(const EntityWorld& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const EntityWorld& operator=(const EntityWorld& rhs);
+		
+		/**
+		 * \var generations_
+		 * \brief the generation of every entity index; the generation of a handle must match for the entity to be alive
+		 */
+		std::vector<unsigned int> generations_;
+		
+		/**
+		 * \var alive_
+		 * \brief true for every entity index that is in use
+		 */
+		std::vector<bool> alive_;
+		
+		/**
+		 * \var freeIndices_
+		 * \brief the entity indices that can be used again
+		 */
+		std::vector<unsigned int> freeIndices_;
+		
+		/**
+		 * \var entityCount_
+		 * \brief the number of entities that are alive
+		 */
+		unsigned int entityCount_;
+		
+		/**
+		 * \var pools_
+		 * \brief the component pools, indexed by the ID of their component type; 0 for the types that this world has not used
+		 */
+		std::vector<ComponentPoolBase*> pools_;
+		
+		/**
+		 * \var destroyQueue_
+		 * \brief the entities to destroy at the end of the next CallUpdate()
+		 */
+		std::vector<EntityHandle> destroyQueue_;
+		
+		/**
+		 * \var updateSystems_
+		 * \brief the systems that CallUpdate() runs, in order
+		 */
+		std::vector<EntitySystem> updateSystems_;
+		
+		/**
+		 * \var renderSystems_
+		 * \brief the systems that CallRender() runs, in order
+		 */
+		std::vector<EntitySystem> renderSystems_;
+	
+	}; // end class
+
+} // end namespace
+#endif
+
+
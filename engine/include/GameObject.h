@@ -48,7 +48,7 @@ namespace ENGINE
 		virtual void Update() = 0;
 		
 		/**
-		 * renders the object
+		 * renders the object; sprites drawn with SpriteBatch->Draw() are drawn after all the objects have rendered
 		 */
 		virtual void Render() = 0;
 		
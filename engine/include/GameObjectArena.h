@@ -0,0 +1,235 @@
+// CODESTYLE: v2.0
+
+// GameObjectArena.h
+// Project: Game Engine Design 101 Project (ENGINE)
+// Author: Richard Marks
+// Purpose: hands out the memory of game objects of one type from chunks that are reused, instead of from the heap
+
+/**
+ * \file GameObjectArena.h
+ * \brief Game Object Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __GAMEOBJECTARENA_H__
+#define __GAMEOBJECTARENA_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "GameObject.h"
+#include "Threading.h"
+
+namespace ENGINE
+{
+	//! the number of objects that an arena takes from the heap at once when it runs out of blocks
+	const unsigned int GAME_OBJECT_ARENA_CHUNK_SIZE = 256;
+	
+	/**
+	 * \class GameObjectArena
+	 * \brief hands out blocks of one size from chunks that are taken from the heap, and keeps the blocks that are given back
+	 * \ingroup ObjectGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The blocks that are given back are kept in a free list and handed out again first, so once an arena holds as many
+	 * blocks as the most objects that are alive at once, spawning and destroying objects never touches the heap.
+	 * The chunks are only given back to the heap when the arena is destroyed. Every function can be called from any thread.
+	 */
+	class GameObjectArena
+	{
+	public:
+		/**
+		 * creates an arena that has no chunks yet
+		 * @param blockSize is the size of every block that the arena hands out
+		 */
+		GameObjectArena(size_t blockSize);
+		
+		/**
+		 * class destructor; gives the chunks back to the heap, so every block must have been freed first
+		 */
+		~GameObjectArena();
+		
+		/**
+		 * Takes a block, taking another chunk from the heap if there are no free blocks
+		 * \return the block
+		 */
+		void* Allocate();
+		
+		/**
+		 * Gives a block back to the arena
+		 * @param block is a block that was handed out by Allocate()
+		 */
+		void Free(void* block);
+		
+		/**
+		 * Takes enough chunks from the heap for the arena to hold at least \a blockCount blocks
+		 */
+		void Reserve(unsigned int blockCount);
+		
+		/**
+		 * \return the size of the blocks
+		 */
+		size_t GetBlockSize();
+		
+		/**
+		 * \return the number of blocks that are handed out
+		 */
+		unsigned int GetUsedCount();
+		
+		/**
+		 * \return the number of blocks in all of the chunks of the arena
+		 */
+		unsigned int GetCapacity();
+	
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		GameObjectArena(const GameObjectArena& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const GameObjectArena& operator=(const GameObjectArena& rhs);
+		
+		/**
+		 * Takes a chunk from the heap and puts all of its blocks in the free list; the mutex must be held
+		 */
+		void AddChunkInternal(unsigned int blockCount);
+		
+		/**
+		 * \struct FreeBlock
+		 * \brief a block in the free list, which holds the next one in the first bytes of the block itself
+		 */
+		struct FreeBlock
+		{
+			//! the next free block, or 0
+			FreeBlock* next;
+		};
+		
+		/**
+		 * \var blockSize_
+		 * \brief the size of the objects that the blocks hold
+		 */
+		size_t blockSize_;
+		
+		/**
+		 * \var freeBlocks_
+		 * \brief the first free block, or 0 if every block is handed out
+		 */
+		FreeBlock* freeBlocks_;
+		
+		/**
+		 * \var chunks_
+		 * \brief the memory that was taken from the heap
+		 */
+		std::vector<void*> chunks_;
+		
+		/**
+		 * \var usedCount_
+		 * \brief the number of blocks that are handed out
+		 */
+		unsigned int usedCount_;
+		
+		/**
+		 * \var capacity_
+		 * \brief the number of blocks in all of the chunks
+		 */
+		unsigned int capacity_;
+		
+		/**
+		 * \var mutex_
+		 * \brief guards the free list, because objects are spawned during the parallel update too
+		 */
+		Mutex mutex_;
+	}; // end class
+	
+	/**
+	 * \class PooledGameObject
+	 * \brief A template base class for game objects whose memory comes from an arena of their own type
+	 * \ingroup ObjectGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * A game object class that is spawned and destroyed all the time derives from PooledGameObject of itself instead of
+	 * from GameObject, and then new and delete take its memory from an arena for the class, which
+	 * GameObjectGroup::QueueDestroyObject() gives it back to:
+	 * \code
+class Bullet : public PooledGameObject<Bullet>
+{
+	...
+};
+
+// hold a second of bullets before the first one is fired
+PooledGameObject<Bullet>::ReserveObjects(1000);
+bullets->QueueAddObject(new Bullet(x, y));
+	 * \endcode
+	 * A class that derives from the pooled class is bigger than the blocks of the arena, so its objects come from the heap.
+	 * GameObjectGroup::QueueAddNamedObject() copies the name into a std::string, so only the objects that are spawned
+	 * without a name keep off the heap completely.
+	 */
+	template <typename T>
+	class PooledGameObject : public GameObject
+	{
+	public:
+		/**
+		 * takes the memory of an object from the arena of the class
+		 */
+		static void* operator new(size_t size)
+		{
+			GameObjectArena* arena = GetArena();
+			return (size == arena->GetBlockSize()) ? arena->Allocate() : ::operator new(size);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * gives the memory of an object back to the arena of the class
+		 */
+		static void operator delete(void* memory, size_t size)
+		{
+			if (0 == memory)
+			{
+				return;
+			}
+			
+			GameObjectArena* arena = GetArena();
+			if (size == arena->GetBlockSize())
+			{
+				arena->Free(memory);
+			}
+			else
+			{
+				::operator delete(memory);
+			}
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * Makes the arena of the class hold at least \a objectCount objects, so that spawning them never touches the heap
+		 */
+		static void ReserveObjects(unsigned int objectCount)
+		{
+			GetArena()->Reserve(objectCount);
+		};
+		
+		/**********************************************************************/
+		
+		/**
+		 * The arena is made the first time that it is needed and is never destroyed, so that an object which is deleted
+		 * by another static object at exit still has an arena to go back to; the chunks are freed by the system.
+		 * Call ReserveObjects() on the main thread before the objects are spawned from the parallel update, so that the
+		 * arena is not made by two threads at once.
+		 * \return the arena that the objects of the class come from
+		 */
+		static GameObjectArena* GetArena()
+		{
+			static GameObjectArena* arena = new GameObjectArena(sizeof(T));
+			return arena;
+		};
+	}; // end class
+
+} // end namespace
+#endif
+
+
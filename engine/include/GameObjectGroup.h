@@ -19,28 +19,91 @@
 #include <map>
 #include <string>
 
+#include "Threading.h"
+
 namespace ENGINE
 {
 	// forward declare classes that we need
 	class GameObject;
 	
+	/**
+	 * \typedef GameObjectID
+	 * \brief identifies an object of a GameObjectGroup; the low bits are the slot of the object, and the high bits count how
+	 * many times that slot has been used, so that the ID of a destroyed object never finds the object that took its slot
+	 */
+	typedef unsigned int GameObjectID;
+	
+	//! the number of bits of a GameObjectID that hold the slot of the object
+	const unsigned int GAME_OBJECT_SLOT_BITS = 20;
+	
+	//! masks the slot of the object out of a GameObjectID
+	const unsigned int GAME_OBJECT_SLOT_MASK = (1 << GAME_OBJECT_SLOT_BITS) - 1;
+	
+	//! the most objects that a GameObjectGroup can hold at once
+	const unsigned int GAME_OBJECT_MAX_COUNT = 1 << GAME_OBJECT_SLOT_BITS;
+	
+	//! the largest generation that fits in the high bits of a GameObjectID; the generation starts over at 1 after it
+	const unsigned int GAME_OBJECT_MAX_GENERATION = (1 << (32 - GAME_OBJECT_SLOT_BITS)) - 1;
+	
+	//! an ID that is never given to an object
+	const GameObjectID GAME_OBJECT_NO_ID = 0;
+	
+	/**
+	 * \enum GameObjectGroupUpdateMode
+	 * \brief how a group may be updated when the GameObjectGroupManager updates its groups in parallel
+	 * \ingroup ObjectGroup
+	 */
+	enum GameObjectGroupUpdateMode
+	{
+		//! the group is updated on the main thread, in order with the other serial groups
+		GameObjectGroupUpdate_Serial,
+		//! the group does not touch the other groups, so it is updated as a job while the rest are updated
+		GameObjectGroupUpdate_Independent,
+		//! the objects of the group do not touch each other either, so the group is split into ranges that are updated at once
+		GameObjectGroupUpdate_Parallel
+	};
+	
+	/**
+	 * \struct GameObjectGroupChange
+	 * \brief an object to add to a group, or to destroy, once the groups have been updated
+	 * \ingroup ObjectGroup
+	 */
+	struct GameObjectGroupChange
+	{
+		//! the object to add, or 0 to destroy the object with the ID objectID
+		GameObject* object;
+		//! the name to add the object with, or empty for an object without a name
+		std::string name;
+		//! the ID of the object to destroy
+		GameObjectID objectID;
+	};
+	
 	/**
 	 * \class GameObjectGroup
 	 * \brief manages a group of game objects either by ID or name
 	 * \ingroup ObjectGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The objects are packed into an array in no particular order, and an object is destroyed by moving the last object
+	 * into its place, so the group never has holes to skip over. The ID of an object names a slot that keeps track of
+	 * where the object is in the array; the slot of a destroyed object is used again by the next object that is added,
+	 * with a new generation, so the old ID stops finding anything instead of finding the new object.\n
+	 * Objects are destroyed with GameObjectGroup::QueueDestroyObject() at the end of the update, so the array never changes
+	 * while the group is updated. The memory of objects that are spawned all the time can come from a GameObjectArena,
+	 * by deriving their class from PooledGameObject.
 	 */
 	class GameObjectGroup
 	{
 	public:
-
+	
 		/**
 		 * class constructor
 		 */
 		GameObjectGroup();
 		
 		/**
-		 * class destructor
+		 * class destructor; calls the Destroy method of every object in the group before deleting it, and deletes the
+		 * objects that are still queued to be added without calling it, because they were never created
 		 */
 		~GameObjectGroup();
 		
@@ -54,6 +117,13 @@ namespace ENGINE
 		 */
 		void CallUpdate();
 		
+		/**
+		 * Calls the Update method on a range of the objects in the group
+		 * @param begin is the position of the first object to update, from 0 to GetObjectCount()
+		 * @param end is one past the position of the last object to update
+		 */
+		void CallUpdateRange(unsigned int begin, unsigned int end);
+		
 		/**
 		 * Calls the Render method on all objects in the group
 		 */
@@ -79,20 +149,71 @@ namespace ENGINE
 		 * @param object is a pointer to a GameObject to add to the group
 		 * \return the object ID for the object you are adding
 		 */
-		unsigned int AddObject(GameObject* object);
+		GameObjectID AddObject(GameObject* object);
 		
 		/**
 		 * Gets an object from the group by its ID
 		 * @param objectID is the ID of the object to retrieve
-		 * \return a pointer to an object by ID or null if the object does not exist
+		 * \return a pointer to an object by ID or null if the object has been destroyed
+		 */
+		GameObject* GetObject(GameObjectID objectID);
+		
+		/**
+		 * Gets an object from the group by its position, to go through all of the objects
+		 * @param position is the position of the object, from 0 to one less than GetObjectCount()
+		 * \return a pointer to the object
 		 */
-		GameObject* GetObject(unsigned int objectID);
+		GameObject* GetObjectAt(unsigned int position);
+		
+		/**
+		 * \return the ID of the object at a position, from 0 to one less than GetObjectCount()
+		 */
+		GameObjectID GetObjectIDAt(unsigned int position);
 		
 		/**
 		 * \return the total number of objects (named and not) in the group
 		 */
 		unsigned int GetObjectCount();
-	
+		
+		/**
+		 * Sets how the group may be updated when the GameObjectGroupManager updates its groups in parallel
+		 * @param updateMode is one of the GameObjectGroupUpdateMode values; groups are serial unless they are told otherwise
+		 */
+		void SetUpdateMode(GameObjectGroupUpdateMode updateMode);
+		
+		/**
+		 * \return how the group may be updated when the GameObjectGroupManager updates its groups in parallel
+		 */
+		GameObjectGroupUpdateMode GetUpdateMode();
+		
+		/**
+		 * Adds an object to the group once the groups have been updated, and then calls its Create method; safe to call from any thread
+		 * @param object is a pointer to a GameObject to add to the group
+		 */
+		void QueueAddObject(GameObject* object);
+		
+		/**
+		 * Adds a named object to the group once the groups have been updated, and then calls its Create method; safe to call from any thread.
+		 * The name is copied into a std::string, which takes memory from the heap even when the object is pooled.
+		 * @param objectName is the name for the object to be added
+		 * @param object is a pointer to a GameObject to add to the group
+		 */
+		void QueueAddNamedObject(const char* objectName, GameObject* object);
+		
+		/**
+		 * Destroys an object of the group once the groups have been updated; safe to call from any thread.
+		 * The last object is moved into its place, and the Destroy method of the object is called before it is deleted.
+		 * @param objectID is the ID of the object to destroy; nothing happens if it has already been destroyed
+		 */
+		void QueueDestroyObject(GameObjectID objectID);
+		
+		/**
+		 * Adds and destroys the objects that were queued, in the order that they were queued. The Create method of every
+		 * added object is called after it has been added, and the Destroy method of every destroyed object before it is deleted.
+		 * GameObjectGroupManager::CallUpdate() calls this on every group once all of them have been updated.
+		 */
+		void ApplyQueuedChanges();
+		
 		/**
 		 * Handles the creation of an instance of this class
 		 * \return an allocated pointer to a new instance of the GameObjectGroup class
@@ -104,9 +225,19 @@ namespace ENGINE
 		 * @param groupInstance is a pointer to a GameObjectGroup class instance allocated by the GameObjectGroup::Create() function
 		 */
 		static void Destroy(GameObjectGroup* groupInstance);
-		
+	
 	private:
-
+	
+		/**
+		 * Destroys an object straight away, moving the last object into its place
+		 */
+		void DestroyObjectInternal(GameObjectID objectID);
+		
+		/**
+		 * \return the position of an object in the array, or GAME_OBJECT_MAX_COUNT if the ID is not alive
+		 */
+		unsigned int FindObjectInternal(GameObjectID objectID);
+		
 		// a few type definitions to make the code easier to read
 		
 		//! STL vector of GameObject pointers
@@ -115,18 +246,42 @@ namespace ENGINE
 		//! STL iterator for a vector of GameObject pointers
 		typedef std::vector<GameObject*>::iterator GameObjectSTLVectorIterator;
 		
-		//! STL map of string to uints for keeping a lookup index for object names
-		typedef std::map<std::string, unsigned int> GameObjectSTLMap;
+		//! STL map of string to object IDs for keeping a lookup index for object names
+		typedef std::map<std::string, GameObjectID> GameObjectSTLMap;
 		
-		//! STL iterator for a map of string to uints
-		typedef std::map<std::string, unsigned int>::iterator GameObjectSTLMapIterator; 
+		//! STL iterator for a map of string to object IDs
+		typedef std::map<std::string, GameObjectID>::iterator GameObjectSTLMapIterator; 
 		
 		/**
 		 * \var objects_
-		 * \brief holds all the objects in the group
+		 * \brief holds all the objects in the group, packed together
 		 */
 		GameObjectSTLVector objects_;
 		
+		/**
+		 * \var objectIDs_
+		 * \brief the ID of every object, in the same order as the objects
+		 */
+		std::vector<GameObjectID> objectIDs_;
+		
+		/**
+		 * \var positions_
+		 * \brief the position of the object of every slot in the array, or GAME_OBJECT_MAX_COUNT for a free slot
+		 */
+		std::vector<unsigned int> positions_;
+		
+		/**
+		 * \var generations_
+		 * \brief the generation of every slot; the generation of an ID must match for the object to be found
+		 */
+		std::vector<unsigned int> generations_;
+		
+		/**
+		 * \var freeSlots_
+		 * \brief the slots of destroyed objects, which are used again before new slots are made
+		 */
+		std::vector<unsigned int> freeSlots_;
+		
 		/**
 		 * \var names_
 		 * \brief maintains a name index for the named objects
@@ -136,6 +291,30 @@ namespace ENGINE
 		 */ 
 		GameObjectSTLMap names_;
 		
+		/**
+		 * \var updateMode_
+		 * \brief how the group may be updated when the groups are updated in parallel
+		 */
+		GameObjectGroupUpdateMode updateMode_;
+		
+		/**
+		 * \var changes_
+		 * \brief the objects to add and destroy once the groups have been updated
+		 */
+		std::vector<GameObjectGroupChange> changes_;
+		
+		/**
+		 * \var appliedChanges_
+		 * \brief the changes that are being applied, kept between frames so that queueing changes does not touch the heap
+		 */
+		std::vector<GameObjectGroupChange> appliedChanges_;
+		
+		/**
+		 * \var changesMutex_
+		 * \brief guards the queued changes, which objects may add to from any thread
+		 */
+		Mutex changesMutex_;
+	
 	}; // end class
 
 } // end namespace
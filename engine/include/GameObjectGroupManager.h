@@ -19,21 +19,52 @@
 #include <map>
 #include <string>
 
+#include "SpatialHash.h"
+
 namespace ENGINE
 {
 	// forward declare classes that we need
 	class GameObjectGroup;
-
+	class EntityWorld;
+	
+	//! the number of objects of a GameObjectGroupUpdate_Parallel group that one job updates
+	const int GAME_OBJECT_GROUP_UPDATE_GRAIN = 128;
+	
 	/**
 	 * \class GameObjectGroupManager
 	 * \brief A class to manage a list of game object groups either by ID or name
 	 * \ingroup ObjectGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * With GameObjectGroupManager::SetParallelUpdate() the groups are updated on the threads of the job system. Every
+	 * group that was given GameObjectGroupUpdate_Independent is updated as one job, and every group that was given
+	 * GameObjectGroupUpdate_Parallel is split into jobs of GAME_OBJECT_GROUP_UPDATE_GRAIN objects, while the serial groups
+	 * are updated in order on the main thread. The changes are made once every group has been updated; an object that
+	 * was queued to be added has its Create method called then, and one that was queued to be destroyed has its Destroy
+	 * method called.\n
+	 * What the objects of the groups that are not serial may call during the update:
+	 * - GameObjectGroup::QueueAddObject(), GameObjectGroup::QueueAddNamedObject() and GameObjectGroup::QueueDestroyObject(),
+	 *   instead of adding or destroying objects straight away.
+	 * - SpatialHash::Move(), as long as only one thread moves each box.
+	 * - TileMap::GetTile(), TileMap::GetValue() and TileMap::IsSolid(), which only read the map and return copies,
+	 *   as long as nothing changes the map during the update.
+	 * - ProfileScope and ProfileZone; the zones are guarded, so they can be timed from any thread.
+	 * - the counters of the ImageCacheSingleton, which are read under its lock.
+	 *
+	 * What they must not call:
+	 * - GameObjectGroup::AddObject(), and anything else that changes a group, the tile map or the spatial hash.
+	 * - ImageCacheSingleton::Acquire() and anything else that loads or creates an image, because Allegro is not safe
+	 *   to use from several threads; acquire the images in Create instead.
+	 * - SpriteBatchSingleton::Draw() and the rest of the drawing, which belongs in Render.
+	 *
+	 * Builds without NDEBUG check the variables that the objects mark with SharedStateRead() and SharedStateWrite() during a
+	 * parallel update, and log a warning the first time that two groups which are updated at the same time touch the same
+	 * variable and one of them writes to it, or that the objects of a parallel group write to one.
 	 */
 	class GameObjectGroupManager
 	{
 	public:
-
+	
 		/**
 		 * default constructor
 		 */
@@ -50,12 +81,13 @@ namespace ENGINE
 		void CallCreate();
 		
 		/**
-		 * Calls the CallUpdate method on all groups in the list
+		 * Calls the CallUpdate method on all groups in the list, and then on all entity worlds
 		 */
 		void CallUpdate();
 		
 		/**
-		 * Calls the CallRender method on all groups in the list
+		 * Calls the CallRender method on all groups in the list and then on all entity worlds, inside of a sprite batch, so that
+		 * the sprites drawn with SpriteBatch->Draw() are drawn sorted by layer and source image once everything has rendered
 		 */
 		void CallRender();
 		
@@ -90,6 +122,54 @@ namespace ENGINE
 		 */
 		unsigned int GetGroupCount();
 		
+		/**
+		 * Turns the parallel update of the groups on or off; the groups are updated one after another by default
+		 * @param parallelUpdate is true to update the groups that are not serial on the threads of the job system
+		 */
+		void SetParallelUpdate(bool parallelUpdate);
+		
+		/**
+		 * \return true if the groups that are not serial are updated on the threads of the job system
+		 */
+		bool IsParallelUpdate();
+		
+		/**
+		 * Records that the object being updated on the calling thread touched a shared variable, for the race detector.
+		 * Use the SharedStateRead() and SharedStateWrite() macros instead, which do nothing in builds with NDEBUG.
+		 * @param address is the address of the variable
+		 * @param name is the name of the variable for the warning
+		 * @param write is true if the variable was written to
+		 */
+		static void TouchSharedState(const void* address, const char* name, bool write);
+		
+		/**
+		 * Creates a new named entity world, which is updated and rendered after the groups
+		 * @param worldName is the name to assign to a new EntityWorld
+		 */
+		void CreateNamedWorld(const char* worldName);
+		
+		/**
+		 * Get an entity world by its name
+		 * @param worldName is the name of the world to get
+		 * \return a pointer to a named world or null if the world does not exist
+		 */
+		EntityWorld* GetNamedWorld(const char* worldName);
+		
+		/**
+		 * Gets the spatial hash that the objects of the groups register their boxes with.
+		 * CallUpdate() puts the boxes that moved into their new cells once every group has been updated.
+		 * \return a pointer to the spatial hash of the manager
+		 */
+		SpatialHash* GetSpatialHash();
+		
+		/**
+		 * Finds every object of one named group whose box in the spatial hash overlaps the box of an object of another
+		 * @param firstGroupName is the name of the group of the first object of every pair
+		 * @param secondGroupName is the name of the group of the second object of every pair, which may be the same group
+		 * @param pairs has the pairs added to the end of it
+		 */
+		void FindNamedPairs(const char* firstGroupName, const char* secondGroupName, std::vector<SpatialPair>& pairs);
+		
 		/**
 		 * Handles the creation of an instance of this class
 		 * \return a pointer to an allocated instance of the GameObjectGroupManager class
@@ -101,9 +181,24 @@ namespace ENGINE
 		 * @param managerInstance is a pointer to an allocated instance of the GameObjectGroupManager class
 		 */
 		static void Destroy(GameObjectGroupManager* managerInstance);
-		
+	
 	private:
 	
+		/**
+		 * Updates the groups on the threads of the job system
+		 */
+		void CallParallelUpdateInternal();
+		
+		/**
+		 * Logs the shared variables that the groups raced for during the last parallel update, and forgets the rest
+		 */
+		void ReportSharedStateInternal();
+		
+		/**
+		 * \return the name of a group, or its ID if it has no name
+		 */
+		std::string GetGroupNameInternal(GameObjectGroup* group);
+		
 		// a few type definitions to make the code easier to read
 		
 		//! an STL vector of pointers to the GameObjectGroup class
@@ -131,8 +226,49 @@ namespace ENGINE
 		 * they were added by name
 		 */
 		GameObjectGroupSTLMap names_;
+		
+		/**
+		 * \var worlds_
+		 * \brief Holds all the entity worlds, in the order that they were created
+		 */
+		std::vector<EntityWorld*> worlds_;
+		
+		/**
+		 * \var worldNames_
+		 * \brief maintains a name index for the entity worlds
+		 */
+		GameObjectGroupSTLMap worldNames_;
+		
+		/**
+		 * \var spatialHash_
+		 * \brief the spatial hash that the objects of the groups register their boxes with
+		 */
+		SpatialHash* spatialHash_;
+		
+		/**
+		 * \var parallelUpdate_
+		 * \brief true if the groups that are not serial are updated on the threads of the job system
+		 */
+		bool parallelUpdate_;
 	}; // end class
 
+#if !defined(NDEBUG)
+/**
+ * \def SharedStateRead
+ * \brief tells the race detector that the object being updated reads a variable that other objects may touch
+ */
+#define SharedStateRead(variable) ENGINE::GameObjectGroupManager::TouchSharedState(&(variable), #variable, false)
+
+/**
+ * \def SharedStateWrite
+ * \brief tells the race detector that the object being updated writes to a variable that other objects may touch
+ */
+#define SharedStateWrite(variable) ENGINE::GameObjectGroupManager::TouchSharedState(&(variable), #variable, true)
+#else
+#define SharedStateRead(variable)
+#define SharedStateWrite(variable)
+#endif
+
 } // end namespace
 #endif
 
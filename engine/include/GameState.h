@@ -21,6 +21,12 @@ namespace ENGINE
 	 * \brief The abstract class that serves as a base for all game states.
 	 * \ingroup SystemGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The main loop in MainSystemSingleton::Execute() runs the game logic at a fixed rate.
+	 * For every fixed step it calls GameState::Update(), and after the steps it calls GameState::Render() once.
+	 * A state that only implements GameState::Execute() has it called once per fixed step, and renders along with its logic.
+	 * A state that wants smooth movement at any frame rate overrides GameState::Update() for its logic and 
+	 * GameState::Render() for its drawing, and blends between the previous and the current positions using the interpolation value.
 	 */
 	class GameState
 	{
@@ -45,6 +51,27 @@ namespace ENGINE
 		 */
 		virtual void Execute() = 0;
 		
+		/**
+		 * Advances the game logic by a single fixed step.
+		 * By default this calls GameState::Execute()
+		 * @param stepSeconds is the length of the fixed step in seconds
+		 */
+		virtual void Update(float /* stepSeconds */) { Execute(); }
+		
+		/**
+		 * Draws the game state. By default this does nothing, because GameState::Execute() is expected to do its own drawing.
+		 * @param interpolation is how far between the last fixed step and the next fixed step the current time is, from 0.0 to 1.0
+		 */
+		virtual void Render(float /* interpolation */) {}
+		
+		/**
+		 * Draws the loading screen while the files that GameState::Initialize() asked the ENGINE::AssetLoaderSingleton for are loading.
+		 * This is called between GraphicsDeviceSingleton::BeginScene() and GraphicsDeviceSingleton::EndScene().
+		 * @param progress is how much of the loading is done, from 0.0 to 1.0
+		 * \return true if the state drew its own loading screen, or false to have a plain progress bar drawn. The default returns false.
+		 */
+		virtual bool RenderLoading(float /* progress */) { return false; }
+		
 		/**
 		 * Cleanup the game state
 		 */
@@ -16,15 +16,18 @@
 #define __GAMESTATEMANAGER_H__
 
 #include <vector>
-#include <map>
 #include <stack>
-#include <string>
+
+#include "NameDirectory.h"
 
 namespace ENGINE
 {
 	// forward declare the classes we need
 	class GameState;
 	
+	//! the longest time in milliseconds between redraws of the loading screen in GameStateManagerSingleton::InitializeStates()
+	const unsigned int GAMESTATE_LOADING_FRAME_TIME = 16;
+	
 	/**
 	 * \class GameStateManagerSingleton
 	 * \brief A class to manage the run-state of a game.
@@ -65,6 +68,18 @@ namespace ENGINE
 		 */
 		void ExecuteNextState();
 		
+		/**
+		 * Advances the state that is on the top of the game state stack by a single fixed step.
+		 * @param stepSeconds is the length of the fixed step in seconds
+		 */
+		void UpdateNextState(float stepSeconds);
+		
+		/**
+		 * Draws the state that is on the top of the game state stack.
+		 * @param interpolation is how far between the last fixed step and the next fixed step the current time is, from 0.0 to 1.0
+		 */
+		void RenderNextState(float interpolation);
+		
 		/**
 		 * Clears all states from the game state stack.
 		 */
@@ -81,6 +96,12 @@ namespace ENGINE
 		 */
 		void PushState(const char* stateName);
 		
+		/**
+		 * Pushes a new state on to the game state stack without hashing its name at run time, as in \c PushState("title"_id)
+		 * @param stateName is the ID of the name of the registered game state to push
+		 */
+		void PushState(NameID stateName);
+		
 		/**
 		 * Registers a game state. You need to do this for every state that you
 		 * will ever use. This will assign both a state ID, and name to a pointer
@@ -92,6 +113,8 @@ namespace ENGINE
 		
 		/**
 		 * Calls the Initialize method on all registered states.
+		 * After each state is initialized, the files that it asked the ENGINE::AssetLoaderSingleton for are loaded
+		 * while GameState::RenderLoading() shows the progress.
 		 */
 		void InitializeStates();
 		
@@ -128,6 +151,13 @@ namespace ENGINE
 		 */
 		GameState* GetStateFromID(unsigned int stateID);
 		
+		/**
+		 * Get the name that a state was registered with
+		 * @param state is a pointer to the registered state
+		 * \return the name of the state, or 0 if the state is not registered
+		 */
+		const char* GetStateName(GameState* state);
+		
 	private:
 	
 		/**
@@ -156,12 +186,6 @@ namespace ENGINE
 		//! an STL iterator to a vector of pointers to the GameState class
 		typedef std::vector<GameState*>::iterator GameStateSTLVectorIterator;
 		
-		//! an STL map for keeping a lookup index
-		typedef std::map<std::string, unsigned int> GameStateSTLMap;
-		
-		//! an STL iterator for the lookup index
-		typedef std::map<std::string, unsigned int>::iterator GameStateSTLMapIterator; 
-		
 		/**
 		 * \var stateStack_
 		 * \brief holds the current state stack
@@ -178,7 +202,14 @@ namespace ENGINE
 		 * \var names_
 		 * \brief maintains the name index lookup for the available game states
 		 */
-		GameStateSTLMap names_;
+		NameDirectory names_;
+		
+		/**
+		 * \var stateNames_
+		 * \brief the name of each registered state, in the same order as GameStateManagerSingleton::stateRegistry_. 
+		 * The names point at the text that GameStateManagerSingleton::names_ interned
+		 */
+		std::vector<const char*> stateNames_;
 	}; // end class
 
 /**
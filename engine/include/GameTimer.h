@@ -15,27 +15,29 @@
 #ifndef __GAMETIMER_H__
 #define __GAMETIMER_H__
 
-/**
- * \def GameTimerMethodReturnType
- * \brief depending on the OS that the code is being compiled for, this will be either a linux data structure or a simple integer
- */
-// only non-windows platforms use this
-#if !defined(WIN32)
-#define GameTimerMethodReturnType time_t
-
-//! we define the __time_t data type so we don't need to include the linux time headers in our header
-typedef long int __time_t;
-//! we define the time_t data type so we don't need to include the linux time headers in our header
-typedef __time_t time_t;
-//! we declare the timeval data type as a struct so we don't need to include the linux time headers in our header
-struct timeval;
-#else
-// this is for the windows platform
-#define GameTimerMethodReturnType DWORD
-#endif
-
 namespace ENGINE
 {
+	/**
+	 * \typedef GameTimerTicks
+	 * \brief a 64-bit count of nanoseconds
+	 */
+	typedef long long GameTimerTicks;
+	
+	/**
+	 * \def GameTimerMethodReturnType
+	 * \brief the type returned by the GameTimerSingleton time functions
+	 */
+	#define GameTimerMethodReturnType GameTimerTicks
+	
+	//! the number of timer ticks in one second
+	const GameTimerTicks GAMETIMER_TICKS_PER_SECOND = 1000000000LL;
+	
+	//! the number of timer ticks in one millisecond
+	const GameTimerTicks GAMETIMER_TICKS_PER_MILLISECOND = 1000000LL;
+	
+	//! the number of timer ticks in one microsecond
+	const GameTimerTicks GAMETIMER_TICKS_PER_MICROSECOND = 1000LL;
+	
 	/**
 	 * \class GameTimerSingleton
 	 * \brief A cross-platform compatible class for handling proper game timing
@@ -45,11 +47,19 @@ namespace ENGINE
 	 * This is a high-resolution timer that wraps up the tricky code needed to
 	 * implement proper timing in your games. And it is cross-platform as well!
 	 *
+	 * The time is read from a monotonic clock, so it never jumps backwards when the system clock is changed.
+	 * On Linux this is clock_gettime(CLOCK_MONOTONIC), and on Windows it is QueryPerformanceCounter().
+	 * All times are measured from when the timer was created, in 64-bit nanosecond ticks.
+	 *
 	 * The GameTimerSingleton is clearly implemented as a singleton class.
 	 * Which means that there is only ever a single instance of the class at all times.
 	 * You access the methods by using the macro "GameTimer" and a pointer.
 	 *
-	 * such as: time_t ms = GameTimer->GetMilliseconds();
+	 * such as: GameTimerTicks ms = GameTimer->GetMilliseconds();
+	 *
+	 * The main loop calls GameTimerSingleton::BeginFrame() once per frame, and anything can then read 
+	 * the length of the previous frame with GameTimerSingleton::GetFrameDelta().
+	 * To time a piece of code use a GameStopwatch or a GameScopedStopwatch.
 	 */
 	class GameTimerSingleton
 	{
@@ -67,24 +77,62 @@ namespace ENGINE
 		~GameTimerSingleton();
 		
 		/**
-		 * Get the number of microseconds passed since the last call.\n
-		 * There are approximately 1000 microseconds in 1 millisecond.
-		 * \return the number of microseconds passed since the last call.
+		 * \return the number of nanoseconds passed since the timer was created.
+		 */
+		GameTimerTicks GetTicks();
+		
+		/**
+		 * Get the number of microseconds passed since the timer was created.\n
+		 * There are 1000 microseconds in 1 millisecond.
+		 * \return the number of microseconds passed since the timer was created.
 		 */
 		GameTimerMethodReturnType GetMicroseconds();
 		
 		/**
-		 * Get the number of milliseconds passed since the last call.\n
-		 * There are approximately 1000 milliseconds in 1 second.
-		 * \return the number of milliseconds passed since the last call.
+		 * Get the number of milliseconds passed since the timer was created.\n
+		 * There are 1000 milliseconds in 1 second.
+		 * \return the number of milliseconds passed since the timer was created.
 		 */
 		GameTimerMethodReturnType GetMilliseconds();
 		
 		/**
-		 * \return the number of seconds passed since the last call.
+		 * \return the number of seconds passed since the timer was created.
 		 */
 		GameTimerMethodReturnType GetSeconds();
 		
+		/**
+		 * Marks the start of a new frame, and measures the length of the frame that just ended.
+		 * Called once per frame by the main loop.
+		 */
+		void BeginFrame();
+		
+		/**
+		 * \return the time that the current frame started at, in nanoseconds since the timer was created
+		 */
+		GameTimerTicks GetFrameStartTime();
+		
+		/**
+		 * \return the length of the previous frame in nanoseconds
+		 */
+		GameTimerTicks GetFrameDelta();
+		
+		/**
+		 * \return the length of the previous frame in seconds
+		 */
+		float GetFrameDeltaSeconds();
+		
+		/**
+		 * \return the number of frames that have been started
+		 */
+		unsigned int GetFrameCount();
+		
+		/**
+		 * Converts a number of ticks to seconds
+		 * @param ticks is the number of ticks
+		 * \return the number of seconds
+		 */
+		static float TicksToSeconds(GameTimerTicks ticks);
+		
 	private:
 		// private members should be declared here
 		/**
@@ -102,26 +150,139 @@ namespace ENGINE
 		 */
 		GameTimerSingleton& operator=(const GameTimerSingleton& rhs);
 		
+		/**
+		 * \return the raw value of the monotonic clock in nanoseconds
+		 */
+		GameTimerTicks ReadClock();
+		
 		/**
 		 * \var startTime_ 
-		 * \brief the time when the timer was created.
-		 */
-		 
-		/**
-		 * \var currentTime_ 
-		 * \brief the current time of the timer.
-		 */
-		 
-// only non-windows platforms use this
-#if !defined(WIN32)
-		timeval* startTime_;
-		timeval* currentTime_;
-#else
-// this is for the windows platform
-		unsigned long long startTime_;
-		unsigned long long currentTime_;
+		 * \brief the raw clock value when the timer was created.
+		 */
+		GameTimerTicks startTime_;
+		
+		/**
+		 * \var frameStartTime_ 
+		 * \brief the time that the current frame started at.
+		 */
+		GameTimerTicks frameStartTime_;
+		
+		/**
+		 * \var frameDelta_ 
+		 * \brief the length of the previous frame.
+		 */
+		GameTimerTicks frameDelta_;
+		
+		/**
+		 * \var frameCount_ 
+		 * \brief the number of frames that have been started.
+		 */
+		unsigned int frameCount_;
+		
+// only windows uses this
+#if defined(WIN32)
+		/**
+		 * \var frequency_ 
+		 * \brief the number of performance counter counts per second.
+		 */
+		GameTimerTicks frequency_;
 #endif
 	}; // end class
+	
+	/**
+	 * \class GameStopwatch
+	 * \brief Measures the time passed since it was started
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * \code
+	 * GameStopwatch stopwatch;
+	 * DoSomethingSlow();
+	 * LogMessage("DoSomethingSlow took %f seconds", stopwatch.GetElapsedSeconds());
+	 * \endcode
+	 */
+	class GameStopwatch
+	{
+	public:
+		/**
+		 * constructor starts the stopwatch
+		 */
+		GameStopwatch();
+		
+		/**
+		 * starts the stopwatch again from zero
+		 */
+		void Restart();
+		
+		/**
+		 * \return the number of nanoseconds passed since the stopwatch was started
+		 */
+		GameTimerTicks GetElapsedTicks();
+		
+		/**
+		 * \return the number of seconds passed since the stopwatch was started
+		 */
+		float GetElapsedSeconds();
+		
+	private:
+		/**
+		 * \var startTime_ 
+		 * \brief the time when the stopwatch was started
+		 */
+		GameTimerTicks startTime_;
+	}; // end class
+	
+	/**
+	 * \class GameScopedStopwatch
+	 * \brief Adds the time between its creation and its destruction to a tick counter
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * \code
+	 * GameTimerTicks physicsTime = 0;
+	 * {
+	 * 	GameScopedStopwatch stopwatch(physicsTime);
+	 * 	UpdatePhysics();
+	 * }
+	 * \endcode
+	 */
+	class GameScopedStopwatch
+	{
+	public:
+		/**
+		 * constructor starts the stopwatch
+		 * @param total is the tick counter that the elapsed time is added to
+		 */
+		GameScopedStopwatch(GameTimerTicks& total);
+		
+		/**
+		 * destructor adds the elapsed time to the tick counter
+		 */
+		~GameScopedStopwatch();
+		
+	private:
+		/**
+		 * The copy constructor is hidden
+		 */
+		GameScopedStopwatch(const GameScopedStopwatch& rhs);
+		
+		/**
+		 * The assignment operator is hidden
+		 */
+		GameScopedStopwatch& operator=(const GameScopedStopwatch& rhs);
+		
+		/**
+		 * \var total_ 
+		 * \brief the tick counter that the elapsed time is added to
+		 */
+		GameTimerTicks& total_;
+		
+		/**
+		 * \var startTime_ 
+		 * \brief the time when the stopwatch was started
+		 */
+		GameTimerTicks startTime_;
+	}; // end class
 
 /**
  * \def GameTimer
@@ -132,3 +293,4 @@ namespace ENGINE
 #endif
 
 
+
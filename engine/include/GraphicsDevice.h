@@ -19,6 +19,7 @@ namespace ENGINE
 {
 	// forward declare the classes we need to use
 	class ImageResource;
+	class DirtyRectList;
 	
 	/**
 	 * \enum GraphicsDeviceDisplayMode
@@ -75,6 +76,12 @@ namespace ENGINE
 	 * you call the GraphicsDeviceSingleton::GetSecondaryDisplayBuffer() function to get a pointer to the
 	 * secondary display buffer, and you do all your drawing of your scene onto this, then you use the 
 	 * GraphicsDeviceSingleton::EndScene() function to copy the contents of the scene to the visible screen so that your scene is shown to the user.
+	 * \n\n
+	 * When only small parts of the scene change from frame to frame, turn on the dirty rectangle mode with 
+	 * GraphicsDeviceSingleton::SetDirtyRectMode(). In this mode GraphicsDeviceSingleton::BeginScene() no longer clears the 
+	 * secondary display buffer, every drawing function of ENGINE::ImageResource that draws onto the secondary display buffer
+	 * records the region that it touched, and GraphicsDeviceSingleton::EndScene() only copies those regions to the screen.
+	 * Use GraphicsDeviceSingleton::MarkDirty() for regions changed in any other way.
 	 */
 	class GraphicsDeviceSingleton
 	{
@@ -93,9 +100,53 @@ namespace ENGINE
 		
 		/**
 		 * Flips the secondary display buffer to the primary display buffer so that the user can see the scene.
+		 * In dirty rectangle mode only the changed regions are copied.
+		 * The profiler overlay is drawn onto the scene first when it is visible.
 		 */
 		void EndScene();
 		
+		/**
+		 * Does what GraphicsDeviceSingleton::EndScene() does, without the profiler overlay and without measuring it.
+		 * The profiler only works on the main thread, so the render thread of ENGINE::RenderQueueSingleton uses this.
+		 */
+		void PresentScene();
+		
+		/**
+		 * Turns the dirty rectangle mode on or off. Turning the mode on marks the whole display as changed.
+		 * In dirty rectangle mode the secondary display buffer keeps the previous scene, so only the parts that change need to be drawn.
+		 * @param enabled is true to only copy the changed regions of the scene in GraphicsDeviceSingleton::EndScene()
+		 */
+		void SetDirtyRectMode(bool enabled);
+		
+		/**
+		 * \return true if the dirty rectangle mode is on
+		 */
+		bool IsDirtyRectMode();
+		
+		/**
+		 * Marks a region of the secondary display buffer as changed. Does nothing when the dirty rectangle mode is off.
+		 * @param x is the X coordinate of the upper-left corner of the region
+		 * @param y is the Y coordinate of the upper-left corner of the region
+		 * @param width is the width of the region in pixels
+		 * @param height is the height of the region in pixels
+		 */
+		void MarkDirty(int x, int y, int width, int height);
+		
+		/**
+		 * Marks the whole secondary display buffer as changed. Does nothing when the dirty rectangle mode is off.
+		 */
+		void MarkAllDirty();
+		
+		/**
+		 * \return the number of pixels that the last call to GraphicsDeviceSingleton::EndScene() copied to the screen
+		 */
+		unsigned int GetPixelsTransferred();
+		
+		/**
+		 * \return the number of rectangles that the last call to GraphicsDeviceSingleton::EndScene() copied to the screen
+		 */
+		unsigned int GetRectsTransferred();
+		
 		/**
 		 * Attempts to set the display mode to either fullscreen or windowed modes.
 		 * This function requires that the display resolution and color depth have already been set.
@@ -229,6 +280,24 @@ namespace ENGINE
 		 * \brief the color depth of the display
 		 */
 		GraphicsDeviceDisplayDepth displayBitsPerPixel_;
+		
+		/**
+		 * \var dirtyRects_
+		 * \brief the changed regions of the secondary display buffer, or 0 if the dirty rectangle mode is off
+		 */
+		DirtyRectList* dirtyRects_;
+		
+		/**
+		 * \var pixelsTransferred_
+		 * \brief the number of pixels that the last call to GraphicsDeviceSingleton::EndScene() copied to the screen
+		 */
+		unsigned int pixelsTransferred_;
+		
+		/**
+		 * \var rectsTransferred_
+		 * \brief the number of rectangles that the last call to GraphicsDeviceSingleton::EndScene() copied to the screen
+		 */
+		unsigned int rectsTransferred_;
 	}; // end class
 
 /**
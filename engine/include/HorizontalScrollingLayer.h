@@ -70,6 +70,11 @@ namespace ENGINE
 		 */
 		virtual void Render(ImageResource* target);
 		
+		/**
+		 * Records the same drawing as Render() with the render queue
+		 */
+		virtual void QueueRender();
+		
 		/**
 		 * De-allocates the data for the layer
 		 */
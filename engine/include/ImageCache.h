@@ -0,0 +1,260 @@
+
+// CODESTYLE: v2.0
+
+// ImageCache.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Shares the images loaded from files, so that each file is only loaded once
+
+#ifndef __IMAGECACHE_H__
+#define __IMAGECACHE_H__
+
+/**
+ * \file ImageCache.h
+ * \brief Image Cache Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#include <map>
+#include <string>
+
+#include "Threading.h"
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	class ImageResource;
+	
+	/**
+	 * \struct ImageCacheEntry
+	 * \brief a single image held by the image cache
+	 * \ingroup GraphicsGroup
+	 */
+	struct ImageCacheEntry
+	{
+		//! the image
+		ImageResource* image;
+		//! the key that the image is found by; the canonical path of the file, followed by the source rectangle if there is one
+		std::string key;
+		//! the number of holders that have not released the image yet
+		int references;
+		//! the size of the pixels of the image in bytes
+		unsigned int bytes;
+		//! when the image was last acquired; larger values are more recent
+		unsigned int lastUsed;
+	};
+	
+	/**
+	 * \class ImageCacheSingleton
+	 * \brief Shares the images loaded from files, so that each file is only loaded once
+	 * \ingroup GraphicsGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * ImageCacheSingleton::Acquire() returns the image of a file, loading it only if no one has acquired it before.
+	 * Every holder of the image gets the same ImageResource, and every call to ImageCacheSingleton::Acquire() must be
+	 * matched by a call to ImageCacheSingleton::Release() instead of deleting the image.
+	 * Because the image is shared, nothing should be drawn onto it.\n
+	 * Images that are no longer held stay in the cache, so that loading the same file again costs nothing,
+	 * until ImageCacheSingleton::Purge() or ImageCacheSingleton::Trim() removes them.\n
+	 * Part of a file, such as a single tile of a spritesheet, may be acquired as well. The whole file is loaded
+	 * into the cache once, and the part is copied out of it.\n
+	 * The files are found by their canonical path, so "data/./water.png" and "data\\water.png" are the same file.\n
+	 * There is a MACRO defined called ImageCache that is just an alias to calling the
+	 * ImageCacheSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 * \code
+	 * ImageResource* water = ImageCache->Acquire("data/water.png");
+	 * ...
+	 * ImageCache->Release(water);
+	 * \endcode
+	 */
+	class ImageCacheSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the image cache singleton class instance
+		 */
+		static ImageCacheSingleton* GetInstance();
+		
+		/**
+		 * Gets the image of a file, loading it if it is not in the cache
+		 * @param fileName is the name of the file that holds the image
+		 * \return a pointer to the shared image, or 0 if the file could not be loaded
+		 */
+		ImageResource* Acquire(const char* fileName);
+		
+		/**
+		 * Gets a part of the image of a file, loading the file if it is not in the cache
+		 * @param fileName is the name of the file that holds the image
+		 * @param sourceX is the X coordinate of the upper-left corner of the part in the file
+		 * @param sourceY is the Y coordinate of the upper-left corner of the part in the file
+		 * @param width is the width of the part in pixels
+		 * @param height is the height of the part in pixels
+		 * \return a pointer to the shared image, or 0 if the file could not be loaded
+		 */
+		ImageResource* Acquire(const char* fileName, int sourceX, int sourceY, int width, int height);
+		
+		/**
+		 * Adds an image that was loaded some other way, such as by the ENGINE::AssetLoaderSingleton, as the image of a file.
+		 * The caller holds one reference to it, as if it had been acquired.
+		 * If the file is already in the cache, the given image is deleted and the cached image is returned instead.
+		 * @param fileName is the name of the file that the image was loaded from
+		 * @param image is the loaded image; the cache takes it over
+		 * \return a pointer to the shared image
+		 */
+		ImageResource* Add(const char* fileName, ImageResource* image);
+		
+		/**
+		 * Gives back an image that was acquired from the cache. The image stays in the cache.
+		 * Passing an image that did not come from the cache does nothing, so owners of images that may or may
+		 * not have come from the cache can use: if (!ImageCache->Release(image)) { delete image; }
+		 * @param image is the image to give back
+		 * \return true if the image came from the cache, false if it did not
+		 */
+		bool Release(ImageResource* image);
+		
+		/**
+		 * \return true if the image came from the cache
+		 */
+		bool IsCached(ImageResource* image);
+		
+		/**
+		 * Deletes every image that is no longer held
+		 * \return the number of images that were deleted
+		 */
+		unsigned int Purge();
+		
+		/**
+		 * Deletes the images that are no longer held, the least recently used first, until the cache is no larger than a given size.
+		 * Images that are still held are never deleted, so the cache may stay larger than the size.
+		 * @param maxBytes is the size in bytes that the cache should be trimmed down to
+		 * \return the number of images that were deleted
+		 */
+		unsigned int Trim(unsigned int maxBytes);
+		
+		/**
+		 * \return the number of images in the cache
+		 */
+		unsigned int GetImageCount();
+		
+		/**
+		 * \return the size of the pixels of every image in the cache in bytes
+		 */
+		unsigned int GetByteCount();
+		
+		/**
+		 * \return the number of times that ImageCacheSingleton::Acquire() found the image in the cache; acquiring a part of a
+		 * file counts once, for the part
+		 */
+		unsigned int GetHitCount();
+		
+		/**
+		 * \return the number of times that ImageCacheSingleton::Acquire() had to load the image
+		 */
+		unsigned int GetMissCount();
+		
+		/**
+		 * Sets the hit and miss counts back to zero
+		 */
+		void ResetCounters();
+		
+		/**
+		 * deletes every image in the cache
+		 */
+		~ImageCacheSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		ImageCacheSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		ImageCacheSingleton(const ImageCacheSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const ImageCacheSingleton& operator=(const ImageCacheSingleton& rhs);
+		
+		/**
+		 * Gets the image of a whole file by its key, loading it if it is not in the cache
+		 * @param key is the canonical name of the file
+		 * @param counted is true if the lookup counts as a hit or a miss
+		 * \return the image, or 0 if the file could not be loaded
+		 */
+		ImageResource* AcquireFileInternal(const std::string& key, bool counted);
+		
+		/**
+		 * Looks an image up by its key, and takes a reference to it if it is found
+		 * @param key is the key of the image
+		 * @param counted is true if the lookup counts as a hit or a miss
+		 * \return the image, or 0 if it is not in the cache
+		 */
+		ImageResource* Find(const std::string& key, bool counted);
+		
+		/**
+		 * Adds a newly loaded image to the cache with one reference.
+		 * If another thread added the same key while the image was loading, the new image is deleted and the other one is used.
+		 * \return the image that is in the cache
+		 */
+		ImageResource* Insert(const std::string& key, ImageResource* image);
+		
+		/**
+		 * Deletes an image that is no longer held
+		 */
+		void Remove(ImageCacheEntry* entry);
+		
+		/**
+		 * \var entries_
+		 * \brief the images in the cache by key
+		 */
+		std::map<std::string, ImageCacheEntry*> entries_;
+		
+		/**
+		 * \var images_
+		 * \brief the images in the cache by pointer, to find them again when they are released
+		 */
+		std::map<ImageResource*, ImageCacheEntry*> images_;
+		
+		/**
+		 * \var mutex_
+		 * \brief held while the cache is looked at or changed; it is not held while a file loads
+		 */
+		Mutex mutex_;
+		
+		/**
+		 * \var byteCount_
+		 * \brief the size of the pixels of every image in the cache in bytes
+		 */
+		unsigned int byteCount_;
+		
+		/**
+		 * \var hitCount_
+		 * \brief the number of times that an image was found in the cache
+		 */
+		unsigned int hitCount_;
+		
+		/**
+		 * \var missCount_
+		 * \brief the number of times that an image had to be loaded
+		 */
+		unsigned int missCount_;
+		
+		/**
+		 * \var useCounter_
+		 * \brief counts up every time an image is acquired, to order the images by when they were last used
+		 */
+		unsigned int useCounter_;
+	}; // end class
+
+/**
+ * \def ImageCache
+ * \brief an alias for the ImageCacheSingleton::GetInstance() function to make your code clean.
+ */
+#define ImageCache ImageCacheSingleton::GetInstance()
+} // end namespace
+#endif
+
+
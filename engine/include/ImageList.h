@@ -75,7 +75,8 @@ namespace ENGINE
 		void Add(ImageResource* image);
 		
 		/**
-		 * Add an image to the list by filename
+		 * Add an image to the list by filename. The image is loaded through the ENGINE::ImageCacheSingleton, so
+		 * it is shared with every other list that adds the same file, and nothing should be drawn onto it.
 		 * @param fileName is the name of the file that holds the image data to load
 		 */
 		bool Add(const char* fileName);
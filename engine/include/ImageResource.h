@@ -19,6 +19,26 @@ struct BITMAP;
 
 namespace ENGINE
 {
+	// forward declare the classes we need
+	class DirtyRectList;
+	
+	/**
+	 * \struct ImagePixelData
+	 * \brief the pixels of an image file after decoding, before they are turned into an Allegro BITMAP
+	 * \ingroup GraphicsGroup
+	 */
+	struct ImagePixelData
+	{
+		//! the width of the image in pixels
+		int width;
+		//! the height of the image in pixels
+		int height;
+		//! 8 for palette images, 24 for RGB images, or 32 for RGBA images
+		int bitsPerPixel;
+		//! the rows of the image one after another, in RGB or RGBA order; allocated with new [], and deleted by the owner of the data
+		unsigned char* pixels;
+	};
+	
 	/**
 	 * \class ImageResource
 	 * \brief A class for loading, saving, manipulating, and rendering non-animated bitmap images
@@ -90,8 +110,28 @@ namespace ENGINE
 		 */
 		void Create(BITMAP* source);
 		
+		/**
+		 * Create a new image from decoded pixels, converting them to the color depth of the screen.
+		 * This must be called from the main thread.
+		 * @param pixels is the decoded image, such as from ImageResource::DecodePNG(). The pixels are not deleted.
+		 * \return true on success, false on failure
+		 */
+		bool Create(const ImagePixelData& pixels);
+		
+		/**
+		 * Decodes a PNG file into memory without using Allegro, so it may be called from any thread.
+		 * A file that the packer decoded ahead of time is copied out of its archive instead.
+		 * Pass the result to ImageResource::Create() on the main thread to make an image of it.
+		 * @param fileName is the name of the PNG file
+		 * @param pixels is filled in with the decoded image. The caller must delete [] pixels.pixels.
+		 * \return true on success, false if the file could not be read
+		 */
+		static bool DecodePNG(const char* fileName, ImagePixelData& pixels);
+		
 		/**
 		 * Loads an image from a file.
+		 * PNG files are read through the ENGINE::VirtualFileSystemSingleton, so they may come from a mounted archive.
+		 * Other formats are loaded by Allegro, and must be loose files.
 		 * @param fileName is the name of the file that holds the image to be loaded.
 		 */
 		bool Load(const char* fileName);
@@ -107,6 +147,42 @@ namespace ENGINE
 		 */
 		bool Load(const char* fileName, int sourceX, int sourceY, int width, int height);
 		
+		// raw cache
+		
+		/**
+		 * Turns the raw cache on or off. It is off by default, and the --raw-cache command line option turns it on.\n
+		 * When a loose PNG file is loaded whole, the converted rows of the image are saved next to it in a raw cache file,
+		 * named like the PNG file with ".gedraw" added. Later loads read the rows straight into the bitmap, without
+		 * running the PNG decoder. The cache is only used while the size and modification time of the PNG file,
+		 * and the color depth and pixel format of the screen, are the same as when it was saved.
+		 * @param enabled is true to use and save raw cache files
+		 */
+		static void SetRawCacheEnabled(bool enabled);
+		
+		/**
+		 * \return true if raw cache files are used and saved
+		 */
+		static bool IsRawCacheEnabled();
+		
+		/**
+		 * Checks for a raw cache file that can be loaded instead of a PNG file. This does not use Allegro, so it may be called from any thread.
+		 * @param fileName is the name of the PNG file
+		 * \return true if the raw cache is on, and the file has a raw cache that is up to date
+		 */
+		static bool IsRawCacheCurrent(const char* fileName);
+		
+		/**
+		 * Saves the image as the raw cache of a PNG file
+		 * @param fileName is the name of the PNG file that the image was loaded from
+		 * \return true if the raw cache file was saved
+		 */
+		bool SaveRawCache(const char* fileName);
+		
+		/**
+		 * Reports the number of raw cache hits and misses of loose PNG files, and the size of the pixels that did not have to be decoded, to the debug log
+		 */
+		static void ReportRawCacheStatistics();
+		
 		// blitting
 		
 		/**
@@ -280,6 +356,7 @@ namespace ENGINE
 		/**
 		 * Draws a rectangle filled with a linear interpolated gradient from 4 colored corners.
 		 * This should not be used in a real-time loop, but rather to generate gradients to be stored and used later.
+		 * 16 and 32 bit images are filled a row at a time with the span kernels of ENGINE::PixelKernelsSingleton.
 		 * @param x1 is the X coordinate of the upper-left corner point in pixels.
 		 * @param y1 is the Y coordinate of the upper-left point in pixels.
 		 * @param x2 is the X coordinate of the lower-right point in pixels.
@@ -359,6 +436,29 @@ namespace ENGINE
 		 */
 		void Clear(int color = 0);
 		
+		/**
+		 * Sets the clipping rectangle of the image. Nothing will be drawn onto the image outside of this rectangle.
+		 * @param x1 is the X coordinate of the upper-left corner of the clipping rectangle in pixels.
+		 * @param y1 is the Y coordinate of the upper-left corner of the clipping rectangle in pixels.
+		 * @param x2 is the X coordinate of the lower-right corner of the clipping rectangle in pixels.
+		 * @param y2 is the Y coordinate of the lower-right corner of the clipping rectangle in pixels.
+		 */
+		void SetClipRect(int x1, int y1, int x2, int y2);
+		
+		/**
+		 * Gets the clipping rectangle of the image.
+		 * @param x1 receives the X coordinate of the upper-left corner of the clipping rectangle in pixels.
+		 * @param y1 receives the Y coordinate of the upper-left corner of the clipping rectangle in pixels.
+		 * @param x2 receives the X coordinate of the lower-right corner of the clipping rectangle in pixels.
+		 * @param y2 receives the Y coordinate of the lower-right corner of the clipping rectangle in pixels.
+		 */
+		void GetClipRect(int& x1, int& y1, int& x2, int& y2);
+		
+		/**
+		 * Resets the clipping rectangle of the image to cover the entire image.
+		 */
+		void ResetClipRect();
+		
 		/**
 		 * Saves the image to a windows BMP file.
 		 * @param fileName is the name of the file to save the image to.
@@ -382,6 +482,34 @@ namespace ENGINE
 		 */
 		int GetHeight();
 		
+		/**
+		 * \return the color depth of the image in bits per pixel
+		 */
+		int GetColorDepth();
+		
+		/**
+		 * Sets the list that records the regions of the image that are drawn on.
+		 * Every drawing function adds the region it touches to the list. The image does not own the list.
+		 * @param dirtyRects is the list to record into, or 0 to stop recording
+		 */
+		void SetDirtyRectList(DirtyRectList* dirtyRects);
+		
+		/**
+		 * \return the list that records the regions of the image that are drawn on, or 0 if nothing is being recorded
+		 */
+		DirtyRectList* GetDirtyRectList();
+		
+		/**
+		 * Records that a region of the image has changed, when a dirty rectangle list has been set.
+		 * The region is clipped to the clipping rectangle of the image.
+		 * Call this after writing to the pixels of the image without going through the drawing functions.
+		 * @param x is the X coordinate of the upper-left corner of the region
+		 * @param y is the Y coordinate of the upper-left corner of the region
+		 * @param width is the width of the region in pixels
+		 * @param height is the height of the region in pixels
+		 */
+		void MarkDirty(int x, int y, int width, int height);
+		
 	private:
 	
 		/**
@@ -402,16 +530,75 @@ namespace ENGINE
 		/**
 		 * Loads an image using the Allegro load_bitmap function.
 		 * Can load from BMP, PCX, TGA.
+		 * Only loose files can be loaded, because Allegro opens the file itself.
 		 * \return a pointer to an Allegro BITMAP containing the loaded image data.
 		 */
 		BITMAP* LoadBitmapInternal(const char* fileName);
 		
+		/**
+		 * Loads the image from the raw cache of a PNG file
+		 * @param fileName is the name of the PNG file
+		 * \return true if the raw cache was up to date and was loaded, false if the PNG file has to be decoded
+		 */
+		bool LoadRawCacheInternal(const char* fileName);
+		
 		/**
 		 * Loads an image using a custom PNG loader.
-		 * Can load from PNG.
+		 * The rows are converted to the color depth of the screen as they are decoded, so no second copy of the image is made.
+		 * When a rectangle is given, only its rows are converted, and the rows below it are never decoded.
+		 * @param fileName is the name of the PNG file
+		 * @param sourceX is the X coordinate of the upper-left corner of the rectangle to load
+		 * @param sourceY is the Y coordinate of the upper-left corner of the rectangle to load
+		 * @param width is the width of the rectangle, or 0 to load the whole image
+		 * @param height is the height of the rectangle, or 0 to load the whole image
 		 * \return a pointer to an Allegro BITMAP containing the loaded image data.
 		 */
-		BITMAP* LoadPNGInternal(const char* fileName);
+		BITMAP* LoadPNGInternal(const char* fileName, int sourceX, int sourceY, int width, int height);
+		
+		/**
+		 * Reads a PNG file, either into memory as ImagePixelData, or into a new Allegro BITMAP at the color depth of the screen.
+		 * @param fileName is the name of the PNG file
+		 * @param pixels is filled in with the whole decoded image, or is 0 to read into a bitmap instead
+		 * @param bitmap is set to the new bitmap when pixels is 0
+		 * @param sourceX is the X coordinate of the upper-left corner of the rectangle to read into the bitmap
+		 * @param sourceY is the Y coordinate of the upper-left corner of the rectangle to read into the bitmap
+		 * @param width is the width of the rectangle, or 0 to read the whole image into the bitmap
+		 * @param height is the height of the rectangle, or 0 to read the whole image into the bitmap
+		 * \return true on success, false if the file could not be read
+		 */
+		static bool ReadPNGInternal(
+			const char* fileName, 
+			ImagePixelData* pixels, 
+			BITMAP** bitmap, 
+			int sourceX, 
+			int sourceY, 
+			int width, 
+			int height);
+		
+		/**
+		 * Converts decoded pixels into the image, which has already been created
+		 * @param pixels is the decoded image
+		 * @param sourceX is the X coordinate in the decoded image of the upper-left corner of the image
+		 * @param sourceY is the Y coordinate in the decoded image of the upper-left corner of the image
+		 */
+		void CopyPixelsInternal(const ImagePixelData& pixels, int sourceX, int sourceY);
+		
+		/**
+		 * Converts a row of decoded pixels to the color depth of a bitmap and writes it into the bitmap
+		 * @param destination is the bitmap to write to
+		 * @param destX is the X coordinate of the first pixel to write
+		 * @param destY is the row to write
+		 * @param source is the first decoded pixel to convert
+		 * @param sourceBitsPerPixel is 8, 24 or 32; see ImagePixelData
+		 * @param count is the number of pixels to convert
+		 */
+		static void ConvertRowInternal(
+			BITMAP* destination, 
+			int destX, 
+			int destY, 
+			const unsigned char* source, 
+			int sourceBitsPerPixel, 
+			int count);
 		
 		/**
 		 * \var allegroBitmap_
@@ -430,6 +617,12 @@ typedef struct BITMAPtag
 		 * All the values of this structure should be regarded as read-only, with the exception of the line field.
 		 */
 		BITMAP* allegroBitmap_;
+		
+		/**
+		 * \var dirtyRects_
+		 * \brief the list that records the regions of the image that are drawn on, or 0 if nothing is being recorded
+		 */
+		DirtyRectList* dirtyRects_;
 	}; // end class
 
 } // end namespace
@@ -0,0 +1,341 @@
+// CODESTYLE: v2.0
+
+// JobSystem.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Runs small jobs on a worker thread per processor, with work stealing
+
+#ifndef __JOBSYSTEM_H__
+#define __JOBSYSTEM_H__
+
+/**
+ * \file JobSystem.h
+ * \brief Job System Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#include <vector>
+
+#include "Threading.h"
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	class JobSystemSingleton;
+	struct Job;
+	
+	//! the most jobs that can be created before the oldest one is used again; a power of two
+	const int JOB_SYSTEM_MAX_JOBS = 4096;
+	
+	//! the most parts that JobSystemSingleton::ParallelFor() splits a range into; larger ranges are given a larger grain
+	const int JOB_SYSTEM_MAX_PARALLEL_FOR_PARTS = JOB_SYSTEM_MAX_JOBS / 16;
+	
+	//! the most threads that the job system runs jobs on, counting the main thread
+	const int JOB_SYSTEM_MAX_THREADS = 64;
+	
+	/**
+	 * \typedef JobFunction
+	 * \brief the function that a job runs. It can create child jobs of \a job, which the job is not finished without
+	 */
+	typedef void (*JobFunction)(Job* job, void* data);
+	
+	/**
+	 * \typedef ParallelForFunction
+	 * \brief the function that JobSystemSingleton::ParallelFor() calls for every part of the range, from \a begin to one before \a end
+	 */
+	typedef void (*ParallelForFunction)(int begin, int end, void* data);
+	
+	/**
+	 * \struct Job
+	 * \brief a function to run on any thread of the job system
+	 * \ingroup SystemGroup
+	 */
+	struct Job
+	{
+		//! the function to run
+		JobFunction function;
+		//! passed to the function
+		void* data;
+		//! the job that is not finished until this one is, or 0
+		Job* parent;
+		//! one for the job itself, plus one for every child job that is not finished yet
+		volatile int unfinished;
+		//! the first index of the range of a JobSystemSingleton::ParallelFor() job
+		int begin;
+		//! one past the last index of the range of a JobSystemSingleton::ParallelFor() job
+		int end;
+	};
+	
+	/**
+	 * \class JobQueue
+	 * \brief The jobs that one thread has been given. The thread takes the newest job, and other threads steal the oldest.
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class JobQueue
+	{
+	public:
+		/**
+		 * creates an empty queue
+		 */
+		JobQueue();
+		
+		/**
+		 * destructor
+		 */
+		~JobQueue();
+		
+		/**
+		 * Adds a job at the back of the queue
+		 */
+		void Push(Job* job);
+		
+		/**
+		 * Takes the job at the back of the queue, which was added last; for the thread that owns the queue
+		 * \return the job, or 0 if the queue is empty
+		 */
+		Job* Pop();
+		
+		/**
+		 * Takes the job at the front of the queue, which was added first; for the other threads
+		 * \return the job, or 0 if the queue is empty
+		 */
+		Job* Steal();
+	
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		JobQueue(const JobQueue& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const JobQueue& operator=(const JobQueue& rhs);
+		
+		/**
+		 * \var mutex_
+		 * \brief guards the jobs
+		 */
+		Mutex mutex_;
+		
+		/**
+		 * \var jobs_
+		 * \brief the jobs, with the ones before front_ already taken
+		 */
+		std::vector<Job*> jobs_;
+		
+		/**
+		 * \var front_
+		 * \brief the index of the oldest job that has not been taken
+		 */
+		unsigned int front_;
+	}; // end class
+	
+	/**
+	 * \struct JobWorker
+	 * \brief a thread that runs jobs
+	 * \ingroup SystemGroup
+	 */
+	struct JobWorker
+	{
+		//! the job system that the worker runs jobs for
+		JobSystemSingleton* system;
+		//! the thread index of the worker, which is also the index of its queue
+		int index;
+		//! the thread of the worker
+		Thread thread;
+	};
+	
+	/**
+	 * \class JobSystemSingleton
+	 * \brief Runs small jobs on a worker thread per processor, with work stealing
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * MainSystemSingleton::Initialize() starts the job system with a thread per processor, or the number of threads
+	 * given with --threads N, counting the main thread. Every thread has its own queue. A thread runs the newest job of
+	 * its own queue first, and when that is empty it steals the oldest job of another queue, so the work spreads out
+	 * without a single queue that every thread fights over.\n
+	 * A job can create child jobs, and is not finished until all of them are. JobSystemSingleton::Wait() runs other jobs
+	 * until the job that it waits for is finished, so waiting never leaves a thread idle while there is work, and jobs
+	 * can wait for their own children. JobSystemSingleton::ParallelFor() splits a range of indices into jobs and waits for them.\n
+	 * The jobs are kept in a ring of JOB_SYSTEM_MAX_JOBS, so no more than that may be waiting or running at once;
+	 * JobSystemSingleton::CreateJob() logs an error and skips the jobs that are still busy when the ring wraps around.
+	 * Threads that are not part of the job system, such as the render thread, can create, run, and wait for jobs too.
+	 * Without Initialize() there are no queues, and every job runs straight away inside of JobSystemSingleton::Run(),
+	 * on the thread that gives it. With one thread the jobs wait in the queue of the main thread until
+	 * JobSystemSingleton::Wait() runs them.\n
+	 * There is a MACRO defined called JobSystem that is just an alias to calling the
+	 * JobSystemSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 */
+	class JobSystemSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the job system singleton class instance
+		 */
+		static JobSystemSingleton* GetInstance();
+		
+		/**
+		 * Starts the worker threads. The calling thread becomes the main thread of the job system.
+		 * @param threadCount is the number of threads to run jobs on, counting the main thread; 0 for one per processor
+		 * \return true if the job system is running
+		 */
+		bool Initialize(int threadCount = 0);
+		
+		/**
+		 * Stops the worker threads. Every job must be finished first.
+		 */
+		void Shutdown();
+		
+		/**
+		 * Creates a job that does not run until it is given to JobSystemSingleton::Run()
+		 * @param function is the function that the job runs
+		 * @param data is passed to the function, and must live until the job is finished
+		 * \return the job
+		 */
+		Job* CreateJob(JobFunction function, void* data);
+		
+		/**
+		 * Creates a job that \a parent is not finished without
+		 * @param parent is the job that waits for the new one; it must not be finished yet
+		 * @param function is the function that the job runs
+		 * @param data is passed to the function, and must live until the job is finished
+		 * \return the job
+		 */
+		Job* CreateChildJob(Job* parent, JobFunction function, void* data);
+		
+		/**
+		 * Queues a job on the calling thread, where any thread can take it
+		 */
+		void Run(Job* job);
+		
+		/**
+		 * Runs jobs until \a job is finished
+		 */
+		void Wait(Job* job);
+		
+		/**
+		 * \return true if \a job and all of its child jobs are finished
+		 */
+		bool IsFinished(Job* job);
+		
+		/**
+		 * Calls \a function for parts of a range of indices on all of the threads, and waits until they are done.
+		 * The parts are never larger than \a grainSize, and are not called in any particular order.
+		 * The grain is raised if the range would otherwise be split into more than JOB_SYSTEM_MAX_PARALLEL_FOR_PARTS parts,
+		 * so that a large range cannot fill up the ring of jobs.
+		 * @param begin is the first index
+		 * @param end is one past the last index
+		 * @param grainSize is the largest number of indices to give to a single call
+		 * @param function is called for every part
+		 * @param data is passed to the function
+		 */
+		void ParallelFor(int begin, int end, int grainSize, ParallelForFunction function, void* data);
+		
+		/**
+		 * \return the number of threads that jobs run on, counting the main thread
+		 */
+		int GetThreadCount();
+		
+		/**
+		 * \return the index of the calling thread; 0 for the main thread, from 1 for the workers,
+		 * and GetThreadCount() for any thread that is not part of the job system
+		 */
+		int GetThreadIndex();
+		
+		/**
+		 * destructor
+		 */
+		~JobSystemSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		JobSystemSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		JobSystemSingleton(const JobSystemSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const JobSystemSingleton& operator=(const JobSystemSingleton& rhs);
+		
+		/**
+		 * Takes the next job for a thread, from its own queue or from another
+		 * \return the job, or 0 if there are none
+		 */
+		Job* GetJobInternal(int threadIndex);
+		
+		/**
+		 * Runs a job and finishes it
+		 */
+		void ExecuteInternal(Job* job);
+		
+		/**
+		 * Counts a job or one of its children as finished, and finishes its parent along with it
+		 */
+		void FinishInternal(Job* job);
+		
+		/**
+		 * the function that the worker threads run
+		 */
+		static void WorkerInternal(void* data);
+		
+		/**
+		 * \var jobs_
+		 * \brief the ring of jobs
+		 */
+		Job jobs_[JOB_SYSTEM_MAX_JOBS];
+		
+		/**
+		 * \var nextJob_
+		 * \brief counts the jobs that have been created; the next job is the one at this index of the ring
+		 */
+		volatile int nextJob_;
+		
+		/**
+		 * \var queues_
+		 * \brief a queue for every thread, and one more for the threads that are not part of the job system
+		 */
+		std::vector<JobQueue*> queues_;
+		
+		/**
+		 * \var workers_
+		 * \brief the worker threads
+		 */
+		std::vector<JobWorker*> workers_;
+		
+		/**
+		 * \var threadIndex_
+		 * \brief one more than the index of each thread of the job system, so that 0 means another thread
+		 */
+		ThreadLocalPointer threadIndex_;
+		
+		/**
+		 * \var workAvailable_
+		 * \brief signaled when a job is queued, to wake a worker that has run out of work
+		 */
+		ThreadEvent workAvailable_;
+		
+		/**
+		 * \var stopping_
+		 * \brief tells the workers to return
+		 */
+		volatile bool stopping_;
+	}; // end class
+
+/**
+ * \def JobSystem
+ * \brief an alias for the JobSystemSingleton::GetInstance() function to make your code clean.
+ */
+#define JobSystem JobSystemSingleton::GetInstance()
+} // end namespace
+#endif
+
+
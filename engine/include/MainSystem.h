@@ -17,11 +17,22 @@
 
 namespace ENGINE
 {
+	//! the default number of fixed logic steps per second
+	const int MAIN_SYSTEM_DEFAULT_UPDATE_RATE = 60;
+	
+	//! the default number of fixed logic steps that may run before a frame is drawn
+	const int MAIN_SYSTEM_DEFAULT_MAX_UPDATES_PER_FRAME = 5;
+	
 	/**
 	 * \class MainSystemSingleton
 	 * \brief Initialization class for the ged101 engine
 	 * \ingroup SystemGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The main loop runs the game logic in fixed steps of 1 / update rate seconds, no matter how fast the machine is.
+	 * When the machine falls behind, several steps are run before the next frame is drawn, up to the maximum number of
+	 * updates per frame. Any time left over after that is dropped, so a slow machine runs the game slower instead of 
+	 * falling further and further behind. When the machine is ahead, the main loop sleeps until the next step is due.
 	 */
 	class MainSystemSingleton
 	{
@@ -49,6 +60,39 @@ namespace ENGINE
 		 */
 		int Execute();
 		
+		/**
+		 * Sets how many fixed logic steps are run per second
+		 * @param updatesPerSecond is the number of steps per second
+		 */
+		void SetUpdateRate(int updatesPerSecond);
+		
+		/**
+		 * Sets how many fixed logic steps may be run to catch up before a frame is drawn
+		 * @param maxUpdatesPerFrame is the number of steps
+		 */
+		void SetMaxUpdatesPerFrame(int maxUpdatesPerFrame);
+		
+		/**
+		 * Sets if the main loop gives the CPU away while it waits for the next fixed step
+		 * @param sleepWhenIdle is true to sleep, or false to spin
+		 */
+		void SetSleepWhenIdle(bool sleepWhenIdle);
+		
+		/**
+		 * \return the number of fixed logic steps per second
+		 */
+		int GetUpdateRate();
+		
+		/**
+		 * \return the number of fixed logic steps that may be run to catch up before a frame is drawn
+		 */
+		int GetMaxUpdatesPerFrame();
+		
+		/**
+		 * \return how far between the last fixed step and the next fixed step the frame being drawn is, from 0.0 to 1.0
+		 */
+		float GetInterpolation();
+		
 	private:
 		/**
 		 * hidden constructor
@@ -65,6 +109,30 @@ namespace ENGINE
 		 */
 		const MainSystemSingleton& operator=(const MainSystemSingleton& rhs);
 		
+		/**
+		 * \var updateRate_
+		 * \brief the number of fixed logic steps per second
+		 */
+		int updateRate_;
+		
+		/**
+		 * \var maxUpdatesPerFrame_
+		 * \brief the number of fixed logic steps that may be run to catch up before a frame is drawn
+		 */
+		int maxUpdatesPerFrame_;
+		
+		/**
+		 * \var sleepWhenIdle_
+		 * \brief true if the main loop gives the CPU away while it waits for the next fixed step
+		 */
+		bool sleepWhenIdle_;
+		
+		/**
+		 * \var interpolation_
+		 * \brief how far between the last fixed step and the next fixed step the frame being drawn is
+		 */
+		float interpolation_;
+		
 	}; // end class
 
 /**
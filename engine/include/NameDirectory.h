@@ -1,4 +1,3 @@
-
 // CODESTYLE: v2.0
 
 // NameDirectory.h
@@ -15,17 +14,85 @@
 #ifndef __NAMEDIRECTORY_H__
 #define __NAMEDIRECTORY_H__
 
+#include <cstddef>
 #include <vector>
-#include <map>
-#include <string>
+
+/**
+ * \def NAME_CONSTEXPR
+ * \brief marks the name hashing functions as constexpr on a C++11 compiler, so that names can be hashed at compile time
+ */
+#if __cplusplus >= 201103L
+#define NAME_CONSTEXPR constexpr
+#else
+#define NAME_CONSTEXPR
+#endif
 
 namespace ENGINE
 {
+	//! the starting value of the 32-bit FNV-1a hash of a name
+	const unsigned int NAME_HASH_BASIS = 2166136261u;
+	
+	//! the value that the 32-bit FNV-1a hash is multiplied by for every character of a name
+	const unsigned int NAME_HASH_PRIME = 16777619u;
+	
+	/**
+	 * Hashes a name with the 32-bit FNV-1a hash
+	 * On a C++11 compiler the hash of a string literal is worked out at compile time.
+	 * @param name is the name to hash
+	 * @param hash is the hash of the characters before \a name, and should be left alone
+	 * \return the hash of the name
+	 */
+	inline NAME_CONSTEXPR unsigned int NameHash(const char* name, unsigned int hash = NAME_HASH_BASIS)
+	{
+		return (0 == *name) ? hash : NameHash(name + 1, (hash ^ static_cast<unsigned char>(*name)) * NAME_HASH_PRIME);
+	}
+	
+	/**
+	 * \struct NameID
+	 * \brief the hash of a name, which looks the name up in a NameDirectory without comparing or copying any text
+	 * \ingroup SystemGroup
+	 *
+	 * The hash is kept in its own type, so that a function taking a NameID is never mixed up with one taking an index.
+	 * On a C++11 compiler a NameID is written \c "water0"_id, and costs nothing at run time; otherwise it is written
+	 * \c NameID("water0"), which hashes the name without allocating anything.
+	 */
+	struct NameID
+	{
+		/**
+		 * Hashes a name
+		 * @param name is the name to hash
+		 */
+		NAME_CONSTEXPR explicit NameID(const char* name) : hash(NameHash(name)) {}
+		
+		/**
+		 * Makes an ID from a hash that was worked out already
+		 * @param nameHash is the hash of the name, from NameHash()
+		 */
+		NAME_CONSTEXPR explicit NameID(unsigned int nameHash) : hash(nameHash) {}
+		
+		//! the hash of the name
+		unsigned int hash;
+	};
+
+#if __cplusplus >= 201103L
+	/**
+	 * Hashes a string literal at compile time; \c "water0"_id is the same as \c NameID("water0")
+	 */
+	inline constexpr NameID operator"" _id(const char* name, std::size_t /* length */)
+	{
+		return NameID(NameHash(name));
+	}
+#endif
+
 	/**
 	 * \class NameDirectory
 	 * \brief A class to manage a directory of names for using simple name/index lookup tables
 	 * \ingroup SystemGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The names are kept in an open addressing hash table keyed on their NameID, so looking a name up is a single
+	 * probe most of the time, and never allocates. The text of every name is interned, so that two names that hash the
+	 * same are caught when they are added, and so that GetName() hands out text that stays put until the directory is destroyed.
 	 */
 	class NameDirectory
 	{
@@ -42,38 +109,113 @@ namespace ENGINE
 		~NameDirectory();
 		
 		/**
-		 * Add a name to the directory
+		 * Add a name to the directory, or change the value of a name that is already in it
 		 * @param name is the name to add
 		 * @param value is the value to associate with the name
-		 * \return the index number of the added name
+		 * \return the ID of the name
+		 */
+		NameID Add(const char* name, unsigned int value);
+		
+		/**
+		 * Gets the lookup value for the name
+		 * @param name is the name to look up
+		 * \return the value associated with the name, or 0 if the name is not in the directory
 		 */
-		void Add(const char* name, unsigned int value);
+		unsigned int Get(const char* name) const;
 		
 		/**
 		 * Gets the lookup value for the name
+		 * @param nameID is the ID of the name to look up
+		 * \return the value associated with the name, or 0 if the name is not in the directory
+		 */
+		unsigned int Get(NameID nameID) const;
+		
+		/**
+		 * Looks up the value for a name, without adding the name if it is not in the directory
 		 * @param name is the name to look up
-		 * \return the value associated with the name
+		 * @param value is set to the value associated with the name, and left alone if the name is not found
+		 * \return true if the name is in the directory
+		 */
+		bool TryGet(const char* name, unsigned int& value) const;
+		
+		/**
+		 * Looks up the value for a name, without adding the name if it is not in the directory
+		 * @param nameID is the ID of the name to look up
+		 * @param value is set to the value associated with the name, and left alone if the name is not found
+		 * \return true if the name is in the directory
+		 */
+		bool TryGet(NameID nameID, unsigned int& value) const;
+		
+		/**
+		 * Gets the interned text of a name
+		 * @param nameID is the ID of the name
+		 * \return the text of the name, or 0 if the name is not in the directory
+		 */
+		const char* GetName(NameID nameID) const;
+		
+		/**
+		 * \return the number of names in the directory
 		 */
-		unsigned int Get(const char* name);
+		unsigned int GetCount() const;
 		
+		/**
+		 * Removes every name from the directory
+		 */
+		void Clear();
+	
 	private:
 	
+		/**
+		 * hidden copy constructor
+		 */
+		NameDirectory(const NameDirectory& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const NameDirectory& operator=(const NameDirectory& rhs);
+		
 		void Destroy();
 		
-		//! STL map of string to unsigned ints for keeping a lookup table
-		typedef std::map<std::string, unsigned int> LUT;
+		/**
+		 * \return the slot that holds a hash, or the empty slot where it would go
+		 */
+		unsigned int FindSlotInternal(unsigned int hash) const;
+		
+		/**
+		 * Moves every name into a table with twice as many slots
+		 */
+		void GrowInternal();
 		
-		//! STL iterator for a map of string to uints
-		typedef std::map<std::string, unsigned int>::iterator LUTIterator; 
+		/**
+		 * \struct Entry
+		 * \brief a slot of the hash table
+		 */
+		struct Entry
+		{
+			//! the interned text of the name, or 0 for an empty slot
+			const char* name;
+			//! the hash of the name
+			unsigned int hash;
+			//! the value associated with the name
+			unsigned int value;
+		};
 		
 		/**
-		 * \var lut_
-		 * \brief maintains the associative array for the lookup table
+		 * \var entries_
+		 * \brief the slots of the hash table; there is always a power of two of them, and at least half are empty
 		 */ 
-		LUT lut_;
+		std::vector<Entry> entries_;
+		
+		/**
+		 * \var count_
+		 * \brief the number of slots that hold a name
+		 */
+		unsigned int count_;
 	}; // end class
 
 } // end namespace
 #endif
 
 
+
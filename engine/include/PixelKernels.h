@@ -0,0 +1,262 @@
+
+// CODESTYLE: v2.0
+
+// PixelKernels.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: SSE2 and AVX2 span kernels for gradients, blending, and masked copies of 16 and 32 bit bitmaps
+
+#ifndef __PIXELKERNELS_H__
+#define __PIXELKERNELS_H__
+
+/**
+ * \file PixelKernels.h
+ * \brief Pixel Kernels Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+struct BITMAP;
+
+namespace ENGINE
+{
+	/**
+	 * \enum PixelKernelSet
+	 * \brief the instruction sets that the span kernels are written for
+	 * \ingroup GraphicsGroup
+	 */
+	enum PixelKernelSet
+	{
+		//! plain C++, which runs everywhere
+		PixelKernels_Scalar = 0,
+		//! 4 pixels at a time, on x86 processors with SSE2
+		PixelKernels_SSE2,
+		//! 8 pixels at a time, on x86 processors with AVX2
+		PixelKernels_AVX2,
+		//! the number of kernel sets
+		PixelKernels_Count
+	};
+	
+	/**
+	 * \struct PixelGradientSpan
+	 * \brief a row of a gradient; the color of the first pixel, and how much it changes from one pixel to the next
+	 * \ingroup GraphicsGroup
+	 *
+	 * The colors are 16.16 fixed point numbers, so 255 is 255 << 16.
+	 */
+	struct PixelGradientSpan
+	{
+		//! the red of the first pixel
+		int red;
+		//! the green of the first pixel
+		int green;
+		//! the blue of the first pixel
+		int blue;
+		//! added to the red for each pixel
+		int redStep;
+		//! added to the green for each pixel
+		int greenStep;
+		//! added to the blue for each pixel
+		int blueStep;
+	};
+	
+	/**
+	 * \struct PixelKernelTable
+	 * \brief the span kernels of one instruction set
+	 * \ingroup GraphicsGroup
+	 *
+	 * The blending kernels give exactly the same pixels as the Allegro trans and alpha blenders that draw_trans_sprite() uses,
+	 * and skip the mask color the same way, so that they can be used in place of Allegro. Like the Allegro blenders,
+	 * they work on the 0xRRGGBB and 5-6-5 pixel layouts; see PixelKernelsSingleton::HasStandardLayout().
+	 */
+	struct PixelKernelTable
+	{
+		//! the name of the instruction set, for the log
+		const char* name;
+		
+		//! fills a span of 32 bit pixels with a gradient, using the pixel layout of the screen
+		void (*GradientSpan32)(unsigned int* destination, int count, const PixelGradientSpan& span);
+		//! fills a span of 16 bit pixels with a gradient, using the pixel layout of the screen
+		void (*GradientSpan16)(unsigned short* destination, int count, const PixelGradientSpan& span);
+		
+		//! blends a span of 32 bit pixels over another with a constant alpha from 0 to 255, skipping the mask color
+		void (*BlendSpan32)(unsigned int* destination, const unsigned int* source, int count, int alpha);
+		//! blends a span of 16 bit pixels over another with a constant alpha from 0 to 255, skipping the mask color
+		void (*BlendSpan16)(unsigned short* destination, const unsigned short* source, int count, int alpha);
+		
+		//! blends a span of 32 bit pixels over another with the alpha of each source pixel, skipping the mask color
+		void (*AlphaBlendSpan32)(unsigned int* destination, const unsigned int* source, int count);
+		//! blends a span of 32 bit pixels over 16 bit pixels with the alpha of each source pixel, skipping the mask color
+		void (*AlphaBlendSpan16)(unsigned short* destination, const unsigned int* source, int count);
+		
+		//! copies a span of 32 bit pixels over another, skipping the mask color
+		void (*MaskedCopySpan32)(unsigned int* destination, const unsigned int* source, int count);
+		//! copies a span of 16 bit pixels over another, skipping the mask color
+		void (*MaskedCopySpan16)(unsigned short* destination, const unsigned short* source, int count);
+	};
+	
+	/**
+	 * \class PixelKernelsSingleton
+	 * \brief Picks the fastest span kernels that the processor can run, and draws 16 and 32 bit memory bitmaps with them
+	 * \ingroup GraphicsGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The instruction set is picked with CPUID the first time that the kernels are used.
+	 * The drawing functions return false for anything that the kernels do not handle, such as video bitmaps,
+	 * 8, 15 and 24 bit bitmaps, or bitmaps of different depths, and the caller then draws with Allegro as before.\n
+	 * Run the game with --benchmark-pixels to time each kernel set against Allegro on 640x480 bitmaps, and check
+	 * that they draw the same pixels. The results are written to the log.\n
+	 * There is a MACRO defined called PixelKernels that is just an alias to calling the
+	 * PixelKernelsSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 */
+	class PixelKernelsSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the pixel kernels singleton class instance
+		 */
+		static PixelKernelsSingleton* GetInstance();
+		
+		/**
+		 * \return true if the processor can run a kernel set
+		 */
+		bool IsSupported(PixelKernelSet kernelSet);
+		
+		/**
+		 * Uses another kernel set. The benchmark uses this to time each set.
+		 * @param kernelSet is the kernel set to use
+		 * \return true if the kernel set is used, false if the processor cannot run it
+		 */
+		bool SelectKernelSet(PixelKernelSet kernelSet);
+		
+		/**
+		 * \return the kernel set that is used
+		 */
+		PixelKernelSet GetKernelSet();
+		
+		/**
+		 * \return the kernels that are used
+		 */
+		const PixelKernelTable& GetKernels();
+		
+		/**
+		 * \return the kernels of a kernel set, whether or not the processor can run them
+		 */
+		static const PixelKernelTable& GetKernels(PixelKernelSet kernelSet);
+		
+		/**
+		 * \return true if pixels of a color depth use the layout that the blending kernels expect; 0xRRGGBB with the alpha on top, or 5-6-5
+		 */
+		static bool HasStandardLayout(int colorDepth);
+		
+		/**
+		 * Fills a row of a bitmap with a gradient
+		 * @param destination is the bitmap to fill
+		 * @param x is the first pixel of the row
+		 * @param y is the row
+		 * @param count is the number of pixels to fill
+		 * @param span is the color of the first pixel, and how much it changes from one pixel to the next
+		 * \return true if the row was filled, false if the bitmap has to be drawn another way
+		 */
+		bool GradientSpan(BITMAP* destination, int x, int y, int count, const PixelGradientSpan& span);
+		
+		/**
+		 * Does what draw_trans_sprite() does after set_trans_blender(0, 0, 0, alpha)
+		 * \return true if the sprite was drawn, false if it has to be drawn with Allegro
+		 */
+		bool BlendSprite(BITMAP* destination, BITMAP* source, int destX, int destY, int alpha);
+		
+		/**
+		 * Does what BlendSprite() does, for a rectangle of the source bitmap
+		 * \return true if the rectangle was drawn, false if it has to be drawn with Allegro
+		 */
+		bool BlendBlit(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height, int alpha);
+		
+		/**
+		 * Does what draw_trans_sprite() does after set_alpha_blender()
+		 * \return true if the sprite was drawn, false if it has to be drawn with Allegro
+		 */
+		bool AlphaBlendSprite(BITMAP* destination, BITMAP* source, int destX, int destY);
+		
+		/**
+		 * Does what AlphaBlendSprite() does, for a rectangle of the source bitmap
+		 * \return true if the rectangle was drawn, false if it has to be drawn with Allegro
+		 */
+		bool AlphaBlendBlit(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height);
+		
+		/**
+		 * Does what masked_blit() does
+		 * \return true if the bitmap was drawn, false if it has to be drawn with Allegro
+		 */
+		bool MaskedBlit(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height);
+		
+		/**
+		 * \return true if BlendBlit() can draw \a source onto \a destination without the Allegro blender
+		 */
+		static bool CanBlendBlit(BITMAP* source, BITMAP* destination);
+		
+		/**
+		 * \return true if AlphaBlendBlit() can draw \a source onto \a destination without the Allegro blender
+		 */
+		static bool CanAlphaBlendBlit(BITMAP* source, BITMAP* destination);
+		
+		/**
+		 * Times the Allegro drawing functions and every kernel set that the processor can run on 640x480 bitmaps,
+		 * checks that the kernels draw the same pixels as Allegro, and writes the results to the log.
+		 * Allegro must be initialized first.
+		 */
+		void RunBenchmark();
+		
+		/**
+		 * destructor
+		 */
+		~PixelKernelsSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		PixelKernelsSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		PixelKernelsSingleton(const PixelKernelsSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const PixelKernelsSingleton& operator=(const PixelKernelsSingleton& rhs);
+		
+		/**
+		 * Clips a sprite or a blit to the source bitmap and to the clipping rectangle of the destination bitmap
+		 * \return false if nothing is left to draw
+		 */
+		static bool ClipInternal(
+			BITMAP* source,
+			BITMAP* destination,
+			int& srcX, int& srcY,
+			int& destX, int& destY,
+			int& width, int& height);
+		
+		/**
+		 * \var kernelSet_
+		 * \brief the kernel set that is used
+		 */
+		PixelKernelSet kernelSet_;
+		
+		/**
+		 * \var supported_
+		 * \brief which of the kernel sets the processor can run
+		 */
+		bool supported_[PixelKernels_Count];
+	}; // end class
+
+/**
+ * \def PixelKernels
+ * \brief an alias for the PixelKernelsSingleton::GetInstance() function to make your code clean.
+ */
+#define PixelKernels PixelKernelsSingleton::GetInstance()
+} // end namespace
+#endif
+
+
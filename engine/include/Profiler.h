@@ -0,0 +1,344 @@
+
+// CODESTYLE: v2.0
+
+// Profiler.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Measures where the time of each frame goes, using named zones
+
+/**
+ * \file Profiler.h
+ * \brief Frame Profiling Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <vector>
+
+#include "GameTimer.h"
+#include "Threading.h"
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	class ImageResource;
+	class BitmapFont;
+	
+	//! the number of frames of timings that the profiler remembers
+	const unsigned int PROFILER_HISTORY_FRAMES = 120;
+	
+	/**
+	 * \struct ProfilerZoneRecord
+	 * \brief the timings of a single named zone
+	 * \ingroup DebugGroup
+	 */
+	struct ProfilerZoneRecord
+	{
+		//! the name of the zone. This must be a string that lives as long as the program, such as a string literal
+		const char* name;
+		//! the time spent in the zone during the current frame
+		GameTimerTicks currentTicks;
+		//! the number of times that the zone was entered during the current frame
+		unsigned int currentCalls;
+		//! the number of times that the zone was entered during the previous frame
+		unsigned int lastCalls;
+		//! the time spent in the zone during each of the remembered frames
+		GameTimerTicks history[PROFILER_HISTORY_FRAMES];
+	};
+	
+	/**
+	 * \struct ProfilerStats
+	 * \brief the last, minimum, average and maximum of a timing over the remembered frames, in milliseconds
+	 * \ingroup DebugGroup
+	 */
+	struct ProfilerStats
+	{
+		//! the timing of the last complete frame
+		float last;
+		//! the smallest timing
+		float minimum;
+		//! the average timing
+		float average;
+		//! the largest timing
+		float maximum;
+	};
+	
+	/**
+	 * \class ProfilerSingleton
+	 * \brief Measures where the time of each frame goes, using named zones
+	 * \ingroup DebugGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Code is measured by placing a ProfileZone object at the start of a block. The time until the end of the block
+	 * is added to the zone with that name. The engine's main loop starts a new frame of timings every frame, and the 
+	 * timings of the last PROFILER_HISTORY_FRAMES frames are remembered.\n
+	 * When the overlay is visible it is drawn onto the secondary display buffer by GraphicsDeviceSingleton::EndScene(),
+	 * showing the time of every zone and a graph of the frame times.\n
+	 * The profiler does nothing until it is enabled. Zones may be used from any thread, such as the render thread or
+	 * the threads of the job system; a zone that is entered by several threads adds up the time of all of them.\n
+	 * BeginFrame(), the stats and the overlay still belong to the main thread.
+	 * \code
+	 * Profiler->SetOverlayVisible(true);
+	 * ...
+	 * void Player::Think()
+	 * {
+	 * 	ProfileScope("Player::Think");
+	 * 	...
+	 * }
+	 * \endcode
+	 */
+	class ProfilerSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the singleton class
+		 */
+		static ProfilerSingleton* GetInstance();
+		
+		/**
+		 * De-allocates any allocated memory
+		 */
+		~ProfilerSingleton();
+		
+		/**
+		 * Turns the measuring of zones on or off
+		 * @param enabled is true to measure the zones
+		 */
+		void SetEnabled(bool enabled);
+		
+		/**
+		 * \return true if the zones are being measured
+		 */
+		bool IsEnabled();
+		
+		/**
+		 * Shows or hides the overlay. Showing the overlay also enables the profiler.
+		 * @param visible is true to draw the overlay
+		 */
+		void SetOverlayVisible(bool visible);
+		
+		/**
+		 * \return true if the overlay is drawn
+		 */
+		bool IsOverlayVisible();
+		
+		/**
+		 * Sets the font that the overlay is printed with. The profiler does not own the font.
+		 * @param font is the font to use, or 0 to use the built-in 8x8 font
+		 */
+		void SetOverlayFont(BitmapFont* font);
+		
+		/**
+		 * Gets the ID of a zone, adding the zone if it does not exist yet
+		 * @param zoneName is the name of the zone. This must be a string that lives as long as the program, such as a string literal
+		 * \return the ID of the zone
+		 */
+		unsigned int RegisterZone(const char* zoneName);
+		
+		/**
+		 * Adds time to a zone for the current frame
+		 * @param zoneID is the ID of the zone
+		 * @param ticks is the time to add
+		 */
+		void AddZoneTime(unsigned int zoneID, GameTimerTicks ticks);
+		
+		/**
+		 * Stores the timings of the current frame and starts a new frame. The main loop calls this once per frame.
+		 */
+		void BeginFrame();
+		
+		/**
+		 * \return the number of zones
+		 */
+		unsigned int GetZoneCount();
+		
+		/**
+		 * \return the name of a zone, or 0 if the ID is not valid
+		 */
+		const char* GetZoneName(unsigned int zoneID);
+		
+		/**
+		 * Gets the timings of a zone over the remembered frames
+		 * @param zoneID is the ID of the zone
+		 * @param stats receives the timings
+		 * \return false if the ID is not valid
+		 */
+		bool GetZoneStats(unsigned int zoneID, ProfilerStats& stats);
+		
+		/**
+		 * Gets the frame times over the remembered frames
+		 * @param stats receives the timings
+		 */
+		void GetFrameStats(ProfilerStats& stats);
+		
+		/**
+		 * Draws the zone timings and a graph of the frame times
+		 * @param target is the image to draw onto
+		 * @param x is the X coordinate of the upper-left corner of the overlay
+		 * @param y is the Y coordinate of the upper-left corner of the overlay
+		 */
+		void DrawOverlay(ImageResource* target, int x = 4, int y = 4);
+		
+	private:
+		/**
+		 * hidden constructor
+		 */
+		ProfilerSingleton();
+		
+		/**
+		 * hidden copy constructor
+		 */
+		ProfilerSingleton(const ProfilerSingleton& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const ProfilerSingleton& operator=(const ProfilerSingleton& rhs);
+		
+		/**
+		 * Works out the timings of a history of ticks
+		 */
+		void CalculateStats(GameTimerTicks* history, ProfilerStats& stats);
+		
+		/**
+		 * \var zones_
+		 * \brief the timings of every zone
+		 */
+		std::vector<ProfilerZoneRecord> zones_;
+		
+		/**
+		 * \var frameHistory_
+		 * \brief the length of each of the remembered frames
+		 */
+		GameTimerTicks frameHistory_[PROFILER_HISTORY_FRAMES];
+		
+		/**
+		 * \var frameStartTime_
+		 * \brief the time that the current frame started at
+		 */
+		GameTimerTicks frameStartTime_;
+		
+		/**
+		 * \var historyIndex_
+		 * \brief the position in the history that the next complete frame is stored at
+		 */
+		unsigned int historyIndex_;
+		
+		/**
+		 * \var historyCount_
+		 * \brief the number of frames stored in the history
+		 */
+		unsigned int historyCount_;
+		
+		/**
+		 * \var enabled_
+		 * \brief true if the zones are being measured
+		 */
+		bool enabled_;
+		
+		/**
+		 * \var overlayVisible_
+		 * \brief true if the overlay is drawn
+		 */
+		bool overlayVisible_;
+		
+		/**
+		 * \var overlayFont_
+		 * \brief the font that the overlay is printed with
+		 */
+		BitmapFont* overlayFont_;
+		
+		/**
+		 * \var defaultFont_
+		 * \brief the built-in font, created the first time that the overlay is drawn without a font
+		 */
+		BitmapFont* defaultFont_;
+		
+		/**
+		 * \var zonesMutex_
+		 * \brief guards the zones, which are registered and timed from any thread
+		 */
+		Mutex zonesMutex_;
+	}; // end class
+	
+	/**
+	 * \class ProfileZone
+	 * \brief Adds the time between its creation and its destruction to a profiler zone
+	 * \ingroup DebugGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Creating a ProfileZone by name looks the zone up every time, so in code that runs often 
+	 * use the ProfileScope MACRO, which looks the zone up only once.\n
+	 * While a trace capture is running, every zone is also recorded as a span in the trace.
+	 */
+	class ProfileZone
+	{
+	public:
+		/**
+		 * starts measuring a zone
+		 * @param zoneName is the name of the zone. This must be a string that lives as long as the program, such as a string literal
+		 */
+		ProfileZone(const char* zoneName);
+		
+		/**
+		 * starts measuring a zone
+		 * @param zoneID is the ID of the zone returned by ProfilerSingleton::RegisterZone()
+		 */
+		ProfileZone(unsigned int zoneID);
+		
+		/**
+		 * stops measuring the zone and adds the time to it
+		 */
+		~ProfileZone();
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		ProfileZone(const ProfileZone& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const ProfileZone& operator=(const ProfileZone& rhs);
+		
+		/**
+		 * \var zoneID_
+		 * \brief the ID of the zone being measured
+		 */
+		unsigned int zoneID_;
+		
+		/**
+		 * \var startTime_
+		 * \brief the time that the zone was entered, or -1 if the profiler was disabled
+		 */
+		GameTimerTicks startTime_;
+		
+		/**
+		 * \var traceName_
+		 * \brief the name of the zone if it was recorded by the trace capture, or 0 if it was not
+		 */
+		const char* traceName_;
+	}; // end class
+
+/**
+ * \def Profiler
+ * \brief an alias for ProfilerSingleton::GetInstance()
+ */
+#define Profiler ProfilerSingleton::GetInstance()
+
+/**
+ * \def ProfileScope
+ * \brief measures the rest of the current block as the named zone. Use it at most once per block.
+ */
+#define ProfileScope(zoneName) \
+	static const unsigned int profileScopeZoneID = ENGINE::Profiler->RegisterZone(zoneName); \
+	ENGINE::ProfileZone profileScopeZone(profileScopeZoneID)
+
+} // end namespace
+#endif
+
+
+
@@ -0,0 +1,536 @@
+// CODESTYLE: v2.0
+
+// RenderQueue.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Records the drawing of a frame, so that a render thread can draw it while the next frame is updated
+
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+/**
+ * \file RenderQueue.h
+ * \brief Render Queue Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#include <vector>
+
+#include "SpriteBatch.h"
+#include "Threading.h"
+#include "TileMapRenderer.h"
+
+struct BITMAP;
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	class ImageResource;
+	class RenderQueueSingleton;
+	
+	//! the most bands that RenderQueueSingleton::SetBandCount() splits the secondary display buffer into
+	const int RENDER_QUEUE_MAX_BANDS = 64;
+	
+	/**
+	 * \typedef RenderCallback
+	 * \brief a function that the render queue calls to draw something that it has no command for
+	 *
+	 * The function is called on the render thread, with the secondary display buffer as the target. Whatever it reads
+	 * cannot be copied when it is recorded, so a frame with a callback in it is drawn before the next frame is updated.
+	 */
+	typedef void (*RenderCallback)(ImageResource* target, void* data);
+	
+	/**
+	 * \enum RenderCommandType
+	 * \brief the kinds of drawing that the render queue records
+	 * \ingroup GraphicsGroup
+	 */
+	enum RenderCommandType
+	{
+		//! draws a sprite, like SpriteBatchSingleton::Draw()
+		RenderCommand_Sprite = 0,
+		//! draws a rectangle, like ImageResource::Rect()
+		RenderCommand_Rect,
+		//! draws a line, like ImageResource::Line()
+		RenderCommand_Line,
+		//! calls a RenderCallback
+		RenderCommand_Call,
+		//! draws a tilemap, like TileMapRenderer::Render()
+		RenderCommand_TileMap
+	};
+	
+	/**
+	 * \struct RenderShapeCommand
+	 * \brief a rectangle or a line recorded by the render queue
+	 * \ingroup GraphicsGroup
+	 */
+	struct RenderShapeCommand
+	{
+		//! the X coordinate of the first point
+		int x1;
+		//! the Y coordinate of the first point
+		int y1;
+		//! the X coordinate of the second point
+		int x2;
+		//! the Y coordinate of the second point
+		int y2;
+		//! the color to draw with
+		int color;
+		//! true to fill a rectangle
+		bool filled;
+	};
+	
+	/**
+	 * \struct RenderCallCommand
+	 * \brief a callback recorded by the render queue
+	 * \ingroup GraphicsGroup
+	 */
+	struct RenderCallCommand
+	{
+		//! the function to call
+		RenderCallback function;
+		//! passed to the function
+		void* data;
+	};
+	
+	/**
+	 * \struct RenderTileMapCommand
+	 * \brief a tilemap recorded by the render queue
+	 * \ingroup GraphicsGroup
+	 */
+	struct RenderTileMapCommand
+	{
+		//! the renderer that draws the tiles
+		TileMapRenderer* renderer;
+		//! the camera position and viewport when the tilemap was recorded
+		TileMapView view;
+		//! the column of the first visible tile
+		int firstColumn;
+		//! the row of the first visible tile
+		int firstRow;
+		//! the number of visible columns
+		int columnCount;
+		//! the number of visible rows
+		int rowCount;
+		//! where the values of the visible tiles start in RenderCommandBuffer::tileValues
+		unsigned int firstValue;
+	};
+	
+	/**
+	 * \struct RenderCommand
+	 * \brief a single recorded drawing operation
+	 * \ingroup GraphicsGroup
+	 */
+	struct RenderCommand
+	{
+		//! which of the members of the union is used
+		RenderCommandType type;
+		
+		union
+		{
+			//! for RenderCommand_Sprite; the destination is filled in with the secondary display buffer when the sprite is drawn
+			SpriteDrawCommand sprite;
+			//! for RenderCommand_Rect and RenderCommand_Line
+			RenderShapeCommand shape;
+			//! for RenderCommand_Call
+			RenderCallCommand call;
+			//! for RenderCommand_TileMap
+			RenderTileMapCommand tileMap;
+		};
+	};
+	
+	/**
+	 * \struct RenderCommandBuffer
+	 * \brief the recorded drawing of one frame
+	 * \ingroup GraphicsGroup
+	 */
+	struct RenderCommandBuffer
+	{
+		//! true once RenderQueueSingleton::BeginScene() has been called for the frame
+		bool sceneBegun;
+		//! the color that the scene is cleared with
+		int clearColor;
+		//! the drawing, in the order that it was recorded
+		std::vector<RenderCommand> commands;
+		//! the values of the visible tiles of every recorded tilemap, copied when the tilemap was recorded
+		std::vector<TileValueType> tileValues;
+		//! true if a callback was recorded, which may read anything that the main thread changes
+		bool hasCalls;
+	};
+	
+	/**
+	 * \struct RenderBandJob
+	 * \brief the commands that the bands are being drawn for
+	 * \ingroup GraphicsGroup
+	 */
+	struct RenderBandJob
+	{
+		//! the first command to draw
+		const RenderCommand* begin;
+		//! one past the last command to draw
+		const RenderCommand* end;
+		//! the image that is drawn onto
+		ImageResource* target;
+		//! the tile values of the frame
+		const TileValueType* tileValues;
+		//! the number of bands that the clipping rectangle of the target is split into
+		int bandCount;
+		//! the X coordinate of the upper-left corner of the clipping rectangle of the target
+		int clipX1;
+		//! the X coordinate of the lower-right corner of the clipping rectangle of the target
+		int clipX2;
+	};
+	
+	/**
+	 * \class RenderQueueSingleton
+	 * \brief Records the drawing of a frame, so that a render thread can draw it while the next frame is updated
+	 * \ingroup GraphicsGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * A game state records its frame with RenderQueueSingleton::BeginScene() and the drawing functions instead of drawing
+	 * onto the secondary display buffer. MainSystemSingleton::Execute() calls RenderQueueSingleton::SubmitFrame() after
+	 * GameState::Render(), which hands the frame over to be drawn.\n
+	 * Without a render thread the frame is drawn straight away, with GraphicsDeviceSingleton::BeginScene() and
+	 * GraphicsDeviceSingleton::EndScene() around it. With a render thread (run the game with --render-thread) there are
+	 * two command buffers; the render thread draws the frame that was submitted last while the main thread updates and
+	 * records the next one, and the buffers are swapped when the next frame is submitted.\n
+	 * While the render thread is running:
+	 * - the render thread owns the display buffers, so the main thread must not draw onto them or call
+	 *   GraphicsDeviceSingleton::BeginScene() or GraphicsDeviceSingleton::EndScene() itself. Call
+	 *   RenderQueueSingleton::Flush() first when it has to, such as for a loading screen.
+	 * - the Allegro blender is shared by all threads, so the main thread must not draw blended sprites onto other images either.
+	 * - every image that is drawn must live until the frame has been drawn; call RenderQueueSingleton::Flush()
+	 *   before destroying an image that was drawn in the last frame.
+	 * - a recorded tilemap copies the values of its visible tiles, so the tilemap may change straight away, but its
+	 *   tileset must not change until the frame has been drawn.
+	 * - a callback may read anything, so SubmitFrame() waits for a frame that has one to be drawn before the next
+	 *   frame is updated. Record the drawing itself where it matters.
+	 * - the profiler only measures the main thread, so its overlay is not drawn. Capture a trace to see the render thread.
+	 *
+	 * The frame can also be split into horizontal bands (run the game with --render-bands=N), which are drawn at the same
+	 * time with JobSystemSingleton::ParallelFor(), a job for every band. Every band draws the whole command list, clipped
+	 * to its own rows, and the thread that draws the frame runs bands too while it waits, so a thread that finishes early
+	 * helps with the rest. Because the bands do not overlap, the frame comes out exactly the
+	 * way that it does in one band; run the game with --verify-bands to draw every frame both ways and compare the pixels.
+	 * Callbacks, and blended sprites that the pixel kernels cannot draw because they need the Allegro blender, are drawn
+	 * by one thread between the runs of commands that are split into bands. Record tilemaps with
+	 * RenderQueueSingleton::DrawTileMap() and scene layers with SceneSingleton::QueueRender() so that they can be split too.\n
+	 * A state that does not call RenderQueueSingleton::BeginScene() draws for itself as before.\n
+	 * There is a MACRO defined called RenderQueue that is just an alias to calling the
+	 * RenderQueueSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 */
+	class RenderQueueSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the render queue singleton class instance
+		 */
+		static RenderQueueSingleton* GetInstance();
+		
+		/**
+		 * Starts recording a frame
+		 * @param color is the color to clear the scene with, like GraphicsDeviceSingleton::BeginScene()
+		 */
+		void BeginScene(int color = 0);
+		
+		/**
+		 * Records drawing a whole image
+		 * @param source is the image to draw
+		 * @param destX is the X coordinate on the screen in pixels
+		 * @param destY is the Y coordinate on the screen in pixels
+		 * @param blendMode is how the sprite is drawn
+		 * @param alpha is the alpha from 0.0f to 1.0f for SpriteBlend_Trans
+		 */
+		void DrawSprite(ImageResource* source, int destX, int destY, SpriteBlendMode blendMode = SpriteBlend_Masked, float alpha = 1.0f);
+		
+		/**
+		 * Records drawing a rectangle of an image
+		 * @param source is the image to draw
+		 * @param srcX is the X coordinate of the upper-left corner of the rectangle on the source image in pixels
+		 * @param srcY is the Y coordinate of the upper-left corner of the rectangle on the source image in pixels
+		 * @param width is the width of the rectangle in pixels
+		 * @param height is the height of the rectangle in pixels
+		 * @param destX is the X coordinate on the screen in pixels
+		 * @param destY is the Y coordinate on the screen in pixels
+		 * @param blendMode is how the sprite is drawn
+		 * @param alpha is the alpha from 0.0f to 1.0f for SpriteBlend_Trans
+		 */
+		void DrawSprite(
+			ImageResource* source,
+			int srcX, int srcY,
+			int width, int height,
+			int destX, int destY,
+			SpriteBlendMode blendMode = SpriteBlend_Masked,
+			float alpha = 1.0f);
+		
+		/**
+		 * Records drawing a rectangle, like ImageResource::Rect()
+		 */
+		void DrawRect(int x1, int y1, int x2, int y2, int color, bool filled = false);
+		
+		/**
+		 * Records drawing a line, like ImageResource::Line()
+		 */
+		void DrawLine(int x1, int y1, int x2, int y2, int color);
+		
+		/**
+		 * Records drawing a tilemap with the camera position, viewport and tiles that it has now, onto the secondary display buffer
+		 * instead of the render target of the renderer. The values of the visible tiles are copied into the frame, so the
+		 * tilemap may change straight away; the tileset must not change until the frame has been drawn.
+		 * @param renderer is the renderer that draws the tiles
+		 */
+		void DrawTileMap(TileMapRenderer* renderer);
+		
+		/**
+		 * Records a call to a function that draws something that there is no command for.
+		 * With a render thread, the frame is drawn before SubmitFrame() returns, so that the function does not read
+		 * what the main thread is changing for the next frame.
+		 * @param function is called on the render thread with the secondary display buffer
+		 * @param data is passed to the function, and must live until the frame has been drawn
+		 */
+		void Call(RenderCallback function, void* data);
+		
+		/**
+		 * Hands the recorded frame over to be drawn. Does nothing if RenderQueueSingleton::BeginScene() was not called.
+		 * With a render thread this waits for the frame before it to be drawn, then swaps the buffers; if the frame has a
+		 * callback in it, it also waits for the frame itself.
+		 */
+		void SubmitFrame();
+		
+		/**
+		 * Waits for the render thread to finish drawing the frame that it is drawing, if there is one
+		 */
+		void Flush();
+		
+		/**
+		 * Starts the render thread
+		 * \return true if the thread is running
+		 */
+		bool StartThread();
+		
+		/**
+		 * Draws the last frame and stops the render thread
+		 */
+		void StopThread();
+		
+		/**
+		 * \return true if the render thread is running
+		 */
+		bool IsThreaded();
+		
+		/**
+		 * Sets the number of horizontal bands that each frame is split into.
+		 * One band draws the frame on one thread. Waits for the render thread to finish the frame that it is drawing first.
+		 * @param bandCount is the number of bands, from 1 to RENDER_QUEUE_MAX_BANDS
+		 */
+		void SetBandCount(int bandCount);
+		
+		/**
+		 * \return the number of horizontal bands that each frame is split into
+		 */
+		int GetBandCount();
+		
+		/**
+		 * Draws every frame that is split into bands a second time in one band, and compares the pixels.
+		 * Callbacks are called twice per frame while this is on.
+		 */
+		void SetBandVerification(bool enabled);
+		
+		/**
+		 * Writes the number of frames that were compared, and how many of them were different, to the log
+		 */
+		void ReportBandVerification();
+		
+		/**
+		 * Records a frame of sprites with every blend mode, lines and rectangles that cross the edges of the bands, a callback
+		 * and a scrolled tilemap, draws it into memory images in one band and in 2 to RENDER_QUEUE_MAX_BANDS bands, with
+		 * and without a tileset atlas, and compares the pixels. The results are written to the log.
+		 * Must be called before the render thread is started (run the game with --test-bands).
+		 * \return true if every band count drew exactly the same pixels as one band
+		 */
+		bool RunBandTest();
+		
+		/**
+		 * destructor
+		 */
+		~RenderQueueSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		RenderQueueSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		RenderQueueSingleton(const RenderQueueSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const RenderQueueSingleton& operator=(const RenderQueueSingleton& rhs);
+		
+		/**
+		 * Draws a frame onto the secondary display buffer and shows it, then empties the buffer
+		 */
+		void ExecuteInternal(RenderCommandBuffer& buffer);
+		
+		/**
+		 * Draws the commands of a frame onto \a target in bands
+		 */
+		void RasterizeInternal(RenderCommandBuffer& buffer, ImageResource* target, int bandCount);
+		
+		/**
+		 * \return true if the command can be drawn in bands by several threads at once
+		 */
+		bool IsBandSafeInternal(const RenderCommand& command, ImageResource* target);
+		
+		/**
+		 * Splits the clipping rectangle of \a target into bands, unless the bands from before still fit
+		 */
+		void PrepareBandsInternal(ImageResource* target, int bandCount);
+		
+		/**
+		 * Destroys the bitmaps of the bands
+		 */
+		void DestroyBandsInternal();
+		
+		/**
+		 * Draws a run of commands in bands on the threads of the job system, and marks what they drew dirty afterwards
+		 */
+		void RasterizeBandsInternal(const RenderCommand* begin, const RenderCommand* end, const TileValueType* tileValues, ImageResource* target);
+		
+		/**
+		 * Draws a range of bands of the current job; called by JobSystemSingleton::ParallelFor()
+		 */
+		static void BandJobInternal(int begin, int end, void* data);
+		
+		/**
+		 * Draws one band of the current job
+		 */
+		void RasterizeBandInternal(int band);
+		
+		/**
+		 * Compares the pixels of two images of the same size
+		 * \return the number of rows that are different
+		 */
+		static int CompareImagesInternal(ImageResource* lhs, ImageResource* rhs);
+		
+		/**
+		 * the function that the render thread runs
+		 */
+		static void RenderThreadInternal(void* data);
+		
+		/**
+		 * \var buffers_
+		 * \brief the two command buffers; one is recorded into while the other is drawn
+		 */
+		RenderCommandBuffer buffers_[2];
+		
+		/**
+		 * \var recordIndex_
+		 * \brief the buffer that the main thread records into
+		 */
+		int recordIndex_;
+		
+		/**
+		 * \var executeIndex_
+		 * \brief the buffer that the render thread draws
+		 */
+		int executeIndex_;
+		
+		/**
+		 * \var frameInFlight_
+		 * \brief true while the render thread has a frame that the main thread has not waited for; only used by the main thread
+		 */
+		bool frameInFlight_;
+		
+		/**
+		 * \var stopping_
+		 * \brief tells the render thread to return instead of drawing
+		 */
+		volatile bool stopping_;
+		
+		/**
+		 * \var thread_
+		 * \brief the render thread
+		 */
+		Thread thread_;
+		
+		/**
+		 * \var frameReady_
+		 * \brief signaled when a frame has been submitted to the render thread, or when it should stop
+		 */
+		ThreadEvent frameReady_;
+		
+		/**
+		 * \var frameDone_
+		 * \brief signaled when the render thread has drawn a frame
+		 */
+		ThreadEvent frameDone_;
+		
+		/**
+		 * \var bandCount_
+		 * \brief the number of horizontal bands that each frame is split into
+		 */
+		int bandCount_;
+		
+		/**
+		 * \var bandBitmaps_
+		 * \brief a sub-bitmap of the target for every band, which rectangles and lines are clipped by
+		 */
+		std::vector<BITMAP*> bandBitmaps_;
+		
+		/**
+		 * \var bandTops_
+		 * \brief the first row of every band on the target
+		 */
+		std::vector<int> bandTops_;
+		
+		/**
+		 * \var bandParent_
+		 * \brief the bitmap that the bands were split from
+		 */
+		BITMAP* bandParent_;
+		
+		/**
+		 * \var bandClip_
+		 * \brief the clipping rectangle that the bands were split from; x1, y1, x2, y2
+		 */
+		int bandClip_[4];
+		
+		/**
+		 * \var bandJob_
+		 * \brief the commands that the bands are being drawn for
+		 */
+		RenderBandJob bandJob_;
+		
+		/**
+		 * \var verifyBands_
+		 * \brief true to draw every banded frame in one band too and compare them
+		 */
+		bool verifyBands_;
+		
+		/**
+		 * \var framesVerified_
+		 * \brief the number of frames that were drawn both ways and compared
+		 */
+		unsigned int framesVerified_;
+		
+		/**
+		 * \var framesDiffered_
+		 * \brief the number of compared frames that were different
+		 */
+		unsigned int framesDiffered_;
+	}; // end class
+
+/**
+ * \def RenderQueue
+ * \brief an alias for the RenderQueueSingleton::GetInstance() function to make your code clean.
+ */
+#define RenderQueue RenderQueueSingleton::GetInstance()
+} // end namespace
+#endif
+
+
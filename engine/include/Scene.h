@@ -16,12 +16,13 @@
 #ifndef __SCENE_H__
 #define __SCENE_H__
 
+#include "NameDirectory.h"
+
 namespace ENGINE
 {
 	// forward declare the classes we need
 	class SceneLayer;
 	class SceneLayerList;
-	class NameDirectory;
 	class ImageResource;
 	
 	/**
@@ -39,9 +40,11 @@ namespace ENGINE
 		
 		void AddLayer(const char* layerName, SceneLayer* layer);
 		SceneLayer* GetLayer(const char* layerName);
+		SceneLayer* GetLayer(NameID layerName);
 		
 		void Update(float deltaTime);
 		void Render(ImageResource* target);
+		void QueueRender();
 		
 	private:
 	
@@ -60,6 +60,14 @@ namespace ENGINE
 		 */
 		virtual void Render(ImageResource* target) = 0;
 		
+		/**
+		 * Records rendering the layer with the render queue, for a state that draws with RenderQueueSingleton::BeginScene().
+		 * The default records a call to Render() with the secondary display buffer, which the render thread has to draw
+		 * before the next frame is updated; override this to record the drawing itself, so that the render queue can draw
+		 * it while the next frame is updated and split it between threads.
+		 */
+		virtual void QueueRender();
+		
 		/**
 		 * De-allocates the data for the layer
 		 * pure-virtual. must be implemented in an inherited class
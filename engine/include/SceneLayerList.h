@@ -44,6 +44,7 @@ namespace ENGINE
 		
 		void Update(float deltaTime);
 		void Render(ImageResource* target);
+		void QueueRender();
 		
 	private:
 		
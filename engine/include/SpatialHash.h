@@ -0,0 +1,322 @@
+// CODESTYLE: v2.0
+
+// SpatialHash.h
+// Project: Game Engine Design 101 Project (ENGINE)
+// Author: Richard Marks
+// Purpose: finds the game objects whose boxes overlap, by sorting the boxes into the cells of a hashed grid
+
+/**
+ * \file SpatialHash.h
+ * \brief Game Object Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __SPATIALHASH_H__
+#define __SPATIALHASH_H__
+
+#include <vector>
+
+#include "Threading.h"
+
+namespace ENGINE
+{
+	// forward declare classes that we need
+	class GameObject;
+	class GameObjectGroup;
+	
+	/**
+	 * \typedef SpatialProxyID
+	 * \brief identifies the box of an object in a SpatialHash
+	 */
+	typedef unsigned int SpatialProxyID;
+	
+	//! a proxy ID that is never given to a box
+	const SpatialProxyID SPATIAL_HASH_NO_PROXY = 0xFFFFFFFF;
+	
+	//! the width and height of the cells of a spatial hash in pixels, unless it is given another size
+	const float SPATIAL_HASH_DEFAULT_CELL_SIZE = 64.0f;
+	
+	//! the number of buckets that a spatial hash starts with; there are always at least as many buckets as boxes
+	const unsigned int SPATIAL_HASH_MIN_BUCKETS = 1024;
+	
+	/**
+	 * \struct SpatialBox
+	 * \brief an axis aligned box; a box covers the points from its left up to its right, and from its top up to its bottom
+	 * \ingroup ObjectGroup
+	 */
+	struct SpatialBox
+	{
+		//! the left edge
+		float left;
+		//! the top edge
+		float top;
+		//! the right edge, which is past the last point of the box
+		float right;
+		//! the bottom edge, which is past the last point of the box
+		float bottom;
+	};
+	
+	/**
+	 * \struct SpatialPair
+	 * \brief two objects whose boxes overlap
+	 * \ingroup ObjectGroup
+	 */
+	struct SpatialPair
+	{
+		//! the object from the first group
+		GameObject* first;
+		//! the object from the second group
+		GameObject* second;
+	};
+	
+	/**
+	 * \class SpatialHash
+	 * \brief finds the game objects whose boxes overlap, by sorting the boxes into the cells of a hashed grid
+	 * \ingroup ObjectGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The grid has no edges; the cells are hashed into a table of buckets, so the world can be any size and only the
+	 * cells that hold a box take any memory. A box is only checked against the boxes in the cells it covers, so finding
+	 * the pairs of n objects costs about n instead of n * n, as long as the cells are about the size of the boxes.\n
+	 * An object registers its box with Insert() when it is created, reports where the box went with Move() every time it
+	 * moves, and takes it out with Remove() in its Destroy method. Move() can be called from the objects of any group,
+	 * including the parallel ones, because it only puts the box back into its cells when it has crossed into other
+	 * cells, and that is done by UpdateCells() on the main thread; GameObjectGroupManager::CallUpdate() calls it once
+	 * every group has been updated, so the queries and pairs are ready from then until the next update.
+	 * The rest of the functions must be called from the main thread.
+	 * \code
+// in Bullet::Create()
+proxy_ = spatialHash->Insert(this, bullets, box_);
+
+// in Bullet::Update()
+spatialHash->Move(proxy_, box_);
+
+// once a frame, after GameObjectGroupManager::CallUpdate()
+std::vector<SpatialPair> hits;
+spatialHash->FindPairs(bullets, enemies, hits);
+	 * \endcode
+	 */
+	class SpatialHash
+	{
+	public:
+		/**
+		 * creates an empty spatial hash
+		 * @param cellSize is the width and height of the cells in pixels; about the size of the larger objects works best
+		 */
+		SpatialHash(float cellSize);
+		
+		/**
+		 * class destructor
+		 */
+		~SpatialHash();
+		
+		/**
+		 * Adds the box of an object
+		 * @param object is the object that the box belongs to
+		 * @param group is the group of the object, which queries and pairs are narrowed down by
+		 * @param box is where the object is
+		 * \return the ID of the box, for Move() and Remove()
+		 */
+		SpatialProxyID Insert(GameObject* object, GameObjectGroup* group, const SpatialBox& box);
+		
+		/**
+		 * Moves the box of an object; the box is put into its new cells by the next UpdateCells().
+		 * Safe to call from any thread, as long as only one thread moves each box. A box that was removed is not moved,
+		 * and a warning is logged.
+		 * @param proxyID is the ID that Insert() returned
+		 * @param box is where the object is now
+		 */
+		void Move(SpatialProxyID proxyID, const SpatialBox& box);
+		
+		/**
+		 * Removes the box of an object
+		 * @param proxyID is the ID that Insert() returned, which is given to another box afterwards
+		 */
+		void Remove(SpatialProxyID proxyID);
+		
+		/**
+		 * Puts the boxes that crossed into other cells since the last call into their new cells
+		 */
+		void UpdateCells();
+		
+		/**
+		 * Finds the objects whose boxes overlap a region
+		 * @param region is the region to look in
+		 * @param objects has the objects added to the end of it
+		 * @param group is the group to look for objects of, or 0 to find the objects of every group
+		 */
+		void Query(const SpatialBox& region, std::vector<GameObject*>& objects, GameObjectGroup* group = 0);
+		
+		/**
+		 * Finds every object of one group whose box overlaps the box of an object of another group
+		 * @param firstGroup is the group of the first object of every pair
+		 * @param secondGroup is the group of the second object of every pair; if it is the same group as \a firstGroup,
+		 * every pair of its objects is found once
+		 * @param pairs has the pairs added to the end of it
+		 */
+		void FindPairs(GameObjectGroup* firstGroup, GameObjectGroup* secondGroup, std::vector<SpatialPair>& pairs);
+		
+		/**
+		 * Changes the size of the cells, and sorts every box into the new cells
+		 * @param cellSize is the width and height of the cells in pixels
+		 */
+		void SetCellSize(float cellSize);
+		
+		/**
+		 * \return the width and height of the cells in pixels
+		 */
+		float GetCellSize();
+		
+		/**
+		 * \return the number of boxes
+		 */
+		unsigned int GetProxyCount();
+		
+		/**
+		 * Times the spatial hash with 1000 to 100000 moving boxes, checks the pairs it finds against checking every box
+		 * against every other box, and writes the results to the log
+		 */
+		static void RunBenchmark();
+		
+		/**
+		 * Handles the creation of an instance of this class
+		 * @param cellSize is the width and height of the cells in pixels
+		 * \return an allocated pointer to a new instance of the SpatialHash class
+		 */
+		static SpatialHash* Create(float cellSize = SPATIAL_HASH_DEFAULT_CELL_SIZE);
+		
+		/**
+		 * Handles the memory release of an instance of this class
+		 * @param hashInstance is a pointer to a SpatialHash class instance allocated by the SpatialHash::Create() function
+		 */
+		static void Destroy(SpatialHash* hashInstance);
+	
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		SpatialHash(const SpatialHash& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const SpatialHash& operator=(const SpatialHash& rhs);
+		
+		/**
+		 * \struct Proxy
+		 * \brief the box of an object, and the cells that it is in
+		 */
+		struct Proxy
+		{
+			//! the object that the box belongs to
+			GameObject* object;
+			//! the group of the object
+			GameObjectGroup* group;
+			//! where the object is
+			SpatialBox box;
+			//! the column of the leftmost cell that the box is in
+			int cellLeft;
+			//! the row of the topmost cell that the box is in
+			int cellTop;
+			//! the column of the rightmost cell that the box is in
+			int cellRight;
+			//! the row of the bottommost cell that the box is in
+			int cellBottom;
+			//! the number of the last search that found the box, so that a box in several cells is only found once
+			unsigned int searchStamp;
+			//! true if the proxy holds a box
+			bool alive;
+			//! true if the box has moved into other cells and is waiting for UpdateCells()
+			bool moved;
+		};
+		
+		/**
+		 * Works out the cells that a box covers
+		 */
+		void GetCellsInternal(const SpatialBox& box, int& cellLeft, int& cellTop, int& cellRight, int& cellBottom);
+		
+		/**
+		 * \return the bucket of a cell
+		 */
+		std::vector<unsigned int>& GetBucketInternal(int column, int row);
+		
+		/**
+		 * Adds a proxy to the buckets of the cells that it is in
+		 */
+		void AddToCellsInternal(unsigned int proxyIndex);
+		
+		/**
+		 * Takes a proxy out of the buckets of the cells that it is in
+		 */
+		void RemoveFromCellsInternal(unsigned int proxyIndex);
+		
+		/**
+		 * Starts a search, so that the boxes it finds can be told apart from the ones found by the last search
+		 * \return the number of the search
+		 */
+		unsigned int NextSearchInternal();
+		
+		/**
+		 * Empties the buckets, makes \a bucketCount of them, and adds every box to them again
+		 */
+		void RebuildInternal(unsigned int bucketCount);
+		
+		/**
+		 * \var cellSize_
+		 * \brief the width and height of the cells in pixels
+		 */
+		float cellSize_;
+		
+		/**
+		 * \var inverseCellSize_
+		 * \brief 1 divided by the size of the cells, so that finding the cell of a point is a multiplication
+		 */
+		float inverseCellSize_;
+		
+		/**
+		 * \var proxies_
+		 * \brief every box, in the order of their IDs
+		 */
+		std::vector<Proxy> proxies_;
+		
+		/**
+		 * \var freeProxies_
+		 * \brief the IDs of removed boxes, which are given to new boxes first
+		 */
+		std::vector<unsigned int> freeProxies_;
+		
+		/**
+		 * \var buckets_
+		 * \brief the IDs of the boxes in each bucket; there is a power of two of them, and a cell goes in the bucket of its hash
+		 */
+		std::vector<std::vector<unsigned int> > buckets_;
+		
+		/**
+		 * \var movedProxies_
+		 * \brief the boxes that crossed into other cells since the last UpdateCells()
+		 */
+		std::vector<unsigned int> movedProxies_;
+		
+		/**
+		 * \var movedMutex_
+		 * \brief guards the moved boxes, which are added to from the threads of the job system during a parallel update
+		 */
+		Mutex movedMutex_;
+		
+		/**
+		 * \var proxyCount_
+		 * \brief the number of boxes
+		 */
+		unsigned int proxyCount_;
+		
+		/**
+		 * \var searchStamp_
+		 * \brief counts the searches, for Proxy::searchStamp
+		 */
+		unsigned int searchStamp_;
+	}; // end class
+
+} // end namespace
+#endif
+
+
@@ -0,0 +1,299 @@
+// CODESTYLE: v2.0
+
+// SpriteBatch.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Collects the sprites drawn during a frame, and draws them sorted by layer and source image
+
+#ifndef __SPRITEBATCH_H__
+#define __SPRITEBATCH_H__
+
+/**
+ * \file SpriteBatch.h
+ * \brief Sprite Batch Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#include <vector>
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	class ImageResource;
+	
+	//! the Allegro blender state of a thread that has not set a blender
+	const int SPRITE_BATCH_NO_BLENDER = -1;
+	
+	//! the Allegro blender state of a thread that has set the alpha blender
+	const int SPRITE_BATCH_ALPHA_BLENDER = 256;
+	
+	//! how many groups of sprites back a sprite looks for a group with its source image before it starts a new one
+	const unsigned int SPRITE_BATCH_MAX_GROUP_SEARCH = 64;
+	
+	/**
+	 * \enum SpriteBlendMode
+	 * \brief how a sprite is drawn onto its destination
+	 * \ingroup GraphicsGroup
+	 */
+	enum SpriteBlendMode
+	{
+		//! every pixel is copied, like ImageResource::Blit()
+		SpriteBlend_Solid = 0,
+		//! the mask color is skipped, like ImageResource::BlitMasked()
+		SpriteBlend_Masked,
+		//! blended with a constant alpha, like ImageResource::BlitAlpha()
+		SpriteBlend_Trans,
+		//! blended with the alpha of each pixel of a 32 bit image, like ImageResource::BlitAlphaSprite()
+		SpriteBlend_Alpha
+	};
+	
+	/**
+	 * \struct SpriteDrawCommand
+	 * \brief a sprite that is waiting to be drawn by the sprite batch
+	 * \ingroup GraphicsGroup
+	 */
+	struct SpriteDrawCommand
+	{
+		//! the image that the sprite is drawn from
+		ImageResource* source;
+		//! the image that the sprite is drawn onto
+		ImageResource* destination;
+		//! the left of the rectangle of the source image
+		int srcX;
+		//! the top of the rectangle of the source image
+		int srcY;
+		//! the width of the rectangle
+		int width;
+		//! the height of the rectangle
+		int height;
+		//! where the left of the rectangle goes on the destination image
+		int destX;
+		//! where the top of the rectangle goes on the destination image
+		int destY;
+		//! lower layers are drawn first
+		int layer;
+		//! how the sprite is drawn
+		SpriteBlendMode blendMode;
+		//! the alpha from 0 to 255 for SpriteBlend_Trans
+		int alpha;
+		//! the order that the sprite was drawn in, which keeps the order of the sprites of a layer that share an image
+		unsigned int order;
+		//! the group of sprites of its layer that it is drawn with; set by SpriteBatchSingleton::End()
+		unsigned int group;
+	};
+	
+	/**
+	 * \class SpriteBatchSingleton
+	 * \brief Collects the sprites drawn during a frame, and draws them sorted by layer and source image
+	 * \ingroup GraphicsGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Between Begin() and End(), Draw() only records the sprite. End() sorts the sprites by destination and layer, and
+	 * gathers the sprites of a layer that share a source image into groups, and draws them all in one pass. A sprite
+	 * only joins an earlier group of its image if it does not overlap any sprite of another image that was drawn
+	 * after that group started, so the sprites that overlap are always drawn in the order that they were drawn in, and
+	 * the order does not depend on where the images are in memory. The clipping
+	 * rectangle of each destination is read once per batch, and sprites that fall outside of it are dropped before
+	 * anything is drawn. Sprites drawn outside of a batch are drawn straight away.\n
+	 * GameObjectGroupManager::CallRender() wraps the game objects in a batch, so a GameObject::Render() only has to
+	 * call SpriteBatch->Draw() instead of blitting. An image that is drawn onto in a batch should not be drawn from
+	 * in the same batch, since the sorting does not keep the order between destinations.\n
+	 * There is a MACRO defined called SpriteBatch that is just an alias to calling the
+	 * SpriteBatchSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 */
+	class SpriteBatchSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the sprite batch singleton class instance
+		 */
+		static SpriteBatchSingleton* GetInstance();
+		
+		/**
+		 * Starts recording sprites. Batches can be nested, and only the outermost End() draws the sprites.
+		 */
+		void Begin();
+		
+		/**
+		 * Sorts and draws the sprites recorded since the outermost Begin()
+		 */
+		void End();
+		
+		/**
+		 * \return true if the sprites are being recorded
+		 */
+		bool IsBatching();
+		
+		/**
+		 * Draws a whole image
+		 * @param source is the image to draw
+		 * @param destination is the image to draw onto
+		 * @param destX is the X coordinate on the destination image in pixels
+		 * @param destY is the Y coordinate on the destination image in pixels
+		 * @param layer is the layer of the sprite; lower layers are drawn first
+		 * @param blendMode is how the sprite is drawn
+		 * @param alpha is the alpha from 0.0f to 1.0f for SpriteBlend_Trans
+		 */
+		void Draw(
+			ImageResource* source,
+			ImageResource* destination,
+			int destX, int destY,
+			int layer = 0,
+			SpriteBlendMode blendMode = SpriteBlend_Masked,
+			float alpha = 1.0f);
+		
+		/**
+		 * Draws a rectangle of an image
+		 * @param source is the image to draw
+		 * @param srcX is the X coordinate of the upper-left corner of the rectangle on the source image in pixels
+		 * @param srcY is the Y coordinate of the upper-left corner of the rectangle on the source image in pixels
+		 * @param width is the width of the rectangle in pixels
+		 * @param height is the height of the rectangle in pixels
+		 * @param destination is the image to draw onto
+		 * @param destX is the X coordinate on the destination image in pixels
+		 * @param destY is the Y coordinate on the destination image in pixels
+		 * @param layer is the layer of the sprite; lower layers are drawn first
+		 * @param blendMode is how the sprite is drawn
+		 * @param alpha is the alpha from 0.0f to 1.0f for SpriteBlend_Trans
+		 */
+		void Draw(
+			ImageResource* source,
+			int srcX, int srcY,
+			int width, int height,
+			ImageResource* destination,
+			int destX, int destY,
+			int layer = 0,
+			SpriteBlendMode blendMode = SpriteBlend_Masked,
+			float alpha = 1.0f);
+		
+		/**
+		 * \return the number of sprites drawn by the last batch
+		 */
+		unsigned int GetSpritesDrawn();
+		
+		/**
+		 * \return the number of sprites of the last batch that were outside of the clipping rectangle
+		 */
+		unsigned int GetSpritesCulled();
+		
+		/**
+		 * \return the number of times that the last batch went from one source image to another
+		 */
+		unsigned int GetSourceSwitches();
+		
+		/**
+		 * Clips a sprite to its source image and to a clipping rectangle, whose right and bottom edges are inside of it
+		 * \return false if nothing is left to draw
+		 */
+		static bool ClipSprite(SpriteDrawCommand& command, int clipX1, int clipY1, int clipX2, int clipY2);
+		
+		/**
+		 * Draws a sprite that has been clipped by SpriteBatchSingleton::ClipSprite().
+		 * The Allegro blender is only changed when the sprite needs another one.
+		 * @param command is the sprite to draw
+		 * @param blender is the blender that the calling thread set last; SPRITE_BATCH_NO_BLENDER, SPRITE_BATCH_ALPHA_BLENDER, or the alpha of the trans blender
+		 */
+		static void DrawClippedSprite(const SpriteDrawCommand& command, int& blender);
+		
+		/**
+		 * Puts the Allegro blender back the way that ImageResource::BlitAlphaSprite() leaves it, if a sprite changed it
+		 * @param blender is the blender that the calling thread set last
+		 */
+		static void RestoreBlender(int& blender);
+		
+		/**
+		 * destructor
+		 */
+		~SpriteBatchSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		SpriteBatchSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		SpriteBatchSingleton(const SpriteBatchSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const SpriteBatchSingleton& operator=(const SpriteBatchSingleton& rhs);
+		
+		/**
+		 * \struct SpriteGroup
+		 * \brief sprites of a layer that share a source image and are drawn one after the other
+		 */
+		struct SpriteGroup
+		{
+			//! the image that the sprites are drawn from
+			ImageResource* source;
+			//! the left of the box around the sprites on the destination image
+			int left;
+			//! the top of the box around the sprites on the destination image
+			int top;
+			//! the right of the box around the sprites, which is past the last pixel
+			int right;
+			//! the bottom of the box around the sprites, which is past the last pixel
+			int bottom;
+		};
+		
+		/**
+		 * Puts every sprite into a group, once the sprites are sorted by destination, layer, and the order that they were drawn in
+		 */
+		void GroupSpritesInternal();
+		
+		/**
+		 * \var commands_
+		 * \brief the sprites recorded since the outermost Begin()
+		 */
+		std::vector<SpriteDrawCommand> commands_;
+		
+		/**
+		 * \var groups_
+		 * \brief the groups of the sprites of the batch that is being drawn
+		 */
+		std::vector<SpriteGroup> groups_;
+		
+		/**
+		 * \var depth_
+		 * \brief the number of Begin() calls that have not been ended yet
+		 */
+		int depth_;
+		
+		/**
+		 * \var blender_
+		 * \brief the Allegro blender that was set last while drawing
+		 */
+		int blender_;
+		
+		/**
+		 * \var spritesDrawn_
+		 * \brief the number of sprites drawn by the last batch
+		 */
+		unsigned int spritesDrawn_;
+		
+		/**
+		 * \var spritesCulled_
+		 * \brief the number of sprites of the last batch that were outside of the clipping rectangle
+		 */
+		unsigned int spritesCulled_;
+		
+		/**
+		 * \var sourceSwitches_
+		 * \brief the number of times that the last batch went from one source image to another
+		 */
+		unsigned int sourceSwitches_;
+	}; // end class
+
+/**
+ * \def SpriteBatch
+ * \brief an alias for the SpriteBatchSingleton::GetInstance() function to make your code clean.
+ */
+#define SpriteBatch SpriteBatchSingleton::GetInstance()
+} // end namespace
+#endif
+
+
@@ -0,0 +1,387 @@
+
+// CODESTYLE: v2.0
+
+// Threading.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Cross-platform threading primitives
+
+/**
+ * \file Threading.h
+ * \brief Cross-platform threading primitives - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ *
+ * The atomic operations use the GCC __sync builtins, which are available in GCC 4.1 and later on every platform
+ * that the engine is built for, including MinGW.
+ */
+
+#ifndef __THREADING_H__
+#define __THREADING_H__
+
+namespace ENGINE
+{
+	/**
+	 * Atomically adds to an integer
+	 * @param value is a pointer to the integer
+	 * @param amount is the amount to add
+	 * \return the new value of the integer
+	 */
+	inline int AtomicAdd(volatile int* value, int amount)
+	{
+		return __sync_add_and_fetch(value, amount);
+	}
+	
+	/**
+	 * Atomically adds one to an integer
+	 * \return the new value of the integer
+	 */
+	inline int AtomicIncrement(volatile int* value)
+	{
+		return __sync_add_and_fetch(value, 1);
+	}
+	
+	/**
+	 * Atomically subtracts one from an integer
+	 * \return the new value of the integer
+	 */
+	inline int AtomicDecrement(volatile int* value)
+	{
+		return __sync_sub_and_fetch(value, 1);
+	}
+	
+	/**
+	 * Atomically replaces an integer
+	 * @param value is a pointer to the integer
+	 * @param replacement is the value to store
+	 * \return the previous value of the integer
+	 */
+	inline int AtomicExchange(volatile int* value, int replacement)
+	{
+		return __sync_lock_test_and_set(value, replacement);
+	}
+	
+	/**
+	 * Atomically replaces an integer if it still has the expected value
+	 * @param value is a pointer to the integer
+	 * @param expected is the value that the integer must have
+	 * @param replacement is the value to store
+	 * \return true if the integer was replaced
+	 */
+	inline bool AtomicCompareAndSwap(volatile int* value, int expected, int replacement)
+	{
+		return __sync_bool_compare_and_swap(value, expected, replacement);
+	}
+	
+	/**
+	 * Atomically replaces a pointer if it still has the expected value
+	 * @param value is a pointer to the pointer
+	 * @param expected is the value that the pointer must have
+	 * @param replacement is the value to store
+	 * \return true if the pointer was replaced
+	 */
+	inline bool AtomicCompareAndSwapPointer(void* volatile* value, void* expected, void* replacement)
+	{
+		return __sync_bool_compare_and_swap(value, expected, replacement);
+	}
+	
+	/**
+	 * Makes sure that every memory write before the barrier is seen by other threads before any write after it
+	 */
+	inline void AtomicMemoryBarrier()
+	{
+		__sync_synchronize();
+	}
+	
+	/**
+	 * \return the number of processors that the program can run threads on; at least 1
+	 */
+	unsigned int GetProcessorCount();
+	
+	/**
+	 * Gives the rest of the time slice of the calling thread to any other thread that is ready to run
+	 */
+	void YieldThread();
+	
+	/**
+	 * \class Mutex
+	 * \brief A lock that only one thread can hold at a time
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class Mutex
+	{
+	public:
+		/**
+		 * creates the lock
+		 */
+		Mutex();
+		
+		/**
+		 * destroys the lock
+		 */
+		~Mutex();
+		
+		/**
+		 * Waits until the lock is free, and takes it
+		 */
+		void Lock();
+		
+		/**
+		 * Frees the lock
+		 */
+		void Unlock();
+		
+		/**
+		 * \return the platform lock object
+		 */
+		void* GetHandle();
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		Mutex(const Mutex& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const Mutex& operator=(const Mutex& rhs);
+		
+		/**
+		 * \var handle_
+		 * \brief the platform lock object; a pthread_mutex_t or a CRITICAL_SECTION
+		 */
+		void* handle_;
+	}; // end class
+	
+	/**
+	 * \class MutexLock
+	 * \brief Holds a Mutex for as long as it exists
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class MutexLock
+	{
+	public:
+		/**
+		 * takes the lock
+		 * @param mutex is the lock to take
+		 */
+		MutexLock(Mutex& mutex);
+		
+		/**
+		 * frees the lock
+		 */
+		~MutexLock();
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		MutexLock(const MutexLock& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const MutexLock& operator=(const MutexLock& rhs);
+		
+		/**
+		 * \var mutex_
+		 * \brief the lock that is held
+		 */
+		Mutex& mutex_;
+	}; // end class
+	
+	/**
+	 * \class ThreadEvent
+	 * \brief A flag that one thread can wait on until another thread signals it
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The event resets itself when a waiting thread wakes up, and a signal that is sent while no thread is waiting
+	 * is kept until the next wait.
+	 */
+	class ThreadEvent
+	{
+	public:
+		/**
+		 * creates the event in the unsignaled state
+		 */
+		ThreadEvent();
+		
+		/**
+		 * destroys the event
+		 */
+		~ThreadEvent();
+		
+		/**
+		 * Signals the event, waking up one waiting thread
+		 */
+		void Signal();
+		
+		/**
+		 * Waits until the event is signaled
+		 */
+		void Wait();
+		
+		/**
+		 * Waits until the event is signaled or the time runs out
+		 * @param milliseconds is the longest time to wait
+		 * \return true if the event was signaled, false if the time ran out
+		 */
+		bool WaitFor(unsigned int milliseconds);
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		ThreadEvent(const ThreadEvent& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const ThreadEvent& operator=(const ThreadEvent& rhs);
+		
+		/**
+		 * \var handle_
+		 * \brief the platform event object; a condition variable with its mutex and flag, or an event HANDLE
+		 */
+		void* handle_;
+	}; // end class
+	
+	/**
+	 * \typedef ThreadFunction
+	 * \brief the function that a Thread runs. The parameter is the data pointer given to Thread::Start()
+	 */
+	typedef void (*ThreadFunction)(void* data);
+	
+	/**
+	 * \class Thread
+	 * \brief A thread of execution
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class Thread
+	{
+	public:
+		/**
+		 * creates the class; no thread is started until Thread::Start() is called
+		 */
+		Thread();
+		
+		/**
+		 * waits for the thread to finish if it is still running
+		 */
+		~Thread();
+		
+		/**
+		 * Starts the thread
+		 * @param function is the function that the thread runs
+		 * @param data is passed to the function
+		 * \return true if the thread was started, false if it could not be started or is already running
+		 */
+		bool Start(ThreadFunction function, void* data);
+		
+		/**
+		 * Waits for the thread to return from its function
+		 */
+		void Join();
+		
+		/**
+		 * \return true if the thread was started and has not been joined
+		 */
+		bool IsRunning();
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		Thread(const Thread& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const Thread& operator=(const Thread& rhs);
+		
+		/**
+		 * \var handle_
+		 * \brief the platform thread object; a pthread_t or a thread HANDLE
+		 */
+		void* handle_;
+		
+		/**
+		 * \var function_
+		 * \brief the function that the thread runs
+		 */
+		ThreadFunction function_;
+		
+		/**
+		 * \var data_
+		 * \brief passed to the function
+		 */
+		void* data_;
+		
+		/**
+		 * runs the function of the thread; this is what the platform thread starts in
+		 */
+// only non-windows platforms use this
+#if !defined(WIN32)
+		static void* Run(void* thread);
+#else
+// this is for the windows platform
+		static unsigned long __stdcall Run(void* thread);
+#endif
+	}; // end class
+	
+	/**
+	 * \class ThreadLocalPointer
+	 * \brief A pointer that holds a different value in every thread
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class ThreadLocalPointer
+	{
+	public:
+		/**
+		 * creates the pointer. It starts out as 0 in every thread
+		 */
+		ThreadLocalPointer();
+		
+		/**
+		 * destroys the pointer. Whatever it points to is not deleted
+		 */
+		~ThreadLocalPointer();
+		
+		/**
+		 * \return the value of the pointer in the calling thread
+		 */
+		void* Get();
+		
+		/**
+		 * Sets the value of the pointer in the calling thread
+		 */
+		void Set(void* value);
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		ThreadLocalPointer(const ThreadLocalPointer& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const ThreadLocalPointer& operator=(const ThreadLocalPointer& rhs);
+		
+		/**
+		 * \var key_
+		 * \brief the platform thread local storage key; a pthread_key_t or a TLS index
+		 */
+		unsigned long key_;
+	}; // end class
+
+} // end namespace
+#endif
+
+
+
@@ -15,10 +15,62 @@
 #ifndef __TILEMAP_H__
 #define __TILEMAP_H__
 
+#include <vector>
+
 namespace ENGINE
 {
 	// forward declare the classes we need
 	class Tile;
+	class TileMap;
+	
+	/**
+	 * \class TileMapListener
+	 * \brief The abstract class for anything that needs to know when the tile values of a TileMap change
+	 * \ingroup TileBasedGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class TileMapListener
+	{
+	public:
+		
+		/**
+		 * virtual deconstructor
+		 */
+		virtual ~TileMapListener(){};
+		
+		/**
+		 * Called after the values of a rectangle of tiles have changed
+		 * @param tileMap is the tile map that changed
+		 * @param x is the X coordinate of the upper-left corner of the changed rectangle in tiles
+		 * @param y is the Y coordinate of the upper-left corner of the changed rectangle in tiles
+		 * @param width is the width of the changed rectangle in tiles
+		 * @param height is the height of the changed rectangle in tiles
+		 */
+		virtual void OnTilesChanged(TileMap* tileMap, int x, int y, int width, int height) = 0;
+		
+	}; // end class
+	
+	/**
+	 * \typedef TileValueType
+	 * \brief the packed storage type for a single tile value; a value between 0 and 65535
+	 */
+	typedef unsigned short TileValueType;
+	
+	//! the largest tile value that fits in a TileValueType
+	const unsigned int TILEMAP_MAX_TILE_VALUE = 0xFFFF;
+	
+	/**
+	 * \struct TileView
+	 * \brief a copy of the value and solidness of one tile of a TileMap
+	 * \ingroup TileBasedGroup
+	 */
+	struct TileView
+	{
+		//! the value of the tile, between 0 and 65535
+		unsigned int value;
+		//! true if the tile is solid, and false if it is not
+		bool solid;
+	};
 	
 	/**
 	 * \class TileMap
@@ -26,6 +78,11 @@ namespace ENGINE
 	 * \ingroup TileBasedGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
 	 *
+	 * The tile values are stored contiguously, row by row, in a single packed array of TileValueType,
+	 * and the solidness of the tiles is stored in a separate bitset. Use the row accessor and the bulk
+	 * fill and copy functions to sweep through the map in order; TileMap::GetTile() copies one tile out of the
+	 * packed storage and TileMap::SetTile() copies one tile into it.
+	 *
 	 * This class serves as a base class for more advanced tile maps
 	 * \sa ENGINE::LayeredTileMap
 	 */
@@ -50,6 +107,7 @@ namespace ENGINE
 		
 		/**
 		 * Sets a tile
+		 * The value and solidness of \a tile are copied into the map.
 		 * @param x is the X coordinate to set the tile in tiles
 		 * @param y is the Y coordiante to set the tile in tiles
 		 * @param tile is a pointer to an ENGINE::Tile structure to place on the tile map
@@ -67,11 +125,114 @@ namespace ENGINE
 		
 		/**
 		 * Gets a tile
+		 * The returned view is a copy of the value and solidness stored at the coordinate, so changing it does not
+		 * change the map; use TileMap::SetTile(), TileMap::SetValue() or TileMap::SetSolid() to change the map.
 		 * @param x is the X coordinate to get the tile from in tiles
 		 * @param y is the Y coordiante to get the tile from in tiles
-		 * \return a pointer to the ENGINE::Tile structure at the coordinate specified or 0 if the coordinate is invalid
+		 * \return the value and solidness of the tile at the coordinate specified, or 0 and non-solid if the
+		 * coordinate is invalid
+		 */
+		TileView GetTile(int x, int y);
+		
+		/**
+		 * Sets the value of a tile
+		 * @param x is the X coordinate of the tile in tiles
+		 * @param y is the Y coordinate of the tile in tiles
+		 * @param value is a value between 0 and 65535; larger values are rejected with a warning
+		 */
+		void SetValue(int x, int y, unsigned int value);
+		
+		/**
+		 * Gets the value of a tile
+		 * @param x is the X coordinate of the tile in tiles
+		 * @param y is the Y coordinate of the tile in tiles
+		 * \return the value of the tile or 0 if the coordinate is invalid
+		 */
+		unsigned int GetValue(int x, int y);
+		
+		/**
+		 * Sets the solidness of a tile
+		 * @param x is the X coordinate of the tile in tiles
+		 * @param y is the Y coordinate of the tile in tiles
+		 * @param isSolid is true if the tile is solid, and false if it is not. Default is true
 		 */
-		Tile* GetTile(int x, int y);
+		void SetSolid(int x, int y, bool isSolid = true);
+		
+		/**
+		 * Gets the solidness of a tile
+		 * @param x is the X coordinate of the tile in tiles
+		 * @param y is the Y coordinate of the tile in tiles
+		 * \return true if the tile is solid, and false if it is not or if the coordinate is invalid
+		 */
+		bool IsSolid(int x, int y);
+		
+		/**
+		 * Gets a row of tile values
+		 * The row is TileMap::GetWidth() values long, and the rows are stored one after the other,
+		 * so the pointer to row 0 can be used to walk the entire map.
+		 * If you change values through the pointer, call TileMap::NotifyChanged() afterwards.
+		 * @param y is the row to get in tiles
+		 * \return a pointer to the first tile value of the row or 0 if the row is invalid
+		 */
+		TileValueType* GetRow(int y);
+		
+		/**
+		 * Fills a rectangle of the tile map with a single tile value and solidness
+		 * The rectangle is clipped to the bounds of the tile map.
+		 * @param x is the X coordinate of the upper-left corner of the rectangle in tiles
+		 * @param y is the Y coordinate of the upper-left corner of the rectangle in tiles
+		 * @param width is the width of the rectangle in tiles
+		 * @param height is the height of the rectangle in tiles
+		 * @param value is a value between 0 and 65535; larger values are rejected with a warning
+		 * @param isSolid is true if the tiles are solid, and false if they are not. Default is false
+		 */
+		void Fill(int x, int y, int width, int height, unsigned int value, bool isSolid = false);
+		
+		/**
+		 * Copies tile values into a rectangle of the tile map
+		 * The source is read row by row, \a width values per row. The solidness of the tiles is not changed.
+		 * The rectangle must lie entirely inside of the tile map.
+		 * @param x is the X coordinate of the upper-left corner of the rectangle in tiles
+		 * @param y is the Y coordinate of the upper-left corner of the rectangle in tiles
+		 * @param width is the width of the rectangle in tiles
+		 * @param height is the height of the rectangle in tiles
+		 * @param values is a pointer to \a width times \a height tile values
+		 */
+		void CopyValuesIn(int x, int y, int width, int height, const TileValueType* values);
+		
+		/**
+		 * Copies tile values out of a rectangle of the tile map
+		 * The destination is written row by row, \a width values per row.
+		 * The rectangle must lie entirely inside of the tile map.
+		 * @param x is the X coordinate of the upper-left corner of the rectangle in tiles
+		 * @param y is the Y coordinate of the upper-left corner of the rectangle in tiles
+		 * @param width is the width of the rectangle in tiles
+		 * @param height is the height of the rectangle in tiles
+		 * @param values is a pointer to room for \a width times \a height tile values
+		 */
+		void CopyValuesOut(int x, int y, int width, int height, TileValueType* values);
+		
+		/**
+		 * Adds a listener that is told whenever the tile values change
+		 * @param listener is a pointer to the listener to add. The tile map does not take ownership.
+		 */
+		void AddListener(TileMapListener* listener);
+		
+		/**
+		 * Removes a listener
+		 * @param listener is a pointer to the listener to remove
+		 */
+		void RemoveListener(TileMapListener* listener);
+		
+		/**
+		 * Tells all of the listeners that the values of a rectangle of tiles have changed
+		 * This is called for you by the functions that change tile values.
+		 * @param x is the X coordinate of the upper-left corner of the changed rectangle in tiles
+		 * @param y is the Y coordinate of the upper-left corner of the changed rectangle in tiles
+		 * @param width is the width of the changed rectangle in tiles
+		 * @param height is the height of the changed rectangle in tiles
+		 */
+		void NotifyChanged(int x, int y, int width, int height);
 		
 		/**
 		 * Gets the width of the tile map
@@ -93,10 +254,30 @@ namespace ENGINE
 		virtual void Destroy();
 		
 		/**
-		 * \var tiles_
-		 * \brief an array of pointers to ENGINE::Tile structures
+		 * Checks that a coordinate lies inside of the tile map
+		 * @param x is the X coordinate in tiles
+		 * @param y is the Y coordinate in tiles
+		 * \return true if the coordinate is valid
 		 */
-		Tile** tiles_;
+		bool IsValidCoordinate(int x, int y);
+		
+		/**
+		 * Checks that a rectangle lies entirely inside of the tile map
+		 * \return true if the rectangle is valid
+		 */
+		bool IsValidRect(int x, int y, int width, int height);
+		
+		/**
+		 * \var values_
+		 * \brief the packed array of tile values, stored row by row
+		 */
+		TileValueType* values_;
+		
+		/**
+		 * \var solidity_
+		 * \brief a bitset holding the solidness of each tile, one bit per tile
+		 */
+		unsigned char* solidity_;
 		
 		/**
 		 * \var mapWidth_
@@ -109,6 +290,24 @@ namespace ENGINE
 		 * \brief the height of the tile map in tiles
 		 */
 		int mapHeight_;
+		
+		/**
+		 * \var listeners_
+		 * \brief the listeners that are told when the tile values change
+		 */
+		std::vector<TileMapListener*> listeners_;
+	
+	private:
+	
+		/**
+		 * hidden copy constructor
+		 */
+		TileMap(const TileMap& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const TileMap& operator=(const TileMap& rhs);
 	
 	}; // end class
 
@@ -116,3 +315,4 @@ namespace ENGINE
 #endif
 
 
+
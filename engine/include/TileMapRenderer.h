@@ -15,13 +15,56 @@
 #ifndef __TILEMAPRENDERER_H__
 #define __TILEMAPRENDERER_H__
 
+#include <vector>
+
+#include "TileMap.h"
+
 namespace ENGINE
 {
 	// forward declare the classes we need
-	class TileMap;
 	class Tileset;
 	class ImageResource;
 	
+	/**
+	 * \struct TileMapView
+	 * \brief where the camera and the viewport of a TileMapRenderer were when the view was taken
+	 * \ingroup TileBasedGroup
+	 */
+	struct TileMapView
+	{
+		//! the X coordinate of the camera in pixels
+		int cameraX;
+		//! the Y coordinate of the camera in pixels
+		int cameraY;
+		//! the X coordinate of the upper-left corner of the viewport on the render target in pixels
+		int viewportX;
+		//! the Y coordinate of the upper-left corner of the viewport on the render target in pixels
+		int viewportY;
+		//! the width of the viewport in pixels
+		int viewportWidth;
+		//! the height of the viewport in pixels
+		int viewportHeight;
+	};
+	
+	/**
+	 * \struct TileMapViewTiles
+	 * \brief the values of the tiles that were visible in a TileMapView, copied out of the tile map
+	 * \ingroup TileBasedGroup
+	 */
+	struct TileMapViewTiles
+	{
+		//! the column of the first copied tile
+		int firstColumn;
+		//! the row of the first copied tile
+		int firstRow;
+		//! the number of columns that were copied
+		int columnCount;
+		//! the number of rows that were copied
+		int rowCount;
+		//! the copied values, row by row, \a columnCount values per row
+		const TileValueType* values;
+	};
+	
 	/**
 	 * \class TileMapRenderer
 	 * \brief A class for rendering a TileMap onto an ImageResource using an Tileset
@@ -55,13 +98,13 @@ namespace ENGINE
 		 * Sets the tilemap
 		 * @param tileMap is the tilemap to render
 		 */
-		void SetTileMap(TileMap* tileMap);
+		virtual void SetTileMap(TileMap* tileMap);
 		
 		/**
 		 * Sets the tileset
 		 * @param tileSet is the tileset with which to render
 		 */
-		void SetTileset(Tileset* tileSet);
+		virtual void SetTileset(Tileset* tileSet);
 		
 		/**
 		 * Sets the render target
@@ -69,15 +112,181 @@ namespace ENGINE
 		 */
 		void SetRenderTarget(ImageResource* target);
 		
+		/**
+		 * Sets the camera position
+		 * The camera is the world-space pixel coordinate of the tile map that will appear
+		 * at the upper-left corner of the viewport.
+		 * @param x is the X coordinate of the camera in pixels
+		 * @param y is the Y coordinate of the camera in pixels
+		 */
+		void SetCamera(int x, int y);
+		
+		/**
+		 * Moves the camera relative to its current position
+		 * @param deltaX is the number of pixels to scroll along the X axis
+		 * @param deltaY is the number of pixels to scroll along the Y axis
+		 */
+		void ScrollCamera(int deltaX, int deltaY);
+		
+		/**
+		 * Sets the viewport
+		 * The viewport is the rectangle on the render target that the map is rendered into.
+		 * Nothing is drawn outside of the viewport.
+		 * If the viewport has never been set, or if the \a width or \a height is zero,
+		 * then the whole render target is used as the viewport.
+		 * @param x is the X coordinate of the upper-left corner of the viewport on the render target in pixels
+		 * @param y is the Y coordinate of the upper-left corner of the viewport on the render target in pixels
+		 * @param width is the width of the viewport in pixels
+		 * @param height is the height of the viewport in pixels
+		 */
+		void SetViewport(int x, int y, int width, int height);
+		
+		/**
+		 * \return the X coordinate of the camera in pixels
+		 */
+		int GetCameraX();
+		
+		/**
+		 * \return the Y coordinate of the camera in pixels
+		 */
+		int GetCameraY();
+		
+		/**
+		 * \return the X coordinate of the upper-left corner of the viewport on the render target in pixels
+		 */
+		int GetViewportX();
+		
+		/**
+		 * \return the Y coordinate of the upper-left corner of the viewport on the render target in pixels
+		 */
+		int GetViewportY();
+		
+		/**
+		 * \return the width of the viewport in pixels
+		 */
+		int GetViewportWidth();
+		
+		/**
+		 * \return the height of the viewport in pixels
+		 */
+		int GetViewportHeight();
+		
+		/**
+		 * \return the current camera position and viewport, for drawing later with RenderView()
+		 */
+		TileMapView GetView();
+		
+		/**
+		 * Copies the values of the tiles that are visible in \a view onto the end of \a values, row by row, so that they
+		 * can be drawn with RenderView() after the tile map has changed
+		 * @param view is the camera position and viewport to copy the tiles of
+		 * @param values has the values of the visible tiles added to the end of it
+		 * @param tiles receives the range of the copied tiles; its values pointer is left at 0, because \a values may
+		 * move when more is added to it
+		 * \return false if no tile is visible, in which case nothing is copied
+		 */
+		bool CopyViewTiles(const TileMapView& view, std::vector<TileValueType>& values, TileMapViewTiles& tiles);
+		
+		/**
+		 * Draws tiles that were copied by CopyViewTiles(), like the default Render() does, but only inside of a clipping rectangle.
+		 * The tile map is not read, the clipping rectangle of \a target is not changed and nothing is marked dirty, so
+		 * several threads can draw different rectangles of the same target at once, while the main thread changes the
+		 * tile map. The tileset must not be changed meanwhile.
+		 * @param target is the image to draw the tiles on
+		 * @param view is the camera position and viewport to draw
+		 * @param tiles is the copy of the tiles that were visible in \a view
+		 * @param clipX1 is the X coordinate of the upper-left corner of the clipping rectangle
+		 * @param clipY1 is the Y coordinate of the upper-left corner of the clipping rectangle
+		 * @param clipX2 is the X coordinate of the lower-right corner of the clipping rectangle, which is drawn on
+		 * @param clipY2 is the Y coordinate of the lower-right corner of the clipping rectangle, which is drawn on
+		 */
+		void RenderView(ImageResource* target, const TileMapView& view, const TileMapViewTiles& tiles, int clipX1, int clipY1, int clipX2, int clipY2);
+		
 		/**
 		 * a default rendering function
-		 * override this to perform more complex rendering than just 
-		 * blitting the whole map to the render target
+		 * only the tiles that are visible through the viewport at the current camera position are drawn,
+		 * so the cost of rendering depends on the size of the viewport, and not on the size of the map.
+		 * override this to perform more complex rendering
 		 */
 		virtual void Render();
 		
 	protected:
 	
+		/**
+		 * Calculates the range of tiles that are visible through the viewport
+		 * The range is clipped to the bounds of the tile map.
+		 * @param firstColumn receives the first visible column in tiles
+		 * @param firstRow receives the first visible row in tiles
+		 * @param lastColumn receives one past the last visible column in tiles
+		 * @param lastRow receives one past the last visible row in tiles
+		 * \return false if no part of the tile map is visible
+		 */
+		bool GetVisibleTileRange(int& firstColumn, int& firstRow, int& lastColumn, int& lastRow);
+		
+		/**
+		 * Calculates the range of tiles that are visible in \a view
+		 * \return false if no part of the tile map is visible
+		 */
+		bool GetVisibleTileRange(const TileMapView& view, int& firstColumn, int& firstRow, int& lastColumn, int& lastRow);
+		
+		/**
+		 * Sets the clipping rectangle of the render target to the part of the viewport that lies inside of the current clipping rectangle
+		 * @param oldClipX1 receives the X coordinate of the upper-left corner of the previous clipping rectangle
+		 * @param oldClipY1 receives the Y coordinate of the upper-left corner of the previous clipping rectangle
+		 * @param oldClipX2 receives the X coordinate of the lower-right corner of the previous clipping rectangle
+		 * @param oldClipY2 receives the Y coordinate of the lower-right corner of the previous clipping rectangle
+		 * \return false if the viewport is completely clipped away, in which case the clipping rectangle was not changed
+		 */
+		bool ClipToViewport(int& oldClipX1, int& oldClipY1, int& oldClipX2, int& oldClipY2);
+		
+		/**
+		 * Draws a rectangular range of tiles
+		 * @param target is the image to draw the tiles on
+		 * @param firstColumn is the first column to draw in tiles
+		 * @param firstRow is the first row to draw in tiles
+		 * @param lastColumn is one past the last column to draw in tiles
+		 * @param lastRow is one past the last row to draw in tiles
+		 * @param startX is the X coordinate on \a target in pixels to draw the first tile at
+		 * @param startY is the Y coordinate on \a target in pixels to draw the first tile at
+		 */
+		void DrawTiles(ImageResource* target, int firstColumn, int firstRow, int lastColumn, int lastRow, int startX, int startY);
+		
+		/**
+		 * \var cameraX_
+		 * \brief the X coordinate of the camera in pixels
+		 */
+		int cameraX_;
+		
+		/**
+		 * \var cameraY_
+		 * \brief the Y coordinate of the camera in pixels
+		 */
+		int cameraY_;
+		
+		/**
+		 * \var viewportX_
+		 * \brief the X coordinate of the upper-left corner of the viewport on the render target in pixels
+		 */
+		int viewportX_;
+		
+		/**
+		 * \var viewportY_
+		 * \brief the Y coordinate of the upper-left corner of the viewport on the render target in pixels
+		 */
+		int viewportY_;
+		
+		/**
+		 * \var viewportWidth_
+		 * \brief the width of the viewport in pixels, zero means the width of the render target
+		 */
+		int viewportWidth_;
+		
+		/**
+		 * \var viewportHeight_
+		 * \brief the height of the viewport in pixels, zero means the height of the render target
+		 */
+		int viewportHeight_;
+	
 		/**
 		 * \var tileMap_
 		 * \brief the tilemap to render
@@ -15,12 +15,35 @@
 #ifndef __TILESET_H__
 #define __TILESET_H__
 
+#include <vector>
+
+#include "NameDirectory.h"
+
 namespace ENGINE
 {
 	// forward declare the classes we need
 	class ImageResource;
 	class ImageList;
-	class NameDirectory;
+	
+	//! the default maximum width of a tileset atlas in pixels
+	const int TILESET_DEFAULT_ATLAS_WIDTH = 1024;
+	
+	/**
+	 * \struct TilesetAtlasRect
+	 * \brief the source rectangle of a single tile image inside of the tileset atlas
+	 * \ingroup TileBasedGroup
+	 */
+	struct TilesetAtlasRect
+	{
+		//! the X coordinate of the upper-left corner of the tile in the atlas in pixels
+		int x;
+		//! the Y coordinate of the upper-left corner of the tile in the atlas in pixels
+		int y;
+		//! the width of the tile in pixels
+		int width;
+		//! the height of the tile in pixels
+		int height;
+	};
 	
 	/**
 	 * \class Tileset
@@ -28,6 +51,10 @@ namespace ENGINE
 	 * \ingroup TileBasedGroup
 	 * \author Richard Marks <ccpsceo@gmail.com>
 	 *
+	 * Once all of the tiles have been added, call Tileset::BuildAtlas() to pack every tile image
+	 * into a single atlas image. The TileMapRenderer will then draw every tile from that one image,
+	 * which keeps the whole tileset close together in memory while the map is rendered.
+	 *
 	 * See the page \ref TileBasedExamplePage1 for an example of using the Tileset class
 	 */
 	class Tileset
@@ -61,6 +88,18 @@ namespace ENGINE
 		 */
 		void AddRange(const char* tileNamePrefix, unsigned int count, ...);
 		
+		/**
+		 * Adds every tile in a spritesheet-style image file to the tileset
+		 * The file is only loaded once, and is cut into tiles from left to right, top to bottom.
+		 * The tiles are named the same way as with Tileset::AddRange()
+		 * @param tileNamePrefix is the prefix for the name that will be given to the added tile images
+		 * @param fileName is the name of the file that holds the spritesheet image
+		 * @param tileWidth is the width of a single tile in pixels
+		 * @param tileHeight is the height of a single tile in pixels
+		 * \return the number of tiles that were added
+		 */
+		unsigned int AddSheet(const char* tileNamePrefix, const char* fileName, int tileWidth, int tileHeight);
+		
 		/**
 		 * Gets a tile image from the tileset
 		 * @param tileName is the name of the tile to try to get
@@ -68,6 +107,13 @@ namespace ENGINE
 		 */
 		ImageResource* Get(const char* tileName);
 		
+		/**
+		 * Gets a tile image from the tileset without hashing the name at run time, as in \c Get("water0"_id)
+		 * @param tileName is the ID of the name of the tile to try to get
+		 * \return a pointer to the image resource for the given name or 0 if none exists
+		 */
+		ImageResource* Get(NameID tileName);
+		
 		/**
 		 * Gets a tile image from the tileset
 		 * @param tileID is the tile ID to try to get
@@ -81,12 +127,55 @@ namespace ENGINE
 		 * \return the tile ID for the given name
 		 */
 		unsigned int GetIndex(const char* tileName);
-
+		
+		/**
+		 * Gets the tile ID for the given name
+		 * @param tileName is the ID of the name of the tile to try to get
+		 * \return the tile ID for the given name
+		 */
+		unsigned int GetIndex(NameID tileName);
+		
 		/**
 		 * Gets the count of the tiles
 		 * \return the number of tile images in the tileset
 		 */
 		unsigned int GetCount();
+		
+		/**
+		 * Packs all of the tile images into a single atlas image
+		 * The tiles are sorted by height and packed onto shelves from left to right.
+		 * Adding tiles after building the atlas discards the atlas, so build it after adding all the tiles.
+		 * @param maxAtlasWidth is the widest that the atlas is allowed to be in pixels
+		 * \return true if the atlas was built, and false otherwise
+		 */
+		bool BuildAtlas(int maxAtlasWidth = TILESET_DEFAULT_ATLAS_WIDTH);
+		
+		/**
+		 * Discards the atlas image if there is one
+		 */
+		void DestroyAtlas();
+		
+		/**
+		 * Gets the atlas image
+		 * \return a pointer to the atlas image or 0 if Tileset::BuildAtlas() has not been called
+		 */
+		ImageResource* GetAtlas();
+		
+		/**
+		 * Gets the source rectangle of a tile inside of the atlas image
+		 * @param tileID is the tile ID to get the rectangle for
+		 * \return a pointer to the rectangle or 0 if there is no atlas or the tile ID does not exist
+		 */
+		TilesetAtlasRect* GetAtlasRect(unsigned int tileID);
+		
+		/**
+		 * Draws a tile onto an image, from the atlas if one has been built
+		 * @param tileID is the tile ID to draw
+		 * @param destination is the image to draw the tile on
+		 * @param destX is the X coordinate in pixels to draw to on the destination image
+		 * @param destY is the Y coordinate in pixels to draw to on the destination image
+		 */
+		void BlitTile(unsigned int tileID, ImageResource* destination, int destX, int destY);
 
 	private:
 	
@@ -117,6 +206,18 @@ namespace ENGINE
 		 */
 		ImageList* images_;
 		
+		/**
+		 * \var atlas_
+		 * \brief the image that all of the tile images are packed into, or 0 if there is no atlas
+		 */
+		ImageResource* atlas_;
+		
+		/**
+		 * \var atlasRects_
+		 * \brief the source rectangle inside of the atlas for each tile ID
+		 */
+		std::vector<TilesetAtlasRect> atlasRects_;
+		
 	}; // end class
 
 } // end namespace
@@ -0,0 +1,280 @@
+
+// CODESTYLE: v2.0
+
+// TraceCapture.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Records a timeline of engine events and saves it as a Chrome trace file
+
+/**
+ * \file TraceCapture.h
+ * \brief Trace Capture Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#ifndef __TRACECAPTURE_H__
+#define __TRACECAPTURE_H__
+
+#include <vector>
+
+#include "GameTimer.h"
+#include "Threading.h"
+
+namespace ENGINE
+{
+	//! the default number of events that each thread can record
+	const unsigned int TRACE_CAPTURE_DEFAULT_EVENTS_PER_THREAD = 0x40000;
+	
+	//! the number of bytes of event details, such as file names, that each thread can record
+	const unsigned int TRACE_CAPTURE_DETAIL_BYTES_PER_THREAD = 0x10000;
+	
+	//! the longest thread name that is kept
+	const unsigned int TRACE_CAPTURE_MAX_THREAD_NAME_LENGTH = 32;
+	
+	//! the longest file name that the trace can be saved to
+	const unsigned int TRACE_CAPTURE_MAX_FILE_NAME_LENGTH = 256;
+	
+	//! the name of the file that the trace is saved to if no other name is given
+	const char* const TRACE_CAPTURE_DEFAULT_FILE_NAME = "trace.json";
+	
+	/**
+	 * \struct TraceEvent
+	 * \brief a single recorded event
+	 * \ingroup DebugGroup
+	 */
+	struct TraceEvent
+	{
+		//! the name of the event. This must be a string that lives as long as the program, such as a string literal
+		const char* name;
+		//! the category of the event. This must be a string that lives as long as the program, such as a string literal
+		const char* category;
+		//! the time of the event
+		GameTimerTicks timestamp;
+		//! the offset of the detail string in the detail buffer of the thread, or -1 if there is no detail
+		int detailOffset;
+		//! 'B' for the beginning of a span of time, or 'E' for the end
+		char phase;
+	};
+	
+	/**
+	 * \struct TraceThreadBuffer
+	 * \brief the events recorded by a single thread. Only the thread that owns it writes to it.
+	 * \ingroup DebugGroup
+	 */
+	struct TraceThreadBuffer
+	{
+		//! the ID of the thread in the trace
+		unsigned int threadID;
+		//! the name of the thread in the trace
+		char threadName[TRACE_CAPTURE_MAX_THREAD_NAME_LENGTH];
+		//! the recorded events
+		TraceEvent* events;
+		//! the number of events that fit in the buffer
+		unsigned int capacity;
+		//! the number of recorded events
+		volatile int count;
+		//! the number of events that did not fit in the buffer
+		unsigned int dropped;
+		//! the detail strings of the recorded events
+		char* details;
+		//! the number of bytes of the detail strings that are used
+		unsigned int detailsUsed;
+	};
+	
+	/**
+	 * \class TraceCaptureSingleton
+	 * \brief Records a timeline of engine events and saves it as a Chrome trace file
+	 * \ingroup DebugGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * While a capture is running, the start and the end of every profiler zone, every game state update and render,
+	 * and every asset load are recorded with the time and the thread that they happened on. Each thread records into 
+	 * its own buffer without taking any locks. When the capture is stopped, or when the program exits, the events are
+	 * saved in the Chrome trace event format, which can be opened with chrome://tracing or ui.perfetto.dev.\n
+	 * Start a capture by running the game with the -t or --trace command-line flag, or --trace=filename.json to choose the file.
+	 * When a thread runs out of room in its buffer, its further events are dropped and counted.
+	 */
+	class TraceCaptureSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the singleton class
+		 */
+		static TraceCaptureSingleton* GetInstance();
+		
+		/**
+		 * Saves the trace if a capture is still running, and de-allocates any allocated memory
+		 */
+		~TraceCaptureSingleton();
+		
+		/**
+		 * Starts recording events. Any events from a previous capture are thrown away,
+		 * so no other thread may be recording events when this is called.
+		 * @param fileName is the name of the file that the trace is saved to
+		 */
+		void StartCapture(const char* fileName = TRACE_CAPTURE_DEFAULT_FILE_NAME);
+		
+		/**
+		 * Stops recording events and saves the trace
+		 * \return true if the trace was saved
+		 */
+		bool StopCapture();
+		
+		/**
+		 * \return true if events are being recorded
+		 */
+		bool IsCapturing();
+		
+		/**
+		 * Sets the number of events that each thread can record. Only affects threads that have not recorded any events yet.
+		 * @param eventsPerThread is the number of events
+		 */
+		void SetEventsPerThread(unsigned int eventsPerThread);
+		
+		/**
+		 * Sets the name that the calling thread is shown with in the trace
+		 * @param threadName is the name of the thread
+		 */
+		void SetThreadName(const char* threadName);
+		
+		/**
+		 * Records the beginning of a span of time on the calling thread
+		 * @param name is the name of the span. This must be a string that lives as long as the program, such as a string literal
+		 * @param category is the category of the span. This must be a string that lives as long as the program, such as a string literal
+		 * @param detail is an optional string that is copied and shown with the span, such as a file name
+		 */
+		void BeginEvent(const char* name, const char* category, const char* detail = 0);
+		
+		/**
+		 * Records the end of the last span of time that was begun on the calling thread
+		 * @param name is the name of the span
+		 * @param category is the category of the span
+		 */
+		void EndEvent(const char* name, const char* category);
+		
+	private:
+		/**
+		 * hidden constructor
+		 */
+		TraceCaptureSingleton();
+		
+		/**
+		 * hidden copy constructor
+		 */
+		TraceCaptureSingleton(const TraceCaptureSingleton& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const TraceCaptureSingleton& operator=(const TraceCaptureSingleton& rhs);
+		
+		/**
+		 * \return the buffer of the calling thread, creating it if needed
+		 */
+		TraceThreadBuffer* GetThreadBuffer();
+		
+		/**
+		 * Records an event on the calling thread
+		 */
+		void RecordEvent(char phase, const char* name, const char* category, const char* detail);
+		
+		/**
+		 * Writes all of the recorded events to the trace file
+		 * \return true on success, false on failure
+		 */
+		bool WriteTrace();
+		
+		/**
+		 * \var threadBuffer_
+		 * \brief the buffer of each thread
+		 */
+		ThreadLocalPointer threadBuffer_;
+		
+		/**
+		 * \var buffersLock_
+		 * \brief guards the list of buffers
+		 */
+		Mutex buffersLock_;
+		
+		/**
+		 * \var buffers_
+		 * \brief the buffers of every thread that has recorded an event
+		 */
+		std::vector<TraceThreadBuffer*> buffers_;
+		
+		/**
+		 * \var capturing_
+		 * \brief non-zero while events are being recorded
+		 */
+		volatile int capturing_;
+		
+		/**
+		 * \var eventsPerThread_
+		 * \brief the number of events that each new thread buffer can hold
+		 */
+		unsigned int eventsPerThread_;
+		
+		/**
+		 * \var fileName_
+		 * \brief the name of the file that the trace is saved to
+		 */
+		char fileName_[TRACE_CAPTURE_MAX_FILE_NAME_LENGTH];
+	}; // end class
+	
+	/**
+	 * \class TraceZone
+	 * \brief Records a span of time from its creation to its destruction while a trace capture is running
+	 * \ingroup DebugGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 */
+	class TraceZone
+	{
+	public:
+		/**
+		 * records the beginning of the span
+		 * @param name is the name of the span. This must be a string that lives as long as the program, such as a string literal
+		 * @param category is the category of the span. This must be a string that lives as long as the program, such as a string literal
+		 * @param detail is an optional string that is copied and shown with the span, such as a file name
+		 */
+		TraceZone(const char* name, const char* category = "engine", const char* detail = 0);
+		
+		/**
+		 * records the end of the span
+		 */
+		~TraceZone();
+		
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		TraceZone(const TraceZone& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const TraceZone& operator=(const TraceZone& rhs);
+		
+		/**
+		 * \var name_
+		 * \brief the name of the span, or 0 if nothing was recorded
+		 */
+		const char* name_;
+		
+		/**
+		 * \var category_
+		 * \brief the category of the span
+		 */
+		const char* category_;
+	}; // end class
+
+/**
+ * \def TraceCapture
+ * \brief an alias for TraceCaptureSingleton::GetInstance()
+ */
+#define TraceCapture TraceCaptureSingleton::GetInstance()
+
+} // end namespace
+#endif
+
+
+
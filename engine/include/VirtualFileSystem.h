@@ -0,0 +1,439 @@
+
+// CODESTYLE: v2.0
+
+// VirtualFileSystem.h
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Reads the asset files out of memory-mapped ged101 pack archives, or from loose files on disk
+
+#ifndef __VIRTUALFILESYSTEM_H__
+#define __VIRTUALFILESYSTEM_H__
+
+/**
+ * \file VirtualFileSystem.h
+ * \brief Virtual File System Module - Header
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Threading.h"
+
+namespace ENGINE
+{
+	// forward declare the classes we need
+	struct ImagePixelData;
+	
+	//! the first eight bytes of every ged101 pack archive
+	const char* const ASSET_ARCHIVE_MAGIC = "GED101PK";
+	
+	//! the version of the archive layout that this engine reads
+	const unsigned int ASSET_ARCHIVE_VERSION = 1;
+	
+	//! the table of contents and every entry start on a multiple of this many bytes
+	const unsigned int ASSET_ARCHIVE_ALIGNMENT = 16;
+	
+	//! the longest name of an entry, including the terminating zero
+	const unsigned int ASSET_ARCHIVE_NAME_LENGTH = 104;
+	
+	/**
+	 * \enum AssetArchiveEntryType
+	 * \brief what the data of an archive entry holds
+	 * \ingroup SystemGroup
+	 */
+	enum AssetArchiveEntryType
+	{
+		//! the bytes of the file, just as they were on disk
+		AssetArchiveEntry_File = 0,
+		//! the pixels of a PNG file that the packer decoded ahead of time, laid out like ENGINE::ImagePixelData
+		AssetArchiveEntry_Pixels = 1
+	};
+	
+	/**
+	 * \struct AssetArchiveHeader
+	 * \brief the start of a ged101 pack archive
+	 * \ingroup SystemGroup
+	 *
+	 * The numbers in an archive are in the byte order of the machine that packed it.
+	 * An archive from a machine of the other byte order fails the version check, and is not mounted.
+	 */
+	struct AssetArchiveHeader
+	{
+		//! ASSET_ARCHIVE_MAGIC, without the terminating zero
+		char magic[8];
+		//! ASSET_ARCHIVE_VERSION
+		unsigned int version;
+		//! the number of entries in the table of contents
+		unsigned int entryCount;
+		//! where the table of contents starts, from the start of the archive
+		unsigned int tocOffset;
+		//! always zero
+		unsigned int reserved;
+	};
+	
+	/**
+	 * \struct AssetArchiveEntry
+	 * \brief a single file in the table of contents of a ged101 pack archive
+	 * \ingroup SystemGroup
+	 *
+	 * The table of contents is sorted by name, so that a file is found with a binary search.
+	 */
+	struct AssetArchiveEntry
+	{
+		//! the name of the file; see VirtualFileSystemSingleton::GetArchiveName()
+		char name[ASSET_ARCHIVE_NAME_LENGTH];
+		//! where the data starts, from the start of the archive
+		unsigned int offset;
+		//! the size of the data in bytes
+		unsigned int size;
+		//! one of the AssetArchiveEntryType values
+		unsigned int type;
+		//! the width of the image for AssetArchiveEntry_Pixels entries, otherwise zero
+		unsigned int width;
+		//! the height of the image for AssetArchiveEntry_Pixels entries, otherwise zero
+		unsigned int height;
+		//! the bits per pixel of the image for AssetArchiveEntry_Pixels entries, otherwise zero
+		unsigned int bitsPerPixel;
+	};
+	
+	/**
+	 * \class AssetArchive
+	 * \brief A ged101 pack archive that is mapped into memory
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * The whole archive is mapped read-only, so the data of an entry is used where it lies, without being copied,
+	 * and only the pages that are touched are ever read from the disk.
+	 */
+	class AssetArchive
+	{
+	public:
+		/**
+		 * creates the class; no archive is open until AssetArchive::Open() is called
+		 */
+		AssetArchive();
+		
+		/**
+		 * closes the archive
+		 */
+		~AssetArchive();
+		
+		/**
+		 * Maps an archive into memory, and checks that its table of contents is sound
+		 * @param fileName is the name of the archive
+		 * \return true if the archive was opened, false if it could not be mapped or is not a ged101 pack archive
+		 */
+		bool Open(const char* fileName);
+		
+		/**
+		 * Unmaps the archive. The data of its entries must no longer be used.
+		 */
+		void Close();
+		
+		/**
+		 * Looks an entry up by its name
+		 * @param name is the name of the entry, as made by VirtualFileSystemSingleton::GetArchiveName()
+		 * \return the entry, or 0 if the archive does not hold it
+		 */
+		const AssetArchiveEntry* Find(const char* name) const;
+		
+		/**
+		 * \return a pointer to the data of an entry, inside of the mapped archive
+		 */
+		const unsigned char* GetData(const AssetArchiveEntry* entry) const;
+		
+		/**
+		 * \return the name of the archive
+		 */
+		const char* GetFileName() const;
+		
+		/**
+		 * \return the number of entries in the archive, or zero if no archive is open
+		 */
+		unsigned int GetEntryCount() const;
+	
+	private:
+		/**
+		 * hidden copy constructor
+		 */
+		AssetArchive(const AssetArchive& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const AssetArchive& operator=(const AssetArchive& rhs);
+		
+		/**
+		 * \return true if the mapped data is a sound ged101 pack archive
+		 */
+		bool Validate() const;
+		
+		/**
+		 * \var fileName_
+		 * \brief the name of the archive
+		 */
+		std::string fileName_;
+		
+		/**
+		 * \var data_
+		 * \brief the mapped archive, or 0 if no archive is open
+		 */
+		const unsigned char* data_;
+		
+		/**
+		 * \var size_
+		 * \brief the size of the mapped archive in bytes
+		 */
+		unsigned long size_;
+		
+		/**
+		 * \var header_
+		 * \brief the header at the start of the mapped archive
+		 */
+		const AssetArchiveHeader* header_;
+		
+		/**
+		 * \var entries_
+		 * \brief the table of contents inside of the mapped archive
+		 */
+		const AssetArchiveEntry* entries_;
+	}; // end class
+	
+	/**
+	 * \class VirtualFile
+	 * \brief A file that is opened through the ENGINE::VirtualFileSystemSingleton
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * A file that comes from an archive is read straight out of the mapped archive, and VirtualFile::GetData()
+	 * gives its bytes without any copy. A loose file is read from the disk with the C library.\n
+	 * Deleting the VirtualFile closes it.
+	 */
+	class VirtualFile
+	{
+	public:
+		/**
+		 * closes the file
+		 */
+		~VirtualFile();
+		
+		/**
+		 * Reads bytes from the current position, and moves the position past them
+		 * @param buffer is where the bytes are copied to
+		 * @param size is the number of bytes to read
+		 * \return the number of bytes that were read, which is less than size at the end of the file
+		 */
+		unsigned long Read(void* buffer, unsigned long size);
+		
+		/**
+		 * Moves the current position
+		 * @param offset is the number of bytes to move
+		 * @param origin is SEEK_SET, SEEK_CUR, or SEEK_END, as for fseek()
+		 * \return true if the position was moved, false if it would have been outside of the file
+		 */
+		bool Seek(long offset, int origin);
+		
+		/**
+		 * \return the current position in bytes from the start of the file
+		 */
+		unsigned long Tell() const;
+		
+		/**
+		 * \return the size of the file in bytes
+		 */
+		unsigned long GetSize() const;
+		
+		/**
+		 * \return the bytes of the file inside of the mapped archive, or 0 for a loose file
+		 */
+		const unsigned char* GetData() const;
+		
+		/**
+		 * \return true if the file comes from an archive
+		 */
+		bool IsPacked() const;
+	
+	private:
+		// only the file system opens files
+		friend class VirtualFileSystemSingleton;
+		
+		/**
+		 * opens a file inside of a mapped archive
+		 */
+		VirtualFile(const unsigned char* data, unsigned long size);
+		
+		/**
+		 * opens a loose file
+		 */
+		VirtualFile(FILE* fp, unsigned long size);
+		
+		/**
+		 * hidden copy constructor
+		 */
+		VirtualFile(const VirtualFile& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const VirtualFile& operator=(const VirtualFile& rhs);
+		
+		/**
+		 * \var fp_
+		 * \brief the loose file, or 0 if the file comes from an archive
+		 */
+		FILE* fp_;
+		
+		/**
+		 * \var data_
+		 * \brief the bytes of the file inside of the mapped archive, or 0 for a loose file
+		 */
+		const unsigned char* data_;
+		
+		/**
+		 * \var size_
+		 * \brief the size of the file in bytes
+		 */
+		unsigned long size_;
+		
+		/**
+		 * \var position_
+		 * \brief the current position in an archive file; loose files use the position of fp_
+		 */
+		unsigned long position_;
+	}; // end class
+	
+	/**
+	 * \class VirtualFileSystemSingleton
+	 * \brief Finds the asset files in the mounted ged101 pack archives, or on disk
+	 * \ingroup SystemGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Mounting an archive makes its files shadow the loose files of the same name. The archives that were mounted
+	 * last are searched first, so a patch archive can replace the files of the archive that it was made for.
+	 * Files that are in no archive are opened from the disk, so the game runs the same from loose files during
+	 * development.\n
+	 * Archives are made with the ged101pack tool:
+	 * \code
+	 * ged101pack [-r|--raw] data.pak data/water.png data/music.ogg ...
+	 * \endcode
+	 * With --raw the PNG files are decoded by the packer, and stored as pixels that ENGINE::ImageResource
+	 * converts to the screen depth without running the PNG decoder.\n
+	 * There is a MACRO defined called VirtualFileSystem that is just an alias to calling the
+	 * VirtualFileSystemSingleton::GetInstance() function which returns a pointer to the singleton instance.
+	 * \code
+	 * VirtualFileSystem->Mount("data.pak");
+	 * VirtualFile* file = VirtualFileSystem->Open("data/level1.map");
+	 * ...
+	 * delete file;
+	 * \endcode
+	 */
+	class VirtualFileSystemSingleton
+	{
+	public:
+		/**
+		 * \return a pointer to the virtual file system singleton class instance
+		 */
+		static VirtualFileSystemSingleton* GetInstance();
+		
+		/**
+		 * Maps an archive, and searches it before every archive that was mounted before it
+		 * @param fileName is the name of the archive
+		 * \return true if the archive was mounted
+		 */
+		bool Mount(const char* fileName);
+		
+		/**
+		 * Unmaps every archive. No file that was opened from an archive may still be open.
+		 */
+		void UnmountAll();
+		
+		/**
+		 * Opens a file from the newest archive that holds it, or from the disk
+		 * @param fileName is the name of the file
+		 * \return the opened file, which the caller deletes, or 0 if the file does not exist
+		 */
+		VirtualFile* Open(const char* fileName);
+		
+		/**
+		 * \return true if a file is in an archive or on the disk
+		 */
+		bool Exists(const char* fileName);
+		
+		/**
+		 * \return true if a file is in a mounted archive, which shadows any loose file of the same name
+		 */
+		bool IsPacked(const char* fileName);
+		
+		/**
+		 * Gets the pixels of an image that the packer decoded ahead of time
+		 * @param fileName is the name of the image file
+		 * @param pixels is filled in with the pixels; they are inside of the mapped archive, and must not be deleted
+		 * \return true if the newest archive that holds the file holds it as pixels, false otherwise
+		 */
+		bool GetPixels(const char* fileName, ImagePixelData& pixels);
+		
+		/**
+		 * Makes the canonical path of a file name by using forward slashes, and removing "." and ".." parts and repeated slashes.
+		 * Paths are not case sensitive on windows, so they are made lower case there.
+		 */
+		static std::string CanonicalizePath(const char* fileName);
+		
+		/**
+		 * Makes the name that a file is stored under in an archive; its canonical path in lower case,
+		 * so that archives work the same on every platform.
+		 */
+		static std::string GetArchiveName(const char* fileName);
+		
+		/**
+		 * unmaps every archive
+		 */
+		~VirtualFileSystemSingleton();
+	
+	private:
+		/**
+		 * constructor is hidden because this is a singleton class
+		 */
+		VirtualFileSystemSingleton();
+		
+		/**
+		 * copy constructor is hidden because this class cannot be copied
+		 */
+		VirtualFileSystemSingleton(const VirtualFileSystemSingleton& rhs);
+		
+		/**
+		 * assignment operator is hidden because you cannot copy this class
+		 */
+		const VirtualFileSystemSingleton& operator=(const VirtualFileSystemSingleton& rhs);
+		
+		/**
+		 * Finds the newest archive entry of a file
+		 * @param fileName is the name of the file
+		 * @param archive is set to the archive that holds the entry
+		 * \return the entry, or 0 if no archive holds the file
+		 */
+		const AssetArchiveEntry* Find(const char* fileName, AssetArchive** archive);
+		
+		/**
+		 * \var archives_
+		 * \brief the mounted archives, the oldest first
+		 */
+		std::vector<AssetArchive*> archives_;
+		
+		/**
+		 * \var mutex_
+		 * \brief held while the list of archives is looked at or changed, because files are opened by the asset loader threads
+		 */
+		Mutex mutex_;
+	}; // end class
+
+/**
+ * \def VirtualFileSystem
+ * \brief an alias for the VirtualFileSystemSingleton::GetInstance() function to make your code clean.
+ */
+#define VirtualFileSystem VirtualFileSystemSingleton::GetInstance()
+} // end namespace
+#endif
+
+
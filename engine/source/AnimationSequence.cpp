@@ -71,15 +71,37 @@ namespace ENGINE
 	
 	void AnimationSequence::Update()
 	{
-		frameCounter_ += 1.0f;
+		Update(1.0f);
+	}
+	
+	/**************************************************************************/
+	
+	void AnimationSequence::Update(float elapsed)
+	{
+		if (frames_.empty())
+		{
+			return;
+		}
+		
+		frameCounter_ += elapsed;
 		
-		if (frameCounter_ >= frames_.at(currentFrame_)->GetDelay())
+		// keep the left over time so that the speed does not depend on how often this is called
+		while (frameCounter_ >= frames_.at(currentFrame_)->GetDelay())
 		{
+			float delay = frames_.at(currentFrame_)->GetDelay();
+			
 			if (++currentFrame_ >= frames_.size())
 			{
 				currentFrame_ = 0;
 			}
-			frameCounter_ = 0.0f;
+			
+			if (delay <= 0.0f)
+			{
+				frameCounter_ = 0.0f;
+				break;
+			}
+			
+			frameCounter_ -= delay;
 		}
 	}
 	
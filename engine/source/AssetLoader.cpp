@@ -0,0 +1,584 @@
+
+// CODESTYLE: v2.0
+
+// AssetLoader.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Decodes image and sound files on worker threads while the game keeps running
+
+/**
+ * \file AssetLoader.cpp
+ * \brief Asynchronous Asset Loading Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// include Allegro
+#include <allegro.h>
+
+// include the complementing header
+#include "AssetLoader.h"
+
+// include the image cache header
+#include "ImageCache.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	AssetRequestType AssetRequest::GetType()
+	{
+		return type_;
+	}
+	
+	/**************************************************************************/
+	
+	AssetRequestState AssetRequest::GetState()
+	{
+		return state_;
+	}
+	
+	/**************************************************************************/
+	
+	bool AssetRequest::IsDone()
+	{
+		return (AssetRequest_Ready == state_) || (AssetRequest_Failed == state_);
+	}
+	
+	/**************************************************************************/
+	
+	const char* AssetRequest::GetFileName()
+	{
+		return fileName_.c_str();
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* AssetRequest::GetImage()
+	{
+		return (AssetRequest_Ready == state_) ? image_ : 0;
+	}
+	
+	/**************************************************************************/
+	
+	AudioSampleResource_OGG* AssetRequest::TakeSample()
+	{
+		if (AssetRequest_Ready != state_)
+		{
+			return 0;
+		}
+		
+		AudioSampleResource_OGG* sample = sample_;
+		sample_ = 0;
+		return sample;
+	}
+	
+	/**************************************************************************/
+	
+	AssetRequest::AssetRequest(AssetRequestType type, const char* fileName) :
+		type_(type),
+		state_(AssetRequest_Queued),
+		fileName_(fileName),
+		decoded_(false),
+		released_(false),
+		image_(0),
+		sample_(0)
+	{
+		pixels_.width 			= 0;
+		pixels_.height 			= 0;
+		pixels_.bitsPerPixel 	= 0;
+		pixels_.pixels 			= 0;
+		
+		samples_.bits 			= 0;
+		samples_.stereo 		= 0;
+		samples_.frequency 		= 0;
+		samples_.length 		= 0;
+		samples_.data 			= 0;
+	}
+	
+	/**************************************************************************/
+	
+	AssetRequest::~AssetRequest()
+	{
+		delete [] pixels_.pixels;
+		
+		if (0 != samples_.data)
+		{
+			free(samples_.data);
+		}
+		
+		if (0 != sample_)
+		{
+			delete sample_;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	AssetLoaderSingleton* AssetLoaderSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static AssetLoaderSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::SetThreadCount(unsigned int threadCount)
+	{
+		requestedThreadCount_ = (threadCount > ASSET_LOADER_MAX_THREADS) ? ASSET_LOADER_MAX_THREADS : threadCount;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int AssetLoaderSingleton::GetThreadCount()
+	{
+		return threadCount_;
+	}
+	
+	/**************************************************************************/
+	
+	AssetRequest* AssetLoaderSingleton::RequestImage(const char* fileName)
+	{
+		return Queue(AssetRequest_Image, fileName);
+	}
+	
+	/**************************************************************************/
+	
+	AssetRequest* AssetLoaderSingleton::RequestSample(const char* fileName)
+	{
+		return Queue(AssetRequest_Sample, fileName);
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::ReleaseRequest(AssetRequest* request)
+	{
+		if (0 == request)
+		{
+			return;
+		}
+		
+		{
+			MutexLock lock(mutex_);
+			
+			if (AssetRequest_Queued == request->state_)
+			{
+				// no worker has seen it yet, so it can be dropped from the queue
+				std::deque<AssetRequest*>::iterator iter;
+				for (iter = queue_.begin(); iter != queue_.end(); iter++)
+				{
+					if (request == *iter)
+					{
+						queue_.erase(iter);
+						break;
+					}
+				}
+				finishedCount_++;
+			}
+			else if (!request->IsDone())
+			{
+				// a worker is decoding it, or it waits for AssetLoaderSingleton::Update()
+				request->released_ = true;
+				return;
+			}
+		}
+		
+		Destroy(request);
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int AssetLoaderSingleton::Update()
+	{
+		std::vector<AssetRequest*> decoded;
+		{
+			MutexLock lock(mutex_);
+			decoded.swap(decoded_);
+		}
+		
+		for (unsigned int index = 0; index < decoded.size(); index++)
+		{
+			AssetRequest* request = decoded[index];
+			Finish(request);
+			finishedCount_++;
+			
+			if (request->released_)
+			{
+				Destroy(request);
+			}
+		}
+		
+		return static_cast<unsigned int>(decoded.size());
+	}
+	
+	/**************************************************************************/
+	
+	bool AssetLoaderSingleton::WaitForDecoded(unsigned int milliseconds)
+	{
+		return decodedEvent_.WaitFor(milliseconds);
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::WaitForAll()
+	{
+		while (IsLoading())
+		{
+			decodedEvent_.Wait();
+			Update();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool AssetLoaderSingleton::IsLoading()
+	{
+		return (finishedCount_ < requestedCount_);
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int AssetLoaderSingleton::GetPendingCount()
+	{
+		return requestedCount_ - finishedCount_;
+	}
+	
+	/**************************************************************************/
+	
+	float AssetLoaderSingleton::GetProgress()
+	{
+		if (0 == requestedCount_)
+		{
+			return 1.0f;
+		}
+		return static_cast<float>(finishedCount_) / static_cast<float>(requestedCount_);
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::DrawProgressBar(ImageResource* target, float progress)
+	{
+		if (0 == target)
+		{
+			return;
+		}
+		
+		progress = (progress < 0.0f) ? 0.0f : ((progress > 1.0f) ? 1.0f : progress);
+		
+		int barWidth = target->GetWidth() / 2;
+		int barHeight = 16;
+		int x = (target->GetWidth() - barWidth) / 2;
+		int y = (target->GetHeight() - barHeight) / 2;
+		int filledWidth = static_cast<int>(progress * static_cast<float>(barWidth - 4));
+		
+		int backColor = makecol(
+			(ASSET_LOADER_PROGRESS_BACK_COLOR >> 16) & 0xFF,
+			(ASSET_LOADER_PROGRESS_BACK_COLOR >> 8) & 0xFF,
+			ASSET_LOADER_PROGRESS_BACK_COLOR & 0xFF);
+		int foreColor = makecol(
+			(ASSET_LOADER_PROGRESS_FORE_COLOR >> 16) & 0xFF,
+			(ASSET_LOADER_PROGRESS_FORE_COLOR >> 8) & 0xFF,
+			ASSET_LOADER_PROGRESS_FORE_COLOR & 0xFF);
+		
+		target->Rect(x, y, x + barWidth - 1, y + barHeight - 1, backColor, true);
+		if (filledWidth > 0)
+		{
+			target->Rect(x + 2, y + 2, x + 2 + filledWidth - 1, y + barHeight - 3, foreColor, true);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::Start()
+	{
+		if (threadCount_ > 0)
+		{
+			return;
+		}
+		
+		unsigned int threadCount = requestedThreadCount_;
+		if (0 == threadCount)
+		{
+			// leave a processor for the main thread
+			unsigned int processorCount = GetProcessorCount();
+			threadCount = (processorCount > 1) ? processorCount - 1 : 1;
+			threadCount = (threadCount > ASSET_LOADER_MAX_THREADS) ? ASSET_LOADER_MAX_THREADS : threadCount;
+		}
+		
+		running_ = 1;
+		for (unsigned int index = 0; index < threadCount; index++)
+		{
+			Thread* thread = new Thread();
+			if (!thread->Start(&AssetLoaderSingleton::Run, this))
+			{
+				LogError("Could not start asset loader thread %u!", index);
+				delete thread;
+				break;
+			}
+			threads_[threadCount_++] = thread;
+		}
+		
+		if (0 == threadCount_)
+		{
+			LogFatal("Could not start any asset loader threads!");
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::Stop()
+	{
+		if (0 == threadCount_)
+		{
+			return;
+		}
+		
+		{
+			MutexLock lock(mutex_);
+			running_ = 0;
+		}
+		
+		// each worker wakes the next one up on its way out
+		workEvent_.Signal();
+		
+		for (unsigned int index = 0; index < threadCount_; index++)
+		{
+			threads_[index]->Join();
+			delete threads_[index];
+			threads_[index] = 0;
+		}
+		threadCount_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	AssetRequest* AssetLoaderSingleton::Queue(AssetRequestType type, const char* fileName)
+	{
+		Start();
+		
+		AssetRequest* request = new AssetRequest(type, (0 != fileName) ? fileName : "");
+		
+		// a new batch starts when the previous one is done
+		if (!IsLoading())
+		{
+			requestedCount_ = 0;
+			finishedCount_ = 0;
+		}
+		requestedCount_++;
+		
+		{
+			MutexLock lock(mutex_);
+			queue_.push_back(request);
+		}
+		workEvent_.Signal();
+		
+		return request;
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::Run(void* data)
+	{
+		AssetLoaderSingleton* loader = static_cast<AssetLoaderSingleton*>(data);
+		
+		if (TraceCapture->IsCapturing())
+		{
+			TraceCapture->SetThreadName("asset loader");
+		}
+		
+		while (true)
+		{
+			AssetRequest* request = 0;
+			{
+				MutexLock lock(loader->mutex_);
+				
+				if (0 == loader->running_)
+				{
+					break;
+				}
+				
+				if (!loader->queue_.empty())
+				{
+					request = loader->queue_.front();
+					loader->queue_.pop_front();
+					request->state_ = AssetRequest_Decoding;
+					
+					// there is more work, so wake up another worker
+					if (!loader->queue_.empty())
+					{
+						loader->workEvent_.Signal();
+					}
+				}
+			}
+			
+			if (0 == request)
+			{
+				loader->workEvent_.Wait();
+				continue;
+			}
+			
+			Decode(request);
+			
+			{
+				MutexLock lock(loader->mutex_);
+				request->state_ = AssetRequest_Decoded;
+				loader->decoded_.push_back(request);
+			}
+			loader->decodedEvent_.Signal();
+		}
+		
+		// let the next worker see that it is time to stop
+		loader->workEvent_.Signal();
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::Decode(AssetRequest* request)
+	{
+		TraceZone traceZone("AssetLoader::Decode", "asset", request->fileName_.c_str());
+		
+		const char* fileName = request->fileName_.c_str();
+		
+		if (AssetRequest_Image == request->type_)
+		{
+			// only PNG files have a decoder that does not need Allegro; the others are loaded on the main thread
+			unsigned int fileNameLength = strlen(fileName);
+			bool isPNG = (fileNameLength > 4) && (0 == stricmp(fileName + fileNameLength - 4, ".png"));
+			// an image with a raw cache that is up to date is read on the main thread, which is quicker than decoding it
+			if (isPNG && !ImageResource::IsRawCacheCurrent(fileName))
+			{
+				request->decoded_ = ImageResource::DecodePNG(fileName, request->pixels_);
+			}
+		}
+		else if (AssetRequest_Sample == request->type_)
+		{
+			request->decoded_ = AudioSampleResource_OGG::Decode(fileName, request->samples_);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::Finish(AssetRequest* request)
+	{
+		TraceZone traceZone("AssetLoader::Finish", "asset", request->fileName_.c_str());
+		
+		const char* fileName = request->fileName_.c_str();
+		request->state_ = AssetRequest_Failed;
+		
+		if (AssetRequest_Image == request->type_)
+		{
+			if (request->decoded_)
+			{
+				ImageResource* image = new ImageResource();
+				if (image->Create(request->pixels_))
+				{
+					if (ImageResource::IsRawCacheEnabled())
+					{
+						image->SaveRawCache(fileName);
+					}
+					request->image_ = ImageCache->Add(fileName, image);
+				}
+				else
+				{
+					delete image;
+				}
+				
+				// the pixels are in the image now
+				delete [] request->pixels_.pixels;
+				request->pixels_.pixels = 0;
+			}
+			else
+			{
+				request->image_ = ImageCache->Acquire(fileName);
+			}
+			
+			if (0 != request->image_)
+			{
+				request->state_ = AssetRequest_Ready;
+			}
+		}
+		else if (AssetRequest_Sample == request->type_)
+		{
+			if (request->decoded_)
+			{
+				AudioSampleResource_OGG* sample = new AudioSampleResource_OGG();
+				if (sample->Create(request->samples_))
+				{
+					request->sample_ = sample;
+					request->state_ = AssetRequest_Ready;
+				}
+				else
+				{
+					delete sample;
+				}
+			}
+		}
+		
+		if (AssetRequest_Failed == request->state_)
+		{
+			LogError("Could not load %s!", fileName);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void AssetLoaderSingleton::Destroy(AssetRequest* request)
+	{
+		if (0 != request->image_)
+		{
+			ImageCache->Release(request->image_);
+			request->image_ = 0;
+		}
+		
+		delete request;
+	}
+	
+	/**************************************************************************/
+	
+	AssetLoaderSingleton::AssetLoaderSingleton() :
+		threadCount_(0),
+		requestedThreadCount_(0),
+		running_(0),
+		requestedCount_(0),
+		finishedCount_(0)
+	{
+		// implement class constructor here
+		for (unsigned int index = 0; index < ASSET_LOADER_MAX_THREADS; index++)
+		{
+			threads_[index] = 0;
+		}
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	AssetLoaderSingleton::~AssetLoaderSingleton()
+	{
+		// implement class destructor here
+		Stop();
+		
+		// whatever is left was never released
+		for (unsigned int index = 0; index < queue_.size(); index++)
+		{
+			delete queue_[index];
+		}
+		queue_.clear();
+		
+		for (unsigned int index = 0; index < decoded_.size(); index++)
+		{
+			delete decoded_[index];
+		}
+		decoded_.clear();
+	} // end destructor
+
+} // end namespace
+
+
@@ -23,11 +23,78 @@
 // include the complementing header
 #include "Audio_OGG.h"
 
+// include the profiler header
+#include "Profiler.h"
+
+// include the virtual file system header
+#include "VirtualFileSystem.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
 // include the error reporting header
 #include "DebugReport.h"
 
 namespace ENGINE
 {
+	/**
+	 * Feeds the vorbis decoder from a file of the virtual file system
+	 */
+	static size_t ReadVorbisData(void* buffer, size_t size, size_t count, void* dataSource)
+	{
+		if (0 == size)
+		{
+			return 0;
+		}
+		VirtualFile* file = static_cast<VirtualFile*>(dataSource);
+		return static_cast<size_t>(file->Read(buffer, static_cast<unsigned long>(size * count))) / size;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Moves the position of a file of the virtual file system for the vorbis decoder
+	 */
+	static int SeekVorbisData(void* dataSource, ogg_int64_t offset, int origin)
+	{
+		VirtualFile* file = static_cast<VirtualFile*>(dataSource);
+		return file->Seek(static_cast<long>(offset), origin) ? 0 : -1;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Closes a file of the virtual file system when the vorbis decoder is cleared
+	 */
+	static int CloseVorbisData(void* dataSource)
+	{
+		delete static_cast<VirtualFile*>(dataSource);
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Gets the position of a file of the virtual file system for the vorbis decoder
+	 */
+	static long TellVorbisData(void* dataSource)
+	{
+		return static_cast<long>(static_cast<VirtualFile*>(dataSource)->Tell());
+	}
+	
+	/**************************************************************************/
+	
+	//! the vorbis decoder reads every file through the virtual file system, so the files may come from a mounted archive
+	static const ov_callbacks VORBIS_VIRTUAL_FILE_CALLBACKS = 
+	{
+		ReadVorbisData,
+		SeekVorbisData,
+		CloseVorbisData,
+		TellVorbisData
+	};
+	
+	/**************************************************************************/
+	
 	AudioSampleResource_OGG::AudioSampleResource_OGG() :
 		allegroSample_(0)
 	{
@@ -44,52 +111,104 @@ namespace ENGINE
 	
 	bool AudioSampleResource_OGG::Load(const char* fileName)
 	{
-		FILE* fp 				= 0;
+		AudioSampleData samples;
+		if (!Decode(fileName, samples))
+		{
+			LogFatal("Could not load the file %s", fileName);
+			return false;
+		}
+		
+		return Create(samples);
+	}
+	
+	/**************************************************************************/
+	
+	bool AudioSampleResource_OGG::Create(AudioSampleData& samples)
+	{
+		Destroy();
+		
+		allegroSample_ = static_cast<SAMPLE*>(malloc(sizeof(SAMPLE)));
+		if (0 == allegroSample_)
+		{
+			LogError("Could not allocate Allegro Audio Sample!");
+			return false;
+		}
+		
+		allegroSample_->bits			= samples.bits;
+		allegroSample_->stereo 			= samples.stereo;
+		allegroSample_->freq 			= samples.frequency;
+		allegroSample_->len 			= samples.length;
+		allegroSample_->data			= samples.data;
+		allegroSample_->loop_start 		= 0;
+		allegroSample_->loop_end 		= allegroSample_->len;
+		allegroSample_->priority		= 128;
+		
+		// the sample owns the data now
+		samples.data = 0;
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool AudioSampleResource_OGG::Decode(const char* fileName, AudioSampleData& samples)
+	{
+		TraceZone traceZone("AudioSampleResource_OGG::Decode", "asset", fileName);
+		
+		samples.bits 		= 16;
+		samples.stereo 		= 0;
+		samples.frequency 	= 0;
+		samples.length 		= 0;
+		samples.data 		= 0;
+		
+		VirtualFile* file 		= 0;
 		vorbis_info* vorbisInfo = 0;
 		OggVorbis_File vorbisFile;
 		
 		int bytesOfDataRead 	= 0;
-		int dataOffset			= 0;
+		unsigned long dataOffset = 0;
 		int bitstream			= 0;
 		
 		char dataBuffer[AUDIORESOURCE_OGG_BUFFER_SIZE];
 		
-		fp = fopen(fileName, "rb");
-		if (!fp)
+		file = VirtualFileSystem->Open(fileName);
+		if (!file)
 		{
-			LogFatal("Could not load the file %s", fileName);
+			LogError("Could not open the file %s", fileName);
+			return false;
 		}
 	
-		int ovResult = ov_open_callbacks(fp, &vorbisFile, 0, 0, OV_CALLBACKS_DEFAULT);
+		int ovResult = ov_open_callbacks(file, &vorbisFile, 0, 0, VORBIS_VIRTUAL_FILE_CALLBACKS);
 		if (0 != ovResult)
 		{
 			switch(ovResult)
 			{
 				case OV_EREAD:
 				{
-					LogFatal("ov_open_callbacks Error - A read from media returned an error.");
+					LogError("ov_open_callbacks Error - A read from media returned an error.");
 				} break;
 		
 				case OV_ENOTVORBIS:
 				{
-					LogFatal("ov_open_callbacks Error - Bitstream does not contain any Vorbis data.");
+					LogError("ov_open_callbacks Error - Bitstream does not contain any Vorbis data.");
 				} break;
 		
 				case OV_EVERSION:
 				{
-					LogFatal("ov_open_callbacks Error - Vorbis version mismatch.");
+					LogError("ov_open_callbacks Error - Vorbis version mismatch.");
 				} break;
 		
 				case OV_EBADHEADER:
 				{
-					LogFatal("ov_open_callbacks Error - Invalid Vorbis bitstream header.");
+					LogError("ov_open_callbacks Error - Invalid Vorbis bitstream header.");
 				} break;
 		
 				case OV_EFAULT:
 				{
-					LogFatal("ov_open_callbacks Error - Internal logic fault; indicates a bug or heap/stack corruption.");
+					LogError("ov_open_callbacks Error - Internal logic fault; indicates a bug or heap/stack corruption.");
 				} break;
 			}
+			// the file is only closed by ov_clear() once it has been opened
+			delete file;
 			return false;
 		}
 	
@@ -110,41 +229,70 @@ namespace ENGINE
 			vorbisInfo->bitrate_nominal
 			);
 		
-		allegroSample_ = static_cast<SAMPLE*>(malloc(sizeof(SAMPLE)));
-		if (0 == allegroSample_)
+		samples.stereo 		= (vorbisInfo->channels > 1) ? 1 : 0;
+		samples.frequency 	= vorbisInfo->rate;
+		samples.length 		= ov_pcm_total(&vorbisFile, -1);
+		
+		// room for two channels of 16 bit samples
+		unsigned long dataSize 	= samples.length * 0x2 * sizeof(unsigned short);
+		samples.data 			= malloc(dataSize);
+		if (0 == samples.data)
 		{
-			LogError("Could not allocate Allegro Audio Sample!");
+			LogError("Could not allocate %lu bytes for the sound in %s!", dataSize, fileName);
 			ov_clear(&vorbisFile);
 			return false;
 		}
 		
-		allegroSample_->bits			= 16;
-		allegroSample_->stereo 			= (vorbisInfo->channels > 1) ? 1 : 0;
-		allegroSample_->freq 			= vorbisInfo->rate;
-		allegroSample_->len 			= ov_pcm_total(&vorbisFile, -1);
-		
-		allegroSample_->data			= malloc(sizeof(unsigned short[allegroSample_->len * 0x2]));
-		allegroSample_->loop_start 		= 0;
-		allegroSample_->loop_end 		= allegroSample_->len;
-		allegroSample_->priority		= 128;
+		for (;;)
+		{
+			bytesOfDataRead = ov_read(&vorbisFile, 
+				dataBuffer, 
+				AUDIORESOURCE_OGG_BUFFER_SIZE, 
+				0, 
+				2, 
+				0, 
+				&bitstream);
+			
+			if (0 == bytesOfDataRead)
+			{
+				break;
+			}
+			
+			if (OV_HOLE == bytesOfDataRead)
+			{
+				// a gap in the data; the samples after it are still good
+				LogWarning("ov_read Warning - %s has a hole in its data, skipping it.", fileName);
+				continue;
+			}
+			
+			if (bytesOfDataRead < 0)
+			{
+				LogError("ov_read Error - %s could not be decoded past %lu bytes.", fileName, dataOffset);
+				break;
+			}
+			
+			unsigned long bytesToCopy = static_cast<unsigned long>(bytesOfDataRead);
+			if (dataOffset + bytesToCopy > dataSize)
+			{
+				bytesToCopy = dataSize - dataOffset;
+			}
+			
+			unsigned char* dataPointer = static_cast<unsigned char*>(samples.data);
+			memcpy(static_cast<unsigned char*>(dataOffset + dataPointer), dataBuffer, bytesToCopy);
+			dataOffset += bytesToCopy;
+		}
 		
-		while((bytesOfDataRead = ov_read(&vorbisFile, 
-			dataBuffer, 
-			AUDIORESOURCE_OGG_BUFFER_SIZE, 
-			0, 
-			2, 
-			0, 
-			&bitstream)))
+		// whatever the holes and errors left undecoded plays as silence, which is the middle of the unsigned range
+		unsigned short* silence = reinterpret_cast<unsigned short*>(static_cast<unsigned char*>(samples.data) + dataOffset);
+		for (unsigned long index = dataOffset; index + sizeof(unsigned short) <= dataSize; index += sizeof(unsigned short))
 		{
-			unsigned char* dataPointer = static_cast<unsigned char*>(allegroSample_->data);
-			memcpy(static_cast<unsigned char*>(dataOffset + dataPointer), dataBuffer, bytesOfDataRead);
-			dataOffset += bytesOfDataRead;
+			*silence++ = 0x8000;
 		}
 		
 		ov_clear(&vorbisFile);
 		return true;
 	}
-	
+
 	/**************************************************************************/
 	
 	int AudioSampleResource_OGG::Play(int volume, int pan, int frequency, int loop)
@@ -211,6 +359,8 @@ namespace ENGINE
 	
 	bool AudioStreamResource_OGG::Load(const char* fileName, int volume, int pan, int loop)
 	{
+		TraceZone traceZone("AudioStreamResource_OGG::Load", "asset", fileName);
+		
 		fileName_ = strdup(fileName);
 
 		if (!fileName_)
@@ -241,6 +391,8 @@ namespace ENGINE
 	
 	int AudioStreamResource_OGG::Update()
 	{
+		ProfileScope("AudioStreamResource_OGG::Update");
+		
 		if (stopped_)
 		{
 			Restart();
@@ -314,15 +466,15 @@ namespace ENGINE
 	
 	int AudioStreamResource_OGG::OpenStream()
 	{
-		FILE* fp;
+		VirtualFile* file;
 		vorbis_info* vorbisInfo;
-		fp = fopen(fileName_, "rb");
-		if (!fp)
+		file = VirtualFileSystem->Open(fileName_);
+		if (!file)
 		{
 			LogFatal("Could not load the file %s", fileName_);
 		}
 	
-		int ovResult = ov_open_callbacks(fp, &vorbisFile_, 0, 0, OV_CALLBACKS_DEFAULT);
+		int ovResult = ov_open_callbacks(file, &vorbisFile_, 0, 0, VORBIS_VIRTUAL_FILE_CALLBACKS);
 		if (0 != ovResult)
 		{
 			switch(ovResult)
@@ -352,6 +504,7 @@ namespace ENGINE
 					LogFatal("ov_open_callbacks Error - Internal logic fault; indicates a bug or heap/stack corruption.");
 				} break;
 			}
+			delete file;
 			return 1;
 		}
 	
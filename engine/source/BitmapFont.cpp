@@ -27,6 +27,9 @@
 // include the image resource header
 #include "ImageResource.h"
 
+// include the image cache header
+#include "ImageCache.h"
+
 // include the error reporting header
 #include "DebugReport.h"
 
@@ -326,9 +329,9 @@ namespace ENGINE
 	{
 		Destroy();
 		
-		fontImage_ = new ImageResource();
+		fontImage_ = ImageCache->Acquire(filePath);
 		
-		if (!fontImage_->Load(filePath))
+		if (0 == fontImage_)
 		{
 			LogError("Could not load font resource from %s!", filePath);
 			return false;
@@ -453,7 +456,12 @@ namespace ENGINE
 	{
 		if (0 != fontImage_)
 		{
-			delete fontImage_;
+			// a font loaded from a file shares its image with the image cache
+			if (!ImageCache->Release(fontImage_))
+			{
+				delete fontImage_;
+			}
+			fontImage_ = 0;
 		}
 	}
 	
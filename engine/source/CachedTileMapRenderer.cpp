@@ -0,0 +1,443 @@
+
+// CODESTYLE: v2.0
+
+// CachedTileMapRenderer.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: A TileMapRenderer that keeps prerendered chunks of the map in offscreen images
+
+/**
+ * \file CachedTileMapRenderer.cpp
+ * \brief Tile-Based Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+
+// include the complementing header
+#include "CachedTileMapRenderer.h"
+
+// include the profiler header
+#include "Profiler.h"
+
+// include the tileset header
+#include "Tileset.h"
+
+// include the tile map header
+#include "TileMap.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	//! the number of bits of a chunk key that hold the X coordinate of the chunk
+	const int TILEMAP_CACHE_CHUNK_KEY_SHIFT = 16;
+	
+	/**************************************************************************/
+	
+	CachedTileMapRenderer::CachedTileMapRenderer() :
+		TileMapRenderer(),
+		chunkSize_(TILEMAP_CACHE_DEFAULT_CHUNK_SIZE),
+		memoryBudget_(TILEMAP_CACHE_DEFAULT_MEMORY_BUDGET),
+		memoryUsed_(0),
+		frame_(0),
+		cachedTileWidth_(0),
+		cachedTileHeight_(0)
+	{
+	}
+	
+	/**************************************************************************/
+	
+	CachedTileMapRenderer::CachedTileMapRenderer(
+		TileMap* tileMap, 
+		Tileset* tileSet, 
+		ImageResource* target, 
+		int chunkSize, 
+		unsigned int memoryBudget) :
+		TileMapRenderer(0, tileSet, target),
+		chunkSize_(TILEMAP_CACHE_DEFAULT_CHUNK_SIZE),
+		memoryBudget_(memoryBudget),
+		memoryUsed_(0),
+		frame_(0),
+		cachedTileWidth_(0),
+		cachedTileHeight_(0)
+	{
+		SetChunkSize(chunkSize);
+		SetTileMap(tileMap);
+	}
+	
+	/**************************************************************************/
+	
+	CachedTileMapRenderer::~CachedTileMapRenderer()
+	{
+		if (0 != tileMap_)
+		{
+			tileMap_->RemoveListener(this);
+		}
+		
+		Flush();
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::SetTileMap(TileMap* tileMap)
+	{
+		if (0 != tileMap_)
+		{
+			tileMap_->RemoveListener(this);
+		}
+		
+		Flush();
+		
+		TileMapRenderer::SetTileMap(tileMap);
+		
+		if (0 != tileMap_)
+		{
+			tileMap_->AddListener(this);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::SetTileset(Tileset* tileSet)
+	{
+		TileMapRenderer::SetTileset(tileSet);
+		InvalidateAll();
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::SetChunkSize(int chunkSize)
+	{
+		if (chunkSize <= 0)
+		{
+			LogWarning("Invalid chunk size %d specified for CachedTileMapRenderer! Using %d instead.", 
+				chunkSize, TILEMAP_CACHE_DEFAULT_CHUNK_SIZE);
+			chunkSize = TILEMAP_CACHE_DEFAULT_CHUNK_SIZE;
+		}
+		
+		if (chunkSize != chunkSize_)
+		{
+			Flush();
+			chunkSize_ = chunkSize;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::SetMemoryBudget(unsigned int memoryBudget)
+	{
+		memoryBudget_ = memoryBudget;
+		EvictChunks();
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::InvalidateAll()
+	{
+		ChunkSTLMapIterator iter;
+		for (iter = chunks_.begin(); iter != chunks_.end(); iter++)
+		{
+			iter->second.dirty = true;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::Flush()
+	{
+		ChunkSTLMapIterator iter;
+		for (iter = chunks_.begin(); iter != chunks_.end(); iter++)
+		{
+			if (0 != iter->second.image)
+			{
+				delete iter->second.image;
+				iter->second.image = 0;
+			}
+		}
+		
+		chunks_.clear();
+		lru_.clear();
+		memoryUsed_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	int CachedTileMapRenderer::GetChunkSize()
+	{
+		return chunkSize_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int CachedTileMapRenderer::GetMemoryBudget()
+	{
+		return memoryBudget_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int CachedTileMapRenderer::GetMemoryUsed()
+	{
+		return memoryUsed_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int CachedTileMapRenderer::GetChunkCount()
+	{
+		return static_cast<unsigned int>(chunks_.size());
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::Render()
+	{
+		ProfileScope("CachedTileMapRenderer::Render");
+		
+		if ((0 == tileMap_) || (0 == tileSet_) || (0 == renderTarget_))
+		{
+			LogWarning("Attempted to render with an incomplete CachedTileMapRenderer!");
+			return;
+		}
+		
+		int firstColumn = 0;
+		int firstRow 	= 0;
+		int lastColumn 	= 0;
+		int lastRow 	= 0;
+		
+		if (!GetVisibleTileRange(firstColumn, firstRow, lastColumn, lastRow))
+		{
+			// nothing is visible
+			return;
+		}
+		
+		int tileWidth 	= tileSet_->Get(static_cast<unsigned int>(0))->GetWidth();
+		int tileHeight 	= tileSet_->Get(static_cast<unsigned int>(0))->GetHeight();
+		
+		// chunks rendered with a different tile size are the wrong size and have to go
+		if ((tileWidth != cachedTileWidth_) || (tileHeight != cachedTileHeight_))
+		{
+			Flush();
+			cachedTileWidth_ 	= tileWidth;
+			cachedTileHeight_ 	= tileHeight;
+		}
+		
+		int oldClipX1 = 0, oldClipY1 = 0, oldClipX2 = 0, oldClipY2 = 0;
+		if (!ClipToViewport(oldClipX1, oldClipY1, oldClipX2, oldClipY2))
+		{
+			return;
+		}
+		
+		frame_++;
+		
+		int chunkPixelWidth 	= chunkSize_ * tileWidth;
+		int chunkPixelHeight 	= chunkSize_ * tileHeight;
+		
+		int firstChunkX 		= firstColumn / chunkSize_;
+		int firstChunkY 		= firstRow / chunkSize_;
+		int lastChunkX 			= (lastColumn - 1) / chunkSize_;
+		int lastChunkY 			= (lastRow - 1) / chunkSize_;
+		
+		for (int chunkY = firstChunkY; chunkY <= lastChunkY; chunkY++)
+		{
+			for (int chunkX = firstChunkX; chunkX <= lastChunkX; chunkX++)
+			{
+				Chunk* chunk = AcquireChunk(chunkX, chunkY);
+				
+				if ((0 != chunk) && (0 != chunk->image))
+				{
+					chunk->image->Blit(renderTarget_, 0, 0, 
+						viewportX_ + (chunkX * chunkPixelWidth) - cameraX_,
+						viewportY_ + (chunkY * chunkPixelHeight) - cameraY_,
+						chunk->image->GetWidth(), chunk->image->GetHeight());
+				}
+			}
+		}
+		
+		renderTarget_->SetClipRect(oldClipX1, oldClipY1, oldClipX2, oldClipY2);
+		
+		EvictChunks();
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::OnTilesChanged(TileMap* tileMap, int x, int y, int width, int height)
+	{
+		if ((tileMap != tileMap_) || (chunks_.empty()) || (width <= 0) || (height <= 0))
+		{
+			return;
+		}
+		
+		int firstChunkX 		= x / chunkSize_;
+		int firstChunkY 		= y / chunkSize_;
+		int lastChunkX 			= (x + width - 1) / chunkSize_;
+		int lastChunkY 			= (y + height - 1) / chunkSize_;
+		
+		unsigned int chunksInRange = 
+			static_cast<unsigned int>((1 + lastChunkX - firstChunkX) * (1 + lastChunkY - firstChunkY));
+		
+		if (chunksInRange > chunks_.size())
+		{
+			// a large change, so it is cheaper to test every cached chunk than to look up every chunk in range
+			ChunkSTLMapIterator iter;
+			for (iter = chunks_.begin(); iter != chunks_.end(); iter++)
+			{
+				int chunkX = iter->first & ((1 << TILEMAP_CACHE_CHUNK_KEY_SHIFT) - 1);
+				int chunkY = iter->first >> TILEMAP_CACHE_CHUNK_KEY_SHIFT;
+				
+				if ((chunkX >= firstChunkX) && (chunkX <= lastChunkX) && 
+					(chunkY >= firstChunkY) && (chunkY <= lastChunkY))
+				{
+					iter->second.dirty = true;
+				}
+			}
+			return;
+		}
+		
+		for (int chunkY = firstChunkY; chunkY <= lastChunkY; chunkY++)
+		{
+			for (int chunkX = firstChunkX; chunkX <= lastChunkX; chunkX++)
+			{
+				ChunkSTLMapIterator iter = chunks_.find(GetChunkKey(chunkX, chunkY));
+				
+				if (iter != chunks_.end())
+				{
+					iter->second.dirty = true;
+				}
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	int CachedTileMapRenderer::GetChunkKey(int chunkX, int chunkY)
+	{
+		return (chunkY << TILEMAP_CACHE_CHUNK_KEY_SHIFT) | chunkX;
+	}
+	
+	/**************************************************************************/
+	
+	CachedTileMapRenderer::Chunk* CachedTileMapRenderer::AcquireChunk(int chunkX, int chunkY)
+	{
+		int key = GetChunkKey(chunkX, chunkY);
+		
+		ChunkSTLMapIterator iter = chunks_.find(key);
+		
+		if (iter == chunks_.end())
+		{
+			Chunk newChunk;
+			newChunk.image 		= 0;
+			newChunk.bytes 		= 0;
+			newChunk.dirty 		= true;
+			newChunk.lastFrame 	= 0;
+			
+			iter = chunks_.insert(std::make_pair(key, newChunk)).first;
+			lru_.push_front(key);
+			iter->second.lruPosition = lru_.begin();
+		}
+		else
+		{
+			// move the chunk to the front of the least recently used list
+			lru_.splice(lru_.begin(), lru_, iter->second.lruPosition);
+		}
+		
+		Chunk* chunk = &iter->second;
+		chunk->lastFrame = frame_;
+		
+		if (chunk->dirty)
+		{
+			RenderChunk(chunk, chunkX, chunkY);
+		}
+		
+		return chunk;
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::RenderChunk(Chunk* chunk, int chunkX, int chunkY)
+	{
+		int firstColumn 	= chunkX * chunkSize_;
+		int firstRow 		= chunkY * chunkSize_;
+		int lastColumn 		= firstColumn + chunkSize_;
+		int lastRow 		= firstRow + chunkSize_;
+		
+		// chunks along the right and bottom edges of the map only cover the tiles that remain
+		lastColumn 	= (lastColumn > tileMap_->GetWidth()) ? tileMap_->GetWidth() : lastColumn;
+		lastRow 	= (lastRow > tileMap_->GetHeight()) ? tileMap_->GetHeight() : lastRow;
+		
+		int width 	= (lastColumn - firstColumn) * cachedTileWidth_;
+		int height 	= (lastRow - firstRow) * cachedTileHeight_;
+		
+		if ((0 != chunk->image) && ((chunk->image->GetWidth() != width) || (chunk->image->GetHeight() != height)))
+		{
+			memoryUsed_ -= chunk->bytes;
+			delete chunk->image;
+			chunk->image = 0;
+			chunk->bytes = 0;
+		}
+		
+		if ((width <= 0) || (height <= 0))
+		{
+			chunk->dirty = false;
+			return;
+		}
+		
+		if (0 == chunk->image)
+		{
+			chunk->image = new ImageResource(width, height);
+			chunk->bytes = static_cast<unsigned int>(width * height * ((chunk->image->GetColorDepth() + 7) / 8));
+			memoryUsed_ += chunk->bytes;
+		}
+		else
+		{
+			chunk->image->Clear();
+		}
+		
+		DrawTiles(chunk->image, firstColumn, firstRow, lastColumn, lastRow, 0, 0);
+		
+		chunk->dirty = false;
+	}
+	
+	/**************************************************************************/
+	
+	void CachedTileMapRenderer::EvictChunks()
+	{
+		while ((memoryUsed_ > memoryBudget_) && (!lru_.empty()))
+		{
+			int key = lru_.back();
+			
+			ChunkSTLMapIterator iter = chunks_.find(key);
+			
+			// the least recently seen chunk is visible right now, so nothing else can go either
+			if ((iter != chunks_.end()) && (iter->second.lastFrame == frame_) && (0 != frame_))
+			{
+				break;
+			}
+			
+			lru_.pop_back();
+			
+			if (iter != chunks_.end())
+			{
+				if (0 != iter->second.image)
+				{
+					memoryUsed_ -= iter->second.bytes;
+					delete iter->second.image;
+				}
+				chunks_.erase(iter);
+			}
+		}
+	}
+	
+} // end namespace
+
+
+
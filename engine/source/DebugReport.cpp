@@ -14,6 +14,9 @@
 
 #include "DebugReport.h"
 
+// include the threading header
+#include "Threading.h"
+
 /**
  * \file DebugReport.cpp
  * \brief Project Debugging Utility Library - Error Reporting Implementation
@@ -22,6 +25,184 @@
 
 namespace DEBUG
 {
+	/**
+	 * \struct DebugReportRecord
+	 * \brief A report that is waiting to be written. The location and message strings are stored right after the record.
+	 */
+	struct DebugReportRecord
+	{
+		//! the next record in the queue
+		DebugReportRecord* next;
+		
+		//! the report severity level
+		ReportSeverityLevel severity;
+		
+		//! the time that the report was made at
+		time_t time;
+		
+		//! the name of the File that the report was made in
+		char* location;
+		
+		//! the report
+		char* message;
+	};
+	
+	/**
+	 * \struct DebugReportRateSlot
+	 * \brief Counts the reports made with one line of code and text in the current second
+	 */
+	struct DebugReportRateSlot
+	{
+		//! the hash of the line of code and text that is being counted, which another report may take the slot over from
+		volatile int key;
+		
+		//! the second that is being counted
+		volatile int second;
+		
+		//! the number of reports made in the second
+		volatile int count;
+		
+		//! the number of reports dropped since the last one that got through
+		volatile int suppressed;
+	};
+	
+	//! the report counters for DebugReportInfo::CheckRateLimit()
+	static DebugReportRateSlot rateSlots[DBGREP_RATE_LIMIT_SLOTS];
+	
+	/**
+	 * \enum DebugReportWriterFile
+	 * \brief The files that the reports are written to
+	 */
+	enum DebugReportWriterFile
+	{
+		//! errors.txt
+		DebugReportWriter_Errors,
+		//! warnings.txt
+		DebugReportWriter_Warnings,
+		//! messages.txt
+		DebugReportWriter_Messages,
+		//! log.txt
+		DebugReportWriter_Log,
+		//! the number of files
+		DebugReportWriter_FileCount
+	};
+	
+	/**
+	 * \class DebugReportWriter
+	 * \brief Queues the reports and writes them to the files on a background thread.
+	 * \ingroup DebugGroup
+	 * \author Richard Marks <ccpsceo@gmail.com>
+	 *
+	 * Any thread may add reports to the queue without locking. The background thread takes the whole queue
+	 * at once, writes it, and flushes the files once for the batch. The files stay open.
+	 */
+	class DebugReportWriter
+	{
+	public:
+		/**
+		 * \return the writer, which is created and started by the first report
+		 */
+		static DebugReportWriter* GetInstance();
+		
+		/**
+		 * Queues a report, or writes it right away if it is fatal or the background thread is not running
+		 */
+		void Post(ReportSeverityLevel severity, const char* location, const char* message);
+		
+		/**
+		 * Writes every queued report and flushes the files
+		 */
+		void Flush();
+		
+	private:
+		/**
+		 * hidden constructor
+		 */
+		DebugReportWriter();
+		
+		/**
+		 * hidden copy constructor
+		 */
+		DebugReportWriter(const DebugReportWriter& rhs);
+		
+		/**
+		 * hidden assignment operator
+		 */
+		const DebugReportWriter& operator=(const DebugReportWriter& rhs);
+		
+		/**
+		 * starts the background thread
+		 */
+		void Start();
+		
+		/**
+		 * stops the background thread and writes what is left in the queue; called when the program exits
+		 */
+		static void Stop();
+		
+		/**
+		 * the function of the background thread
+		 */
+		static void Run(void* data);
+		
+		/**
+		 * \return every queued record, oldest first, and empties the queue
+		 */
+		DebugReportRecord* TakeRecords();
+		
+		/**
+		 * writes and deletes a list of records
+		 */
+		void WriteRecords(DebugReportRecord* records);
+		
+		/**
+		 * \return the file that reports of a severity level are written to, opening it if needed
+		 */
+		FILE* GetFile(ReportSeverityLevel severity);
+		
+		/**
+		 * flushes the open files
+		 */
+		void FlushFiles();
+		
+		/**
+		 * \return the formatted timestamp of a time
+		 */
+		const char* GetTimeStamp(time_t rawTime);
+		
+		//! the newest queued record
+		void* volatile head_;
+		
+		//! the number of queued records
+		volatile int queuedCount_;
+		
+		//! the number of reports dropped because the queue was full
+		volatile int droppedCount_;
+		
+		//! 1 while the background thread is writing the reports
+		volatile int running_;
+		
+		//! held while reports are written, so that a flush on another thread does not mix its reports in
+		ENGINE::Mutex writeMutex_;
+		
+		//! wakes the background thread up early
+		ENGINE::ThreadEvent wakeEvent_;
+		
+		//! the background thread
+		ENGINE::Thread thread_;
+		
+		//! the open files
+		FILE* files_[DebugReportWriter_FileCount];
+		
+		//! the time of the cached timestamp
+		time_t timeStampTime_;
+		
+		//! the cached timestamp
+		char timeStampBuffer_[128];
+	}; // end class
+	
+	/**************************************************************************/
+	
 	DebugReportInfo::DebugReportInfo(const char* func, const char* file, int line) : 
 		func_(func), 
 		file_(file), 
@@ -44,7 +225,24 @@ namespace DEBUG
 		const int lengthReport = strlen(logBuffer);
 		// concatenate printf-style message string to logBuffer for remaining buffer space minus two for the trailing \n and \0 characters
 		vsnprintf(logBuffer + lengthReport, DEBUG::DBGREP_MAX_REPORT_LENGTH - lengthReport - 2, message, va);
+		
+		// errors are rare and always worth reading, so only the warnings and messages are limited
+		unsigned int suppressed = 0;
+		bool limited = (DebugReport_Fatal != severity) && (DebugReport_Error != severity);
+		if (limited && !CheckRateLimit(logBuffer + lengthReport, suppressed))
+		{
+			return;
+		}
+		
 		strncat(logBuffer, "\n", 2);
+		
+		if (suppressed > 0)
+		{
+			const int lengthMessage = strlen(logBuffer);
+			snprintf(logBuffer + lengthMessage, DEBUG::DBGREP_MAX_REPORT_LENGTH - lengthMessage,
+				"\t\t(%u more of the same report were dropped)\n", suppressed);
+		}
+		
 		DEBUG::DebugReport::Log(severity, file_, logBuffer);
 	}
 
@@ -95,123 +293,437 @@ namespace DEBUG
 		va_list va;
 		va_start(va, message);
 		char logBuffer[DEBUG::DBGREP_MAX_REPORT_LENGTH];
-		const int lengthReport = strlen(logBuffer);
-		vsnprintf(logBuffer + lengthReport, DEBUG::DBGREP_MAX_REPORT_LENGTH - lengthReport - 2, message, va);
+		vsnprintf(logBuffer, DEBUG::DBGREP_MAX_REPORT_LENGTH - 2, message, va);
+		va_end(va);
+		
+		unsigned int suppressed = 0;
+		if (!CheckRateLimit(logBuffer, suppressed))
+		{
+			return;
+		}
+		
 		strncat(logBuffer, "\n", 2);
 		DEBUG::DebugReport::Log(DebugReport_SimpleMessage, func_, logBuffer);
-		va_end(va);
+	}
+	
+	/**************************************************************************/
+	
+	bool DebugReportInfo::CheckRateLimit(const char* text, unsigned int& suppressed)
+	{
+		// hash the file, line and text of the report (FNV-1a), so that only the same report repeated is limited
+		unsigned int key = 2166136261U;
+		key = (key ^ static_cast<unsigned int>(line_)) * 16777619U;
+		for (const char* character = file_; 0 != character && '\0' != *character; character++)
+		{
+			key = (key ^ static_cast<unsigned char>(*character)) * 16777619U;
+		}
+		for (const char* character = text; '\0' != *character; character++)
+		{
+			key = (key ^ static_cast<unsigned char>(*character)) * 16777619U;
+		}
+		DebugReportRateSlot& slot = rateSlots[(key ^ (key >> 13)) % DBGREP_RATE_LIMIT_SLOTS];
+		
+		// another report that hashes to the same slot takes it over and starts counting from zero, so reports that
+		// share a slot are never dropped because of each other; at worst they are not limited while they alternate
+		int slotKey = static_cast<int>(key);
+		int owner = slot.key;
+		if ((owner != slotKey) && ENGINE::AtomicCompareAndSwap(&slot.key, owner, slotKey))
+		{
+			ENGINE::AtomicExchange(&slot.count, 0);
+			ENGINE::AtomicExchange(&slot.suppressed, 0);
+		}
+		
+		// start counting again every second
+		int now = static_cast<int>(time(0));
+		int second = slot.second;
+		if ((second != now) && ENGINE::AtomicCompareAndSwap(&slot.second, second, now))
+		{
+			ENGINE::AtomicExchange(&slot.count, 0);
+		}
+		
+		if (ENGINE::AtomicIncrement(&slot.count) > DBGREP_MAX_REPORTS_PER_SECOND)
+		{
+			ENGINE::AtomicIncrement(&slot.suppressed);
+			return false;
+		}
+		
+		suppressed = static_cast<unsigned int>(ENGINE::AtomicExchange(&slot.suppressed, 0));
+		return true;
 	}
 	
 	/**************************************************************************/
 	
 	void DebugReport::Log(ReportSeverityLevel severity, const char* location, const char* message)
 	{
-		FILE* fp = 0;
+		DebugReportWriter* writer = DebugReportWriter::GetInstance();
+		writer->Post(severity, location, message);
 		
-		// create a timestamp for the report
-		char timeStampBuffer[128];
-		time_t rawTime;
-		time(&rawTime);
-		strftime (timeStampBuffer, 128, "%I:%M:%S %p %Z on %m-%d-%Y", localtime(&rawTime));
+		// this is a fatal error. process execution will cease after this call
+		if (DebugReport_Fatal == severity)
+		{
+			writer->Flush();
+			exit(1);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReport::Flush()
+	{
+		DebugReportWriter::GetInstance()->Flush();
+	}
+	
+	/**************************************************************************/
+	
+	DebugReport::DebugReport()
+	{
+		// We NEVER need to create an instance of this class.
+	}	
+	
+	/**************************************************************************/
+	
+	DebugReportWriter* DebugReportWriter::GetInstance()
+	{
+		// the writer is never deleted, so that reports can still be made while static objects are being destroyed
+		static DebugReportWriter* volatile instance = 0;
+		if (0 == instance)
+		{
+			DebugReportWriter* writer = new DebugReportWriter();
+			if (ENGINE::AtomicCompareAndSwapPointer(reinterpret_cast<void* volatile*>(&instance), 0, writer))
+			{
+				writer->Start();
+			}
+			else
+			{
+				// another thread made the first report at the same time
+				delete writer;
+			}
+		}
+		return instance;
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReportWriter::Post(ReportSeverityLevel severity, const char* location, const char* message)
+	{
+		if (0 == location)
+		{
+			location = "";
+		}
 		
-		// how severe is the reporting?
-		switch(severity)
+		if (0 == message)
 		{
-			// this is a fatal error. process execution will cease after this call
-			case DebugReport_Fatal:
+			message = "";
+		}
+		
+		bool queued = (0 != running_) && (DebugReport_Fatal != severity);
+		
+		if (queued && (ENGINE::AtomicIncrement(&queuedCount_) > DBGREP_MAX_QUEUED_REPORTS))
+		{
+			// the writer cannot keep up
+			ENGINE::AtomicDecrement(&queuedCount_);
+			ENGINE::AtomicIncrement(&droppedCount_);
+			return;
+		}
+		
+		// the strings are copied into the same block as the record
+		unsigned int locationLength = strlen(location) + 1;
+		unsigned int messageLength = strlen(message) + 1;
+		char* block = new char [sizeof(DebugReportRecord) + locationLength + messageLength];
+		
+		DebugReportRecord* record 	= reinterpret_cast<DebugReportRecord*>(block);
+		record->next 				= 0;
+		record->severity 			= severity;
+		record->time 				= time(0);
+		record->location 			= block + sizeof(DebugReportRecord);
+		record->message 			= record->location + locationLength;
+		memcpy(record->location, location, locationLength);
+		memcpy(record->message, message, messageLength);
+		
+		if (!queued)
+		{
+			// fatal errors, and reports made before the writer started or after it stopped, are written right away
+			ENGINE::MutexLock lock(writeMutex_);
+			WriteRecords(TakeRecords());
+			WriteRecords(record);
+			FlushFiles();
+			return;
+		}
+		
+		// push the record onto the queue
+		void* head = 0;
+		do
+		{
+			head = head_;
+			record->next = static_cast<DebugReportRecord*>(head);
+		} while (!ENGINE::AtomicCompareAndSwapPointer(&head_, head, record));
+		
+		// errors are written right away, everything else waits for the next flush unless the queue is filling up
+		if ((DebugReport_Error == severity) || (DBGREP_WAKE_THRESHOLD == queuedCount_))
+		{
+			wakeEvent_.Signal();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReportWriter::Flush()
+	{
+		ENGINE::MutexLock lock(writeMutex_);
+		
+		DebugReportRecord* records = TakeRecords();
+		int dropped = ENGINE::AtomicExchange(&droppedCount_, 0);
+		
+		if ((0 == records) && (0 == dropped))
+		{
+			return;
+		}
+		
+		WriteRecords(records);
+		
+		if (dropped > 0)
+		{
+			FILE* fp = GetFile(DebugReport_Warning);
+			if (fp)
 			{
-				fp = fopen("errors.txt", "a");
-				if (fp)
-				{
-					fprintf(fp, 
-						"********************************************************************************\n"
-						"A Fatal Error has occurred at %s in the file: %s\n\t"
-						"%s\n"
-						"********************************************************************************\n\n", 
-						timeStampBuffer, location, message);
-					fclose(fp);
-				}
-				fprintf(stderr, "A Fatal Error has occurred at %s in the file: %s\n\t%s\n\n", timeStampBuffer, location, message);
-				exit(1);
-			} break;
+				fprintf(fp, "%d reports were dropped because they were made faster than they could be written\n\n", dropped);
+			}
+			fprintf(stderr, "%d reports were dropped because they were made faster than they could be written\n\n", dropped);
+		}
+		
+		FlushFiles();
+	}
+	
+	/**************************************************************************/
+	
+	DebugReportWriter::DebugReportWriter() :
+		head_(0),
+		queuedCount_(0),
+		droppedCount_(0),
+		running_(0),
+		timeStampTime_(0)
+	{
+		for (unsigned int index = 0; index < DebugReportWriter_FileCount; index++)
+		{
+			files_[index] = 0;
+		}
+		timeStampBuffer_[0] = '\0';
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReportWriter::Start()
+	{
+		running_ = 1;
+		if (!thread_.Start(&DebugReportWriter::Run, this))
+		{
+			// without a thread every report is written right away
+			running_ = 0;
+			return;
+		}
+		atexit(&DebugReportWriter::Stop);
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReportWriter::Stop()
+	{
+		DebugReportWriter* writer = GetInstance();
+		
+		// reports made from here on are written right away
+		ENGINE::AtomicExchange(&writer->running_, 0);
+		writer->wakeEvent_.Signal();
+		writer->thread_.Join();
+		writer->Flush();
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReportWriter::Run(void* data)
+	{
+		DebugReportWriter* writer = static_cast<DebugReportWriter*>(data);
+		while (0 != writer->running_)
+		{
+			writer->wakeEvent_.WaitFor(DBGREP_FLUSH_INTERVAL);
+			writer->Flush();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	DebugReportRecord* DebugReportWriter::TakeRecords()
+	{
+		// take the whole queue at once
+		void* head = 0;
+		do
+		{
+			head = head_;
+		} while (!ENGINE::AtomicCompareAndSwapPointer(&head_, head, 0));
+		
+		// the queue holds the newest record first, so reverse it
+		DebugReportRecord* records = 0;
+		DebugReportRecord* record = static_cast<DebugReportRecord*>(head);
+		int count = 0;
+		while (0 != record)
+		{
+			DebugReportRecord* next = record->next;
+			record->next = records;
+			records = record;
+			record = next;
+			count++;
+		}
+		
+		ENGINE::AtomicAdd(&queuedCount_, -count);
+		return records;
+	}
+	
+	/**************************************************************************/
+	
+	void DebugReportWriter::WriteRecords(DebugReportRecord* records)
+	{
+		while (0 != records)
+		{
+			DebugReportRecord* record = records;
+			records = records->next;
 			
-			// just an error. it is logged and process execution continues.
-			case DebugReport_Error:
-			{
-				fp = fopen("errors.txt", "a");
-				if (fp)
-				{
-					fprintf(fp, 
-						"********************************************************************************\n"
-						"An Error has occurred at %s in the file: %s\n\t"
-						"%s\n"
-						"********************************************************************************\n\n", 
-						timeStampBuffer, location, message);
-					fclose(fp);
-				}
-				fprintf(stderr, "An Error has occurred at %s in the file: %s\n\t%s\n\n", timeStampBuffer, location, message);
-			} break;
+			FILE* fp = GetFile(record->severity);
+			const char* timeStamp = GetTimeStamp(record->time);
+			const char* location = record->location;
+			const char* message = record->message;
 			
-			// a warning. it is logged and process execution continues.
-			case DebugReport_Warning:
+			// how severe is the reporting?
+			switch(record->severity)
 			{
-				// open warnings.txt and write the message to it
-				fp = fopen("warnings.txt", "a");
-				if (fp)
+				// this is a fatal error. process execution will cease after this report is written
+				case DebugReport_Fatal:
 				{
-					fprintf(fp, 
-						"********************************************************************************\n"
-						"A Warning has occurred at %s in the file: %s\n\t"
-						"%s\n"
-						"********************************************************************************\n\n", 
-						timeStampBuffer, location, message);
-					fclose(fp);
-				}
-				fprintf(stderr, "A Warning has occurred at %s in the file: %s\n\t%s\n\n", timeStampBuffer, location, message);
-			} break;
-			
-			// a message. it is logged and process execution continues.
-			case DebugReport_Message:
-			{
-				// open messages.txt and write the message to it
-				fp = fopen("messages.txt", "a");
-				if (fp)
+					if (fp)
+					{
+						fprintf(fp, 
+							"********************************************************************************\n"
+							"A Fatal Error has occurred at %s in the file: %s\n\t"
+							"%s\n"
+							"********************************************************************************\n\n", 
+							timeStamp, location, message);
+					}
+					fprintf(stderr, "A Fatal Error has occurred at %s in the file: %s\n\t%s\n\n", timeStamp, location, message);
+				} break;
+				
+				// just an error. it is logged and process execution continues.
+				case DebugReport_Error:
 				{
-					fprintf(fp, 
-						"********************************************************************************\n"
-						"A Message Reported at %s from the file: %s\n\t"
-						"%s\n"
-						"********************************************************************************\n\n", 
-						timeStampBuffer, location, message);
-					fclose(fp);
-				}
-				fprintf(stderr, "A Message Reported at %s from the file: %s\n\t%s\n", timeStampBuffer, location, message);
-			} break;
-			
-			// a simple message with no formatting it is logged and process execution continues.
-			case DebugReport_SimpleMessage:
-			{
-				// open log.txt and write the message to it
-				fp = fopen("log.txt", "a");
-				if (fp)
+					if (fp)
+					{
+						fprintf(fp, 
+							"********************************************************************************\n"
+							"An Error has occurred at %s in the file: %s\n\t"
+							"%s\n"
+							"********************************************************************************\n\n", 
+							timeStamp, location, message);
+					}
+					fprintf(stderr, "An Error has occurred at %s in the file: %s\n\t%s\n\n", timeStamp, location, message);
+				} break;
+				
+				// a warning. it is logged and process execution continues.
+				case DebugReport_Warning:
+				{
+					if (fp)
+					{
+						fprintf(fp, 
+							"********************************************************************************\n"
+							"A Warning has occurred at %s in the file: %s\n\t"
+							"%s\n"
+							"********************************************************************************\n\n", 
+							timeStamp, location, message);
+					}
+					fprintf(stderr, "A Warning has occurred at %s in the file: %s\n\t%s\n\n", timeStamp, location, message);
+				} break;
+				
+				// a message. it is logged and process execution continues.
+				case DebugReport_Message:
 				{
-					fprintf(fp, "%s: %s", timeStampBuffer, message);
-					fclose(fp);
-				}
-				fprintf(stderr, "%s: %s", timeStampBuffer, message);
-			} break;
+					if (fp)
+					{
+						fprintf(fp, 
+							"********************************************************************************\n"
+							"A Message Reported at %s from the file: %s\n\t"
+							"%s\n"
+							"********************************************************************************\n\n", 
+							timeStamp, location, message);
+					}
+					fprintf(stderr, "A Message Reported at %s from the file: %s\n\t%s\n", timeStamp, location, message);
+				} break;
+				
+				// a simple message with no formatting it is logged and process execution continues.
+				case DebugReport_SimpleMessage:
+				{
+					if (fp)
+					{
+						fprintf(fp, "%s: %s", timeStamp, message);
+					}
+					fprintf(stderr, "%s: %s", timeStamp, message);
+				} break;
+				
+				default: break;
+			}
 			
+			delete [] reinterpret_cast<char*>(record);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	FILE* DebugReportWriter::GetFile(ReportSeverityLevel severity)
+	{
+		DebugReportWriterFile file = DebugReportWriter_Log;
+		const char* fileName = "log.txt";
+		
+		switch(severity)
+		{
+			case DebugReport_Fatal:
+			case DebugReport_Error: { file = DebugReportWriter_Errors; fileName = "errors.txt"; } break;
+			case DebugReport_Warning: { file = DebugReportWriter_Warnings; fileName = "warnings.txt"; } break;
+			case DebugReport_Message: { file = DebugReportWriter_Messages; fileName = "messages.txt"; } break;
 			default: break;
 		}
+		
+		// the files are opened the first time they are needed, and stay open until the program exits
+		if (0 == files_[file])
+		{
+			files_[file] = fopen(fileName, "a");
+		}
+		
+		return files_[file];
 	}
 	
 	/**************************************************************************/
 	
-	DebugReport::DebugReport()
+	void DebugReportWriter::FlushFiles()
 	{
-		// We NEVER need to create an instance of this class.
-	}	
+		for (unsigned int index = 0; index < DebugReportWriter_FileCount; index++)
+		{
+			if (0 != files_[index])
+			{
+				fflush(files_[index]);
+			}
+		}
+		fflush(stderr);
+	}
+	
+	/**************************************************************************/
+	
+	const char* DebugReportWriter::GetTimeStamp(time_t rawTime)
+	{
+		// create a timestamp for the report; reports made in the same second share it
+		if ((rawTime != timeStampTime_) || ('\0' == timeStampBuffer_[0]))
+		{
+			strftime(timeStampBuffer_, sizeof(timeStampBuffer_), "%I:%M:%S %p %Z on %m-%d-%Y", localtime(&rawTime));
+			timeStampTime_ = rawTime;
+		}
+		return timeStampBuffer_;
+	}
 	
 } // end namespace
 
 
+
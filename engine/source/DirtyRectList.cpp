@@ -0,0 +1,183 @@
+
+// CODESTYLE: v2.0
+
+// DirtyRectList.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: A list of the changed regions of an image that merges overlapping regions
+
+/**
+ * \file DirtyRectList.cpp
+ * \brief Dirty Rectangle Tracking Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// include the complementing header
+#include "DirtyRectList.h"
+
+namespace ENGINE
+{
+	DirtyRectList::DirtyRectList(int width, int height)
+	{
+		SetBounds(width, height);
+	}
+	
+	/**************************************************************************/
+	
+	DirtyRectList::~DirtyRectList()
+	{
+		Clear();
+	}
+	
+	/**************************************************************************/
+	
+	void DirtyRectList::SetBounds(int width, int height)
+	{
+		width_ 	= (width < 0) ? 0 : width;
+		height_ = (height < 0) ? 0 : height;
+		Clear();
+	}
+	
+	/**************************************************************************/
+	
+	void DirtyRectList::Add(int x, int y, int width, int height)
+	{
+		// clip the region to the bounds
+		int x1 = (x < 0) ? 0 : x;
+		int y1 = (y < 0) ? 0 : y;
+		int x2 = (x + width > width_) ? width_ : x + width;
+		int y2 = (y + height > height_) ? height_ : y + height;
+		
+		if ((x1 >= x2) || (y1 >= y2))
+		{
+			return;
+		}
+		
+		// keep swallowing every rectangle that the region overlaps or touches, since growing the
+		// region can make it reach rectangles that it did not reach before
+		bool merged = true;
+		while (merged)
+		{
+			merged = false;
+			
+			for (unsigned int index = 0; index < rects_.size(); index++)
+			{
+				DirtyRect& rect = rects_[index];
+				
+				if ((rect.x > x2) || (rect.y > y2) || (rect.x + rect.width < x1) || (rect.y + rect.height < y1))
+				{
+					continue;
+				}
+				
+				x1 = (rect.x < x1) ? rect.x : x1;
+				y1 = (rect.y < y1) ? rect.y : y1;
+				x2 = (rect.x + rect.width > x2) ? rect.x + rect.width : x2;
+				y2 = (rect.y + rect.height > y2) ? rect.y + rect.height : y2;
+				
+				rects_[index] = rects_.back();
+				rects_.pop_back();
+				merged = true;
+				break;
+			}
+		}
+		
+		DirtyRect region;
+		region.x 		= x1;
+		region.y 		= y1;
+		region.width 	= x2 - x1;
+		region.height 	= y2 - y1;
+		rects_.push_back(region);
+		
+		if (rects_.size() > DIRTY_RECT_LIST_MAX_RECTS)
+		{
+			Collapse();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void DirtyRectList::AddAll()
+	{
+		Clear();
+		Add(0, 0, width_, height_);
+	}
+	
+	/**************************************************************************/
+	
+	void DirtyRectList::Clear()
+	{
+		rects_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int DirtyRectList::GetCount()
+	{
+		return static_cast<unsigned int>(rects_.size());
+	}
+	
+	/**************************************************************************/
+	
+	DirtyRect* DirtyRectList::Get(unsigned int index)
+	{
+		if (index >= rects_.size())
+		{
+			return 0;
+		}
+		return &rects_[index];
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int DirtyRectList::GetPixelCount()
+	{
+		unsigned int pixelCount = 0;
+		for (unsigned int index = 0; index < rects_.size(); index++)
+		{
+			pixelCount += static_cast<unsigned int>(rects_[index].width * rects_[index].height);
+		}
+		return pixelCount;
+	}
+	
+	/**************************************************************************/
+	
+	void DirtyRectList::Collapse()
+	{
+		if (rects_.empty())
+		{
+			return;
+		}
+		
+		int x1 = rects_[0].x;
+		int y1 = rects_[0].y;
+		int x2 = rects_[0].x + rects_[0].width;
+		int y2 = rects_[0].y + rects_[0].height;
+		
+		for (unsigned int index = 1; index < rects_.size(); index++)
+		{
+			DirtyRect& rect = rects_[index];
+			x1 = (rect.x < x1) ? rect.x : x1;
+			y1 = (rect.y < y1) ? rect.y : y1;
+			x2 = (rect.x + rect.width > x2) ? rect.x + rect.width : x2;
+			y2 = (rect.y + rect.height > y2) ? rect.y + rect.height : y2;
+		}
+		
+		rects_.clear();
+		
+		DirtyRect region;
+		region.x 		= x1;
+		region.y 		= y1;
+		region.width 	= x2 - x1;
+		region.height 	= y2 - y1;
+		rects_.push_back(region);
+	}
+
+} // end namespace
+
+
+
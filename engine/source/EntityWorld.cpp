@@ -0,0 +1,207 @@
+// CODESTYLE: v2.0
+
+// EntityWorld.cpp
+// Project: Game Engine Design 101 Project (ENGINE)
+// Author: Richard Marks
+// Purpose: stores entities as plain components in dense arrays, for objects that there are too many of to be GameObjects
+
+/**
+ * \file EntityWorld.cpp
+ * \brief Game Object Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the complementing header
+#include "EntityWorld.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	unsigned int NextComponentTypeID()
+	{
+		static unsigned int nextTypeID = 0;
+		return nextTypeID++;
+	}
+	
+	/**************************************************************************/
+	
+	EntityWorld::EntityWorld() :
+		entityCount_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	EntityWorld::~EntityWorld()
+	{
+		// delete all component pools
+		unsigned int index = 0;
+		for (index = 0; index < pools_.size(); index++)
+		{
+			if (0 != pools_[index])
+			{
+				delete pools_[index];
+				pools_[index] = 0;
+			}
+		}
+		pools_.clear();
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	EntityHandle EntityWorld::CreateEntity()
+	{
+		unsigned int index = 0;
+		if (!freeIndices_.empty())
+		{
+			index = freeIndices_.back();
+			freeIndices_.pop_back();
+		}
+		else
+		{
+			if (generations_.size() >= ENTITY_MAX_COUNT)
+			{
+				LogError("An entity world cannot hold more than %u entities!", ENTITY_MAX_COUNT);
+				return ENTITY_NULL;
+			}
+			
+			index = static_cast<unsigned int>(generations_.size());
+			generations_.push_back(1);
+			alive_.push_back(false);
+		}
+		
+		alive_[index] = true;
+		entityCount_++;
+		
+		return (generations_[index] << ENTITY_INDEX_BITS) | index;
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::DestroyEntity(EntityHandle entity)
+	{
+		if (!IsAlive(entity))
+		{
+			return;
+		}
+		
+		std::vector<ComponentPoolBase*>::iterator iter;
+		for (iter = pools_.begin(); iter != pools_.end(); iter++)
+		{
+			if (0 != *iter)
+			{
+				(*iter)->Remove(entity);
+			}
+		}
+		
+		// the old handles of the index stop working, and generation 0 is skipped so that no handle is ever ENTITY_NULL
+		unsigned int index = entity & ENTITY_INDEX_MASK;
+		generations_[index] = (generations_[index] >= ENTITY_MAX_GENERATION) ? 1 : generations_[index] + 1;
+		alive_[index] = false;
+		freeIndices_.push_back(index);
+		entityCount_--;
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::QueueDestroyEntity(EntityHandle entity)
+	{
+		destroyQueue_.push_back(entity);
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::DestroyQueuedEntities()
+	{
+		// an entity that was queued twice is only destroyed once, because the second handle is no longer alive
+		std::vector<EntityHandle>::iterator iter;
+		for (iter = destroyQueue_.begin(); iter != destroyQueue_.end(); iter++)
+		{
+			DestroyEntity(*iter);
+		}
+		destroyQueue_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	bool EntityWorld::IsAlive(EntityHandle entity) const
+	{
+		unsigned int index = entity & ENTITY_INDEX_MASK;
+		return (index < generations_.size()) && alive_[index] && (generations_[index] == (entity >> ENTITY_INDEX_BITS));
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int EntityWorld::GetEntityCount() const
+	{
+		return entityCount_;
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::AddUpdateSystem(EntitySystemFunction function, void* data)
+	{
+		EntitySystem system;
+		system.function = function;
+		system.data = data;
+		updateSystems_.push_back(system);
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::AddRenderSystem(EntitySystemFunction function, void* data)
+	{
+		EntitySystem system;
+		system.function = function;
+		system.data = data;
+		renderSystems_.push_back(system);
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::CallUpdate()
+	{
+		std::vector<EntitySystem>::iterator iter;
+		for (iter = updateSystems_.begin(); iter < updateSystems_.end(); iter++)
+		{
+			iter->function(this, iter->data);
+		}
+		
+		DestroyQueuedEntities();
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::CallRender()
+	{
+		std::vector<EntitySystem>::iterator iter;
+		for (iter = renderSystems_.begin(); iter < renderSystems_.end(); iter++)
+		{
+			iter->function(this, iter->data);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	EntityWorld* EntityWorld::Create()
+	{
+		return new EntityWorld();
+	}
+	
+	/**************************************************************************/
+	
+	void EntityWorld::Destroy(EntityWorld* worldInstance)
+	{
+		if (0 != worldInstance)
+		{
+			delete worldInstance;
+			worldInstance = 0;
+		}
+	}
+
+} // end namespace
+
+
@@ -0,0 +1,144 @@
+// CODESTYLE: v2.0
+
+// GameObjectArena.cpp
+// Project: Game Engine Design 101 Project (ENGINE)
+// Author: Richard Marks
+// Purpose: hands out the memory of game objects of one type from chunks that are reused, instead of from the heap
+
+/**
+ * \file GameObjectArena.cpp
+ * \brief Game Object Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the complementing header
+#include "GameObjectArena.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	/**
+	 * \var GAME_OBJECT_ARENA_ALIGNMENT
+	 * \brief every block starts on a multiple of this, which is enough for any object
+	 */
+	static const size_t GAME_OBJECT_ARENA_ALIGNMENT = 16;
+	
+	/**************************************************************************/
+	
+	GameObjectArena::GameObjectArena(size_t blockSize) :
+		blockSize_(blockSize),
+		freeBlocks_(0),
+		usedCount_(0),
+		capacity_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	GameObjectArena::~GameObjectArena()
+	{
+		// implement class destructor here
+		if (0 != usedCount_)
+		{
+			LogWarning("%u objects of %u bytes were never given back to their arena!", usedCount_, static_cast<unsigned int>(blockSize_));
+		}
+		
+		std::vector<void*>::iterator iter;
+		for (iter = chunks_.begin(); iter != chunks_.end(); iter++)
+		{
+			::operator delete(*iter);
+		}
+		chunks_.clear();
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	void* GameObjectArena::Allocate()
+	{
+		MutexLock lock(mutex_);
+		
+		if (0 == freeBlocks_)
+		{
+			AddChunkInternal(GAME_OBJECT_ARENA_CHUNK_SIZE);
+		}
+		
+		FreeBlock* block = freeBlocks_;
+		freeBlocks_ = block->next;
+		usedCount_++;
+		return block;
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectArena::Free(void* block)
+	{
+		MutexLock lock(mutex_);
+		
+		FreeBlock* freeBlock = reinterpret_cast<FreeBlock*>(block);
+		freeBlock->next = freeBlocks_;
+		freeBlocks_ = freeBlock;
+		usedCount_--;
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectArena::Reserve(unsigned int blockCount)
+	{
+		MutexLock lock(mutex_);
+		
+		if (blockCount > capacity_)
+		{
+			AddChunkInternal(blockCount - capacity_);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	size_t GameObjectArena::GetBlockSize()
+	{
+		return blockSize_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int GameObjectArena::GetUsedCount()
+	{
+		MutexLock lock(mutex_);
+		return usedCount_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int GameObjectArena::GetCapacity()
+	{
+		MutexLock lock(mutex_);
+		return capacity_;
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectArena::AddChunkInternal(unsigned int blockCount)
+	{
+		// the blocks hold a pointer to the next free block while they are free, and stay aligned in the chunk
+		size_t stride = (blockSize_ < sizeof(FreeBlock)) ? sizeof(FreeBlock) : blockSize_;
+		stride = (stride + GAME_OBJECT_ARENA_ALIGNMENT - 1) & ~(GAME_OBJECT_ARENA_ALIGNMENT - 1);
+		
+		char* chunk = reinterpret_cast<char*>(::operator new(stride * blockCount));
+		chunks_.push_back(chunk);
+		
+		// the blocks are linked from the back, so that they are handed out from the front of the chunk
+		for (unsigned int index = blockCount; index > 0; index--)
+		{
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + (stride * (index - 1)));
+			block->next = freeBlocks_;
+			freeBlocks_ = block;
+		}
+		capacity_ += blockCount;
+	}
+
+} // end namespace
+
+
@@ -18,9 +18,13 @@
 // include the game object header
 #include "GameObject.h"
 
+// include the error reporting header
+#include "DebugReport.h"
+
 namespace ENGINE
 {
-	GameObjectGroup::GameObjectGroup()
+	GameObjectGroup::GameObjectGroup() :
+		updateMode_(GameObjectGroupUpdate_Serial)
 	{
 	} // end constructor
 	
@@ -28,12 +32,13 @@ namespace ENGINE
 	
 	GameObjectGroup::~GameObjectGroup()
 	{		
-		// delete all objects
+		// destroy and delete all objects, as DestroyObjectInternal() does
 		unsigned int index = 0;
 		for (index = 0; index < objects_.size(); index++)
 		{
 			if (0 != objects_[index])
 			{
+				objects_[index]->Destroy();
 				delete objects_[index];
 				objects_[index] = 0;
 			}
@@ -43,6 +48,17 @@ namespace ENGINE
 		// clear the named object index
 		names_.clear();
 		
+		// the objects that were never added are deleted too
+		std::vector<GameObjectGroupChange>::iterator change;
+		for (change = changes_.begin(); change != changes_.end(); change++)
+		{
+			if (0 != change->object)
+			{
+				delete change->object;
+			}
+		}
+		changes_.clear();
+	
 	} // end destructor
 	
 	/**************************************************************************/
@@ -60,10 +76,16 @@ namespace ENGINE
 	
 	void GameObjectGroup::CallUpdate()
 	{
-		GameObjectSTLVectorIterator iter;
-		for (iter = objects_.begin(); iter < objects_.end(); iter++)
+		CallUpdateRange(0, (unsigned int)objects_.size());
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroup::CallUpdateRange(unsigned int begin, unsigned int end)
+	{
+		for (unsigned int index = begin; index < end; index++)
 		{
-			(*iter)->Update();
+			objects_[index]->Update();
 		}
 	}
 	
@@ -83,10 +105,13 @@ namespace ENGINE
 	void GameObjectGroup::AddNamedObject(const char* objectName, GameObject* object)
 	{
 		// add the object to the vector
-		objects_.push_back(object);
+		GameObjectID objectID = AddObject(object);
 		
 		// add the name to the index
-		names_[objectName] = (unsigned int)objects_.size() - 1;
+		if (GAME_OBJECT_NO_ID != objectID)
+		{
+			names_[objectName] = objectID;
+		}
 	}
 	
 	/**************************************************************************/
@@ -99,7 +124,7 @@ namespace ENGINE
 		if ((iter = names_.find(objectName)) != names_.end())
 		{
 			// return the object pointer for the named object
-			return objects_.at(iter->second);
+			return GetObject(iter->second);
 		}
 		
 		// object was not found, return null
@@ -108,20 +133,60 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
-	unsigned int GameObjectGroup::AddObject(GameObject* object)
+	GameObjectID GameObjectGroup::AddObject(GameObject* object)
 	{
+		// use the slot of a destroyed object if there is one
+		unsigned int slot = 0;
+		if (!freeSlots_.empty())
+		{
+			slot = freeSlots_.back();
+			freeSlots_.pop_back();
+		}
+		else
+		{
+			if (positions_.size() >= GAME_OBJECT_MAX_COUNT)
+			{
+				LogError("A game object group cannot hold more than %u objects!", GAME_OBJECT_MAX_COUNT);
+				delete object;
+				return GAME_OBJECT_NO_ID;
+			}
+			
+			slot = (unsigned int)positions_.size();
+			positions_.push_back(GAME_OBJECT_MAX_COUNT);
+			generations_.push_back(1);
+		}
+		
+		GameObjectID objectID = (generations_[slot] << GAME_OBJECT_SLOT_BITS) | slot;
+		
 		// add the object to the vector
+		positions_[slot] = (unsigned int)objects_.size();
 		objects_.push_back(object);
+		objectIDs_.push_back(objectID);
 		
 		// return the id for the new object
-		return (unsigned int)objects_.size() - 1;
+		return objectID;
+	}
+	
+	/**************************************************************************/
+	
+	GameObject* GameObjectGroup::GetObject(GameObjectID objectID)
+	{
+		unsigned int position = FindObjectInternal(objectID);
+		return (GAME_OBJECT_MAX_COUNT != position) ? objects_[position] : 0;
 	}
 	
 	/**************************************************************************/
 	
-	GameObject* GameObjectGroup::GetObject(unsigned int objectID)
+	GameObject* GameObjectGroup::GetObjectAt(unsigned int position)
 	{
-		return objects_.at(objectID);
+		return objects_.at(position);
+	}
+	
+	/**************************************************************************/
+	
+	GameObjectID GameObjectGroup::GetObjectIDAt(unsigned int position)
+	{
+		return objectIDs_.at(position);
 	}
 	
 	/**************************************************************************/
@@ -133,6 +198,157 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	void GameObjectGroup::SetUpdateMode(GameObjectGroupUpdateMode updateMode)
+	{
+		updateMode_ = updateMode;
+	}
+	
+	/**************************************************************************/
+	
+	GameObjectGroupUpdateMode GameObjectGroup::GetUpdateMode()
+	{
+		return updateMode_;
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroup::QueueAddObject(GameObject* object)
+	{
+		GameObjectGroupChange change;
+		change.object = object;
+		change.objectID = 0;
+		
+		MutexLock lock(changesMutex_);
+		changes_.push_back(change);
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroup::QueueAddNamedObject(const char* objectName, GameObject* object)
+	{
+		GameObjectGroupChange change;
+		change.object = object;
+		change.name = objectName;
+		change.objectID = 0;
+		
+		MutexLock lock(changesMutex_);
+		changes_.push_back(change);
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroup::QueueDestroyObject(GameObjectID objectID)
+	{
+		GameObjectGroupChange change;
+		change.object = 0;
+		change.objectID = objectID;
+		
+		MutexLock lock(changesMutex_);
+		changes_.push_back(change);
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroup::ApplyQueuedChanges()
+	{
+		// the changes are taken first, so that a Create or Destroy method can queue more for the next frame
+		{
+			MutexLock lock(changesMutex_);
+			appliedChanges_.swap(changes_);
+		}
+		
+		std::vector<GameObjectGroupChange>::iterator change;
+		for (change = appliedChanges_.begin(); change != appliedChanges_.end(); change++)
+		{
+			if (0 != change->object)
+			{
+				// an object that does not fit has already been deleted
+				GameObjectID objectID = AddObject(change->object);
+				if (GAME_OBJECT_NO_ID == objectID)
+				{
+					continue;
+				}
+				
+				if (!change->name.empty())
+				{
+					names_[change->name] = objectID;
+				}
+				
+				// the object is created like the ones that were added before GameObjectGroupManager::CallCreate()
+				change->object->Create();
+			}
+			else
+			{
+				DestroyObjectInternal(change->objectID);
+			}
+		}
+		
+		// the vector keeps its memory for the changes of a later frame
+		appliedChanges_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroup::DestroyObjectInternal(GameObjectID objectID)
+	{
+		// an object that was queued twice is only destroyed once, because its ID stops working the first time
+		unsigned int position = FindObjectInternal(objectID);
+		if (GAME_OBJECT_MAX_COUNT == position)
+		{
+			return;
+		}
+		
+		GameObject* object = objects_[position];
+		
+		// the last object takes the place of the destroyed one
+		unsigned int last = (unsigned int)objects_.size() - 1;
+		if (position != last)
+		{
+			objects_[position] = objects_[last];
+			objectIDs_[position] = objectIDs_[last];
+			positions_[objectIDs_[position] & GAME_OBJECT_SLOT_MASK] = position;
+		}
+		objects_.pop_back();
+		objectIDs_.pop_back();
+		
+		// the slot gets a new generation, and generation 0 is skipped so that no ID is ever GAME_OBJECT_NO_ID
+		unsigned int slot = objectID & GAME_OBJECT_SLOT_MASK;
+		positions_[slot] = GAME_OBJECT_MAX_COUNT;
+		generations_[slot] = (generations_[slot] >= GAME_OBJECT_MAX_GENERATION) ? 1 : generations_[slot] + 1;
+		freeSlots_.push_back(slot);
+		
+		// a named object loses its name
+		GameObjectSTLMapIterator iter = names_.begin();
+		while (iter != names_.end())
+		{
+			if (iter->second == objectID)
+			{
+				names_.erase(iter++);
+			}
+			else
+			{
+				iter++;
+			}
+		}
+		
+		object->Destroy();
+		delete object;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int GameObjectGroup::FindObjectInternal(GameObjectID objectID)
+	{
+		unsigned int slot = objectID & GAME_OBJECT_SLOT_MASK;
+		if ((slot >= positions_.size()) || (generations_[slot] != (objectID >> GAME_OBJECT_SLOT_BITS)))
+		{
+			return GAME_OBJECT_MAX_COUNT;
+		}
+		return positions_[slot];
+	}
+	
+	/**************************************************************************/
+	
 	GameObjectGroup* GameObjectGroup::Create()
 	{
 		return new GameObjectGroup();
@@ -12,15 +12,126 @@
  * \author Richard Marks <ccpsceo@gmail.com>
  */
 
+// include the common headers
+#include <cstdio>
+#include <set>
+
 // include the complementing header
 #include "GameObjectGroupManager.h"
 
+// include the profiler header
+#include "Profiler.h"
+
 // include the game object group header
 #include "GameObjectGroup.h"
 
+// include the entity world header
+#include "EntityWorld.h"
+
+// include the sprite batch header
+#include "SpriteBatch.h"
+
+// include the job system header
+#include "JobSystem.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
 namespace ENGINE
 {
-	GameObjectGroupManager::GameObjectGroupManager()
+#if !defined(NDEBUG)
+	/**
+	 * \struct SharedStateAccess
+	 * \brief how the groups touched a shared variable during a parallel update
+	 */
+	struct SharedStateAccess
+	{
+		//! the group that touched the variable first
+		GameObjectGroup* group;
+		//! the group that raced the first one for the variable, or 0
+		GameObjectGroup* otherGroup;
+		//! the name of the variable
+		const char* name;
+		//! true if any group wrote to the variable
+		bool written;
+	};
+	
+	//! the group whose objects the calling thread is updating during a parallel update, or 0
+	static ThreadLocalPointer updatingGroup;
+	
+	//! guards the shared variables that have been touched
+	static Mutex sharedStateMutex;
+	
+	//! the shared variables that have been touched during the parallel update
+	static std::map<const void*, SharedStateAccess> sharedStateAccesses;
+	
+	//! the shared variables that have been reported, so that every race is only logged once
+	static std::set<const void*> sharedStateReported;
+#endif
+
+	/**************************************************************************/
+	
+	/**
+	 * updates a range of the objects of a group, and tells the race detector which group it is
+	 */
+	static void UpdateGroupRange(int begin, int end, void* data)
+	{
+		GameObjectGroup* group = reinterpret_cast<GameObjectGroup*>(data);
+
+#if !defined(NDEBUG)
+		// a thread that waits for its jobs may update another group in the middle of this one
+		void* previousGroup = updatingGroup.Get();
+		updatingGroup.Set(group);
+#endif
+
+		group->CallUpdateRange(static_cast<unsigned int>(begin), static_cast<unsigned int>(end));
+
+#if !defined(NDEBUG)
+		updatingGroup.Set(previousGroup);
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * updates a group that is not serial
+	 */
+	static void UpdateGroupJob(Job* /* job */, void* data)
+	{
+		GameObjectGroup* group = reinterpret_cast<GameObjectGroup*>(data);
+		
+		TraceZone traceZone("GameObjectGroup::CallUpdate");
+		
+		int objectCount = static_cast<int>(group->GetObjectCount());
+		if (GameObjectGroupUpdate_Parallel == group->GetUpdateMode())
+		{
+			// ParallelFor() raises the grain of a very large group, so that its jobs always fit in the ring
+			JobSystem->ParallelFor(0, objectCount, GAME_OBJECT_GROUP_UPDATE_GRAIN, UpdateGroupRange, group);
+		}
+		else
+		{
+			UpdateGroupRange(0, objectCount, group);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * does nothing; it only exists so that the jobs of the groups have a parent to wait on, which is
+	 * finished once all of them are
+	 */
+	static void UpdateGroupsJob(Job* /* job */, void* /* data */)
+	{
+	}
+	
+	/**************************************************************************/
+	
+	GameObjectGroupManager::GameObjectGroupManager() :
+		spatialHash_(SpatialHash::Create()),
+		parallelUpdate_(false)
 	{
 		// implement class constructor here
 	} // end constructor
@@ -31,7 +142,7 @@ namespace ENGINE
 	{
 		// implement class destructor here
 		
-		// delete all groups
+		// delete all groups; they go before the spatial hash, because their objects take their boxes out of it in Destroy
 		unsigned int index = 0;
 		for (index = 0; index < groups_.size(); index++)
 		{
@@ -45,8 +156,20 @@ namespace ENGINE
 		
 		// clear the named group index
 		names_.clear();
+		
+		// delete all entity worlds
+		for (index = 0; index < worlds_.size(); index++)
+		{
+			EntityWorld::Destroy(worlds_[index]);
+			worlds_[index] = 0;
+		}
+		worlds_.clear();
+		
+		SpatialHash::Destroy(spatialHash_);
+		spatialHash_ = 0;
+		worldNames_.clear();
 	} // end destructor
-
+	
 	/**************************************************************************/
 	
 	void GameObjectGroupManager::CallCreate()
@@ -62,10 +185,34 @@ namespace ENGINE
 	
 	void GameObjectGroupManager::CallUpdate()
 	{
+		ProfileScope("GameObjectGroupManager::CallUpdate");
+		
 		GameObjectGroupSTLVectorIterator iter;
+		if (parallelUpdate_)
+		{
+			CallParallelUpdateInternal();
+		}
+		else
+		{
+			for (iter = groups_.begin(); iter < groups_.end(); iter++)
+			{
+				(*iter)->CallUpdate();
+			}
+		}
+		
+		std::vector<EntityWorld*>::iterator world;
+		for (world = worlds_.begin(); world < worlds_.end(); world++)
+		{
+			(*world)->CallUpdate();
+		}
+		
+		// the boxes that moved during the update are sorted into their new cells before any objects are destroyed
+		spatialHash_->UpdateCells();
+		
+		// the objects that were spawned or destroyed during the update
 		for (iter = groups_.begin(); iter < groups_.end(); iter++)
 		{
-			(*iter)->CallUpdate();
+			(*iter)->ApplyQueuedChanges();
 		}
 	}
 	
@@ -73,13 +220,26 @@ namespace ENGINE
 	
 	void GameObjectGroupManager::CallRender()
 	{
+		ProfileScope("GameObjectGroupManager::CallRender");
+		
+		// the sprites of every group are sorted and drawn together once all the groups have rendered
+		SpriteBatch->Begin();
+		
 		GameObjectGroupSTLVectorIterator iter;
 		for (iter = groups_.begin(); iter < groups_.end(); iter++)
 		{
 			(*iter)->CallRender();
 		}
+		
+		std::vector<EntityWorld*>::iterator world;
+		for (world = worlds_.begin(); world < worlds_.end(); world++)
+		{
+			(*world)->CallRender();
+		}
+		
+		SpriteBatch->End();
 	}
-
+	
 	/**************************************************************************/
 	
 	void GameObjectGroupManager::CreateNamedGroup(const char* groupName)
@@ -135,6 +295,199 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	void GameObjectGroupManager::CreateNamedWorld(const char* worldName)
+	{
+		// add a new world to the vector
+		worlds_.push_back(EntityWorld::Create());
+		
+		// add the name to the index
+		worldNames_[worldName] = (unsigned int)worlds_.size() - 1;
+	}
+	
+	/**************************************************************************/
+	
+	EntityWorld* GameObjectGroupManager::GetNamedWorld(const char* worldName)
+	{
+		// find the index of the named world
+		GameObjectGroupSTLMapIterator iter;
+		
+		if ((iter = worldNames_.find(worldName)) != worldNames_.end())
+		{
+			return worlds_.at(iter->second);
+		}
+		
+		// world was not found, return null
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	SpatialHash* GameObjectGroupManager::GetSpatialHash()
+	{
+		return spatialHash_;
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroupManager::FindNamedPairs(const char* firstGroupName, const char* secondGroupName, std::vector<SpatialPair>& pairs)
+	{
+		GameObjectGroup* firstGroup = GetNamedGroup(firstGroupName);
+		GameObjectGroup* secondGroup = GetNamedGroup(secondGroupName);
+		if ((0 == firstGroup) || (0 == secondGroup))
+		{
+			LogError("Cannot find the pairs of the groups [%s] and [%s], because one of them does not exist!", firstGroupName, secondGroupName);
+			return;
+		}
+		
+		spatialHash_->FindPairs(firstGroup, secondGroup, pairs);
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroupManager::SetParallelUpdate(bool parallelUpdate)
+	{
+		parallelUpdate_ = parallelUpdate;
+	}
+	
+	/**************************************************************************/
+	
+	bool GameObjectGroupManager::IsParallelUpdate()
+	{
+		return parallelUpdate_;
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroupManager::TouchSharedState(const void* address, const char* name, bool write)
+	{
+#if !defined(NDEBUG)
+		GameObjectGroup* group = reinterpret_cast<GameObjectGroup*>(updatingGroup.Get());
+		if (0 == group)
+		{
+			// nothing is being updated in parallel
+			return;
+		}
+		
+		MutexLock lock(sharedStateMutex);
+		
+		std::map<const void*, SharedStateAccess>::iterator iter = sharedStateAccesses.find(address);
+		if (iter == sharedStateAccesses.end())
+		{
+			SharedStateAccess access;
+			access.group = group;
+			access.otherGroup = 0;
+			access.name = name;
+			access.written = false;
+			iter = sharedStateAccesses.insert(std::make_pair(address, access)).first;
+		}
+		
+		SharedStateAccess& access = iter->second;
+		if (0 == access.otherGroup)
+		{
+			if (write && (GameObjectGroupUpdate_Parallel == group->GetUpdateMode()))
+			{
+				// the objects of a parallel group race each other
+				access.otherGroup = group;
+			}
+			else if ((access.group != group) && (write || access.written) &&
+				((GameObjectGroupUpdate_Serial != group->GetUpdateMode()) || (GameObjectGroupUpdate_Serial != access.group->GetUpdateMode())))
+			{
+				// the serial groups are updated one after another, but the rest are updated at the same time as everything else
+				access.otherGroup = group;
+			}
+		}
+		access.written = access.written || write;
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroupManager::CallParallelUpdateInternal()
+	{
+		// the groups that are not serial are handed to the job system first, so that they run while the serial ones do
+		Job* groupsJob = JobSystem->CreateJob(UpdateGroupsJob, 0);
+		
+		GameObjectGroupSTLVectorIterator iter;
+		for (iter = groups_.begin(); iter < groups_.end(); iter++)
+		{
+			if (GameObjectGroupUpdate_Serial != (*iter)->GetUpdateMode())
+			{
+				JobSystem->Run(JobSystem->CreateChildJob(groupsJob, UpdateGroupJob, *iter));
+			}
+		}
+		
+		for (iter = groups_.begin(); iter < groups_.end(); iter++)
+		{
+			if (GameObjectGroupUpdate_Serial == (*iter)->GetUpdateMode())
+			{
+				UpdateGroupRange(0, static_cast<int>((*iter)->GetObjectCount()), *iter);
+			}
+		}
+		
+		JobSystem->Run(groupsJob);
+		JobSystem->Wait(groupsJob);
+		
+		ReportSharedStateInternal();
+	}
+	
+	/**************************************************************************/
+	
+	void GameObjectGroupManager::ReportSharedStateInternal()
+	{
+#if !defined(NDEBUG)
+		std::map<const void*, SharedStateAccess>::iterator iter;
+		for (iter = sharedStateAccesses.begin(); iter != sharedStateAccesses.end(); iter++)
+		{
+			SharedStateAccess& access = iter->second;
+			if ((0 == access.otherGroup) || (sharedStateReported.end() != sharedStateReported.find(iter->first)))
+			{
+				continue;
+			}
+			sharedStateReported.insert(iter->first);
+			
+			if (access.otherGroup == access.group)
+			{
+				LogWarning("The objects of the parallel group %s are updated at the same time, and write to %s!",
+					GetGroupNameInternal(access.group).c_str(), access.name);
+			}
+			else
+			{
+				LogWarning("The groups %s and %s are updated at the same time, and both touch %s while one of them writes to it!",
+					GetGroupNameInternal(access.group).c_str(), GetGroupNameInternal(access.otherGroup).c_str(), access.name);
+			}
+		}
+		sharedStateAccesses.clear();
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	std::string GameObjectGroupManager::GetGroupNameInternal(GameObjectGroup* group)
+	{
+		GameObjectGroupSTLMapIterator iter;
+		for (iter = names_.begin(); iter != names_.end(); iter++)
+		{
+			if (groups_.at(iter->second) == group)
+			{
+				return iter->first;
+			}
+		}
+		
+		// the group has no name, so its ID will have to do
+		for (unsigned int index = 0; index < groups_.size(); index++)
+		{
+			if (groups_[index] == group)
+			{
+				char groupID[32];
+				sprintf(groupID, "#%u", index);
+				return groupID;
+			}
+		}
+		return "?";
+	}
+	
+	/**************************************************************************/
+	
 	GameObjectGroupManager* GameObjectGroupManager::Create()
 	{
 		return new GameObjectGroupManager();
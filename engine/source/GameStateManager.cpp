@@ -26,6 +26,21 @@
 // include the error reporting header
 #include "DebugReport.h"
 
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the asset loader header
+#include "AssetLoader.h"
+
+// include the graphics device header
+#include "GraphicsDevice.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the render queue header
+#include "RenderQueue.h"
+
 namespace ENGINE
 {
 	GameStateManagerSingleton* GameStateManagerSingleton::GetInstance()
@@ -66,6 +81,32 @@ namespace ENGINE
 	
 	/**************************************************************************/
 
+	void GameStateManagerSingleton::UpdateNextState(float stepSeconds)
+	{
+		GameState* state = stateStack_.top();
+		
+		// the span is named after the state, so the trace shows which state the time went to
+		const char* stateName = (TraceCapture->IsCapturing()) ? GetStateName(state) : 0;
+		TraceZone traceZone((0 != stateName) ? stateName : "GameState", "GameState::Update");
+		
+		state->Update(stepSeconds);
+	}
+	
+	/**************************************************************************/
+
+	void GameStateManagerSingleton::RenderNextState(float interpolation)
+	{
+		GameState* state = stateStack_.top();
+		
+		// the span is named after the state, so the trace shows which state the time went to
+		const char* stateName = (TraceCapture->IsCapturing()) ? GetStateName(state) : 0;
+		TraceZone traceZone((0 != stateName) ? stateName : "GameState", "GameState::Render");
+		
+		state->Render(interpolation);
+	}
+	
+	/**************************************************************************/
+
 	void GameStateManagerSingleton::Clear()
 	{
 		while (!stateStack_.empty())
@@ -85,9 +126,10 @@ namespace ENGINE
 
 	void GameStateManagerSingleton::PushState(const char* stateName)
 	{
-		if (IsStateRegistered(stateName))
+		unsigned int stateID = 0;
+		if (names_.TryGet(stateName, stateID))
 		{
-			stateStack_.push(GetStateFromID(GetStateID(stateName)));
+			stateStack_.push(GetStateFromID(stateID));
 		}
 		else
 		{
@@ -99,20 +141,38 @@ namespace ENGINE
 	}
 	
 	/**************************************************************************/
-
+	
+	void GameStateManagerSingleton::PushState(NameID stateName)
+	{
+		unsigned int stateID = 0;
+		if (names_.TryGet(stateName, stateID))
+		{
+			stateStack_.push(GetStateFromID(stateID));
+		}
+		else
+		{
+			LogError("The Game State with the name hash 0x%08X was not registered!\n", stateName.hash);
+		}
+	}
+	
+	/**************************************************************************/
+	
 	void GameStateManagerSingleton::RegisterState(const char* stateName, GameState* stateInstance)
 	{
 		// check that the state is not already registered
 		// search the name index for state name
-		GameStateSTLMapIterator iter;
+		unsigned int stateID = 0;
 		
-		if (!((iter = names_.find(stateName)) != names_.end()))
+		if (!names_.TryGet(stateName, stateID))
 		{
 			// add the state to the registry
 			stateRegistry_.push_back(stateInstance);
 			
 			// add the state id to the name index
-			names_[stateName] = static_cast<unsigned int>(stateRegistry_.size() - 1);
+			NameID nameID = names_.Add(stateName, static_cast<unsigned int>(stateRegistry_.size() - 1));
+			
+			// the interned text does not move, so it can be kept for looking the name up by state
+			stateNames_.push_back(names_.GetName(nameID));
 		}
 		else
 		{
@@ -133,6 +193,28 @@ namespace ENGINE
 		for (iter = stateRegistry_.begin(); iter < stateRegistry_.end(); iter++)
 		{
 			(*iter)->Initialize();
+			
+			// show the progress of the files that the state asked for until they are loaded
+			while (AssetLoader->IsLoading())
+			{
+				AssetLoader->Update();
+				
+				// the render thread must be done with the display before it is drawn onto here
+				RenderQueue->Flush();
+				
+				ImageResource* target = GraphicsDevice->GetSecondaryDisplayBuffer();
+				if (0 != target)
+				{
+					GraphicsDevice->BeginScene();
+					if (!(*iter)->RenderLoading(AssetLoader->GetProgress()))
+					{
+						AssetLoader->DrawProgressBar(target, AssetLoader->GetProgress());
+					}
+					GraphicsDevice->EndScene();
+				}
+				
+				AssetLoader->WaitForDecoded(GAMESTATE_LOADING_FRAME_TIME);
+			}
 		}
 	}
 	
@@ -141,9 +223,9 @@ namespace ENGINE
 	bool GameStateManagerSingleton::IsStateRegistered(const char* stateName)
 	{
 		// search the name index for state name
-		GameStateSTLMapIterator iter;
+		unsigned int stateID = 0;
 		
-		if ((iter = names_.find(stateName)) != names_.end())
+		if (names_.TryGet(stateName, stateID))
 		{
 			return true;
 		}
@@ -166,7 +248,8 @@ namespace ENGINE
 		stateRegistry_.clear();
 		
 		// clear the name index
-		names_.clear();
+		names_.Clear();
+		stateNames_.clear();
 	}
 	
 	/**************************************************************************/
@@ -174,11 +257,11 @@ namespace ENGINE
 	unsigned int GameStateManagerSingleton::GetStateID(const char* stateName)
 	{
 		// search the name index for state name and return the assigned state ID
-		GameStateSTLMapIterator iter;
+		unsigned int stateID = 0;
 		
-		if ((iter = names_.find(stateName)) != names_.end())
+		if (names_.TryGet(stateName, stateID))
 		{
-			return static_cast<unsigned int>(iter->second);
+			return stateID;
 		}
 		else
 		{
@@ -200,6 +283,20 @@ namespace ENGINE
 		return stateRegistry_.at(stateID);
 	}
 	
+	/**************************************************************************/
+
+	const char* GameStateManagerSingleton::GetStateName(GameState* state)
+	{
+		for (unsigned int index = 0; index < stateRegistry_.size(); index++)
+		{
+			if (state == stateRegistry_[index])
+			{
+				return stateNames_[index];
+			}
+		}
+		return 0;
+	}
+	
 
 } // end namespace
 
@@ -15,7 +15,7 @@
 // only non-windows platforms use this
 #if !defined(WIN32)
 #include <ctime>
-#include <sys/time.h>
+#include <time.h>
 #else
 // this is for the windows platform
 #include <windows.h>
@@ -37,19 +37,18 @@ namespace ENGINE
 	
 	GameTimerSingleton::GameTimerSingleton() :
 		startTime_(0),
-		currentTime_(0)
+		frameStartTime_(0),
+		frameDelta_(0),
+		frameCount_(0)
 	{
 		// implement class constructor here
-// only non-windows platforms use this
-#if !defined(WIN32)
-		startTime_ = new timeval;
-		currentTime_ = new timeval;
-		gettimeofday(startTime_, 0);
-#else
-// this is for the windows platform
-		startTime_ = GetTickCount();
-		currentTime_ = startTime_;
+// only windows uses this
+#if defined(WIN32)
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		frequency_ = static_cast<GameTimerTicks>(frequency.QuadPart);
 #endif
+		startTime_ = ReadClock();
 	} // end constructor
 	
 	/**************************************************************************/
@@ -57,76 +56,148 @@ namespace ENGINE
 	GameTimerSingleton::~GameTimerSingleton()
 	{
 		// implement class destructor here
-// only non-windows platforms use this
-#if !defined(WIN32)
-		if (0 != startTime_) { delete startTime_; startTime_ = 0; }
-		if (0 != currentTime_) { delete currentTime_; currentTime_ = 0; }
-#else
-// this is for the windows platform
-	startTime_ = 0;
-	currentTime_ = 0;
-#endif
 	} // end destructor
 	
 	/**************************************************************************/
 	
-	GameTimerMethodReturnType GameTimerSingleton::GetMicroseconds()
+	GameTimerTicks GameTimerSingleton::ReadClock()
 	{
 // only non-windows platforms use this
 #if !defined(WIN32)
-		gettimeofday(currentTime_, 0);
-		return static_cast<GameTimerMethodReturnType>(
-			((currentTime_->tv_sec - startTime_->tv_sec) / 1000) +
-			((currentTime_->tv_usec - startTime_->tv_usec)));
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return (static_cast<GameTimerTicks>(now.tv_sec) * GAMETIMER_TICKS_PER_SECOND) + 
+			static_cast<GameTimerTicks>(now.tv_nsec);
 #else
 // this is for the windows platform
-		static bool firstCall = true;
-		static unsigned long long frequency = 0;
-		if (firstCall)
-		{
-			QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
-			firstCall = false; 
-		}
-		QueryPerformanceCounter((LARGE_INTEGER*)&currentTime_);
-		currentTime_ *= 1000000;
-		currentTime_ /= frequency;
-		return static_cast<GameTimerMethodReturnType>(currentTime_ - (startTime_ * 1000));
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		GameTimerTicks count = static_cast<GameTimerTicks>(counter.QuadPart);
+		
+		// split the conversion so that the multiply cannot overflow
+		return ((count / frequency_) * GAMETIMER_TICKS_PER_SECOND) + 
+			(((count % frequency_) * GAMETIMER_TICKS_PER_SECOND) / frequency_);
 #endif
 	}
 	
 	/**************************************************************************/
 	
+	GameTimerTicks GameTimerSingleton::GetTicks()
+	{
+		return ReadClock() - startTime_;
+	}
+	
+	/**************************************************************************/
+	
+	GameTimerMethodReturnType GameTimerSingleton::GetMicroseconds()
+	{
+		return GetTicks() / GAMETIMER_TICKS_PER_MICROSECOND;
+	}
+	
+	/**************************************************************************/
+	
 	GameTimerMethodReturnType GameTimerSingleton::GetMilliseconds()
 	{
-// only non-windows platforms use this
-#if !defined(WIN32)
-		gettimeofday(currentTime_, 0);
-		return static_cast<GameTimerMethodReturnType>(
-			((currentTime_->tv_sec - startTime_->tv_sec) * 1000) +
-			((currentTime_->tv_usec - startTime_->tv_usec) / 1000));
-#else
-// this is for the windows platform
-		currentTime_ = GetTickCount();
-		return static_cast<GameTimerMethodReturnType>(currentTime_ - startTime_);
-#endif
+		return GetTicks() / GAMETIMER_TICKS_PER_MILLISECOND;
 	}
 	
 	/**************************************************************************/
 	
 	GameTimerMethodReturnType GameTimerSingleton::GetSeconds()
 	{
-// only non-windows platforms use this
-#if !defined(WIN32)
-		gettimeofday(currentTime_, 0);
-		return static_cast<GameTimerMethodReturnType>(
-			(currentTime_->tv_sec - startTime_->tv_sec));
-#else
-// this is for the windows platform
-		currentTime = GetTickCount();
-		return static_cast<GameTimerMethodReturnType>((currentTime_ - startTime_) / 1000);
-#endif
+		return GetTicks() / GAMETIMER_TICKS_PER_SECOND;
+	}
+	
+	/**************************************************************************/
+	
+	void GameTimerSingleton::BeginFrame()
+	{
+		GameTimerTicks now = GetTicks();
+		
+		frameDelta_ = (0 == frameCount_) ? 0 : now - frameStartTime_;
+		frameStartTime_ = now;
+		frameCount_++;
+	}
+	
+	/**************************************************************************/
+	
+	GameTimerTicks GameTimerSingleton::GetFrameStartTime()
+	{
+		return frameStartTime_;
+	}
+	
+	/**************************************************************************/
+	
+	GameTimerTicks GameTimerSingleton::GetFrameDelta()
+	{
+		return frameDelta_;
+	}
+	
+	/**************************************************************************/
+	
+	float GameTimerSingleton::GetFrameDeltaSeconds()
+	{
+		return TicksToSeconds(frameDelta_);
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int GameTimerSingleton::GetFrameCount()
+	{
+		return frameCount_;
+	}
+	
+	/**************************************************************************/
+	
+	float GameTimerSingleton::TicksToSeconds(GameTimerTicks ticks)
+	{
+		return static_cast<float>(static_cast<double>(ticks) / static_cast<double>(GAMETIMER_TICKS_PER_SECOND));
+	}
+	
+	/**************************************************************************/
+	
+	GameStopwatch::GameStopwatch()
+	{
+		Restart();
+	}
+	
+	/**************************************************************************/
+	
+	void GameStopwatch::Restart()
+	{
+		startTime_ = GameTimer->GetTicks();
+	}
+	
+	/**************************************************************************/
+	
+	GameTimerTicks GameStopwatch::GetElapsedTicks()
+	{
+		return GameTimer->GetTicks() - startTime_;
+	}
+	
+	/**************************************************************************/
+	
+	float GameStopwatch::GetElapsedSeconds()
+	{
+		return GameTimerSingleton::TicksToSeconds(GetElapsedTicks());
+	}
+	
+	/**************************************************************************/
+	
+	GameScopedStopwatch::GameScopedStopwatch(GameTimerTicks& total) :
+		total_(total),
+		startTime_(GameTimer->GetTicks())
+	{
+	}
+	
+	/**************************************************************************/
+	
+	GameScopedStopwatch::~GameScopedStopwatch()
+	{
+		total_ += GameTimer->GetTicks() - startTime_;
 	}
 
 } // end namespace
 
 
+
@@ -26,6 +26,12 @@
 // include the image resource header
 #include "ImageResource.h"
 
+// include the dirty rectangle list header
+#include "DirtyRectList.h"
+
+// include the profiler header
+#include "Profiler.h"
+
 // include the error reporting header
 #include "DebugReport.h"
 
@@ -49,6 +55,12 @@ namespace ENGINE
 			return;
 		}
 		
+		if (0 != dirtyRects_)
+		{
+			// the secondary display buffer keeps the previous scene, and only the changed parts are drawn again
+			return;
+		}
+		
 		secondaryDisplayBuffer_->Clear(color);
 	}
 	
@@ -62,7 +74,117 @@ namespace ENGINE
 			return;
 		}
 		
-		secondaryDisplayBuffer_->Blit(primaryDisplayBuffer_, 0, 0, 0, 0, displayWidth_, displayHeight_);
+		if (Profiler->IsOverlayVisible())
+		{
+			Profiler->DrawOverlay(secondaryDisplayBuffer_);
+		}
+		
+		ProfileScope("GraphicsDevice::EndScene");
+		
+		PresentScene();
+	}
+	
+	/**************************************************************************/
+	
+	void GraphicsDeviceSingleton::PresentScene()
+	{
+		if ((0 == primaryDisplayBuffer_) || (0 == secondaryDisplayBuffer_))
+		{
+			LogFatal("Attempted to call PresentScene on an invalid Graphics Device!");
+			return;
+		}
+		
+		if (0 == dirtyRects_)
+		{
+			secondaryDisplayBuffer_->Blit(primaryDisplayBuffer_, 0, 0, 0, 0, displayWidth_, displayHeight_);
+			pixelsTransferred_ 	= static_cast<unsigned int>(displayWidth_ * displayHeight_);
+			rectsTransferred_ 	= 1;
+			return;
+		}
+		
+		unsigned int rectCount = dirtyRects_->GetCount();
+		for (unsigned int index = 0; index < rectCount; index++)
+		{
+			DirtyRect* rect = dirtyRects_->Get(index);
+			secondaryDisplayBuffer_->Blit(primaryDisplayBuffer_, rect->x, rect->y, rect->x, rect->y, rect->width, rect->height);
+		}
+		
+		pixelsTransferred_ 	= dirtyRects_->GetPixelCount();
+		rectsTransferred_ 	= rectCount;
+		
+		dirtyRects_->Clear();
+	}
+	
+	/**************************************************************************/
+	
+	void GraphicsDeviceSingleton::SetDirtyRectMode(bool enabled)
+	{
+		if (enabled)
+		{
+			if (0 == dirtyRects_)
+			{
+				dirtyRects_ = new DirtyRectList(displayWidth_, displayHeight_);
+			}
+			
+			if (0 != secondaryDisplayBuffer_)
+			{
+				secondaryDisplayBuffer_->SetDirtyRectList(dirtyRects_);
+			}
+			
+			// the screen may not match the secondary display buffer yet
+			dirtyRects_->AddAll();
+		}
+		else if (0 != dirtyRects_)
+		{
+			if (0 != secondaryDisplayBuffer_)
+			{
+				secondaryDisplayBuffer_->SetDirtyRectList(0);
+			}
+			
+			delete dirtyRects_;
+			dirtyRects_ = 0;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool GraphicsDeviceSingleton::IsDirtyRectMode()
+	{
+		return (0 != dirtyRects_);
+	}
+	
+	/**************************************************************************/
+	
+	void GraphicsDeviceSingleton::MarkDirty(int x, int y, int width, int height)
+	{
+		if (0 != dirtyRects_)
+		{
+			dirtyRects_->Add(x, y, width, height);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void GraphicsDeviceSingleton::MarkAllDirty()
+	{
+		if (0 != dirtyRects_)
+		{
+			dirtyRects_->AddAll();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int GraphicsDeviceSingleton::GetPixelsTransferred()
+	{
+		return pixelsTransferred_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int GraphicsDeviceSingleton::GetRectsTransferred()
+	{
+		return rectsTransferred_;
 	}
 	
 	/**************************************************************************/
@@ -99,6 +221,13 @@ namespace ENGINE
 			
 			secondaryDisplayBuffer_ = new ImageResource(displayWidth_, displayHeight_);
 			
+			if (0 != dirtyRects_)
+			{
+				dirtyRects_->SetBounds(displayWidth_, displayHeight_);
+				dirtyRects_->AddAll();
+				secondaryDisplayBuffer_->SetDirtyRectList(dirtyRects_);
+			}
+			
 			return true;
 		}
 		else if (result < 0)
@@ -118,7 +247,7 @@ namespace ENGINE
 	void GraphicsDeviceSingleton::SetDisplayResolution(int displayWidth, int displayHeight)
 	{
 		displayWidth_ = displayWidth;
-		displayHeight_ = displayHeight_;
+		displayHeight_ = displayHeight;
 	}
 	
 	/**************************************************************************/
@@ -221,7 +350,10 @@ namespace ENGINE
 		displayMode_(GraphicsDevice_Windowed),
 		displayWidth_(GRAPHICS_DEVICE_FALLBACK_DISPLAY_WIDTH),
 		displayHeight_(GRAPHICS_DEVICE_FALLBACK_DISPLAY_HEIGHT),
-		displayBitsPerPixel_(GRAPHICS_DEVICE_FALLBACK_DISPLAY_BPP)
+		displayBitsPerPixel_(GRAPHICS_DEVICE_FALLBACK_DISPLAY_BPP),
+		dirtyRects_(0),
+		pixelsTransferred_(0),
+		rectsTransferred_(0)
 	{
 		// implement class constructor here
 	} // end constructor
@@ -232,6 +364,12 @@ namespace ENGINE
 	{
 		// implement class destructor here
 		Destroy();
+		
+		if (0 != dirtyRects_)
+		{
+			delete dirtyRects_;
+			dirtyRects_ = 0;
+		}
 	} // end destructor
 
 } // end namespace
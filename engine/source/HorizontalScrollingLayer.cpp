@@ -24,6 +24,12 @@
 // include the image resource header
 #include "ImageResource.h"
 
+// include the image cache header
+#include "ImageCache.h"
+
+// include the render queue header
+#include "RenderQueue.h"
+
 // include the error reporting header
 #include "DebugReport.h"
 
@@ -127,6 +133,20 @@ namespace ENGINE
 
 	/**************************************************************************/
 	
+	void HorizontalScrollingLayer::QueueRender()
+	{
+		int x = static_cast<int>(layerPosition_[0]);
+		int y = static_cast<int>(layerPosition_[1]);
+		
+		// the same three copies that Render() draws
+		SpriteBlendMode blendMode = (translucency_ < 1.0f) ? SpriteBlend_Trans : SpriteBlend_Masked;
+		RenderQueue->DrawSprite(drawingSurface_, x - layerWidth_, y, blendMode, translucency_);
+		RenderQueue->DrawSprite(drawingSurface_, x, y, blendMode, translucency_);
+		RenderQueue->DrawSprite(drawingSurface_, x + layerWidth_, y, blendMode, translucency_);
+	}
+
+	/**************************************************************************/
+	
 	void HorizontalScrollingLayer::Destroy()
 	{
 	}
@@ -154,11 +174,14 @@ namespace ENGINE
 	{
 		Destroy();
 		
-		drawingSurface_ = new ImageResource(imageFileName);
+		drawingSurface_ = ImageCache->Acquire(imageFileName);
 		
 		if (0 == drawingSurface_)
 		{
 			LogWarning("layer image is invalid!");
+			layerWidth_ = 0;
+			layerHeight_ = 0;
+			return;
 		}
 		
 		layerWidth_ = drawingSurface_->GetWidth();
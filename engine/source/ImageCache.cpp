@@ -0,0 +1,360 @@
+
+// CODESTYLE: v2.0
+
+// ImageCache.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Shares the images loaded from files, so that each file is only loaded once
+
+/**
+ * \file ImageCache.cpp
+ * \brief Image Cache Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// include the complementing header
+#include "ImageCache.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the virtual file system header
+#include "VirtualFileSystem.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	ImageCacheSingleton* ImageCacheSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static ImageCacheSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* ImageCacheSingleton::Acquire(const char* fileName)
+	{
+		if ((0 == fileName) || ('\0' == fileName[0]))
+		{
+			LogError("Cannot acquire an image without a file name!");
+			return 0;
+		}
+		
+		return AcquireFileInternal(VirtualFileSystemSingleton::CanonicalizePath(fileName), true);
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* ImageCacheSingleton::AcquireFileInternal(const std::string& key, bool counted)
+	{
+		ImageResource* image = Find(key, counted);
+		if (0 != image)
+		{
+			return image;
+		}
+		
+		// the file is loaded without holding the lock, so other threads can use the cache meanwhile
+		image = new ImageResource();
+		if (!image->Load(key.c_str()))
+		{
+			delete image;
+			return 0;
+		}
+		
+		return Insert(key, image);
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* ImageCacheSingleton::Acquire(const char* fileName, int sourceX, int sourceY, int width, int height)
+	{
+		if ((0 == fileName) || ('\0' == fileName[0]))
+		{
+			LogError("Cannot acquire an image without a file name!");
+			return 0;
+		}
+		
+		if ((width <= 0) || (height <= 0))
+		{
+			LogError("Invalid image size %d x %d for the file %s!", width, height, fileName);
+			return 0;
+		}
+		
+		char rect[64];
+		snprintf(rect, 64, "#%d,%d,%d,%d", sourceX, sourceY, width, height);
+		std::string fileKey = VirtualFileSystemSingleton::CanonicalizePath(fileName);
+		std::string key = fileKey + rect;
+		
+		ImageResource* image = Find(key, true);
+		if (0 != image)
+		{
+			return image;
+		}
+		
+		// copy the part out of the whole file, which stays in the cache for the other parts;
+		// the part was already counted as a hit or a miss, so the lookup of the file is not counted again
+		ImageResource* sheet = AcquireFileInternal(fileKey, false);
+		if (0 == sheet)
+		{
+			return 0;
+		}
+		
+		image = new ImageResource(width, height);
+		sheet->Blit(image, sourceX, sourceY, 0, 0, width, height);
+		Release(sheet);
+		
+		return Insert(key, image);
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* ImageCacheSingleton::Add(const char* fileName, ImageResource* image)
+	{
+		if ((0 == fileName) || (0 == image))
+		{
+			LogError("Cannot add an image to the cache without a file name and an image!");
+			return 0;
+		}
+		
+		return Insert(VirtualFileSystemSingleton::CanonicalizePath(fileName), image);
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageCacheSingleton::Release(ImageResource* image)
+	{
+		MutexLock lock(mutex_);
+		
+		std::map<ImageResource*, ImageCacheEntry*>::iterator iter = images_.find(image);
+		if (images_.end() == iter)
+		{
+			return false;
+		}
+		
+		ImageCacheEntry* entry = iter->second;
+		if (entry->references > 0)
+		{
+			entry->references--;
+		}
+		else
+		{
+			LogWarning("The cached image %s was released more times than it was acquired!", entry->key.c_str());
+		}
+		
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageCacheSingleton::IsCached(ImageResource* image)
+	{
+		MutexLock lock(mutex_);
+		return (images_.end() != images_.find(image));
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ImageCacheSingleton::Purge()
+	{
+		MutexLock lock(mutex_);
+		
+		std::vector<ImageCacheEntry*> unused;
+		std::map<std::string, ImageCacheEntry*>::iterator iter;
+		for (iter = entries_.begin(); iter != entries_.end(); iter++)
+		{
+			if (0 == iter->second->references)
+			{
+				unused.push_back(iter->second);
+			}
+		}
+		
+		for (unsigned int index = 0; index < unused.size(); index++)
+		{
+			Remove(unused[index]);
+		}
+		
+		return static_cast<unsigned int>(unused.size());
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ImageCacheSingleton::Trim(unsigned int maxBytes)
+	{
+		MutexLock lock(mutex_);
+		
+		unsigned int removed = 0;
+		while (byteCount_ > maxBytes)
+		{
+			// find the least recently used image that is no longer held
+			ImageCacheEntry* oldest = 0;
+			std::map<std::string, ImageCacheEntry*>::iterator iter;
+			for (iter = entries_.begin(); iter != entries_.end(); iter++)
+			{
+				ImageCacheEntry* entry = iter->second;
+				if ((0 == entry->references) && ((0 == oldest) || (entry->lastUsed < oldest->lastUsed)))
+				{
+					oldest = entry;
+				}
+			}
+			
+			if (0 == oldest)
+			{
+				// everything left is still held
+				break;
+			}
+			
+			Remove(oldest);
+			removed++;
+		}
+		
+		return removed;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ImageCacheSingleton::GetImageCount()
+	{
+		MutexLock lock(mutex_);
+		return static_cast<unsigned int>(entries_.size());
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ImageCacheSingleton::GetByteCount()
+	{
+		return byteCount_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ImageCacheSingleton::GetHitCount()
+	{
+		MutexLock lock(mutex_);
+		return hitCount_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ImageCacheSingleton::GetMissCount()
+	{
+		MutexLock lock(mutex_);
+		return missCount_;
+	}
+	
+	/**************************************************************************/
+	
+	void ImageCacheSingleton::ResetCounters()
+	{
+		MutexLock lock(mutex_);
+		hitCount_ = 0;
+		missCount_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* ImageCacheSingleton::Find(const std::string& key, bool counted)
+	{
+		MutexLock lock(mutex_);
+		
+		std::map<std::string, ImageCacheEntry*>::iterator iter = entries_.find(key);
+		if (entries_.end() == iter)
+		{
+			if (counted)
+			{
+				missCount_++;
+			}
+			return 0;
+		}
+		
+		ImageCacheEntry* entry = iter->second;
+		entry->references++;
+		entry->lastUsed = ++useCounter_;
+		if (counted)
+		{
+			hitCount_++;
+		}
+		return entry->image;
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* ImageCacheSingleton::Insert(const std::string& key, ImageResource* image)
+	{
+		MutexLock lock(mutex_);
+		
+		std::map<std::string, ImageCacheEntry*>::iterator iter = entries_.find(key);
+		if (entries_.end() != iter)
+		{
+			// another thread loaded the same file at the same time
+			delete image;
+			ImageCacheEntry* entry = iter->second;
+			entry->references++;
+			entry->lastUsed = ++useCounter_;
+			return entry->image;
+		}
+		
+		ImageCacheEntry* entry 	= new ImageCacheEntry;
+		entry->image 			= image;
+		entry->key 				= key;
+		entry->references 		= 1;
+		entry->bytes 			= static_cast<unsigned int>(image->GetWidth() * image->GetHeight() * ((image->GetColorDepth() + 7) / 8));
+		entry->lastUsed 		= ++useCounter_;
+		
+		entries_[key] = entry;
+		images_[image] = entry;
+		byteCount_ += entry->bytes;
+		
+		return image;
+	}
+	
+	/**************************************************************************/
+	
+	void ImageCacheSingleton::Remove(ImageCacheEntry* entry)
+	{
+		entries_.erase(entry->key);
+		images_.erase(entry->image);
+		byteCount_ -= entry->bytes;
+		
+		delete entry->image;
+		delete entry;
+	}
+	
+	/**************************************************************************/
+	
+	ImageCacheSingleton::ImageCacheSingleton() :
+		byteCount_(0),
+		hitCount_(0),
+		missCount_(0),
+		useCounter_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	ImageCacheSingleton::~ImageCacheSingleton()
+	{
+		// implement class destructor here
+		std::map<std::string, ImageCacheEntry*>::iterator iter;
+		for (iter = entries_.begin(); iter != entries_.end(); iter++)
+		{
+			delete iter->second->image;
+			delete iter->second;
+		}
+		entries_.clear();
+		images_.clear();
+		byteCount_ = 0;
+	} // end destructor
+
+} // end namespace
+
+
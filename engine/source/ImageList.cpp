@@ -24,6 +24,9 @@
 // include the image resource header
 #include "ImageResource.h"
 
+// include the image cache header
+#include "ImageCache.h"
+
 // include the error reporting header
 #include "DebugReport.h"
 
@@ -52,9 +55,9 @@ namespace ENGINE
 		{
 			for (unsigned int index = 0; index < count; index++)
 			{
-				const char* fileName = strdup(va_arg(va, const char*));
-				ImageResource* image = new ImageResource();
-				if (image->Load(fileName))
+				const char* fileName = va_arg(va, const char*);
+				ImageResource* image = ImageCache->Acquire(fileName);
+				if (0 != image)
 				{
 					images_.push_back(image);
 				}
@@ -86,8 +89,8 @@ namespace ENGINE
 	
 	bool ImageList::Add(const char* fileName)
 	{
-		ImageResource* image = new ImageResource();
-		if (image->Load(fileName))
+		ImageResource* image = ImageCache->Acquire(fileName);
+		if (0 != image)
 		{
 			images_.push_back(image);
 			return true;
@@ -133,13 +136,16 @@ namespace ENGINE
 	
 	void ImageList::Destroy()
 	{
-		// delete all images
+		// delete all images, giving the ones that were loaded by file name back to the image cache
 		unsigned int index = 0;
 		for (index = 0; index < images_.size(); index++)
 		{
 			if (0 != images_[index])
 			{
-				delete images_[index];
+				if (!ImageCache->Release(images_[index]))
+				{
+					delete images_[index];
+				}
 				images_[index] = 0;
 			}
 		}
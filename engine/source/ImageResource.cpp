@@ -16,6 +16,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 // include the libpng header
 #include <png.h>
@@ -26,13 +29,156 @@
 // include the complementing header
 #include "ImageResource.h"
 
+// include the dirty rectangle list header
+#include "DirtyRectList.h"
+
+// include the virtual file system header
+#include "VirtualFileSystem.h"
+
+// include the pixel kernels header
+#include "PixelKernels.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
 // include the error reporting header
 #include "DebugReport.h"
 
 namespace ENGINE
 {
+	//! the first eight bytes of every raw cache file
+	static const char* const IMAGE_RAW_CACHE_MAGIC = "GEDRAW01";
+	
+	//! added to the name of a PNG file to make the name of its raw cache file
+	static const char* const IMAGE_RAW_CACHE_EXTENSION = ".gedraw";
+	
+	/**
+	 * \struct ImageRawCacheHeader
+	 * \brief the start of a raw cache file; the rows of the image follow it, one after another
+	 * \ingroup GraphicsGroup
+	 */
+	struct ImageRawCacheHeader
+	{
+		//! IMAGE_RAW_CACHE_MAGIC, without the terminating zero
+		char magic[8];
+		//! the width of the image in pixels
+		int width;
+		//! the height of the image in pixels
+		int height;
+		//! the color depth of the rows
+		int colorDepth;
+		//! the color that makecol_depth() made of (0x12, 0x34, 0x56), so that a screen with another pixel format does not use the rows
+		int formatCheck;
+		//! the size of a row in bytes
+		int bytesPerRow;
+		//! the size of the PNG file in bytes when the cache was saved
+		unsigned int sourceSize;
+		//! the modification time of the PNG file when the cache was saved
+		unsigned int sourceTime;
+		//! always zero
+		unsigned int reserved;
+	};
+	
+	//! true if raw cache files are used and saved; off unless the game asks for it, so nothing is written next to the game files
+	static bool rawCacheEnabled = false;
+	
+	//! the number of images that were loaded from a raw cache file
+	static unsigned int rawCacheHits = 0;
+	
+	//! the number of loose PNG files that had no raw cache file that was up to date; files in an archive are not counted
+	static unsigned int rawCacheMisses = 0;
+	
+	//! the size of the pixels that were loaded from raw cache files instead of being decoded
+	static unsigned long rawCacheBytesSaved = 0;
+	
+	/**************************************************************************/
+	
+	/**
+	 * Fills in the parts of a raw cache header that describe the PNG file and the pixel format
+	 * \return false if the file is not a loose file, because files in an archive have no raw cache
+	 */
+	static bool MakeRawCacheHeader(const char* fileName, int colorDepth, ImageRawCacheHeader& header)
+	{
+		if (VirtualFileSystem->IsPacked(fileName))
+		{
+			return false;
+		}
+		
+		struct stat fileInfo;
+		if (0 != stat(fileName, &fileInfo))
+		{
+			return false;
+		}
+		
+		memset(&header, 0, sizeof(ImageRawCacheHeader));
+		memcpy(header.magic, IMAGE_RAW_CACHE_MAGIC, 8);
+		header.colorDepth 	= colorDepth;
+		header.formatCheck 	= makecol_depth(colorDepth, 0x12, 0x34, 0x56);
+		header.sourceSize 	= static_cast<unsigned int>(fileInfo.st_size);
+		header.sourceTime 	= static_cast<unsigned int>(fileInfo.st_mtime);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Opens the raw cache file of a PNG file, and checks that it is up to date
+	 * @param fileName is the name of the PNG file
+	 * @param header is filled in with the header of the raw cache file
+	 * \return the raw cache file, at the start of the rows, or 0 if there is no raw cache file that is up to date
+	 */
+	static FILE* OpenRawCache(const char* fileName, ImageRawCacheHeader& header)
+	{
+		ImageRawCacheHeader expected;
+		if (!MakeRawCacheHeader(fileName, bitmap_color_depth(screen), expected))
+		{
+			return 0;
+		}
+		
+		std::string cacheFileName = std::string(fileName) + IMAGE_RAW_CACHE_EXTENSION;
+		FILE* fp = fopen(cacheFileName.c_str(), "rb");
+		if (0 == fp)
+		{
+			return 0;
+		}
+		
+		bool current = 
+			(1 == fread(&header, sizeof(ImageRawCacheHeader), 1, fp)) &&
+			(0 == memcmp(header.magic, expected.magic, 8)) &&
+			(header.colorDepth == expected.colorDepth) &&
+			(header.formatCheck == expected.formatCheck) &&
+			(header.sourceSize == expected.sourceSize) &&
+			(header.sourceTime == expected.sourceTime) &&
+			(header.width > 0) && (header.height > 0) &&
+			(header.bytesPerRow == header.width * ((header.colorDepth + 7) / 8));
+		
+		if (!current)
+		{
+			fclose(fp);
+			return 0;
+		}
+		return fp;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Feeds libpng from a file of the virtual file system
+	 */
+	static void ReadPNGData(png_structp pngReadStruct, png_bytep data, png_size_t length)
+	{
+		VirtualFile* file = static_cast<VirtualFile*>(png_get_io_ptr(pngReadStruct));
+		if (file->Read(data, static_cast<unsigned long>(length)) != static_cast<unsigned long>(length))
+		{
+			png_error(pngReadStruct, "unexpected end of file");
+		}
+	}
+	
+	/**************************************************************************/
+	
 	ImageResource::ImageResource() :
-		allegroBitmap_(0)
+		allegroBitmap_(0),
+		dirtyRects_(0)
 	{
 		// implement class constructor here
 	} // end constructor
@@ -42,6 +188,7 @@ namespace ENGINE
 	ImageResource::ImageResource(int width, int height, int color)
 	{
 		allegroBitmap_ = 0;
+		dirtyRects_ = 0;
 		Create(width, height, color);
 	}
 	
@@ -50,6 +197,7 @@ namespace ENGINE
 	ImageResource::ImageResource(BITMAP* source)
 	{
 		allegroBitmap_ = 0;
+		dirtyRects_ = 0;
 		Create(source);
 	}
 	
@@ -58,6 +206,7 @@ namespace ENGINE
 	ImageResource::ImageResource(const char* fileName)
 	{
 		allegroBitmap_ = 0;
+		dirtyRects_ = 0;
 		Load(fileName);
 	}
 	
@@ -66,6 +215,7 @@ namespace ENGINE
 	ImageResource::ImageResource(const char* fileName, int sourceX, int sourceY, int width, int height)
 	{
 		allegroBitmap_ = 0;
+		dirtyRects_ = 0;
 		Load(fileName, sourceX, sourceY, width, height);
 	}
 	
@@ -102,8 +252,17 @@ namespace ENGINE
 	
 	bool ImageResource::Load(const char* fileName)
 	{
+		TraceZone traceZone("ImageResource::Load", "asset", fileName);
+		
 		Destroy();
 		
+		// images that the packer decoded ahead of time only have to be converted
+		ImagePixelData packedPixels;
+		if (VirtualFileSystem->GetPixels(fileName, packedPixels))
+		{
+			return Create(packedPixels);
+		}
+		
 		BITMAP* tempBitmap = 0;
 		char fileExt[4]; 
 		int fileNameLen = strlen(fileName);
@@ -114,13 +273,22 @@ namespace ENGINE
 		
 		if (!stricmp(fileExt, "png") || !stricmp(fileExt, "PNG"))
 		{
-			tempBitmap = LoadPNGInternal(fileName);
-		}
-		else
-		{
-			tempBitmap = LoadBitmapInternal(fileName);
+			if (LoadRawCacheInternal(fileName))
+			{
+				return true;
+			}
+			
+			// the rows are converted into the final bitmap as they are decoded
+			Create(LoadPNGInternal(fileName, 0, 0, 0, 0));
+			if ((0 != allegroBitmap_) && rawCacheEnabled)
+			{
+				SaveRawCache(fileName);
+			}
+			return (0 != allegroBitmap_);
 		}
 		
+		tempBitmap = LoadBitmapInternal(fileName);
+		
 		if (0 != tempBitmap)
 		{
 			Create(tempBitmap->w, tempBitmap->h);
@@ -137,8 +305,19 @@ namespace ENGINE
 	
 	bool ImageResource::Load(const char* fileName, int sourceX, int sourceY, int width, int height)
 	{
+		TraceZone traceZone("ImageResource::Load", "asset", fileName);
+		
 		Destroy();
 		
+		// images that the packer decoded ahead of time only have to be converted
+		ImagePixelData packedPixels;
+		if (VirtualFileSystem->GetPixels(fileName, packedPixels))
+		{
+			Create(width, height);
+			CopyPixelsInternal(packedPixels, sourceX, sourceY);
+			return true;
+		}
+		
 		BITMAP* tempBitmap = 0;
 		char fileExt[4]; 
 		int fileNameLen = strlen(fileName);
@@ -149,13 +328,13 @@ namespace ENGINE
 		
 		if (!stricmp(fileExt, "png") || !stricmp(fileExt, "PNG"))
 		{
-			tempBitmap = LoadPNGInternal(fileName);
-		}
-		else
-		{
-			tempBitmap = LoadBitmapInternal(fileName);
+			// only the rows of the rectangle are converted, and the rows below it are never decoded
+			Create(LoadPNGInternal(fileName, sourceX, sourceY, width, height));
+			return (0 != allegroBitmap_);
 		}
 		
+		tempBitmap = LoadBitmapInternal(fileName);
+		
 		if (0 != tempBitmap)
 		{
 			Create(width, height);
@@ -170,6 +349,160 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	void ImageResource::SetRawCacheEnabled(bool enabled)
+	{
+		rawCacheEnabled = enabled;
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::IsRawCacheEnabled()
+	{
+		return rawCacheEnabled;
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::IsRawCacheCurrent(const char* fileName)
+	{
+		if (!rawCacheEnabled)
+		{
+			return false;
+		}
+		
+		ImageRawCacheHeader header;
+		FILE* fp = OpenRawCache(fileName, header);
+		if (0 == fp)
+		{
+			return false;
+		}
+		fclose(fp);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::SaveRawCache(const char* fileName)
+	{
+		TraceZone traceZone("ImageResource::SaveRawCache", "asset", fileName);
+		
+		// only memory bitmaps can be written out row by row
+		if ((0 == allegroBitmap_) || !is_memory_bitmap(allegroBitmap_))
+		{
+			return false;
+		}
+		
+		ImageRawCacheHeader header;
+		if (!MakeRawCacheHeader(fileName, bitmap_color_depth(allegroBitmap_), header))
+		{
+			return false;
+		}
+		header.width 		= allegroBitmap_->w;
+		header.height 		= allegroBitmap_->h;
+		header.bytesPerRow 	= header.width * ((header.colorDepth + 7) / 8);
+		
+		std::string cacheFileName = std::string(fileName) + IMAGE_RAW_CACHE_EXTENSION;
+		FILE* fp = fopen(cacheFileName.c_str(), "wb");
+		if (0 == fp)
+		{
+			// the game may be installed where it cannot write, so this is only reported once
+			static bool reported = false;
+			if (!reported)
+			{
+				reported = true;
+				LogWarning("Could not save the raw cache file %s! No more raw cache failures will be reported.", cacheFileName.c_str());
+			}
+			return false;
+		}
+		
+		bool saved = (1 == fwrite(&header, sizeof(ImageRawCacheHeader), 1, fp));
+		for (int y = 0; saved && (y < header.height); y++)
+		{
+			saved = (1 == fwrite(allegroBitmap_->line[y], header.bytesPerRow, 1, fp));
+		}
+		saved = (0 == fclose(fp)) && saved;
+		
+		// a partly written cache would fail its size check anyway, but there is no reason to leave it around
+		if (!saved)
+		{
+			remove(cacheFileName.c_str());
+		}
+		return saved;
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::ReportRawCacheStatistics()
+	{
+		unsigned int loads = rawCacheHits + rawCacheMisses;
+		LogMessage("Raw image cache: %u hits, %u misses (%u%% hit rate), %lu bytes of pixels loaded without decoding",
+			rawCacheHits, 
+			rawCacheMisses, 
+			(loads > 0) ? (rawCacheHits * 100) / loads : 0,
+			rawCacheBytesSaved);
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::LoadRawCacheInternal(const char* fileName)
+	{
+		if (!rawCacheEnabled)
+		{
+			return false;
+		}
+		
+		// files in an archive never have a raw cache, so they are neither a hit nor a miss
+		if (VirtualFileSystem->IsPacked(fileName))
+		{
+			return false;
+		}
+		
+		TraceZone traceZone("ImageResource::LoadRawCacheInternal", "asset", fileName);
+		
+		ImageRawCacheHeader header;
+		FILE* fp = OpenRawCache(fileName, header);
+		if (0 == fp)
+		{
+			rawCacheMisses++;
+			return false;
+		}
+		
+		Destroy();
+		allegroBitmap_ = create_bitmap_ex(header.colorDepth, header.width, header.height);
+		bool loaded = (0 != allegroBitmap_);
+		if (loaded)
+		{
+			unsigned char* firstRow = allegroBitmap_->line[0];
+			bool contiguous = (1 == header.height) || (allegroBitmap_->line[1] == firstRow + header.bytesPerRow);
+			if (contiguous)
+			{
+				// memory bitmaps keep their rows one after another, so the whole image is read at once
+				loaded = (1 == fread(firstRow, header.bytesPerRow * header.height, 1, fp));
+			}
+			else
+			{
+				for (int y = 0; loaded && (y < header.height); y++)
+				{
+					loaded = (1 == fread(allegroBitmap_->line[y], header.bytesPerRow, 1, fp));
+				}
+			}
+		}
+		fclose(fp);
+		
+		if (!loaded)
+		{
+			Destroy();
+			rawCacheMisses++;
+			return false;
+		}
+		
+		rawCacheHits++;
+		rawCacheBytesSaved += static_cast<unsigned long>(header.bytesPerRow) * header.height;
+		return true;
+	}
+	
+	/**************************************************************************/
+	
 	void ImageResource::Destroy()
 	{
 		if (0 != allegroBitmap_)
@@ -196,6 +529,7 @@ namespace ENGINE
 		int width, int height)
 	{
 		blit(allegroBitmap_, destination->GetBitmap(), srcX, srcY, destX, destY, width, height);
+		destination->MarkDirty(destX, destY, width, height);
 	}
 	
 	/**************************************************************************/
@@ -208,6 +542,7 @@ namespace ENGINE
 		int destWidth, int destHeight)
 	{
 		stretch_blit(allegroBitmap_, destination->GetBitmap(), srcX, srcY, srcWidth, srcHeight, destX, destY, destWidth, destHeight);
+		destination->MarkDirty(destX, destY, destWidth, destHeight);
 	}
 	
 	/**************************************************************************/
@@ -218,7 +553,11 @@ namespace ENGINE
 		int destX, int destY,
 		int width, int height)
 	{
-		masked_blit(allegroBitmap_, destination->GetBitmap(), srcX, srcY, destX, destY, width, height);
+		if (!PixelKernels->MaskedBlit(allegroBitmap_, destination->GetBitmap(), srcX, srcY, destX, destY, width, height))
+		{
+			masked_blit(allegroBitmap_, destination->GetBitmap(), srcX, srcY, destX, destY, width, height);
+		}
+		destination->MarkDirty(destX, destY, width, height);
 	}
 	
 	/**************************************************************************/
@@ -231,6 +570,7 @@ namespace ENGINE
 		int destWidth, int destHeight)
 	{
 		masked_stretch_blit(allegroBitmap_, destination->GetBitmap(), srcX, srcY, srcWidth, srcHeight, destX, destY, destWidth, destHeight);
+		destination->MarkDirty(destX, destY, destWidth, destHeight);
 	}
 	
 	/**************************************************************************/
@@ -238,23 +578,33 @@ namespace ENGINE
 	void ImageResource::BlitSprite(ImageResource* destination, int destX, int destY)
 	{
 		draw_sprite(destination->GetBitmap(), allegroBitmap_, destX, destY);
+		destination->MarkDirty(destX, destY, allegroBitmap_->w, allegroBitmap_->h);
 	}
 	
 	/**************************************************************************/
 	
 	void ImageResource::BlitAlpha(ImageResource* destination, int destX, int destY, float alpha)
 	{
-		set_trans_blender(0, 0, 0, static_cast<int>(255 * alpha));
-		draw_trans_sprite(destination->GetBitmap(), allegroBitmap_, destX, destY);
+		int alphaValue = static_cast<int>(255 * alpha);
+		if (!PixelKernels->BlendSprite(destination->GetBitmap(), allegroBitmap_, destX, destY, alphaValue))
+		{
+			set_trans_blender(0, 0, 0, alphaValue);
+			draw_trans_sprite(destination->GetBitmap(), allegroBitmap_, destX, destY);
+		}
+		destination->MarkDirty(destX, destY, allegroBitmap_->w, allegroBitmap_->h);
 	}
 	
 	/**************************************************************************/
 	
 	void ImageResource::BlitAlphaSprite(ImageResource* destination, int destX, int destY)
 	{
-		set_alpha_blender();
-		draw_trans_sprite(destination->GetBitmap(), allegroBitmap_, destX, destY);
-		set_trans_blender(0, 0, 0, 255);
+		if (!PixelKernels->AlphaBlendSprite(destination->GetBitmap(), allegroBitmap_, destX, destY))
+		{
+			set_alpha_blender();
+			draw_trans_sprite(destination->GetBitmap(), allegroBitmap_, destX, destY);
+			set_trans_blender(0, 0, 0, 255);
+		}
+		destination->MarkDirty(destX, destY, allegroBitmap_->w, allegroBitmap_->h);
 	}
 	
 	/**************************************************************************/
@@ -268,6 +618,7 @@ namespace ENGINE
 			blit(allegroBitmap_, originalCopy, 0, 0, 0, 0, allegroBitmap_->w, allegroBitmap_->h);
 			draw_sprite_h_flip(allegroBitmap_, originalCopy, 0, 0);
 			destroy_bitmap(originalCopy);
+			MarkDirty(0, 0, allegroBitmap_->w, allegroBitmap_->h);
 		}
 	}
 	
@@ -281,6 +632,7 @@ namespace ENGINE
 			blit(allegroBitmap_, originalCopy, 0, 0, 0, 0, allegroBitmap_->w, allegroBitmap_->h);
 			draw_sprite_v_flip(allegroBitmap_, originalCopy, 0, 0);
 			destroy_bitmap(originalCopy);
+			MarkDirty(0, 0, allegroBitmap_->w, allegroBitmap_->h);
 		}
 	}
 	
@@ -295,6 +647,7 @@ namespace ENGINE
 			float rotationAngle = 0.711f * static_cast<float>(angle);
 			rotate_sprite(allegroBitmap_, originalCopy, 0, 0, itofix(rotationAngle));
 			destroy_bitmap(originalCopy);
+			MarkDirty(0, 0, allegroBitmap_->w, allegroBitmap_->h);
 		}
 	}
 	
@@ -311,6 +664,7 @@ namespace ENGINE
 	void ImageResource::SetPixel(int x, int y, int color)
 	{
 		putpixel(allegroBitmap_, x, y, color);
+		MarkDirty(x, y, 1, 1);
 	}
 	
 	/**************************************************************************/
@@ -319,6 +673,9 @@ namespace ENGINE
 	void ImageResource::Line(int x1, int y1, int x2, int y2, int color)
 	{
 		line(allegroBitmap_, x1, y1, x2, y2, color);
+		MarkDirty(
+			(x1 < x2) ? x1 : x2, (y1 < y2) ? y1 : y2, 
+			1 + ((x1 < x2) ? x2 - x1 : x1 - x2), 1 + ((y1 < y2) ? y2 - y1 : y1 - y2));
 	}
 	
 	/**************************************************************************/
@@ -327,100 +684,87 @@ namespace ENGINE
 	{
 		if (filled)
 		{
-			rectfill(allegroBitmap_, x1, y2, x2, y2, color);
+			rectfill(allegroBitmap_, x1, y1, x2, y2, color);
 		}
 		else
 		{
 			rect(allegroBitmap_, x1, y1, x2, y2, color);
 		}
+		
+		MarkDirty(
+			(x1 < x2) ? x1 : x2, (y1 < y2) ? y1 : y2, 
+			1 + ((x1 < x2) ? x2 - x1 : x1 - x2), 1 + ((y1 < y2) ? y2 - y1 : y1 - y2));
 	}
 	
 	/**************************************************************************/
 	
 	void ImageResource::GradientRect(int x1, int y1, int x2, int y2, int c1, int c2, int c3, int c4)
 	{
-		float size[2] = {
-			static_cast<float>(x2 - x1),
-			static_cast<float>(y2 - y1)
+		int size[2] = {
+			x2 - x1,
+			y2 - y1
 		};
-	
-		float upperLeftColor[3] = {
-			static_cast<float>(getr(c1)),
-			static_cast<float>(getg(c1)),
-			static_cast<float>(getb(c1))
-		};
-	
-		float upperRightColor[3] = {
-			static_cast<float>(getr(c2)),
-			static_cast<float>(getg(c2)),
-			static_cast<float>(getb(c2))
-		};
-	
-		float lowerLeftColor[3] = {
-			static_cast<float>(getr(c3)),
-			static_cast<float>(getg(c3)),
-			static_cast<float>(getb(c3))
-		};
-	
-		float lowerRightColor[3] = {
-			static_cast<float>(getr(c4)),
-			static_cast<float>(getg(c4)),
-			static_cast<float>(getb(c4))
-		};
-	
-		float deltaXRGB[3] = { 
-			0.0f, 
-			0.0f, 
-			0.0f 
+		
+		if ((size[0] <= 0) || (size[1] <= 0))
+		{
+			return;
+		}
+		
+		// the colors of the left and right edges of the row, in 16.16 fixed point
+		int leftColor[3] = {
+			getr(c1) << 16,
+			getg(c1) << 16,
+			getb(c1) << 16
 		};
-	
-		float deltaYRGB[6] = {
-			static_cast<float>((lowerLeftColor[0] - upperLeftColor[0]) / size[1]),
-			static_cast<float>((lowerLeftColor[1] - upperLeftColor[1]) / size[1]),
-			static_cast<float>((lowerLeftColor[2] - upperLeftColor[2]) / size[1]),
-			static_cast<float>((lowerRightColor[0] - upperRightColor[0]) / size[1]),
-			static_cast<float>((lowerRightColor[1] - upperRightColor[1]) / size[1]),
-			static_cast<float>((lowerRightColor[2] - upperRightColor[2]) / size[1])
+		
+		int rightColor[3] = {
+			getr(c2) << 16,
+			getg(c2) << 16,
+			getb(c2) << 16
 		};
-	
-		float rgb[3] = {
-			0.0f,
-			0.0f,
-			0.0f
+		
+		int deltaYRGB[6] = {
+			((getr(c3) << 16) - leftColor[0]) / size[1],
+			((getg(c3) << 16) - leftColor[1]) / size[1],
+			((getb(c3) << 16) - leftColor[2]) / size[1],
+			((getr(c4) << 16) - rightColor[0]) / size[1],
+			((getg(c4) << 16) - rightColor[1]) / size[1],
+			((getb(c4) << 16) - rightColor[2]) / size[1]
 		};
-	
+		
+		PixelGradientSpan span;
 		for (int y = y1; y < y2; y++)
 		{
-			deltaXRGB[0] = static_cast<float>((upperRightColor[0] - upperLeftColor[0]) / size[0]);
-			deltaXRGB[1] = static_cast<float>((upperRightColor[1] - upperLeftColor[1]) / size[0]);
-			deltaXRGB[2] = static_cast<float>((upperRightColor[2] - upperLeftColor[2]) / size[0]);
-		
-			rgb[0] = upperLeftColor[0];
-			rgb[1] = upperLeftColor[1];
-			rgb[2] = upperLeftColor[2];
-		
-			for (int x = x1; x < x2; x++)
-			{
-				int pixelColor = makecol(
-					static_cast<int>(rgb[0]), 
-					static_cast<int>(rgb[1]),
-					static_cast<int>(rgb[2])
-					);
-				putpixel(allegroBitmap_, x, y, pixelColor);
+			span.red 		= leftColor[0];
+			span.green 		= leftColor[1];
+			span.blue 		= leftColor[2];
+			span.redStep 	= (rightColor[0] - leftColor[0]) / size[0];
+			span.greenStep 	= (rightColor[1] - leftColor[1]) / size[0];
+			span.blueStep 	= (rightColor[2] - leftColor[2]) / size[0];
 			
-				rgb[0] += deltaXRGB[0];
-				rgb[1] += deltaXRGB[1];
-				rgb[2] += deltaXRGB[2];
+			// 16 and 32 bit memory bitmaps are filled a row at a time, and anything else a pixel at a time
+			if (!PixelKernels->GradientSpan(allegroBitmap_, x1, y, size[0], span))
+			{
+				for (int x = x1; x < x2; x++)
+				{
+					putpixel(allegroBitmap_, x, y, makecol(span.red >> 16, span.green >> 16, span.blue >> 16));
+					
+					span.red 	+= span.redStep;
+					span.green 	+= span.greenStep;
+					span.blue 	+= span.blueStep;
+				}
 			}
-		
-			upperLeftColor[0] += deltaYRGB[0];
-			upperLeftColor[1] += deltaYRGB[1];
-			upperLeftColor[2] += deltaYRGB[2];
-		
-			upperRightColor[0] += deltaYRGB[3];
-			upperRightColor[1] += deltaYRGB[4];
-			upperRightColor[2] += deltaYRGB[5];
+			
+			leftColor[0] += deltaYRGB[0];
+			leftColor[1] += deltaYRGB[1];
+			leftColor[2] += deltaYRGB[2];
+			
+			rightColor[0] += deltaYRGB[3];
+			rightColor[1] += deltaYRGB[4];
+			rightColor[2] += deltaYRGB[5];
 		}
+		
+		MarkDirty(x1, y1, x2 - x1, y2 - y1);
 	}
 	
 	/**************************************************************************/
@@ -435,6 +779,8 @@ namespace ENGINE
 		{
 			ellipse(allegroBitmap_, x, y, radiusX, radiusY, color);
 		}
+		
+		MarkDirty(x - radiusX, y - radiusY, 1 + radiusX * 2, 1 + radiusY * 2);
 	}
 	
 	/**************************************************************************/
@@ -449,6 +795,8 @@ namespace ENGINE
 		{
 			circle(allegroBitmap_, x, y, radius, color);
 		}
+		
+		MarkDirty(x - radius, y - radius, 1 + radius * 2, 1 + radius * 2);
 	}
 	
 	/**************************************************************************/
@@ -458,6 +806,7 @@ namespace ENGINE
 		float start = 0.711f * static_cast<float>(startAngle);
 		float end = 0.711f * static_cast<float>(endAngle);
 		arc(allegroBitmap_, x, y, itofix(start), itofix(end), radius, color);
+		MarkDirty(x - radius, y - radius, 1 + radius * 2, 1 + radius * 2);
 	}
 	
 	/**************************************************************************/
@@ -467,6 +816,12 @@ namespace ENGINE
 		if (filled)
 		{
 			triangle(allegroBitmap_, x1, y1, x2, y2, x3, y3, color);
+			
+			int left 	= (x1 < x2) ? ((x1 < x3) ? x1 : x3) : ((x2 < x3) ? x2 : x3);
+			int top 	= (y1 < y2) ? ((y1 < y3) ? y1 : y3) : ((y2 < y3) ? y2 : y3);
+			int right 	= (x1 > x2) ? ((x1 > x3) ? x1 : x3) : ((x2 > x3) ? x2 : x3);
+			int bottom 	= (y1 > y2) ? ((y1 > y3) ? y1 : y3) : ((y2 > y3) ? y2 : y3);
+			MarkDirty(left, top, 1 + right - left, 1 + bottom - top);
 		}
 		else
 		{
@@ -481,6 +836,9 @@ namespace ENGINE
 	void ImageResource::Fill(int x, int y, int color)
 	{
 		floodfill(allegroBitmap_, x, y, color);
+		
+		// a flood fill can reach anywhere
+		MarkDirty(0, 0, allegroBitmap_->w, allegroBitmap_->h);
 	}
 	
 	/**************************************************************************/
@@ -489,6 +847,28 @@ namespace ENGINE
 	void ImageResource::Clear(int color)
 	{
 		clear_to_color(allegroBitmap_, color);
+		MarkDirty(0, 0, allegroBitmap_->w, allegroBitmap_->h);
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::SetClipRect(int x1, int y1, int x2, int y2)
+	{
+		set_clip_rect(allegroBitmap_, x1, y1, x2, y2);
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::GetClipRect(int& x1, int& y1, int& x2, int& y2)
+	{
+		get_clip_rect(allegroBitmap_, &x1, &y1, &x2, &y2);
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::ResetClipRect()
+	{
+		set_clip_rect(allegroBitmap_, 0, 0, allegroBitmap_->w - 1, allegroBitmap_->h - 1);
 	}
 	
 	/**************************************************************************/
@@ -507,147 +887,347 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
-	BITMAP* ImageResource::LoadPNGInternal(const char* fileName)
+	BITMAP* ImageResource::LoadPNGInternal(const char* fileName, int sourceX, int sourceY, int width, int height)
 	{
-		FILE* fp = fopen(fileName, "rb");
-		if (fp)
+		BITMAP* resource = 0;
+		if (!ReadPNGInternal(fileName, 0, &resource, sourceX, sourceY, width, height))
 		{
-			// read header
-			unsigned char pngHeader[8];
-			fread(&pngHeader, sizeof(unsigned char), 8, fp);
-			if (0 != png_sig_cmp(pngHeader, 0, 8))
-			{
-				fclose(fp);
-				{ char e[256]; sprintf(e, "%s is not a valid PNG file!", fileName); LogFatal(e); }
-			}
-			
-			// create the png structures we need for reading
-			// it is not apparent, but these are all pointers
-			// can thank the idiots that made libpng for the shit typedef names
-			png_structp pngReadStruct;
-			png_infop 	pngInfoStruct;
-			png_infop 	pngEndStruct;
-			
-			pngReadStruct = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
-			if (!pngReadStruct)
-			{
-				fclose(fp);
-				LogFatal("Cannot create the PNG Read Structure!");
-			}
-			
-			pngInfoStruct = png_create_info_struct(pngReadStruct);
-			if (!pngInfoStruct)
+			LogFatal("Could not load the PNG file %s!", fileName);
+			return 0;
+		}
+		return resource;
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::Create(const ImagePixelData& pixels)
+	{
+		if ((0 == pixels.pixels) || (pixels.width <= 0) || (pixels.height <= 0))
+		{
+			LogError("Could not create the ImageResource!");
+			return false;
+		}
+		
+		Create(pixels.width, pixels.height);
+		if (0 == allegroBitmap_)
+		{
+			return false;
+		}
+		
+		CopyPixelsInternal(pixels, 0, 0);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::CopyPixelsInternal(const ImagePixelData& pixels, int sourceX, int sourceY)
+	{
+		if (0 == allegroBitmap_)
+		{
+			return;
+		}
+		
+		// the part of the bitmap that is inside of the pixels
+		int firstRow 		= (sourceY > 0) ? sourceY : 0;
+		int lastRow 		= (sourceY + allegroBitmap_->h < pixels.height) ? sourceY + allegroBitmap_->h : pixels.height;
+		int firstColumn 	= (sourceX > 0) ? sourceX : 0;
+		int lastColumn 		= (sourceX + allegroBitmap_->w < pixels.width) ? sourceX + allegroBitmap_->w : pixels.width;
+		
+		int bytesPerPixel = pixels.bitsPerPixel / 8;
+		int bytesPerRow = pixels.width * bytesPerPixel;
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			ConvertRowInternal(allegroBitmap_, firstColumn - sourceX, y - sourceY, 
+				pixels.pixels + (y * bytesPerRow) + (firstColumn * bytesPerPixel), pixels.bitsPerPixel, lastColumn - firstColumn);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::DecodePNG(const char* fileName, ImagePixelData& pixels)
+	{
+		// the pixels of an image that the packer decoded ahead of time are copied, so the caller owns them either way
+		ImagePixelData packedPixels;
+		if (VirtualFileSystem->GetPixels(fileName, packedPixels))
+		{
+			unsigned int byteCount = packedPixels.width * packedPixels.height * (packedPixels.bitsPerPixel / 8);
+			pixels = packedPixels;
+			pixels.pixels = new unsigned char [byteCount];
+			memcpy(pixels.pixels, packedPixels.pixels, byteCount);
+			return true;
+		}
+		
+		return ReadPNGInternal(fileName, &pixels, 0, 0, 0, 0, 0);
+	}
+	
+	/**************************************************************************/
+	
+	bool ImageResource::ReadPNGInternal(
+		const char* fileName, 
+		ImagePixelData* pixels, 
+		BITMAP** bitmap, 
+		int sourceX, 
+		int sourceY, 
+		int width, 
+		int height)
+	{
+		if (0 != pixels)
+		{
+			pixels->width 			= 0;
+			pixels->height 			= 0;
+			pixels->bitsPerPixel 	= 0;
+			pixels->pixels 			= 0;
+		}
+		
+		if (0 != bitmap)
+		{
+			*bitmap = 0;
+		}
+		
+		// the file may be loose, or inside of a mounted archive
+		VirtualFile* file = VirtualFileSystem->Open(fileName);
+		if (0 == file)
+		{
+			LogError("Could not open %s!", fileName);
+			return false;
+		}
+		
+		// read header
+		unsigned char pngHeader[8];
+		if ((8 != file->Read(pngHeader, 8)) || (0 != png_sig_cmp(pngHeader, 0, 8)))
+		{
+			delete file;
+			LogError("%s is not a valid PNG file!", fileName);
+			return false;
+		}
+		
+		// create the png structures we need for reading
+		// it is not apparent, but these are all pointers
+		png_structp pngReadStruct 	= png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+		png_infop 	pngInfoStruct 	= (0 != pngReadStruct) ? png_create_info_struct(pngReadStruct) : 0;
+		png_infop 	pngEndStruct 	= (0 != pngReadStruct) ? png_create_info_struct(pngReadStruct) : 0;
+		if ((0 == pngInfoStruct) || (0 == pngEndStruct))
+		{
+			png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
+			delete file;
+			LogError("Cannot create the PNG read structures for %s!", fileName);
+			return false;
+		}
+		
+		// libpng jumps back here when the file is damaged
+		unsigned char* volatile imagePixels = 0;
+		png_bytep* volatile rows = 0;
+		BITMAP* volatile resource = 0;
+		if (setjmp(png_jmpbuf(pngReadStruct)))
+		{
+			delete [] imagePixels;
+			delete [] rows;
+			if (0 != resource)
 			{
-				fclose(fp);
-				png_destroy_read_struct(&pngReadStruct, 0, 0);
-				LogFatal("Cannot create the PNG Info Structure!");
+				destroy_bitmap(resource);
 			}
-			
-			pngEndStruct = png_create_info_struct(pngReadStruct);
-			if (!pngEndStruct)
+			png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
+			delete file;
+			LogError("%s is damaged and could not be decoded!", fileName);
+			return false;
+		}
+		
+		png_set_read_fn(pngReadStruct, file, ReadPNGData);
+		png_set_sig_bytes(pngReadStruct, 8);
+		
+		// read dimensions
+		png_uint_32 imageWidth = 0;
+		png_uint_32 imageHeight = 0;
+		int imageBitDepth = 0;
+		int imageColorType = 0;
+		
+		png_read_info(pngReadStruct, pngInfoStruct);
+		png_get_IHDR(pngReadStruct, 
+			pngInfoStruct, 
+			&imageWidth, 
+			&imageHeight, 
+			&imageBitDepth,
+			&imageColorType,
+			0,
+			0,
+			0);
+		
+		png_set_packing(pngReadStruct);
+		
+		// expand low-bpp gray-scale to 8 bit
+		if ((imageColorType == PNG_COLOR_TYPE_GRAY) && (imageBitDepth < 8))
+		{
+			png_set_expand(pngReadStruct);
+		}
+		
+		// convert gray-scale to RGB
+		if ((imageColorType == PNG_COLOR_TYPE_GRAY) || (imageColorType == PNG_COLOR_TYPE_GRAY_ALPHA))
+		{
+			png_set_gray_to_rgb(pngReadStruct);
+		}
+		
+		// if there is transparency info, then create an alpha channel
+		if (png_get_valid(pngReadStruct, pngInfoStruct, PNG_INFO_tRNS))
+		{
+			png_set_tRNS_to_alpha(pngReadStruct);
+		}
+		
+		// convert 16 bit to 8 bit
+		if (16 == imageBitDepth)
+		{
+			png_set_strip_16(pngReadStruct);
+		}
+		
+		int scanPasses = png_set_interlace_handling(pngReadStruct);
+		
+		// find out what the rows look like after the conversions
+		png_read_update_info(pngReadStruct, pngInfoStruct);
+		
+		unsigned long imageBytesPerRow = png_get_rowbytes(pngReadStruct, pngInfoStruct);
+		int imageBitsPerPixel = static_cast<int>(imageBytesPerRow * 8 / imageWidth);
+		imageBitsPerPixel = (imageBitsPerPixel < 8) ? 8 : imageBitsPerPixel;
+		int imageBytesPerPixel = imageBitsPerPixel / 8;
+		
+		if (0 != pixels)
+		{
+			// read pixels; reading the whole image at once lets libpng handle interlaced files
+			imagePixels = new unsigned char [imageBytesPerRow * imageHeight];
+			rows = new png_bytep [imageHeight];
+			for (png_uint_32 y = 0; y < imageHeight; y++)
 			{
-				fclose(fp);
-				png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, 0);
-				LogFatal("Cannot create the PNG Info Structure!");
+				rows[y] = imagePixels + (y * imageBytesPerRow);
 			}
-
-			png_init_io(pngReadStruct, fp);
-			png_set_sig_bytes(pngReadStruct, 8);
-			
-			// read dimensions
-			unsigned long imageWidth = 0;
-			unsigned long imageHeight = 0;
-			int imageBitsPerPixel = 0;
-			int imageColorType = 0;
 			
-			png_read_info(pngReadStruct, pngInfoStruct);
-			png_get_IHDR(pngReadStruct, 
-				pngInfoStruct, 
-				&imageWidth, 
-				&imageHeight, 
-				&imageBitsPerPixel,
-				&imageColorType,
-				0,
-				0,
-				0);
-			
-			png_set_packing(pngReadStruct);
+			png_read_image(pngReadStruct, rows);
+			png_read_end(pngReadStruct, pngEndStruct);
 			
-			// expand low-bpp gray-scale to 8 bit
-			if ((imageColorType == PNG_COLOR_TYPE_GRAY) && (imageBitsPerPixel < 8))
-			{
-				png_set_expand(pngReadStruct);
-			}
+			delete [] rows;
+			png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
+			delete file;
 			
-			// convert gray-scale to RGB
-			if ((imageColorType == PNG_COLOR_TYPE_GRAY) || (imageColorType == PNG_COLOR_TYPE_GRAY_ALPHA))
+			pixels->width 			= static_cast<int>(imageWidth);
+			pixels->height 			= static_cast<int>(imageHeight);
+			pixels->bitsPerPixel 	= imageBitsPerPixel;
+			pixels->pixels 			= imagePixels;
+			return true;
+		}
+		
+		// the whole image is loaded when no rectangle is given
+		if ((width <= 0) || (height <= 0))
+		{
+			sourceX = 0;
+			sourceY = 0;
+			width 	= static_cast<int>(imageWidth);
+			height 	= static_cast<int>(imageHeight);
+		}
+		
+		resource = create_bitmap_ex(bitmap_color_depth(screen), width, height);
+		if (0 == resource)
+		{
+			png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
+			delete file;
+			LogError("Could not create the Allegro bitmap surface for %s!", fileName);
+			return false;
+		}
+		clear_to_color(resource, 0);
+		
+		// the part of the rectangle that is inside of the image
+		int firstRow 		= (sourceY > 0) ? sourceY : 0;
+		int lastRow 		= (sourceY + height < static_cast<int>(imageHeight)) ? sourceY + height : static_cast<int>(imageHeight);
+		int firstColumn 	= (sourceX > 0) ? sourceX : 0;
+		int lastColumn 		= (sourceX + width < static_cast<int>(imageWidth)) ? sourceX + width : static_cast<int>(imageWidth);
+		int columnCount 	= lastColumn - firstColumn;
+		
+		if ((firstRow < lastRow) && (columnCount > 0))
+		{
+			if (scanPasses > 1)
 			{
-				png_set_gray_to_rgb(pngReadStruct);
+				// an interlaced file only has its rows complete after the last pass, so it is read whole
+				imagePixels = new unsigned char [imageBytesPerRow * imageHeight];
+				rows = new png_bytep [imageHeight];
+				for (png_uint_32 y = 0; y < imageHeight; y++)
+				{
+					rows[y] = imagePixels + (y * imageBytesPerRow);
+				}
+				png_read_image(pngReadStruct, rows);
+				
+				for (int y = firstRow; y < lastRow; y++)
+				{
+					ConvertRowInternal(resource, firstColumn - sourceX, y - sourceY, 
+						rows[y] + (firstColumn * imageBytesPerPixel), imageBitsPerPixel, columnCount);
+				}
+				
+				delete [] rows;
+				rows = 0;
 			}
-			
-			// if there is transparency info, then create an alpha channel
-			bool transparencyToAlpha = false;
-			if (png_get_valid(pngReadStruct, pngInfoStruct, PNG_INFO_tRNS))
+			else
 			{
-				png_set_tRNS_to_alpha(pngReadStruct);
-				transparencyToAlpha = true;
+				// a single row is decoded at a time, and converted right into the bitmap
+				imagePixels = new unsigned char [imageBytesPerRow];
+				for (int y = 0; y < lastRow; y++)
+				{
+					png_read_row(pngReadStruct, imagePixels, 0);
+					if (y >= firstRow)
+					{
+						ConvertRowInternal(resource, firstColumn - sourceX, y - sourceY, 
+							imagePixels + (firstColumn * imageBytesPerPixel), imageBitsPerPixel, columnCount);
+					}
+				}
 			}
 			
-			// convert 16 bit to 8 bit
-			if (16 == imageBitsPerPixel)
+			delete [] imagePixels;
+			imagePixels = 0;
+		}
+		
+		// the rows below the rectangle are never decoded
+		png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
+		delete file;
+		
+		*bitmap = resource;
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::ConvertRowInternal(
+		BITMAP* destination, 
+		int destX, 
+		int destY, 
+		const unsigned char* source, 
+		int sourceBitsPerPixel, 
+		int count)
+	{
+		int depth = bitmap_color_depth(destination);
+		int bytesPerPixel = sourceBitsPerPixel / 8;
+		
+		for (int index = 0; index < count; index++, source += bytesPerPixel)
+		{
+			int color = 0;
+			if (1 == bytesPerPixel)
 			{
-				png_set_strip_16(pngReadStruct);
+				// palette images keep their indices on an 8 bit display, and use the current palette otherwise
+				color = (8 == depth) ? source[0] : makecol_depth(depth, getr8(source[0]), getg8(source[0]), getb8(source[0]));
 			}
-
-			// read pixels
-			unsigned long imageBytesPerRow = png_get_rowbytes(pngReadStruct, pngInfoStruct);
-			
-			imageBitsPerPixel = imageBytesPerRow * 8 / imageWidth;
-			
-			imageBitsPerPixel = (imageBitsPerPixel < 8) ? 8 : imageBitsPerPixel;
-			
-			BITMAP* resource = 0;
-			resource = create_bitmap_ex(imageBitsPerPixel, imageWidth, imageHeight);
-			if (0 == resource)
+			else if ((4 == bytesPerPixel) && (32 == depth))
 			{
-				png_read_end(pngReadStruct, pngEndStruct);
-				png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
-				fclose(fp);
-				LogFatal("Could not create the Allegro bitmap surface!");
+				color = makeacol32(source[0], source[1], source[2], source[3]);
 			}
-			
-			int scanPasses = png_set_interlace_handling(pngReadStruct);
-			
-			if ((24 == imageBitsPerPixel) || (32 == imageBitsPerPixel)) 
+			else
 			{
-				int c = makecol_depth(imageBitsPerPixel, 0, 0, 255);
-				unsigned char *pc = (unsigned char *)&c;
-				if (pc[0] == 255)
-				{
-					png_set_bgr(pngReadStruct);
-				}
-#if defined(ALLEGRO_BIG_ENDIAN)
-				png_set_swap_alpha(pngReadStruct);
-#endif	    
+				color = makecol_depth(depth, source[0], source[1], source[2]);
 			}
 			
-			for (unsigned long y = 0; y < imageHeight; y++)
+			switch(depth)
 			{
-				png_read_row(pngReadStruct, resource->line[y], 0);
+				case 8: { _putpixel(destination, destX + index, destY, color); } break;
+				case 15: { _putpixel15(destination, destX + index, destY, color); } break;
+				case 16: { _putpixel16(destination, destX + index, destY, color); } break;
+				case 24: { _putpixel24(destination, destX + index, destY, color); } break;
+				case 32: { _putpixel32(destination, destX + index, destY, color); } break;
+				default: break;
 			}
-
-			png_read_end(pngReadStruct, pngEndStruct);
-			png_destroy_read_struct(&pngReadStruct, &pngInfoStruct, &pngEndStruct);
-			fclose(fp);
-			return resource;
 		}
-		else
-		{
-			{ char e[256]; sprintf(e, "Could not open %s!", fileName); LogFatal(e); }
-		}
-		return 0;
 	}
-	
 	/**************************************************************************/
 	
 	BITMAP* ImageResource::GetBitmap()
@@ -668,6 +1248,48 @@ namespace ENGINE
 	{
 		return allegroBitmap_->h;
 	}
+	
+	/**************************************************************************/
+	
+	int ImageResource::GetColorDepth()
+	{
+		return bitmap_color_depth(allegroBitmap_);
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::SetDirtyRectList(DirtyRectList* dirtyRects)
+	{
+		dirtyRects_ = dirtyRects;
+	}
+	
+	/**************************************************************************/
+	
+	DirtyRectList* ImageResource::GetDirtyRectList()
+	{
+		return dirtyRects_;
+	}
+	
+	/**************************************************************************/
+	
+	void ImageResource::MarkDirty(int x, int y, int width, int height)
+	{
+		if ((0 == dirtyRects_) || (0 == allegroBitmap_))
+		{
+			return;
+		}
+		
+		// nothing is drawn outside of the clipping rectangle
+		int clipX1 = 0, clipY1 = 0, clipX2 = 0, clipY2 = 0;
+		get_clip_rect(allegroBitmap_, &clipX1, &clipY1, &clipX2, &clipY2);
+		
+		int x1 = (x < clipX1) ? clipX1 : x;
+		int y1 = (y < clipY1) ? clipY1 : y;
+		int x2 = (x + width - 1 > clipX2) ? clipX2 : x + width - 1;
+		int y2 = (y + height - 1 > clipY2) ? clipY2 : y + height - 1;
+		
+		dirtyRects_->Add(x1, y1, 1 + x2 - x1, 1 + y2 - y1);
+	}
 
 } // end namespace
 
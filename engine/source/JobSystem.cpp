@@ -0,0 +1,459 @@
+// CODESTYLE: v2.0
+
+// JobSystem.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Runs small jobs on a worker thread per processor, with work stealing
+
+/**
+ * \file JobSystem.cpp
+ * \brief Job System Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the complementing header
+#include "JobSystem.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	/**
+	 * \struct ParallelForContext
+	 * \brief what every job of a JobSystemSingleton::ParallelFor() shares
+	 */
+	struct ParallelForContext
+	{
+		//! the function to call for every part of the range
+		ParallelForFunction function;
+		//! passed to the function
+		void* data;
+		//! the largest part of the range to give to a single call
+		int grainSize;
+	};
+	
+	/**************************************************************************/
+	
+	/**
+	 * runs a part of a JobSystemSingleton::ParallelFor() range, handing the back half to another job until the part is small enough
+	 */
+	static void ParallelForJob(Job* job, void* data)
+	{
+		ParallelForContext* context = reinterpret_cast<ParallelForContext*>(data);
+		
+		while (job->end - job->begin > context->grainSize)
+		{
+			int middle = job->begin + ((job->end - job->begin) / 2);
+			
+			Job* child = JobSystem->CreateChildJob(job, ParallelForJob, data);
+			child->begin = middle;
+			child->end = job->end;
+			JobSystem->Run(child);
+			
+			job->end = middle;
+		}
+		
+		context->function(job->begin, job->end, context->data);
+	}
+	
+	/**************************************************************************/
+	
+	JobQueue::JobQueue() :
+		front_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	JobQueue::~JobQueue()
+	{
+		// implement class destructor here
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	void JobQueue::Push(Job* job)
+	{
+		MutexLock lock(mutex_);
+		jobs_.push_back(job);
+	}
+	
+	/**************************************************************************/
+	
+	Job* JobQueue::Pop()
+	{
+		MutexLock lock(mutex_);
+		if (front_ >= jobs_.size())
+		{
+			return 0;
+		}
+		
+		Job* job = jobs_.back();
+		jobs_.pop_back();
+		
+		// the vector keeps its memory once it is empty
+		if (front_ >= jobs_.size())
+		{
+			jobs_.clear();
+			front_ = 0;
+		}
+		return job;
+	}
+	
+	/**************************************************************************/
+	
+	Job* JobQueue::Steal()
+	{
+		MutexLock lock(mutex_);
+		if (front_ >= jobs_.size())
+		{
+			return 0;
+		}
+		
+		Job* job = jobs_[front_++];
+		
+		if (front_ >= jobs_.size())
+		{
+			jobs_.clear();
+			front_ = 0;
+		}
+		return job;
+	}
+	
+	/**************************************************************************/
+	
+	JobSystemSingleton* JobSystemSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static JobSystemSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	bool JobSystemSingleton::Initialize(int threadCount)
+	{
+		if (!queues_.empty())
+		{
+			LogWarning("The job system is already running!");
+			return true;
+		}
+		
+		if (threadCount <= 0)
+		{
+			threadCount = static_cast<int>(GetProcessorCount());
+		}
+		threadCount = (threadCount > JOB_SYSTEM_MAX_THREADS) ? JOB_SYSTEM_MAX_THREADS : threadCount;
+		
+		// the last queue is for the threads that are not part of the job system
+		for (int index = 0; index <= threadCount; index++)
+		{
+			queues_.push_back(new JobQueue);
+		}
+		
+		threadIndex_.Set(reinterpret_cast<void*>(1));
+		
+		stopping_ = false;
+		for (int index = 1; index < threadCount; index++)
+		{
+			JobWorker* worker = new JobWorker;
+			worker->system = this;
+			worker->index = index;
+			if (!worker->thread.Start(JobSystemSingleton::WorkerInternal, worker))
+			{
+				LogError("Could not start job worker %d!", index);
+				delete worker;
+				break;
+			}
+			workers_.push_back(worker);
+		}
+		
+		LogMessage("Running jobs on %d threads.", GetThreadCount());
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::Shutdown()
+	{
+		stopping_ = true;
+		
+		std::vector<JobWorker*>::iterator iter;
+		for (iter = workers_.begin(); iter != workers_.end(); iter++)
+		{
+			workAvailable_.Signal();
+		}
+		for (iter = workers_.begin(); iter != workers_.end(); iter++)
+		{
+			(*iter)->thread.Join();
+			delete *iter;
+		}
+		workers_.clear();
+		
+		std::vector<JobQueue*>::iterator queue;
+		for (queue = queues_.begin(); queue != queues_.end(); queue++)
+		{
+			delete *queue;
+		}
+		queues_.clear();
+		
+		threadIndex_.Set(0);
+	}
+	
+	/**************************************************************************/
+	
+	Job* JobSystemSingleton::CreateJob(JobFunction function, void* data)
+	{
+		// a slot is only used again once its job is finished, so too many jobs at once are reported instead of lost
+		Job* job = 0;
+		for (int attempt = 0; attempt < JOB_SYSTEM_MAX_JOBS; attempt++)
+		{
+			unsigned int index = static_cast<unsigned int>(AtomicIncrement(&nextJob_) - 1) & (JOB_SYSTEM_MAX_JOBS - 1);
+			if (IsFinished(&jobs_[index]))
+			{
+				job = &jobs_[index];
+				break;
+			}
+			
+			if (0 == attempt)
+			{
+				LogError("The job in slot %u is still waiting or running, so it was skipped! No more than %d jobs may be waiting or running at once.", index, JOB_SYSTEM_MAX_JOBS);
+			}
+		}
+		
+		if (0 == job)
+		{
+			LogFatal("All %d jobs are waiting or running!", JOB_SYSTEM_MAX_JOBS);
+		}
+		
+		job->function 	= function;
+		job->data 		= data;
+		job->parent 	= 0;
+		job->unfinished = 1;
+		job->begin 		= 0;
+		job->end 		= 0;
+		return job;
+	}
+	
+	/**************************************************************************/
+	
+	Job* JobSystemSingleton::CreateChildJob(Job* parent, JobFunction function, void* data)
+	{
+		AtomicIncrement(&parent->unfinished);
+		
+		Job* job = CreateJob(function, data);
+		job->parent = parent;
+		return job;
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::Run(Job* job)
+	{
+		if (queues_.empty())
+		{
+			// without Initialize() there are no queues, so the job runs straight away on the thread that gives it
+			ExecuteInternal(job);
+			return;
+		}
+		
+		queues_[GetThreadIndex()]->Push(job);
+		
+		if (!workers_.empty())
+		{
+			workAvailable_.Signal();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::Wait(Job* job)
+	{
+		int threadIndex = GetThreadIndex();
+		
+		while (!IsFinished(job))
+		{
+			Job* next = GetJobInternal(threadIndex);
+			if (0 != next)
+			{
+				ExecuteInternal(next);
+			}
+			else
+			{
+				// the rest of the job is running on other threads
+				YieldThread();
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool JobSystemSingleton::IsFinished(Job* job)
+	{
+		// an atomic read, so that whatever the job wrote is seen once it is finished
+		return AtomicAdd(&job->unfinished, 0) <= 0;
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::ParallelFor(int begin, int end, int grainSize, ParallelForFunction function, void* data)
+	{
+		if (end <= begin)
+		{
+			return;
+		}
+		
+		grainSize = (grainSize < 1) ? 1 : grainSize;
+		
+		// a large range is split into larger parts, so that its jobs never fill up the ring
+		if ((end - begin) / grainSize > JOB_SYSTEM_MAX_PARALLEL_FOR_PARTS)
+		{
+			grainSize = ((end - begin) + JOB_SYSTEM_MAX_PARALLEL_FOR_PARTS - 1) / JOB_SYSTEM_MAX_PARALLEL_FOR_PARTS;
+		}
+		
+		// there is nobody to share the range with
+		if ((end - begin <= grainSize) || workers_.empty())
+		{
+			function(begin, end, data);
+			return;
+		}
+		
+		ParallelForContext context;
+		context.function 	= function;
+		context.data 		= data;
+		context.grainSize 	= grainSize;
+		
+		Job* job = CreateJob(ParallelForJob, &context);
+		job->begin = begin;
+		job->end = end;
+		
+		Run(job);
+		Wait(job);
+	}
+	
+	/**************************************************************************/
+	
+	int JobSystemSingleton::GetThreadCount()
+	{
+		return 1 + static_cast<int>(workers_.size());
+	}
+	
+	/**************************************************************************/
+	
+	int JobSystemSingleton::GetThreadIndex()
+	{
+		int index = static_cast<int>(reinterpret_cast<long>(threadIndex_.Get()));
+		if (index > 0)
+		{
+			return index - 1;
+		}
+		
+		// the last queue belongs to the other threads, even when a worker could not be started
+		return queues_.empty() ? GetThreadCount() : static_cast<int>(queues_.size()) - 1;
+	}
+	
+	/**************************************************************************/
+	
+	Job* JobSystemSingleton::GetJobInternal(int threadIndex)
+	{
+		if (queues_.empty())
+		{
+			return 0;
+		}
+		
+		Job* job = queues_[threadIndex]->Pop();
+		if (0 != job)
+		{
+			return job;
+		}
+		
+		// steal from the next queue along, so that the threads do not all go after the same one
+		int queueCount = static_cast<int>(queues_.size());
+		for (int offset = 1; offset < queueCount; offset++)
+		{
+			job = queues_[(threadIndex + offset) % queueCount]->Steal();
+			if (0 != job)
+			{
+				return job;
+			}
+		}
+		
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::ExecuteInternal(Job* job)
+	{
+		job->function(job, job->data);
+		FinishInternal(job);
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::FinishInternal(Job* job)
+	{
+		while ((0 != job) && (0 == AtomicDecrement(&job->unfinished)))
+		{
+			job = job->parent;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void JobSystemSingleton::WorkerInternal(void* data)
+	{
+		JobWorker* worker = reinterpret_cast<JobWorker*>(data);
+		JobSystemSingleton* system = worker->system;
+		
+		system->threadIndex_.Set(reinterpret_cast<void*>(static_cast<long>(worker->index + 1)));
+		TraceCapture->SetThreadName("job worker");
+		
+		while (!system->stopping_)
+		{
+			Job* job = system->GetJobInternal(worker->index);
+			if (0 != job)
+			{
+				// there may be more where this one came from, so another worker is woken to look
+				system->workAvailable_.Signal();
+				system->ExecuteInternal(job);
+			}
+			else
+			{
+				// a job that is queued without a signal is still found within a millisecond
+				system->workAvailable_.WaitFor(1);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	JobSystemSingleton::JobSystemSingleton() :
+		nextJob_(0),
+		stopping_(false)
+	{
+		// implement class constructor here
+		
+		// every slot of the ring starts out free
+		for (int index = 0; index < JOB_SYSTEM_MAX_JOBS; index++)
+		{
+			jobs_[index].unfinished = 0;
+		}
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	JobSystemSingleton::~JobSystemSingleton()
+	{
+		// implement class destructor here
+		Shutdown();
+	} // end destructor
+
+} // end namespace
+
+
@@ -11,7 +11,7 @@
  * \brief Main ged101 Engine Module - Implementation
  v
  */
- 
+
 // include the common headers
 #include <cstdio>
 #include <cstdlib>
@@ -40,7 +40,11 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
-	MainSystemSingleton::MainSystemSingleton()
+	MainSystemSingleton::MainSystemSingleton() :
+		updateRate_(MAIN_SYSTEM_DEFAULT_UPDATE_RATE),
+		maxUpdatesPerFrame_(MAIN_SYSTEM_DEFAULT_MAX_UPDATES_PER_FRAME),
+		sleepWhenIdle_(true),
+		interpolation_(0.0f)
 	{
 		// implement class constructor here
 	} // end constructor
@@ -60,17 +64,34 @@ namespace ENGINE
 		LogMessage("\nCCPS Solutions Presents\n\n"
 			"ALBASE v1.0 - An Allegro Game Framework\n"
 			"Developed by Richard Marks\n");
-			
+		
 		/**
 		* Parse the optional command-line flags:
 		*
 		* 	specify -f or --fullscreen to lose the window and use the whole screen
 		* 	specify -q or --quiet to lose audio support
+		* 	specify -t or --trace to save a timeline of the engine to trace.json on exit
+		* 	specify --trace=filename to save the timeline to another file
+		* 	specify --pack=filename to read the game files out of a ged101 pack archive; may be given more than once
+		* 	specify --benchmark-pixels to time the pixel kernels against Allegro, write the results to the log, and exit
+		* 	specify --benchmark-collision to time the spatial hash with 1000 to 100000 objects, write the results to the log, and exit
+		* 	specify --render-thread to draw the frames that are recorded with the render queue on a separate thread
+		* 	specify --render-bands=N to split the frames that are recorded with the render queue into N bands that are drawn at once
+		* 	specify --verify-bands to draw every banded frame in one band too, and log the frames that come out different
+		* 	specify --threads N to run jobs on N threads, counting the main thread, instead of one per processor
 		* 	specify -h or --help to view a list of available options
 		*
 		*/
 		bool useFullscreen = false;
 		bool useSound = true;
+		const char* traceFileName = 0;
+		bool benchmarkPixels = false;
+		bool benchmarkCollision = false;
+		bool useRenderThread = false;
+		int renderBands = 1;
+		bool verifyBands = false;
+		bool testBands = false;
+		int threadCount = 0;
 		if (argc > 1)
 		{
 			for (int index = 1; index < argc; index++)
@@ -83,28 +104,102 @@ namespace ENGINE
 				{
 					useSound = false;
 				}
+				else if (!stricmp(argv[index], "-t") || !stricmp(argv[index], "--trace"))
+				{
+					traceFileName = TRACE_CAPTURE_DEFAULT_FILE_NAME;
+				}
+				else if (!strncmp(argv[index], "--trace=", 8) && ('\0' != argv[index][8]))
+				{
+					traceFileName = argv[index] + 8;
+				}
+				else if (!strncmp(argv[index], "--pack=", 7) && ('\0' != argv[index][7]))
+				{
+					// the archives that are given last shadow the ones before them
+					if (!VirtualFileSystem->Mount(argv[index] + 7))
+					{
+						LogFatal("Could not mount the archive %s!", argv[index] + 7);
+					}
+				}
+				else if (!stricmp(argv[index], "--raw-cache"))
+				{
+					ImageResource::SetRawCacheEnabled(true);
+				}
+				else if (!stricmp(argv[index], "--benchmark-pixels"))
+				{
+					benchmarkPixels = true;
+				}
+				else if (!stricmp(argv[index], "--benchmark-collision"))
+				{
+					benchmarkCollision = true;
+				}
+				else if (!stricmp(argv[index], "--render-thread"))
+				{
+					useRenderThread = true;
+				}
+				else if (!strncmp(argv[index], "--render-bands=", 15) && ('\0' != argv[index][15]))
+				{
+					renderBands = atoi(argv[index] + 15);
+				}
+				else if (!stricmp(argv[index], "--verify-bands"))
+				{
+					verifyBands = true;
+				}
+				else if (!stricmp(argv[index], "--test-bands"))
+				{
+					testBands = true;
+				}
+				else if (!stricmp(argv[index], "--threads") && (index + 1 < argc))
+				{
+					threadCount = atoi(argv[++index]);
+				}
 				else if(!stricmp(argv[index], "-h") || !stricmp(argv[index], "--help"))
 				{
 					fprintf(stderr, 
-					"Usage: %s [-|--][f|h|q|fullscreen|quiet|help]\n\n"
+					"Usage: %s [-|--][f|h|q|t|fullscreen|quiet|trace|help] [--trace=filename] [--pack=filename] [--raw-cache] [--benchmark-pixels] [--benchmark-collision] [--render-thread] [--render-bands=N] [--verify-bands] [--test-bands] [--threads N]\n\n"
 					"\tspecify -f or --fullscreen to lose the window and use the whole screen\n"
 					"\tspecify -q or --quiet to lose audio support\n"
+					"\tspecify -t or --trace to save a timeline of the engine to %s on exit\n"
+					"\tspecify --trace=filename to save the timeline to another file\n"
+					"\tspecify --pack=filename to read the game files out of a ged101 pack archive\n"
+					"\tspecify --raw-cache to save the decoded PNG files next to them, and load those instead next time\n"
+					"\tspecify --benchmark-pixels to time the pixel kernels against Allegro and exit\n"
+					"\tspecify --benchmark-collision to time the spatial hash with up to 100000 objects and exit\n"
+					"\tspecify --render-thread to draw the frames recorded with the render queue on a separate thread\n"
+					"\tspecify --render-bands=N to split the frames recorded with the render queue into N bands drawn at once\n"
+					"\tspecify --verify-bands to draw banded frames in one band too and log any that differ\n"
+					"\tspecify --test-bands to draw a test frame in one band and in several, compare the pixels and exit\n"
+					"\tspecify --threads N to run jobs on N threads instead of one per processor\n"
 					"\tspecify -h or --help to view this information.\n"
 					"* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\n", 
-					argv[0]);
+					argv[0], TRACE_CAPTURE_DEFAULT_FILE_NAME);
 					exit(1);
 				}
 			}
 		}
 		
+		// start the capture before anything is loaded, so that the loading shows up in the trace
+		if (0 != traceFileName)
+		{
+			TraceCapture->SetThreadName("main");
+			TraceCapture->StartCapture(traceFileName);
+		}
 		
+		// start the job system before anything that may hand it work
+		JobSystem->Initialize(threadCount);
+		
+		// the collision benchmark needs nothing but the timer
+		if (benchmarkCollision)
+		{
+			SpatialHash::RunBenchmark();
+			exit(0);
+		}
 		
 		// initialize Allegro
 		if (0 != allegro_init())
 		{
 			LogFatal("Could not initialize Allegro!");
 		}
-
+		
 		// install the Allegro timer driver
 		if (0 != install_timer())
 		{
@@ -118,6 +213,19 @@ namespace ENGINE
 			GraphicsDevice_24bit, 
 			(useFullscreen) ? GraphicsDevice_Fullscreen : GraphicsDevice_Windowed);
 		
+		// the benchmark only needs the graphics device
+		if (benchmarkPixels)
+		{
+			PixelKernels->RunBenchmark();
+			exit(0);
+		}
+		
+		// so does the band test, which exits with 1 if the bands drew anything differently
+		if (testBands)
+		{
+			exit(RenderQueue->RunBandTest() ? 0 : 1);
+		}
+		
 		// setup the audio device
 		if (useSound)
 		{
@@ -129,6 +237,15 @@ namespace ENGINE
 		
 		// call the game setup functions
 		GAME::GameInstance->Initialize();
+		
+		// the loading screens are drawn on the main thread, so the render thread starts afterwards
+		RenderQueue->SetBandCount(renderBands);
+		RenderQueue->SetBandVerification(verifyBands);
+		if (useRenderThread)
+		{
+			RenderQueue->StartThread();
+		}
+		
 		LogMessage("Initialization Complete.");
 		
 		return 0;
@@ -140,16 +257,133 @@ namespace ENGINE
 	{
 		// implement class main loop here
 		
+		// all times are in nanosecond ticks
+		GameTimerTicks stepTime 	= GAMETIMER_TICKS_PER_SECOND / updateRate_;
+		float stepSeconds 			= 1.0f / static_cast<float>(updateRate_);
+		GameTimerTicks accumulator 	= 0;
+		
+		GameTimer->BeginFrame();
+		
 		// if there are still states in the game state stack
 		while(!GameStateManager->Empty())
 		{
-			// process the state
-			GameStateManager->ExecuteNextState();
+			GameTimer->BeginFrame();
+			Profiler->BeginFrame();
+			
+			// pick up the files that finished loading in the background
+			AssetLoader->Update();
+			accumulator += GameTimer->GetFrameDelta();
+			
+			// run the logic in fixed steps to catch up with the clock
+			int updates = 0;
+			while ((accumulator >= stepTime) && (updates < maxUpdatesPerFrame_) && (!GameStateManager->Empty()))
+			{
+				// process the state
+				ProfileScope("GameState::Update");
+				GameStateManager->UpdateNextState(stepSeconds);
+				accumulator -= stepTime;
+				updates++;
+			}
+			
+			if (GameStateManager->Empty())
+			{
+				break;
+			}
+			
+			// drop the time that could not be caught up on, instead of trying to make it up later
+			if (accumulator >= stepTime)
+			{
+				accumulator %= stepTime;
+			}
+			
+			interpolation_ = static_cast<float>(accumulator) / static_cast<float>(stepTime);
+			
+			{
+				ProfileScope("GameState::Render");
+				GameStateManager->RenderNextState(interpolation_);
+			}
+			
+			// draw the frame if the state recorded it with the render queue; with a render thread it is drawn while the next frame updates
+			RenderQueue->SubmitFrame();
+			
+			// wait for the next step when we are ahead of the clock
+			if (sleepWhenIdle_)
+			{
+				GameTimerTicks elapsed = GameTimer->GetTicks() - GameTimer->GetFrameStartTime();
+				GameTimerTicks remaining = stepTime - accumulator - elapsed;
+				
+				// rest(0) gives the rest of our time slice away without sleeping
+				rest((remaining >= GAMETIMER_TICKS_PER_MILLISECOND) ? 
+					static_cast<unsigned int>(remaining / GAMETIMER_TICKS_PER_MILLISECOND) : 0);
+			}
 		}
 		
+		// finish drawing the last frame
+		RenderQueue->StopThread();
+		RenderQueue->ReportBandVerification();
+		
+		// the bitmaps of the bands go before Allegro does
+		RenderQueue->SetBandCount(1);
+		
+		// every job is finished by now
+		JobSystem->Shutdown();
+		
+		ImageResource::ReportRawCacheStatistics();
+		
+		// save the trace if one is being captured
+		TraceCapture->StopCapture();
+		
 		return 0;
 	}
 	
+	/**************************************************************************/
+	
+	void MainSystemSingleton::SetUpdateRate(int updatesPerSecond)
+	{
+		if (updatesPerSecond <= 0)
+		{
+			LogWarning("Invalid update rate %d specified! Using %d instead.", 
+				updatesPerSecond, MAIN_SYSTEM_DEFAULT_UPDATE_RATE);
+			updatesPerSecond = MAIN_SYSTEM_DEFAULT_UPDATE_RATE;
+		}
+		updateRate_ = updatesPerSecond;
+	}
+	
+	/**************************************************************************/
+	
+	void MainSystemSingleton::SetMaxUpdatesPerFrame(int maxUpdatesPerFrame)
+	{
+		maxUpdatesPerFrame_ = (maxUpdatesPerFrame < 1) ? 1 : maxUpdatesPerFrame;
+	}
+	
+	/**************************************************************************/
+	
+	void MainSystemSingleton::SetSleepWhenIdle(bool sleepWhenIdle)
+	{
+		sleepWhenIdle_ = sleepWhenIdle;
+	}
+	
+	/**************************************************************************/
+	
+	int MainSystemSingleton::GetUpdateRate()
+	{
+		return updateRate_;
+	}
+	
+	/**************************************************************************/
+	
+	int MainSystemSingleton::GetMaxUpdatesPerFrame()
+	{
+		return maxUpdatesPerFrame_;
+	}
+	
+	/**************************************************************************/
+	
+	float MainSystemSingleton::GetInterpolation()
+	{
+		return interpolation_;
+	}
+
 } // end namespace
 
 
@@ -1,4 +1,3 @@
-
 // CODESTYLE: v2.0
 
 // NameDirectory.cpp
@@ -26,7 +25,16 @@
 
 namespace ENGINE
 {
-	NameDirectory::NameDirectory()
+	/**
+	 * \var NAME_DIRECTORY_MIN_SLOTS
+	 * \brief the number of slots that the hash table starts with once the first name is added
+	 */
+	static const unsigned int NAME_DIRECTORY_MIN_SLOTS = 16;
+	
+	/**************************************************************************/
+	
+	NameDirectory::NameDirectory() :
+		count_(0)
 	{
 	}
 	
@@ -39,25 +47,175 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
-	void NameDirectory::Add(const char* name, unsigned int value)
+	NameID NameDirectory::Add(const char* name, unsigned int value)
+	{
+		NameID nameID(name);
+		
+		// the table is kept at least half empty so that the probes stay short
+		if ((count_ + 1) * 2 > entries_.size())
+		{
+			GrowInternal();
+		}
+		
+		Entry& entry = entries_[FindSlotInternal(nameID.hash)];
+		if (0 != entry.name)
+		{
+			if (0 != strcmp(entry.name, name))
+			{
+				LogError("The names [%s] and [%s] have the same hash 0x%08X, so [%s] was not added!", entry.name, name, nameID.hash, name);
+				return nameID;
+			}
+			
+			entry.value = value;
+			return nameID;
+		}
+		
+		// the name is interned, so its text stays put while the table grows
+		char* text = new char [strlen(name) + 1];
+		strcpy(text, name);
+		
+		entry.name = text;
+		entry.hash = nameID.hash;
+		entry.value = value;
+		count_++;
+		
+		return nameID;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int NameDirectory::Get(const char* name) const
 	{
-		lut_[name] = value;
+		unsigned int value = 0;
+		TryGet(name, value);
+		return value;
 	}
 	
 	/**************************************************************************/
 	
-	unsigned int NameDirectory::Get(const char* name)
+	unsigned int NameDirectory::Get(NameID nameID) const
 	{
-		return static_cast<unsigned int>(lut_[name]);
+		unsigned int value = 0;
+		TryGet(nameID, value);
+		return value;
+	}
+	
+	/**************************************************************************/
+	
+	bool NameDirectory::TryGet(const char* name, unsigned int& value) const
+	{
+		if (entries_.empty())
+		{
+			return false;
+		}
+		
+		// the text is compared as well, in case the name was never added and only shares the hash of one that was
+		const Entry& entry = entries_[FindSlotInternal(NameHash(name))];
+		if ((0 == entry.name) || (0 != strcmp(entry.name, name)))
+		{
+			return false;
+		}
+		
+		value = entry.value;
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool NameDirectory::TryGet(NameID nameID, unsigned int& value) const
+	{
+		if (entries_.empty())
+		{
+			return false;
+		}
+		
+		const Entry& entry = entries_[FindSlotInternal(nameID.hash)];
+		if (0 == entry.name)
+		{
+			return false;
+		}
+		
+		value = entry.value;
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	const char* NameDirectory::GetName(NameID nameID) const
+	{
+		return (entries_.empty()) ? 0 : entries_[FindSlotInternal(nameID.hash)].name;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int NameDirectory::GetCount() const
+	{
+		return count_;
+	}
+	
+	/**************************************************************************/
+	
+	void NameDirectory::Clear()
+	{
+		Destroy();
 	}
 	
 	/**************************************************************************/
 	
 	void NameDirectory::Destroy()
 	{
-		lut_.clear();
+		std::vector<Entry>::iterator iter;
+		for (iter = entries_.begin(); iter != entries_.end(); iter++)
+		{
+			if (0 != iter->name)
+			{
+				delete [] iter->name;
+				iter->name = 0;
+			}
+		}
+		entries_.clear();
+		count_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int NameDirectory::FindSlotInternal(unsigned int hash) const
+	{
+		// linear probing; the table is never full, so an empty slot always ends the search
+		unsigned int mask = static_cast<unsigned int>(entries_.size() - 1);
+		unsigned int slot = hash & mask;
+		while ((0 != entries_[slot].name) && (hash != entries_[slot].hash))
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
 	}
 	
+	/**************************************************************************/
+	
+	void NameDirectory::GrowInternal()
+	{
+		unsigned int slotCount = (entries_.empty()) ? NAME_DIRECTORY_MIN_SLOTS : static_cast<unsigned int>(entries_.size() * 2);
+		
+		Entry empty;
+		empty.name = 0;
+		empty.hash = 0;
+		empty.value = 0;
+		
+		std::vector<Entry> oldEntries(slotCount, empty);
+		oldEntries.swap(entries_);
+		
+		// the interned text moves over with its entry
+		std::vector<Entry>::iterator iter;
+		for (iter = oldEntries.begin(); iter != oldEntries.end(); iter++)
+		{
+			if (0 != iter->name)
+			{
+				entries_[FindSlotInternal(iter->hash)] = *iter;
+			}
+		}
+	}
+
 } // end namespace
 
 
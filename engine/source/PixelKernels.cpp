@@ -0,0 +1,1401 @@
+
+// CODESTYLE: v2.0
+
+// PixelKernels.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: SSE2 and AVX2 span kernels for gradients, blending, and masked copies of 16 and 32 bit bitmaps
+
+/**
+ * \file PixelKernels.cpp
+ * \brief Pixel Kernels Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// only x86 processors have the SSE2 and AVX2 kernels
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define PIXEL_KERNELS_X86
+#define PIXEL_KERNELS_SSE2 __attribute__((target("sse2")))
+#define PIXEL_KERNELS_AVX2 __attribute__((target("avx2")))
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// include Allegro
+#include <allegro.h>
+
+// include the complementing header
+#include "PixelKernels.h"
+
+// include the game timer header
+#include "GameTimer.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	/**
+	 * Blends two 32 bit pixels the way that the Allegro trans and alpha blenders do
+	 * @param x is the source pixel
+	 * @param y is the destination pixel
+	 * @param n is the alpha from 0 to 256
+	 */
+	static inline unsigned int BlendPixel32(unsigned int x, unsigned int y, unsigned int n)
+	{
+		unsigned int redBlue 	= ((((x & 0xFF00FF) - (y & 0xFF00FF)) * n) >> 8) + y;
+		unsigned int green 		= ((((x & 0xFF00) - (y & 0xFF00)) * n) >> 8) + (y & 0xFF00);
+		return (redBlue & 0xFF00FF) | (green & 0xFF00);
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Blends two 16 bit pixels the way that the Allegro trans and alpha blenders do
+	 * @param x is the source pixel
+	 * @param y is the destination pixel
+	 * @param n is the alpha from 0 to 32
+	 */
+	static inline unsigned int BlendPixel16(unsigned int x, unsigned int y, unsigned int n)
+	{
+		// spread the green out of the way, so that all three channels blend with one multiply
+		x = (x | (x << 16)) & 0x7E0F81F;
+		y = (y | (y << 16)) & 0x7E0F81F;
+		unsigned int result = ((((x - y) * n) >> 5) + y) & 0x7E0F81F;
+		return (result & 0xFFFF) | (result >> 16);
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return a 32 bit pixel in the 0xRRGGBB layout turned into a 5-6-5 pixel
+	 */
+	static inline unsigned int Pack565(unsigned int color)
+	{
+		return ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F);
+	}
+	
+	/**************************************************************************/
+	
+	static void GradientSpan32_Scalar(unsigned int* destination, int count, const PixelGradientSpan& span)
+	{
+		int red = span.red;
+		int green = span.green;
+		int blue = span.blue;
+		for (int index = 0; index < count; index++)
+		{
+			destination[index] =
+				((static_cast<unsigned int>(red) >> 16) << _rgb_r_shift_32) |
+				((static_cast<unsigned int>(green) >> 16) << _rgb_g_shift_32) |
+				((static_cast<unsigned int>(blue) >> 16) << _rgb_b_shift_32);
+			red 	+= span.redStep;
+			green 	+= span.greenStep;
+			blue 	+= span.blueStep;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void GradientSpan16_Scalar(unsigned short* destination, int count, const PixelGradientSpan& span)
+	{
+		int red = span.red;
+		int green = span.green;
+		int blue = span.blue;
+		for (int index = 0; index < count; index++)
+		{
+			destination[index] = static_cast<unsigned short>(
+				((static_cast<unsigned int>(red) >> 19) << _rgb_r_shift_16) |
+				((static_cast<unsigned int>(green) >> 18) << _rgb_g_shift_16) |
+				((static_cast<unsigned int>(blue) >> 19) << _rgb_b_shift_16));
+			red 	+= span.redStep;
+			green 	+= span.greenStep;
+			blue 	+= span.blueStep;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void BlendSpan32_Scalar(unsigned int* destination, const unsigned int* source, int count, int alpha)
+	{
+		unsigned int n = (0 != alpha) ? alpha + 1 : 0;
+		for (int index = 0; index < count; index++)
+		{
+			if (MASK_COLOR_32 != source[index])
+			{
+				destination[index] = BlendPixel32(source[index], destination[index], n);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void BlendSpan16_Scalar(unsigned short* destination, const unsigned short* source, int count, int alpha)
+	{
+		unsigned int n = (0 != alpha) ? (alpha + 1) / 8 : 0;
+		for (int index = 0; index < count; index++)
+		{
+			if (MASK_COLOR_16 != source[index])
+			{
+				destination[index] = static_cast<unsigned short>(BlendPixel16(source[index], destination[index], n));
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void AlphaBlendSpan32_Scalar(unsigned int* destination, const unsigned int* source, int count)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			unsigned int color = source[index];
+			if (MASK_COLOR_32 != color)
+			{
+				unsigned int n = color >> 24;
+				n = (0 != n) ? n + 1 : 0;
+				destination[index] = BlendPixel32(color, destination[index], n);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void AlphaBlendSpan16_Scalar(unsigned short* destination, const unsigned int* source, int count)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			unsigned int color = source[index];
+			if (MASK_COLOR_32 != color)
+			{
+				unsigned int n = color >> 24;
+				n = (0 != n) ? (n + 1) / 8 : 0;
+				destination[index] = static_cast<unsigned short>(BlendPixel16(Pack565(color), destination[index], n));
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void MaskedCopySpan32_Scalar(unsigned int* destination, const unsigned int* source, int count)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			if (MASK_COLOR_32 != source[index])
+			{
+				destination[index] = source[index];
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	static void MaskedCopySpan16_Scalar(unsigned short* destination, const unsigned short* source, int count)
+	{
+		for (int index = 0; index < count; index++)
+		{
+			if (MASK_COLOR_16 != source[index])
+			{
+				destination[index] = source[index];
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return span moved forward by a number of pixels
+	 */
+	static PixelGradientSpan AdvanceGradientSpan(const PixelGradientSpan& span, int count)
+	{
+		PixelGradientSpan advanced = span;
+		advanced.red 	+= span.redStep * count;
+		advanced.green 	+= span.greenStep * count;
+		advanced.blue 	+= span.blueStep * count;
+		return advanced;
+	}
+
+// only x86 processors have the SSE2 and AVX2 kernels
+#if defined(PIXEL_KERNELS_X86)
+
+	/**************************************************************************/
+	
+	/**
+	 * \return the low 32 bits of the products of the 32 bit lanes; SSE2 only has a multiply for two of the four lanes
+	 */
+	PIXEL_KERNELS_SSE2 static inline __m128i MultiplyLow32_SSE2(__m128i a, __m128i b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(
+			_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return the lanes of a where the mask is set, and the lanes of b elsewhere
+	 */
+	PIXEL_KERNELS_SSE2 static inline __m128i Select_SSE2(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * BlendPixel32() for 4 pixels
+	 */
+	PIXEL_KERNELS_SSE2 static inline __m128i BlendPixels32_SSE2(__m128i x, __m128i y, __m128i n)
+	{
+		const __m128i redBlueMask = _mm_set1_epi32(0xFF00FF);
+		const __m128i greenMask = _mm_set1_epi32(0xFF00);
+		__m128i redBlue = _mm_sub_epi32(_mm_and_si128(x, redBlueMask), _mm_and_si128(y, redBlueMask));
+		__m128i green = _mm_sub_epi32(_mm_and_si128(x, greenMask), _mm_and_si128(y, greenMask));
+		redBlue = _mm_add_epi32(_mm_srli_epi32(MultiplyLow32_SSE2(redBlue, n), 8), y);
+		green = _mm_add_epi32(_mm_srli_epi32(MultiplyLow32_SSE2(green, n), 8), _mm_and_si128(y, greenMask));
+		return _mm_or_si128(_mm_and_si128(redBlue, redBlueMask), _mm_and_si128(green, greenMask));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * BlendPixel16() for 4 pixels that are held in 32 bit lanes
+	 */
+	PIXEL_KERNELS_SSE2 static inline __m128i BlendPixels16_SSE2(__m128i x, __m128i y, __m128i n)
+	{
+		const __m128i spreadMask = _mm_set1_epi32(0x7E0F81F);
+		x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi32(x, 16)), spreadMask);
+		y = _mm_and_si128(_mm_or_si128(y, _mm_slli_epi32(y, 16)), spreadMask);
+		__m128i result = _mm_add_epi32(_mm_srli_epi32(MultiplyLow32_SSE2(_mm_sub_epi32(x, y), n), 5), y);
+		result = _mm_and_si128(result, spreadMask);
+		return _mm_or_si128(_mm_and_si128(result, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(result, 16));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return eight 16 bit pixels made of two sets of four pixels that are held in 32 bit lanes
+	 */
+	PIXEL_KERNELS_SSE2 static inline __m128i Pack16_SSE2(__m128i low, __m128i high)
+	{
+		// sign extend the pixels, so that the saturating pack leaves them as they are
+		return _mm_packs_epi32(
+			_mm_srai_epi32(_mm_slli_epi32(low, 16), 16),
+			_mm_srai_epi32(_mm_slli_epi32(high, 16), 16));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return four 32 bit pixels in the 0xRRGGBB layout turned into 5-6-5 pixels in 32 bit lanes
+	 */
+	PIXEL_KERNELS_SSE2 static inline __m128i Pack565_SSE2(__m128i color)
+	{
+		return _mm_or_si128(
+			_mm_or_si128(
+				_mm_and_si128(_mm_srli_epi32(color, 8), _mm_set1_epi32(0xF800)),
+				_mm_and_si128(_mm_srli_epi32(color, 5), _mm_set1_epi32(0x07E0))),
+			_mm_and_si128(_mm_srli_epi32(color, 3), _mm_set1_epi32(0x001F)));
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void GradientSpan32_SSE2(unsigned int* destination, int count, const PixelGradientSpan& span)
+	{
+		__m128i red 	= _mm_set_epi32(span.red + 3 * span.redStep, span.red + 2 * span.redStep, span.red + span.redStep, span.red);
+		__m128i green 	= _mm_set_epi32(span.green + 3 * span.greenStep, span.green + 2 * span.greenStep, span.green + span.greenStep, span.green);
+		__m128i blue 	= _mm_set_epi32(span.blue + 3 * span.blueStep, span.blue + 2 * span.blueStep, span.blue + span.blueStep, span.blue);
+		__m128i redStep 	= _mm_set1_epi32(4 * span.redStep);
+		__m128i greenStep 	= _mm_set1_epi32(4 * span.greenStep);
+		__m128i blueStep 	= _mm_set1_epi32(4 * span.blueStep);
+		__m128i redShift 	= _mm_cvtsi32_si128(_rgb_r_shift_32);
+		__m128i greenShift 	= _mm_cvtsi32_si128(_rgb_g_shift_32);
+		__m128i blueShift 	= _mm_cvtsi32_si128(_rgb_b_shift_32);
+		
+		int index = 0;
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i pixels = _mm_or_si128(
+				_mm_or_si128(
+					_mm_sll_epi32(_mm_srli_epi32(red, 16), redShift),
+					_mm_sll_epi32(_mm_srli_epi32(green, 16), greenShift)),
+				_mm_sll_epi32(_mm_srli_epi32(blue, 16), blueShift));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), pixels);
+			red 	= _mm_add_epi32(red, redStep);
+			green 	= _mm_add_epi32(green, greenStep);
+			blue 	= _mm_add_epi32(blue, blueStep);
+		}
+		
+		GradientSpan32_Scalar(destination + index, count - index, AdvanceGradientSpan(span, index));
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void GradientSpan16_SSE2(unsigned short* destination, int count, const PixelGradientSpan& span)
+	{
+		__m128i red 	= _mm_set_epi32(span.red + 3 * span.redStep, span.red + 2 * span.redStep, span.red + span.redStep, span.red);
+		__m128i green 	= _mm_set_epi32(span.green + 3 * span.greenStep, span.green + 2 * span.greenStep, span.green + span.greenStep, span.green);
+		__m128i blue 	= _mm_set_epi32(span.blue + 3 * span.blueStep, span.blue + 2 * span.blueStep, span.blue + span.blueStep, span.blue);
+		__m128i redStep 	= _mm_set1_epi32(4 * span.redStep);
+		__m128i greenStep 	= _mm_set1_epi32(4 * span.greenStep);
+		__m128i blueStep 	= _mm_set1_epi32(4 * span.blueStep);
+		__m128i redShift 	= _mm_cvtsi32_si128(_rgb_r_shift_16);
+		__m128i greenShift 	= _mm_cvtsi32_si128(_rgb_g_shift_16);
+		__m128i blueShift 	= _mm_cvtsi32_si128(_rgb_b_shift_16);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m128i pixels[2];
+			for (int half = 0; half < 2; half++)
+			{
+				pixels[half] = _mm_or_si128(
+					_mm_or_si128(
+						_mm_sll_epi32(_mm_srli_epi32(red, 19), redShift),
+						_mm_sll_epi32(_mm_srli_epi32(green, 18), greenShift)),
+					_mm_sll_epi32(_mm_srli_epi32(blue, 19), blueShift));
+				red 	= _mm_add_epi32(red, redStep);
+				green 	= _mm_add_epi32(green, greenStep);
+				blue 	= _mm_add_epi32(blue, blueStep);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Pack16_SSE2(pixels[0], pixels[1]));
+		}
+		
+		GradientSpan16_Scalar(destination + index, count - index, AdvanceGradientSpan(span, index));
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void BlendSpan32_SSE2(unsigned int* destination, const unsigned int* source, int count, int alpha)
+	{
+		const __m128i n = _mm_set1_epi32((0 != alpha) ? alpha + 1 : 0);
+		const __m128i maskColor = _mm_set1_epi32(MASK_COLOR_32);
+		
+		int index = 0;
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+			__m128i blended = BlendPixels32_SSE2(x, y, n);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Select_SSE2(_mm_cmpeq_epi32(x, maskColor), y, blended));
+		}
+		
+		BlendSpan32_Scalar(destination + index, source + index, count - index, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void BlendSpan16_SSE2(unsigned short* destination, const unsigned short* source, int count, int alpha)
+	{
+		const __m128i n = _mm_set1_epi32((0 != alpha) ? (alpha + 1) / 8 : 0);
+		const __m128i maskColor = _mm_set1_epi16(static_cast<short>(MASK_COLOR_16));
+		const __m128i zero = _mm_setzero_si128();
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+			__m128i blended = Pack16_SSE2(
+				BlendPixels16_SSE2(_mm_unpacklo_epi16(x, zero), _mm_unpacklo_epi16(y, zero), n),
+				BlendPixels16_SSE2(_mm_unpackhi_epi16(x, zero), _mm_unpackhi_epi16(y, zero), n));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Select_SSE2(_mm_cmpeq_epi16(x, maskColor), y, blended));
+		}
+		
+		BlendSpan16_Scalar(destination + index, source + index, count - index, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void AlphaBlendSpan32_SSE2(unsigned int* destination, const unsigned int* source, int count)
+	{
+		const __m128i maskColor = _mm_set1_epi32(MASK_COLOR_32);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi32(1);
+		
+		int index = 0;
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+			
+			// n is the alpha plus one, unless the alpha is zero
+			__m128i n = _mm_srli_epi32(x, 24);
+			n = _mm_add_epi32(n, _mm_andnot_si128(_mm_cmpeq_epi32(n, zero), one));
+			
+			__m128i blended = BlendPixels32_SSE2(x, y, n);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Select_SSE2(_mm_cmpeq_epi32(x, maskColor), y, blended));
+		}
+		
+		AlphaBlendSpan32_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void AlphaBlendSpan16_SSE2(unsigned short* destination, const unsigned int* source, int count)
+	{
+		const __m128i maskColor = _mm_set1_epi32(MASK_COLOR_32);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi32(1);
+		
+		int index = 0;
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(destination + index)), zero);
+			
+			// n is the alpha plus one divided by eight, unless the alpha is zero
+			__m128i alpha = _mm_srli_epi32(x, 24);
+			__m128i n = _mm_andnot_si128(_mm_cmpeq_epi32(alpha, zero), _mm_srli_epi32(_mm_add_epi32(alpha, one), 3));
+			
+			__m128i blended = BlendPixels16_SSE2(Pack565_SSE2(x), y, n);
+			__m128i pixels = Select_SSE2(_mm_cmpeq_epi32(x, maskColor), y, blended);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + index), Pack16_SSE2(pixels, pixels));
+		}
+		
+		AlphaBlendSpan16_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void MaskedCopySpan32_SSE2(unsigned int* destination, const unsigned int* source, int count)
+	{
+		const __m128i maskColor = _mm_set1_epi32(MASK_COLOR_32);
+		
+		int index = 0;
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Select_SSE2(_mm_cmpeq_epi32(x, maskColor), y, x));
+		}
+		
+		MaskedCopySpan32_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_SSE2 static void MaskedCopySpan16_SSE2(unsigned short* destination, const unsigned short* source, int count)
+	{
+		const __m128i maskColor = _mm_set1_epi16(static_cast<short>(MASK_COLOR_16));
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Select_SSE2(_mm_cmpeq_epi16(x, maskColor), y, x));
+		}
+		
+		MaskedCopySpan16_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return the lanes of a where the mask is set, and the lanes of b elsewhere
+	 */
+	PIXEL_KERNELS_AVX2 static inline __m256i Select_AVX2(__m256i mask, __m256i a, __m256i b)
+	{
+		return _mm256_or_si256(_mm256_and_si256(mask, a), _mm256_andnot_si256(mask, b));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * BlendPixel32() for 8 pixels
+	 */
+	PIXEL_KERNELS_AVX2 static inline __m256i BlendPixels32_AVX2(__m256i x, __m256i y, __m256i n)
+	{
+		const __m256i redBlueMask = _mm256_set1_epi32(0xFF00FF);
+		const __m256i greenMask = _mm256_set1_epi32(0xFF00);
+		__m256i redBlue = _mm256_sub_epi32(_mm256_and_si256(x, redBlueMask), _mm256_and_si256(y, redBlueMask));
+		__m256i green = _mm256_sub_epi32(_mm256_and_si256(x, greenMask), _mm256_and_si256(y, greenMask));
+		redBlue = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(redBlue, n), 8), y);
+		green = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(green, n), 8), _mm256_and_si256(y, greenMask));
+		return _mm256_or_si256(_mm256_and_si256(redBlue, redBlueMask), _mm256_and_si256(green, greenMask));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * BlendPixel16() for 8 pixels that are held in 32 bit lanes
+	 */
+	PIXEL_KERNELS_AVX2 static inline __m256i BlendPixels16_AVX2(__m256i x, __m256i y, __m256i n)
+	{
+		const __m256i spreadMask = _mm256_set1_epi32(0x7E0F81F);
+		x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 16)), spreadMask);
+		y = _mm256_and_si256(_mm256_or_si256(y, _mm256_slli_epi32(y, 16)), spreadMask);
+		__m256i result = _mm256_add_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(x, y), n), 5), y);
+		result = _mm256_and_si256(result, spreadMask);
+		return _mm256_or_si256(_mm256_and_si256(result, _mm256_set1_epi32(0xFFFF)), _mm256_srli_epi32(result, 16));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return eight 16 bit pixels made of eight pixels that are held in 32 bit lanes
+	 */
+	PIXEL_KERNELS_AVX2 static inline __m128i Pack16_AVX2(__m256i pixels)
+	{
+		// the pack works on each half of the register, so the two halves are gathered afterwards
+		__m256i signExtended = _mm256_srai_epi32(_mm256_slli_epi32(pixels, 16), 16);
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(signExtended, signExtended), 0x08);
+		return _mm256_castsi256_si128(packed);
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return eight 32 bit pixels in the 0xRRGGBB layout turned into 5-6-5 pixels in 32 bit lanes
+	 */
+	PIXEL_KERNELS_AVX2 static inline __m256i Pack565_AVX2(__m256i color)
+	{
+		return _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_and_si256(_mm256_srli_epi32(color, 8), _mm256_set1_epi32(0xF800)),
+				_mm256_and_si256(_mm256_srli_epi32(color, 5), _mm256_set1_epi32(0x07E0))),
+			_mm256_and_si256(_mm256_srli_epi32(color, 3), _mm256_set1_epi32(0x001F)));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return the colors of the first 8 pixels of a gradient channel
+	 */
+	PIXEL_KERNELS_AVX2 static inline __m256i GradientLanes_AVX2(int value, int step)
+	{
+		return _mm256_add_epi32(_mm256_set1_epi32(value), _mm256_mullo_epi32(_mm256_set1_epi32(step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void GradientSpan32_AVX2(unsigned int* destination, int count, const PixelGradientSpan& span)
+	{
+		__m256i red 	= GradientLanes_AVX2(span.red, span.redStep);
+		__m256i green 	= GradientLanes_AVX2(span.green, span.greenStep);
+		__m256i blue 	= GradientLanes_AVX2(span.blue, span.blueStep);
+		__m256i redStep 	= _mm256_set1_epi32(8 * span.redStep);
+		__m256i greenStep 	= _mm256_set1_epi32(8 * span.greenStep);
+		__m256i blueStep 	= _mm256_set1_epi32(8 * span.blueStep);
+		__m128i redShift 	= _mm_cvtsi32_si128(_rgb_r_shift_32);
+		__m128i greenShift 	= _mm_cvtsi32_si128(_rgb_g_shift_32);
+		__m128i blueShift 	= _mm_cvtsi32_si128(_rgb_b_shift_32);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i pixels = _mm256_or_si256(
+				_mm256_or_si256(
+					_mm256_sll_epi32(_mm256_srli_epi32(red, 16), redShift),
+					_mm256_sll_epi32(_mm256_srli_epi32(green, 16), greenShift)),
+				_mm256_sll_epi32(_mm256_srli_epi32(blue, 16), blueShift));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + index), pixels);
+			red 	= _mm256_add_epi32(red, redStep);
+			green 	= _mm256_add_epi32(green, greenStep);
+			blue 	= _mm256_add_epi32(blue, blueStep);
+		}
+		
+		GradientSpan32_Scalar(destination + index, count - index, AdvanceGradientSpan(span, index));
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void GradientSpan16_AVX2(unsigned short* destination, int count, const PixelGradientSpan& span)
+	{
+		__m256i red 	= GradientLanes_AVX2(span.red, span.redStep);
+		__m256i green 	= GradientLanes_AVX2(span.green, span.greenStep);
+		__m256i blue 	= GradientLanes_AVX2(span.blue, span.blueStep);
+		__m256i redStep 	= _mm256_set1_epi32(8 * span.redStep);
+		__m256i greenStep 	= _mm256_set1_epi32(8 * span.greenStep);
+		__m256i blueStep 	= _mm256_set1_epi32(8 * span.blueStep);
+		__m128i redShift 	= _mm_cvtsi32_si128(_rgb_r_shift_16);
+		__m128i greenShift 	= _mm_cvtsi32_si128(_rgb_g_shift_16);
+		__m128i blueShift 	= _mm_cvtsi32_si128(_rgb_b_shift_16);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i pixels = _mm256_or_si256(
+				_mm256_or_si256(
+					_mm256_sll_epi32(_mm256_srli_epi32(red, 19), redShift),
+					_mm256_sll_epi32(_mm256_srli_epi32(green, 18), greenShift)),
+				_mm256_sll_epi32(_mm256_srli_epi32(blue, 19), blueShift));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Pack16_AVX2(pixels));
+			red 	= _mm256_add_epi32(red, redStep);
+			green 	= _mm256_add_epi32(green, greenStep);
+			blue 	= _mm256_add_epi32(blue, blueStep);
+		}
+		
+		GradientSpan16_Scalar(destination + index, count - index, AdvanceGradientSpan(span, index));
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void BlendSpan32_AVX2(unsigned int* destination, const unsigned int* source, int count, int alpha)
+	{
+		const __m256i n = _mm256_set1_epi32((0 != alpha) ? alpha + 1 : 0);
+		const __m256i maskColor = _mm256_set1_epi32(MASK_COLOR_32);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + index));
+			__m256i blended = BlendPixels32_AVX2(x, y, n);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + index), Select_AVX2(_mm256_cmpeq_epi32(x, maskColor), y, blended));
+		}
+		
+		BlendSpan32_Scalar(destination + index, source + index, count - index, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void BlendSpan16_AVX2(unsigned short* destination, const unsigned short* source, int count, int alpha)
+	{
+		const __m256i n = _mm256_set1_epi32((0 != alpha) ? (alpha + 1) / 8 : 0);
+		const __m128i maskColor = _mm_set1_epi16(static_cast<short>(MASK_COLOR_16));
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + index));
+			__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index));
+			__m128i blended = Pack16_AVX2(BlendPixels16_AVX2(_mm256_cvtepu16_epi32(x), _mm256_cvtepu16_epi32(y), n));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Select_SSE2(_mm_cmpeq_epi16(x, maskColor), y, blended));
+		}
+		
+		BlendSpan16_Scalar(destination + index, source + index, count - index, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void AlphaBlendSpan32_AVX2(unsigned int* destination, const unsigned int* source, int count)
+	{
+		const __m256i maskColor = _mm256_set1_epi32(MASK_COLOR_32);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i one = _mm256_set1_epi32(1);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + index));
+			
+			// n is the alpha plus one, unless the alpha is zero
+			__m256i n = _mm256_srli_epi32(x, 24);
+			n = _mm256_add_epi32(n, _mm256_andnot_si256(_mm256_cmpeq_epi32(n, zero), one));
+			
+			__m256i blended = BlendPixels32_AVX2(x, y, n);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + index), Select_AVX2(_mm256_cmpeq_epi32(x, maskColor), y, blended));
+		}
+		
+		AlphaBlendSpan32_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void AlphaBlendSpan16_AVX2(unsigned short* destination, const unsigned int* source, int count)
+	{
+		const __m256i maskColor = _mm256_set1_epi32(MASK_COLOR_32);
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i one = _mm256_set1_epi32(1);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index));
+			__m256i y = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(destination + index)));
+			
+			// n is the alpha plus one divided by eight, unless the alpha is zero
+			__m256i alpha = _mm256_srli_epi32(x, 24);
+			__m256i n = _mm256_andnot_si256(_mm256_cmpeq_epi32(alpha, zero), _mm256_srli_epi32(_mm256_add_epi32(alpha, one), 3));
+			
+			__m256i blended = BlendPixels16_AVX2(Pack565_AVX2(x), y, n);
+			__m256i pixels = Select_AVX2(_mm256_cmpeq_epi32(x, maskColor), y, blended);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + index), Pack16_AVX2(pixels));
+		}
+		
+		AlphaBlendSpan16_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void MaskedCopySpan32_AVX2(unsigned int* destination, const unsigned int* source, int count)
+	{
+		const __m256i maskColor = _mm256_set1_epi32(MASK_COLOR_32);
+		
+		int index = 0;
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + index));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + index), Select_AVX2(_mm256_cmpeq_epi32(x, maskColor), y, x));
+		}
+		
+		MaskedCopySpan32_Scalar(destination + index, source + index, count - index);
+	}
+	
+	/**************************************************************************/
+	
+	PIXEL_KERNELS_AVX2 static void MaskedCopySpan16_AVX2(unsigned short* destination, const unsigned short* source, int count)
+	{
+		const __m256i maskColor = _mm256_set1_epi16(static_cast<short>(MASK_COLOR_16));
+		
+		int index = 0;
+		for (; index + 16 <= count; index += 16)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + index));
+			__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + index));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + index), Select_AVX2(_mm256_cmpeq_epi16(x, maskColor), y, x));
+		}
+		
+		MaskedCopySpan16_Scalar(destination + index, source + index, count - index);
+	}
+
+#endif
+
+	/**************************************************************************/
+	
+	//! the kernels that run everywhere
+	static const PixelKernelTable scalarKernels =
+	{
+		"scalar",
+		GradientSpan32_Scalar,
+		GradientSpan16_Scalar,
+		BlendSpan32_Scalar,
+		BlendSpan16_Scalar,
+		AlphaBlendSpan32_Scalar,
+		AlphaBlendSpan16_Scalar,
+		MaskedCopySpan32_Scalar,
+		MaskedCopySpan16_Scalar
+	};
+
+// only x86 processors have the SSE2 and AVX2 kernels
+#if defined(PIXEL_KERNELS_X86)
+	//! the kernels for processors with SSE2
+	static const PixelKernelTable sse2Kernels =
+	{
+		"SSE2",
+		GradientSpan32_SSE2,
+		GradientSpan16_SSE2,
+		BlendSpan32_SSE2,
+		BlendSpan16_SSE2,
+		AlphaBlendSpan32_SSE2,
+		AlphaBlendSpan16_SSE2,
+		MaskedCopySpan32_SSE2,
+		MaskedCopySpan16_SSE2
+	};
+	
+	//! the kernels for processors with AVX2
+	static const PixelKernelTable avx2Kernels =
+	{
+		"AVX2",
+		GradientSpan32_AVX2,
+		GradientSpan16_AVX2,
+		BlendSpan32_AVX2,
+		BlendSpan16_AVX2,
+		AlphaBlendSpan32_AVX2,
+		AlphaBlendSpan16_AVX2,
+		MaskedCopySpan32_AVX2,
+		MaskedCopySpan16_AVX2
+	};
+#endif
+
+	/**************************************************************************/
+	
+	PixelKernelsSingleton* PixelKernelsSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static PixelKernelsSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::IsSupported(PixelKernelSet kernelSet)
+	{
+		return (kernelSet >= 0) && (kernelSet < PixelKernels_Count) && supported_[kernelSet];
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::SelectKernelSet(PixelKernelSet kernelSet)
+	{
+		if (!IsSupported(kernelSet))
+		{
+			return false;
+		}
+		kernelSet_ = kernelSet;
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	PixelKernelSet PixelKernelsSingleton::GetKernelSet()
+	{
+		return kernelSet_;
+	}
+	
+	/**************************************************************************/
+	
+	const PixelKernelTable& PixelKernelsSingleton::GetKernels()
+	{
+		return GetKernels(kernelSet_);
+	}
+	
+	/**************************************************************************/
+	
+	const PixelKernelTable& PixelKernelsSingleton::GetKernels(PixelKernelSet kernelSet)
+	{
+		switch(kernelSet)
+		{
+// only x86 processors have the SSE2 and AVX2 kernels
+#if defined(PIXEL_KERNELS_X86)
+			case PixelKernels_SSE2: { return sse2Kernels; } break;
+			case PixelKernels_AVX2: { return avx2Kernels; } break;
+#endif
+			default: break;
+		}
+		return scalarKernels;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::HasStandardLayout(int colorDepth)
+	{
+		switch(colorDepth)
+		{
+			case 16:
+			{
+				return (11 == _rgb_r_shift_16) && (5 == _rgb_g_shift_16) && (0 == _rgb_b_shift_16);
+			} break;
+			
+			case 32:
+			{
+				return (16 == _rgb_r_shift_32) && (8 == _rgb_g_shift_32) && (0 == _rgb_b_shift_32) && (24 == _rgb_a_shift_32);
+			} break;
+			
+			default: break;
+		}
+		return false;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::GradientSpan(BITMAP* destination, int x, int y, int count, const PixelGradientSpan& span)
+	{
+		int colorDepth = bitmap_color_depth(destination);
+		if (!is_memory_bitmap(destination) || ((16 != colorDepth) && (32 != colorDepth)))
+		{
+			return false;
+		}
+		
+		// clip the row like putpixel() would
+		int left 	= destination->clip ? destination->cl : 0;
+		int right 	= destination->clip ? destination->cr : destination->w;
+		int top 	= destination->clip ? destination->ct : 0;
+		int bottom 	= destination->clip ? destination->cb : destination->h;
+		if ((y < top) || (y >= bottom))
+		{
+			return true;
+		}
+		
+		PixelGradientSpan clipped = span;
+		if (x < left)
+		{
+			clipped = AdvanceGradientSpan(span, left - x);
+			count -= left - x;
+			x = left;
+		}
+		if (x + count > right)
+		{
+			count = right - x;
+		}
+		if (count <= 0)
+		{
+			return true;
+		}
+		
+		const PixelKernelTable& kernels = GetKernels();
+		if (32 == colorDepth)
+		{
+			kernels.GradientSpan32(reinterpret_cast<unsigned int*>(destination->line[y]) + x, count, clipped);
+		}
+		else
+		{
+			kernels.GradientSpan16(reinterpret_cast<unsigned short*>(destination->line[y]) + x, count, clipped);
+		}
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::BlendSprite(BITMAP* destination, BITMAP* source, int destX, int destY, int alpha)
+	{
+		return BlendBlit(source, destination, 0, 0, destX, destY, source->w, source->h, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::BlendBlit(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height, int alpha)
+	{
+		if (!CanBlendBlit(source, destination))
+		{
+			return false;
+		}
+		
+		if (!ClipInternal(source, destination, srcX, srcY, destX, destY, width, height))
+		{
+			return true;
+		}
+		
+		int colorDepth = bitmap_color_depth(destination);
+		alpha = (alpha < 0) ? 0 : ((alpha > 255) ? 255 : alpha);
+		
+		const PixelKernelTable& kernels = GetKernels();
+		for (int row = 0; row < height; row++)
+		{
+			if (32 == colorDepth)
+			{
+				kernels.BlendSpan32(
+					reinterpret_cast<unsigned int*>(destination->line[destY + row]) + destX,
+					reinterpret_cast<const unsigned int*>(source->line[srcY + row]) + srcX,
+					width, alpha);
+			}
+			else
+			{
+				kernels.BlendSpan16(
+					reinterpret_cast<unsigned short*>(destination->line[destY + row]) + destX,
+					reinterpret_cast<const unsigned short*>(source->line[srcY + row]) + srcX,
+					width, alpha);
+			}
+		}
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::AlphaBlendSprite(BITMAP* destination, BITMAP* source, int destX, int destY)
+	{
+		return AlphaBlendBlit(source, destination, 0, 0, destX, destY, source->w, source->h);
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::AlphaBlendBlit(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height)
+	{
+		if (!CanAlphaBlendBlit(source, destination))
+		{
+			return false;
+		}
+		
+		int colorDepth = bitmap_color_depth(destination);
+		
+		if (!ClipInternal(source, destination, srcX, srcY, destX, destY, width, height))
+		{
+			return true;
+		}
+		
+		const PixelKernelTable& kernels = GetKernels();
+		for (int row = 0; row < height; row++)
+		{
+			const unsigned int* sourceRow = reinterpret_cast<const unsigned int*>(source->line[srcY + row]) + srcX;
+			if (32 == colorDepth)
+			{
+				kernels.AlphaBlendSpan32(reinterpret_cast<unsigned int*>(destination->line[destY + row]) + destX, sourceRow, width);
+			}
+			else
+			{
+				kernels.AlphaBlendSpan16(reinterpret_cast<unsigned short*>(destination->line[destY + row]) + destX, sourceRow, width);
+			}
+		}
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::MaskedBlit(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height)
+	{
+		int colorDepth = bitmap_color_depth(destination);
+		if (!is_memory_bitmap(destination) || !is_memory_bitmap(source) ||
+			(bitmap_color_depth(source) != colorDepth) || ((16 != colorDepth) && (32 != colorDepth)))
+		{
+			return false;
+		}
+		
+		if (!ClipInternal(source, destination, srcX, srcY, destX, destY, width, height))
+		{
+			return true;
+		}
+		
+		const PixelKernelTable& kernels = GetKernels();
+		for (int row = 0; row < height; row++)
+		{
+			if (32 == colorDepth)
+			{
+				kernels.MaskedCopySpan32(
+					reinterpret_cast<unsigned int*>(destination->line[destY + row]) + destX,
+					reinterpret_cast<const unsigned int*>(source->line[srcY + row]) + srcX,
+					width);
+			}
+			else
+			{
+				kernels.MaskedCopySpan16(
+					reinterpret_cast<unsigned short*>(destination->line[destY + row]) + destX,
+					reinterpret_cast<const unsigned short*>(source->line[srcY + row]) + srcX,
+					width);
+			}
+		}
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::CanBlendBlit(BITMAP* source, BITMAP* destination)
+	{
+		int colorDepth = bitmap_color_depth(destination);
+		return is_memory_bitmap(destination) && is_memory_bitmap(source) &&
+			(bitmap_color_depth(source) == colorDepth) && HasStandardLayout(colorDepth);
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::CanAlphaBlendBlit(BITMAP* source, BITMAP* destination)
+	{
+		return is_memory_bitmap(destination) && is_memory_bitmap(source) &&
+			(32 == bitmap_color_depth(source)) && HasStandardLayout(32) && HasStandardLayout(bitmap_color_depth(destination));
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \struct PixelBenchmarkSurfaces
+	 * \brief the bitmaps that the benchmark draws with
+	 */
+	struct PixelBenchmarkSurfaces
+	{
+		//! the sprite that is drawn, with some mask colored pixels
+		BITMAP* source;
+		//! a 32 bit sprite with random alpha, for the alpha blender
+		BITMAP* alphaSource;
+		//! what is under the sprite; it is copied into the other bitmaps before each round
+		BITMAP* background;
+		//! drawn by Allegro
+		BITMAP* expected;
+		//! drawn by the kernels
+		BITMAP* actual;
+	};
+	
+	/**************************************************************************/
+	
+	/**
+	 * the operations that the benchmark times
+	 */
+	enum PixelBenchmarkOperation
+	{
+		PixelBenchmark_Gradient,
+		PixelBenchmark_Blend,
+		PixelBenchmark_AlphaBlend,
+		PixelBenchmark_MaskedCopy,
+		PixelBenchmark_Count
+	};
+	
+	/**************************************************************************/
+	
+	/**
+	 * the gradient that the benchmark draws on each row; the colors of the corners of a 640 pixel wide gradient
+	 */
+	static PixelGradientSpan MakeBenchmarkGradient(int row)
+	{
+		PixelGradientSpan span;
+		span.red 		= (row * 255 / 480) << 16;
+		span.green 		= 32 << 16;
+		span.blue 		= 255 << 16;
+		span.redStep 	= ((255 << 16) - span.red) / 640;
+		span.greenStep 	= (200 << 16) / 640;
+		span.blueStep 	= -(255 << 16) / 640;
+		return span;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Draws an operation once with Allegro into surfaces.expected, or with the kernels into surfaces.actual
+	 */
+	static void DrawBenchmarkOperation(PixelBenchmarkOperation operation, PixelBenchmarkSurfaces& surfaces, bool useKernels)
+	{
+		BITMAP* target = useKernels ? surfaces.actual : surfaces.expected;
+		switch(operation)
+		{
+			case PixelBenchmark_Gradient:
+			{
+				int colorDepth = bitmap_color_depth(target);
+				for (int y = 0; y < target->h; y++)
+				{
+					PixelGradientSpan span = MakeBenchmarkGradient(y);
+					if (useKernels)
+					{
+						PixelKernels->GradientSpan(target, 0, y, target->w, span);
+						continue;
+					}
+					
+					// the way that ImageResource::GradientRect() used to draw, a pixel at a time
+					for (int x = 0; x < target->w; x++)
+					{
+						putpixel(target, x, y, makecol_depth(colorDepth, span.red >> 16, span.green >> 16, span.blue >> 16));
+						span.red 	+= span.redStep;
+						span.green 	+= span.greenStep;
+						span.blue 	+= span.blueStep;
+					}
+				}
+			} break;
+			
+			case PixelBenchmark_Blend:
+			{
+				if (!useKernels || !PixelKernels->BlendSprite(target, surfaces.source, 0, 0, 128))
+				{
+					set_trans_blender(0, 0, 0, 128);
+					draw_trans_sprite(target, surfaces.source, 0, 0);
+				}
+			} break;
+			
+			case PixelBenchmark_AlphaBlend:
+			{
+				if (!useKernels || !PixelKernels->AlphaBlendSprite(target, surfaces.alphaSource, 0, 0))
+				{
+					set_alpha_blender();
+					draw_trans_sprite(target, surfaces.alphaSource, 0, 0);
+					set_trans_blender(0, 0, 0, 255);
+				}
+			} break;
+			
+			case PixelBenchmark_MaskedCopy:
+			{
+				if (!useKernels || !PixelKernels->MaskedBlit(surfaces.source, target, 0, 0, 0, 0, target->w, target->h))
+				{
+					masked_blit(surfaces.source, target, 0, 0, 0, 0, target->w, target->h);
+				}
+			} break;
+			
+			default: break;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Draws an operation a number of times, starting from the background each time
+	 * \return the time that the drawing took, in milliseconds per round
+	 */
+	static double TimeBenchmarkOperation(PixelBenchmarkOperation operation, PixelBenchmarkSurfaces& surfaces, bool useKernels, int rounds)
+	{
+		BITMAP* target = useKernels ? surfaces.actual : surfaces.expected;
+		GameTimerTicks total = 0;
+		for (int round = 0; round < rounds; round++)
+		{
+			blit(surfaces.background, target, 0, 0, 0, 0, target->w, target->h);
+			
+			GameTimerTicks start = GameTimer->GetTicks();
+			DrawBenchmarkOperation(operation, surfaces, useKernels);
+			total += GameTimer->GetTicks() - start;
+		}
+		return static_cast<double>(total) / static_cast<double>(GAMETIMER_TICKS_PER_MILLISECOND) / rounds;
+	}
+	
+	/**************************************************************************/
+	
+	void PixelKernelsSingleton::RunBenchmark()
+	{
+		const int width = 640;
+		const int height = 480;
+		const int rounds = 20;
+		const char* operationNames[PixelBenchmark_Count] = { "gradient", "blend", "alpha blend", "masked copy" };
+		
+		PixelKernelSet selectedSet = kernelSet_;
+		
+		LogMessage("Pixel kernel benchmark: %d rounds on %dx%d bitmaps, in milliseconds per round", rounds, width, height);
+		
+		const int colorDepths[2] = { 32, 16 };
+		for (int depthIndex = 0; depthIndex < 2; depthIndex++)
+		{
+			int colorDepth = colorDepths[depthIndex];
+			
+			PixelBenchmarkSurfaces surfaces;
+			surfaces.source 		= create_bitmap_ex(colorDepth, width, height);
+			surfaces.alphaSource 	= create_bitmap_ex(32, width, height);
+			surfaces.background 	= create_bitmap_ex(colorDepth, width, height);
+			surfaces.expected 		= create_bitmap_ex(colorDepth, width, height);
+			surfaces.actual 		= create_bitmap_ex(colorDepth, width, height);
+			if ((0 == surfaces.source) || (0 == surfaces.alphaSource) || (0 == surfaces.background) || (0 == surfaces.expected) || (0 == surfaces.actual))
+			{
+				LogError("Could not create the %d bit benchmark bitmaps!", colorDepth);
+			}
+			else
+			{
+				// random pixels, with one in eight of the sprite pixels being the mask color
+				srand(101);
+				for (int y = 0; y < height; y++)
+				{
+					for (int x = 0; x < width; x++)
+					{
+						bool masked = (0 == rand() % 8);
+						putpixel(surfaces.source, x, y, masked ?
+							bitmap_mask_color(surfaces.source) :
+							makecol_depth(colorDepth, rand() & 0xFF, rand() & 0xFF, rand() & 0xFF));
+						putpixel(surfaces.alphaSource, x, y, masked ?
+							MASK_COLOR_32 :
+							makeacol32(rand() & 0xFF, rand() & 0xFF, rand() & 0xFF, rand() & 0xFF));
+						putpixel(surfaces.background, x, y, makecol_depth(colorDepth, rand() & 0xFF, rand() & 0xFF, rand() & 0xFF));
+					}
+				}
+				
+				for (int operation = 0; operation < PixelBenchmark_Count; operation++)
+				{
+					PixelBenchmarkOperation benchmarkOperation = static_cast<PixelBenchmarkOperation>(operation);
+					double allegroTime = TimeBenchmarkOperation(benchmarkOperation, surfaces, false, rounds);
+					
+					for (int kernelSet = 0; kernelSet < PixelKernels_Count; kernelSet++)
+					{
+						if (!SelectKernelSet(static_cast<PixelKernelSet>(kernelSet)))
+						{
+							continue;
+						}
+						
+						double kernelTime = TimeBenchmarkOperation(benchmarkOperation, surfaces, true, rounds);
+						
+						// the last round of each is compared
+						bool same = true;
+						int bytesPerRow = width * (colorDepth / 8);
+						for (int y = 0; same && (y < height); y++)
+						{
+							same = (0 == memcmp(surfaces.expected->line[y], surfaces.actual->line[y], bytesPerRow));
+						}
+						
+						LogMessage("%2d bit %-12s Allegro %8.3f  %-6s %8.3f  %5.1fx faster  %s",
+							colorDepth,
+							operationNames[operation],
+							allegroTime,
+							GetKernels().name,
+							kernelTime,
+							(kernelTime > 0.0) ? allegroTime / kernelTime : 0.0,
+							same ? "same pixels" : "DIFFERENT PIXELS");
+					}
+				}
+			}
+			
+			destroy_bitmap(surfaces.source);
+			destroy_bitmap(surfaces.alphaSource);
+			destroy_bitmap(surfaces.background);
+			destroy_bitmap(surfaces.expected);
+			destroy_bitmap(surfaces.actual);
+		}
+		
+		kernelSet_ = selectedSet;
+	}
+	
+	/**************************************************************************/
+	
+	bool PixelKernelsSingleton::ClipInternal(
+		BITMAP* source,
+		BITMAP* destination,
+		int& srcX, int& srcY,
+		int& destX, int& destY,
+		int& width, int& height)
+	{
+		// clip to the source bitmap
+		if (srcX < 0)
+		{
+			width += srcX;
+			destX -= srcX;
+			srcX = 0;
+		}
+		if (srcY < 0)
+		{
+			height += srcY;
+			destY -= srcY;
+			srcY = 0;
+		}
+		if (srcX + width > source->w)
+		{
+			width = source->w - srcX;
+		}
+		if (srcY + height > source->h)
+		{
+			height = source->h - srcY;
+		}
+		
+		// clip to the clipping rectangle of the destination; its right and bottom edges are outside of it
+		int left 	= destination->clip ? destination->cl : 0;
+		int right 	= destination->clip ? destination->cr : destination->w;
+		int top 	= destination->clip ? destination->ct : 0;
+		int bottom 	= destination->clip ? destination->cb : destination->h;
+		if (destX < left)
+		{
+			width -= left - destX;
+			srcX += left - destX;
+			destX = left;
+		}
+		if (destY < top)
+		{
+			height -= top - destY;
+			srcY += top - destY;
+			destY = top;
+		}
+		if (destX + width > right)
+		{
+			width = right - destX;
+		}
+		if (destY + height > bottom)
+		{
+			height = bottom - destY;
+		}
+		
+		return (width > 0) && (height > 0);
+	}
+	
+	/**************************************************************************/
+	
+	PixelKernelsSingleton::PixelKernelsSingleton() :
+		kernelSet_(PixelKernels_Scalar)
+	{
+		// implement class constructor here
+		supported_[PixelKernels_Scalar] = true;
+		supported_[PixelKernels_SSE2] = false;
+		supported_[PixelKernels_AVX2] = false;
+
+// only x86 processors have the SSE2 and AVX2 kernels
+#if defined(PIXEL_KERNELS_X86)
+		__builtin_cpu_init();
+		supported_[PixelKernels_SSE2] = (0 != __builtin_cpu_supports("sse2"));
+		supported_[PixelKernels_AVX2] = (0 != __builtin_cpu_supports("avx2"));
+#endif
+
+		// use the widest kernels that the processor can run
+		for (int kernelSet = PixelKernels_Count - 1; kernelSet >= 0; kernelSet--)
+		{
+			if (supported_[kernelSet])
+			{
+				kernelSet_ = static_cast<PixelKernelSet>(kernelSet);
+				break;
+			}
+		}
+		
+		LogMessage("Using the %s pixel kernels", GetKernels(kernelSet_).name);
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	PixelKernelsSingleton::~PixelKernelsSingleton()
+	{
+		// implement class destructor here
+	} // end destructor
+
+} // end namespace
+
+
@@ -0,0 +1,406 @@
+
+// CODESTYLE: v2.0
+
+// Profiler.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Measures where the time of each frame goes, using named zones
+
+/**
+ * \file Profiler.cpp
+ * \brief Frame Profiling Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// include Allegro
+#include <allegro.h>
+
+// include the complementing header
+#include "Profiler.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the bitmap font header
+#include "BitmapFont.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	//! the height of the frame time graph in pixels
+	const int PROFILER_GRAPH_HEIGHT = 60;
+	
+	//! the frame time in milliseconds at the top of the frame time graph
+	const float PROFILER_GRAPH_MAX_MS = 50.0f;
+	
+	//! the frame time in milliseconds that the target line of the frame time graph is drawn at
+	const float PROFILER_GRAPH_TARGET_MS = 1000.0f / 60.0f;
+	
+	//! the number of letters in a line of the overlay
+	const int PROFILER_OVERLAY_COLUMNS = 64;
+	
+	/**************************************************************************/
+	
+	ProfilerSingleton* ProfilerSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static ProfilerSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	ProfilerSingleton::ProfilerSingleton() :
+		frameStartTime_(0),
+		historyIndex_(0),
+		historyCount_(0),
+		enabled_(false),
+		overlayVisible_(false),
+		overlayFont_(0),
+		defaultFont_(0)
+	{
+		memset(frameHistory_, 0, sizeof(frameHistory_));
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	ProfilerSingleton::~ProfilerSingleton()
+	{
+		if (0 != defaultFont_)
+		{
+			delete defaultFont_;
+			defaultFont_ = 0;
+		}
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::SetEnabled(bool enabled)
+	{
+		if (enabled && !enabled_)
+		{
+			// start from a clean frame, so the first frame is not charged for the time spent disabled
+			frameStartTime_ = GameTimer->GetTicks();
+		}
+		enabled_ = enabled;
+	}
+	
+	/**************************************************************************/
+	
+	bool ProfilerSingleton::IsEnabled()
+	{
+		return enabled_;
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::SetOverlayVisible(bool visible)
+	{
+		overlayVisible_ = visible;
+		if (visible)
+		{
+			SetEnabled(true);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool ProfilerSingleton::IsOverlayVisible()
+	{
+		return overlayVisible_;
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::SetOverlayFont(BitmapFont* font)
+	{
+		overlayFont_ = font;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ProfilerSingleton::RegisterZone(const char* zoneName)
+	{
+		MutexLock lock(zonesMutex_);
+		
+		for (unsigned int index = 0; index < zones_.size(); index++)
+		{
+			if ((zones_[index].name == zoneName) || (0 == strcmp(zones_[index].name, zoneName)))
+			{
+				return index;
+			}
+		}
+		
+		ProfilerZoneRecord zone;
+		memset(&zone, 0, sizeof(zone));
+		zone.name = zoneName;
+		zones_.push_back(zone);
+		
+		return static_cast<unsigned int>(zones_.size() - 1);
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::AddZoneTime(unsigned int zoneID, GameTimerTicks ticks)
+	{
+		MutexLock lock(zonesMutex_);
+		
+		if (zoneID < zones_.size())
+		{
+			zones_[zoneID].currentTicks += ticks;
+			zones_[zoneID].currentCalls++;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::BeginFrame()
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		
+		GameTimerTicks now = GameTimer->GetTicks();
+		
+		frameHistory_[historyIndex_] = now - frameStartTime_;
+		frameStartTime_ = now;
+		
+		MutexLock lock(zonesMutex_);
+		for (unsigned int index = 0; index < zones_.size(); index++)
+		{
+			ProfilerZoneRecord& zone = zones_[index];
+			zone.history[historyIndex_] = zone.currentTicks;
+			zone.lastCalls 		= zone.currentCalls;
+			zone.currentTicks 	= 0;
+			zone.currentCalls 	= 0;
+		}
+		
+		historyIndex_ = (historyIndex_ + 1) % PROFILER_HISTORY_FRAMES;
+		if (historyCount_ < PROFILER_HISTORY_FRAMES)
+		{
+			historyCount_++;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int ProfilerSingleton::GetZoneCount()
+	{
+		MutexLock lock(zonesMutex_);
+		return static_cast<unsigned int>(zones_.size());
+	}
+	
+	/**************************************************************************/
+	
+	const char* ProfilerSingleton::GetZoneName(unsigned int zoneID)
+	{
+		MutexLock lock(zonesMutex_);
+		return (zoneID < zones_.size()) ? zones_[zoneID].name : 0;
+	}
+	
+	/**************************************************************************/
+	
+	bool ProfilerSingleton::GetZoneStats(unsigned int zoneID, ProfilerStats& stats)
+	{
+		MutexLock lock(zonesMutex_);
+		if (zoneID >= zones_.size())
+		{
+			return false;
+		}
+		
+		CalculateStats(zones_[zoneID].history, stats);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::GetFrameStats(ProfilerStats& stats)
+	{
+		CalculateStats(frameHistory_, stats);
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::CalculateStats(GameTimerTicks* history, ProfilerStats& stats)
+	{
+		stats.last 		= 0.0f;
+		stats.minimum 	= 0.0f;
+		stats.average 	= 0.0f;
+		stats.maximum 	= 0.0f;
+		
+		if (0 == historyCount_)
+		{
+			return;
+		}
+		
+		GameTimerTicks minimum 	= history[0];
+		GameTimerTicks maximum 	= history[0];
+		GameTimerTicks total 	= 0;
+		
+		for (unsigned int index = 0; index < historyCount_; index++)
+		{
+			GameTimerTicks ticks = history[index];
+			minimum = (ticks < minimum) ? ticks : minimum;
+			maximum = (ticks > maximum) ? ticks : maximum;
+			total += ticks;
+		}
+		
+		unsigned int lastIndex = (historyIndex_ + PROFILER_HISTORY_FRAMES - 1) % PROFILER_HISTORY_FRAMES;
+		float ticksPerMillisecond = static_cast<float>(GAMETIMER_TICKS_PER_MILLISECOND);
+		
+		stats.last 		= static_cast<float>(history[lastIndex]) / ticksPerMillisecond;
+		stats.minimum 	= static_cast<float>(minimum) / ticksPerMillisecond;
+		stats.maximum 	= static_cast<float>(maximum) / ticksPerMillisecond;
+		stats.average 	= (static_cast<float>(total) / static_cast<float>(historyCount_)) / ticksPerMillisecond;
+	}
+	
+	/**************************************************************************/
+	
+	void ProfilerSingleton::DrawOverlay(ImageResource* target, int x, int y)
+	{
+		if (0 == target)
+		{
+			return;
+		}
+		
+		BitmapFont* font = overlayFont_;
+		if (0 == font)
+		{
+			if (0 == defaultFont_)
+			{
+				defaultFont_ = new BitmapFont();
+			}
+			font = defaultFont_;
+		}
+		
+		// a zone may be registered by another thread while the overlay is drawn
+		MutexLock lock(zonesMutex_);
+		
+		int lineHeight 	= font->GetLetterHeight() + font->GetLetterSpacing();
+		int textWidth 	= PROFILER_OVERLAY_COLUMNS * (font->GetLetterWidth() + font->GetLetterSpacing());
+		int graphWidth 	= static_cast<int>(PROFILER_HISTORY_FRAMES);
+		int width 		= ((textWidth > graphWidth) ? textWidth : graphWidth) + 8;
+		int height 		= (lineHeight * (2 + static_cast<int>(zones_.size()))) + PROFILER_GRAPH_HEIGHT + 12;
+		
+		target->Rect(x, y, x + width - 1, y + height - 1, makecol(0, 0, 0), true);
+		target->Rect(x, y, x + width - 1, y + height - 1, makecol(96, 96, 96));
+		
+		ProfilerStats stats;
+		GetFrameStats(stats);
+		
+		int cursorX = x + 4;
+		int cursorY = y + 4;
+		
+		font->Print(target, cursorX, cursorY, "%-28s %7s %7s %7s %7s", "frame (ms)", "last", "min", "avg", "max");
+		cursorY += lineHeight;
+		
+		font->Print(target, cursorX, cursorY, "%-28.28s %7.2f %7.2f %7.2f %7.2f", 
+			"frame", stats.last, stats.minimum, stats.average, stats.maximum);
+		cursorY += lineHeight;
+		
+		for (unsigned int index = 0; index < zones_.size(); index++)
+		{
+			CalculateStats(zones_[index].history, stats);
+			font->Print(target, cursorX, cursorY, "%-28.28s %7.2f %7.2f %7.2f %7.2f x%u", 
+				zones_[index].name, stats.last, stats.minimum, stats.average, stats.maximum, zones_[index].lastCalls);
+			cursorY += lineHeight;
+		}
+		
+		// draw the frame time graph from the oldest frame on the left to the newest frame on the right
+		int graphBottom 	= cursorY + 4 + PROFILER_GRAPH_HEIGHT - 1;
+		float pixelsPerMs 	= static_cast<float>(PROFILER_GRAPH_HEIGHT) / PROFILER_GRAPH_MAX_MS;
+		int barColor 		= makecol(0, 192, 0);
+		int slowBarColor 	= makecol(224, 0, 0);
+		
+		for (unsigned int frame = 0; frame < historyCount_; frame++)
+		{
+			unsigned int historyIndex = 
+				(historyIndex_ + PROFILER_HISTORY_FRAMES - historyCount_ + frame) % PROFILER_HISTORY_FRAMES;
+			float frameMs = static_cast<float>(frameHistory_[historyIndex]) / static_cast<float>(GAMETIMER_TICKS_PER_MILLISECOND);
+			
+			int barHeight = static_cast<int>(frameMs * pixelsPerMs);
+			barHeight = (barHeight > PROFILER_GRAPH_HEIGHT) ? PROFILER_GRAPH_HEIGHT : barHeight;
+			
+			if (barHeight > 0)
+			{
+				target->Line(cursorX + frame, graphBottom, cursorX + frame, graphBottom - barHeight + 1, 
+					(frameMs > PROFILER_GRAPH_TARGET_MS) ? slowBarColor : barColor);
+			}
+		}
+		
+		int targetY = graphBottom - static_cast<int>(PROFILER_GRAPH_TARGET_MS * pixelsPerMs);
+		target->Line(cursorX, targetY, cursorX + graphWidth - 1, targetY, makecol(192, 192, 0));
+	}
+	
+	/**************************************************************************/
+	
+	ProfileZone::ProfileZone(const char* zoneName) :
+		zoneID_(0),
+		startTime_(-1),
+		traceName_(0)
+	{
+		if (Profiler->IsEnabled())
+		{
+			zoneID_ = Profiler->RegisterZone(zoneName);
+			startTime_ = GameTimer->GetTicks();
+		}
+		
+		if (TraceCapture->IsCapturing())
+		{
+			traceName_ = zoneName;
+			TraceCapture->BeginEvent(traceName_, "engine");
+		}
+	}
+	
+	/**************************************************************************/
+	
+	ProfileZone::ProfileZone(unsigned int zoneID) :
+		zoneID_(zoneID),
+		startTime_(-1),
+		traceName_(0)
+	{
+		if (Profiler->IsEnabled())
+		{
+			startTime_ = GameTimer->GetTicks();
+		}
+		
+		if (TraceCapture->IsCapturing())
+		{
+			traceName_ = Profiler->GetZoneName(zoneID_);
+			if (0 != traceName_)
+			{
+				TraceCapture->BeginEvent(traceName_, "engine");
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	ProfileZone::~ProfileZone()
+	{
+		if (startTime_ >= 0)
+		{
+			Profiler->AddZoneTime(zoneID_, GameTimer->GetTicks() - startTime_);
+		}
+		
+		if (0 != traceName_)
+		{
+			TraceCapture->EndEvent(traceName_, "engine");
+		}
+	}
+
+} // end namespace
+
+
+
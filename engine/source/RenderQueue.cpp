@@ -0,0 +1,955 @@
+// CODESTYLE: v2.0
+
+// RenderQueue.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Records the drawing of a frame, so that a render thread can draw it while the next frame is updated
+
+/**
+ * \file RenderQueue.cpp
+ * \brief Render Queue Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// include Allegro
+#include <allegro.h>
+
+// include the complementing header
+#include "RenderQueue.h"
+
+// include the graphics device header
+#include "GraphicsDevice.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the pixel kernels header
+#include "PixelKernels.h"
+
+// include the tileset header
+#include "Tileset.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the job system header
+#include "JobSystem.h"
+
+// include the dirty rectangle list header
+#include "DirtyRectList.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	/**
+	 * draws a pixel of a line; putpixel() keeps the line inside of the clipping rectangle of its band
+	 */
+	static void PutBandPixel(BITMAP* bitmap, int x, int y, int color)
+	{
+		putpixel(bitmap, x, y, color);
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * marks the part of \a target that a command drew on as dirty, the same way that drawing it straight away would have
+	 */
+	static void MarkCommandDirty(const RenderCommand& command, ImageResource* target, int clipX1, int clipY1, int clipX2, int clipY2)
+	{
+		switch(command.type)
+		{
+			case RenderCommand_Sprite:
+			{
+				SpriteDrawCommand sprite = command.sprite;
+				sprite.destination = target;
+				if (SpriteBatchSingleton::ClipSprite(sprite, clipX1, clipY1, clipX2, clipY2))
+				{
+					target->MarkDirty(sprite.destX, sprite.destY, sprite.width, sprite.height);
+				}
+			} break;
+			
+			case RenderCommand_Rect:
+			case RenderCommand_Line:
+			{
+				const RenderShapeCommand& shape = command.shape;
+				target->MarkDirty(
+					(shape.x1 < shape.x2) ? shape.x1 : shape.x2, (shape.y1 < shape.y2) ? shape.y1 : shape.y2, 
+					1 + ((shape.x1 < shape.x2) ? shape.x2 - shape.x1 : shape.x1 - shape.x2), 
+					1 + ((shape.y1 < shape.y2) ? shape.y2 - shape.y1 : shape.y1 - shape.y2));
+			} break;
+			
+			case RenderCommand_TileMap:
+			{
+				const TileMapView& view = command.tileMap.view;
+				target->MarkDirty(view.viewportX, view.viewportY, view.viewportWidth, view.viewportHeight);
+			} break;
+			
+			default: break;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * draws a frame around the target from the band test, so that the test has a callback between two runs of bands
+	 */
+	static void DrawBandTestFrame(ImageResource* target, void* /* data */)
+	{
+		target->Rect(6, 6, target->GetWidth() - 7, target->GetHeight() - 7, makecol(255, 255, 0));
+	}
+	
+	/**************************************************************************/
+	
+	RenderQueueSingleton* RenderQueueSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static RenderQueueSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::BeginScene(int color)
+	{
+		RenderCommandBuffer& buffer = buffers_[recordIndex_];
+		buffer.sceneBegun = true;
+		buffer.clearColor = color;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::DrawSprite(ImageResource* source, int destX, int destY, SpriteBlendMode blendMode, float alpha)
+	{
+		if (0 == source)
+		{
+			LogError("Cannot draw a sprite without a source image!");
+			return;
+		}
+		DrawSprite(source, 0, 0, source->GetWidth(), source->GetHeight(), destX, destY, blendMode, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::DrawSprite(
+		ImageResource* source,
+		int srcX, int srcY,
+		int width, int height,
+		int destX, int destY,
+		SpriteBlendMode blendMode,
+		float alpha)
+	{
+		if (0 == source)
+		{
+			LogError("Cannot draw a sprite without a source image!");
+			return;
+		}
+		
+		int alphaValue = static_cast<int>(255 * alpha);
+		
+		RenderCommand command;
+		command.type 					= RenderCommand_Sprite;
+		command.sprite.source 			= source;
+		command.sprite.destination 		= 0;
+		command.sprite.srcX 			= srcX;
+		command.sprite.srcY 			= srcY;
+		command.sprite.width 			= width;
+		command.sprite.height 			= height;
+		command.sprite.destX 			= destX;
+		command.sprite.destY 			= destY;
+		command.sprite.layer 			= 0;
+		command.sprite.blendMode 		= blendMode;
+		command.sprite.alpha 			= (alphaValue < 0) ? 0 : ((alphaValue > 255) ? 255 : alphaValue);
+		command.sprite.order 			= 0;
+		command.sprite.group 			= 0;
+		buffers_[recordIndex_].commands.push_back(command);
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::DrawRect(int x1, int y1, int x2, int y2, int color, bool filled)
+	{
+		RenderCommand command;
+		command.type 			= RenderCommand_Rect;
+		command.shape.x1 		= x1;
+		command.shape.y1 		= y1;
+		command.shape.x2 		= x2;
+		command.shape.y2 		= y2;
+		command.shape.color 	= color;
+		command.shape.filled 	= filled;
+		buffers_[recordIndex_].commands.push_back(command);
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::DrawLine(int x1, int y1, int x2, int y2, int color)
+	{
+		RenderCommand command;
+		command.type 			= RenderCommand_Line;
+		command.shape.x1 		= x1;
+		command.shape.y1 		= y1;
+		command.shape.x2 		= x2;
+		command.shape.y2 		= y2;
+		command.shape.color 	= color;
+		command.shape.filled 	= false;
+		buffers_[recordIndex_].commands.push_back(command);
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::DrawTileMap(TileMapRenderer* renderer)
+	{
+		if (0 == renderer)
+		{
+			LogError("Cannot draw a tilemap without a renderer!");
+			return;
+		}
+		
+		RenderCommandBuffer& buffer = buffers_[recordIndex_];
+		
+		RenderCommand command;
+		command.type 				= RenderCommand_TileMap;
+		command.tileMap.renderer 	= renderer;
+		command.tileMap.view 		= renderer->GetView();
+		command.tileMap.firstValue 	= static_cast<unsigned int>(buffer.tileValues.size());
+		
+		// the tiles are copied now, because the main thread may change the tilemap while the render thread draws it
+		TileMapViewTiles tiles;
+		if (!renderer->CopyViewTiles(command.tileMap.view, buffer.tileValues, tiles))
+		{
+			// nothing is visible
+			return;
+		}
+		command.tileMap.firstColumn = tiles.firstColumn;
+		command.tileMap.firstRow 	= tiles.firstRow;
+		command.tileMap.columnCount = tiles.columnCount;
+		command.tileMap.rowCount 	= tiles.rowCount;
+		buffer.commands.push_back(command);
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::Call(RenderCallback function, void* data)
+	{
+		if (0 == function)
+		{
+			return;
+		}
+		
+		RenderCommand command;
+		command.type 			= RenderCommand_Call;
+		command.call.function 	= function;
+		command.call.data 		= data;
+		buffers_[recordIndex_].commands.push_back(command);
+		buffers_[recordIndex_].hasCalls = true;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::SubmitFrame()
+	{
+		RenderCommandBuffer& recorded = buffers_[recordIndex_];
+		
+		// the state drew for itself
+		if (!recorded.sceneBegun)
+		{
+			recorded.commands.clear();
+			return;
+		}
+		
+		if (!thread_.IsRunning())
+		{
+			ExecuteInternal(recorded);
+			return;
+		}
+		
+		// the render thread is done with the other buffer once it has drawn the frame before this one
+		Flush();
+		
+		// read before the render thread gets the buffer, since it empties the buffer when it is done
+		bool hasCalls = recorded.hasCalls;
+		
+		executeIndex_ = recordIndex_;
+		recordIndex_ = 1 - recordIndex_;
+		frameInFlight_ = true;
+		frameReady_.Signal();
+		
+		// a callback reads whatever it likes, so the next frame is not updated until it has been called
+		if (hasCalls)
+		{
+			static bool reported = false;
+			if (!reported)
+			{
+				reported = true;
+				LogMessage("A frame with a RenderQueue callback is drawn before the next frame is updated. "
+					"Record the drawing itself, such as by overriding SceneLayer::QueueRender(), to draw while the next frame is updated.");
+			}
+			Flush();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::Flush()
+	{
+		if (frameInFlight_)
+		{
+			TraceZone traceZone("RenderQueue::Flush");
+			frameDone_.Wait();
+			frameInFlight_ = false;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool RenderQueueSingleton::StartThread()
+	{
+		if (thread_.IsRunning())
+		{
+			return true;
+		}
+		
+		stopping_ = false;
+		if (!thread_.Start(RenderQueueSingleton::RenderThreadInternal, this))
+		{
+			LogError("Could not start the render thread!");
+			return false;
+		}
+		
+		LogMessage("Rendering on a separate thread.");
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::StopThread()
+	{
+		if (!thread_.IsRunning())
+		{
+			return;
+		}
+		
+		Flush();
+		
+		stopping_ = true;
+		frameReady_.Signal();
+		thread_.Join();
+	}
+	
+	/**************************************************************************/
+	
+	bool RenderQueueSingleton::IsThreaded()
+	{
+		return thread_.IsRunning();
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::SetBandCount(int bandCount)
+	{
+		bandCount = (bandCount < 1) ? 1 : ((bandCount > RENDER_QUEUE_MAX_BANDS) ? RENDER_QUEUE_MAX_BANDS : bandCount);
+		
+		// the render thread may be drawing bands right now
+		Flush();
+		
+		DestroyBandsInternal();
+		
+		bandCount_ = bandCount;
+		
+		// the bands are drawn by the threads of the job system
+		if (bandCount_ > 1)
+		{
+			int threadCount = JobSystem->GetThreadCount();
+			LogMessage("Rendering in %d bands on %d threads.", bandCount_, (bandCount_ < threadCount) ? bandCount_ : threadCount);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	int RenderQueueSingleton::GetBandCount()
+	{
+		return bandCount_;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::SetBandVerification(bool enabled)
+	{
+		Flush();
+		verifyBands_ = enabled;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::ReportBandVerification()
+	{
+		if (framesVerified_ > 0)
+		{
+			LogMessage("Compared %u frames drawn in bands with the same frames drawn in one band; %u of them were different.", 
+				framesVerified_, framesDiffered_);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool RenderQueueSingleton::RunBandTest()
+	{
+		const int width = 320;
+		const int height = 240;
+		const int tileSize = 16;
+		const int tileCount = 4;
+		const int bandCounts[] = { 2, 3, 7, 16, RENDER_QUEUE_MAX_BANDS };
+		const int bandCountCount = static_cast<int>(sizeof(bandCounts) / sizeof(bandCounts[0]));
+		
+		if (thread_.IsRunning())
+		{
+			LogError("The band test cannot run while the render thread is drawing!");
+			return false;
+		}
+		
+		srand(101);
+		
+		// tiles with a diagonal through them, so that a tile drawn one pixel off shows up
+		Tileset* tileSet = new Tileset();
+		for (int tile = 0; tile < tileCount; tile++)
+		{
+			ImageResource* image = new ImageResource(tileSize, tileSize, makecol(rand() & 0xFF, rand() & 0xFF, rand() & 0xFF));
+			image->Line(0, 0, tileSize - 1, tileSize - 1, makecol(255, 255, 255));
+			
+			char tileName[16];
+			snprintf(tileName, 16, "tile%d", tile);
+			tileSet->Add(tileName, image);
+		}
+		
+		TileMap* tileMap = new TileMap(64, 64);
+		for (int y = 0; y < tileMap->GetHeight(); y++)
+		{
+			for (int x = 0; x < tileMap->GetWidth(); x++)
+			{
+				tileMap->SetValue(x, y, rand() % tileCount);
+			}
+		}
+		
+		// the camera is not on a tile boundary, so every edge of the viewport cuts through tiles
+		TileMapRenderer* tileRenderer = new TileMapRenderer(tileMap, tileSet, 0);
+		tileRenderer->SetViewport(8, 8, width - 16, height - 16);
+		tileRenderer->SetCamera(37, 23);
+		
+		// random pixels, with one in eight of the sprite pixels being the mask color
+		ImageResource* sprite = new ImageResource(48, 40);
+		ImageResource* alphaSprite = new ImageResource(create_bitmap_ex(32, 40, 40));
+		for (int y = 0; y < 40; y++)
+		{
+			for (int x = 0; x < 48; x++)
+			{
+				bool masked = (0 == rand() % 8);
+				sprite->SetPixel(x, y, masked ? bitmap_mask_color(sprite->GetBitmap()) : makecol(rand() & 0xFF, rand() & 0xFF, rand() & 0xFF));
+				if (x < 40)
+				{
+					putpixel(alphaSprite->GetBitmap(), x, y, masked ? MASK_COLOR_32 : makeacol32(rand() & 0xFF, rand() & 0xFF, rand() & 0xFF, rand() & 0xFF));
+				}
+			}
+		}
+		
+		ImageResource* expected = new ImageResource(width, height);
+		ImageResource* actual = new ImageResource(width, height);
+		
+		bool passed = true;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			// the tiles are drawn from the tile images first, and then from the atlas
+			if (1 == pass)
+			{
+				tileSet->BuildAtlas();
+			}
+			
+			BeginScene(0);
+			DrawTileMap(tileRenderer);
+			for (int index = 0; index < 96; index++)
+			{
+				SpriteBlendMode blendMode = static_cast<SpriteBlendMode>(index % 4);
+				ImageResource* source = (SpriteBlend_Alpha == blendMode) ? alphaSprite : sprite;
+				DrawSprite(source, (rand() % (width + 40)) - 40, (rand() % (height + 40)) - 40, blendMode, 0.25f * (1 + (rand() % 3)));
+				
+				if (48 == index)
+				{
+					Call(DrawBandTestFrame, 0);
+				}
+			}
+			for (int index = 0; index < 32; index++)
+			{
+				// steep lines cross every band, and the ends of some of them are outside of the clipping rectangle
+				DrawLine((rand() % (width + 40)) - 20, (rand() % 40) - 20, (rand() % (width + 40)) - 20, height - 20 + (rand() % 40), makecol(255, rand() & 0xFF, 0));
+				DrawLine((rand() % width), (rand() % height), (rand() % width), (rand() % height), makecol(0, rand() & 0xFF, 255));
+			}
+			for (int index = 0; index < 8; index++)
+			{
+				int x = rand() % width;
+				int y = rand() % height;
+				DrawRect(x, y, x + (rand() % 80), y + (rand() % 120), makecol(rand() & 0xFF, 0, rand() & 0xFF), (0 == (index & 1)));
+			}
+			
+			RenderCommandBuffer& buffer = buffers_[recordIndex_];
+			
+			// a clipping rectangle that is not the whole image, like a game with a status bar
+			expected->SetClipRect(0, 0, width - 1, height - 1);
+			expected->Clear(makecol(32, 64, 96));
+			expected->SetClipRect(4, 2, width - 5, height - 3);
+			RasterizeInternal(buffer, expected, 1);
+			
+			for (int index = 0; index < bandCountCount; index++)
+			{
+				actual->SetClipRect(0, 0, width - 1, height - 1);
+				actual->Clear(makecol(32, 64, 96));
+				actual->SetClipRect(4, 2, width - 5, height - 3);
+				RasterizeInternal(buffer, actual, bandCounts[index]);
+				
+				int rowsDiffering = CompareImagesInternal(expected, actual);
+				if (rowsDiffering > 0)
+				{
+					LogError("Band test: %d bands %s the atlas differ from one band in %d rows!", 
+						bandCounts[index], pass ? "with" : "without", rowsDiffering);
+					passed = false;
+				}
+			}
+			
+			// the bands are sub-bitmaps of the test images, which are about to go
+			DestroyBandsInternal();
+			
+			buffer.commands.clear();
+			buffer.tileValues.clear();
+			buffer.hasCalls = false;
+			buffer.sceneBegun = false;
+		}
+		
+		delete actual;
+		delete expected;
+		delete alphaSprite;
+		delete sprite;
+		delete tileRenderer;
+		delete tileMap;
+		delete tileSet;
+		
+		LogMessage("Band test %s: %d band counts, with and without a tileset atlas, compared with one band.", 
+			passed ? "passed" : "failed", bandCountCount);
+		return passed;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::ExecuteInternal(RenderCommandBuffer& buffer)
+	{
+		TraceZone traceZone("RenderQueue::Execute");
+		
+		ImageResource* target = GraphicsDevice->GetSecondaryDisplayBuffer();
+		if (0 != target)
+		{
+			GraphicsDevice->BeginScene(buffer.clearColor);
+			
+			// the scene that the frame starts from is kept to draw the frame again in one band
+			ImageResource* reference = 0;
+			if (verifyBands_ && (bandCount_ > 1))
+			{
+				reference = new ImageResource(target->GetWidth(), target->GetHeight());
+				blit(target->GetBitmap(), reference->GetBitmap(), 0, 0, 0, 0, target->GetWidth(), target->GetHeight());
+				
+				int clipX1 = 0, clipY1 = 0, clipX2 = 0, clipY2 = 0;
+				target->GetClipRect(clipX1, clipY1, clipX2, clipY2);
+				reference->SetClipRect(clipX1, clipY1, clipX2, clipY2);
+			}
+			
+			RasterizeInternal(buffer, target, bandCount_);
+			
+			if (0 != reference)
+			{
+				RasterizeInternal(buffer, reference, 1);
+				
+				int rowsDiffering = CompareImagesInternal(target, reference);
+				if (rowsDiffering > 0)
+				{
+					LogError("Frame %u drawn in %d bands differs from the same frame drawn in one band in %d rows!", 
+						framesVerified_, bandCount_, rowsDiffering);
+					framesDiffered_++;
+				}
+				framesVerified_++;
+				
+				delete reference;
+			}
+			
+			// the profiler only works on the main thread
+			if (thread_.IsRunning())
+			{
+				GraphicsDevice->PresentScene();
+			}
+			else
+			{
+				GraphicsDevice->EndScene();
+			}
+		}
+		
+		// the vectors keep their memory for the frame after next
+		buffer.commands.clear();
+		buffer.tileValues.clear();
+		buffer.hasCalls = false;
+		buffer.sceneBegun = false;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::RasterizeInternal(RenderCommandBuffer& buffer, ImageResource* target, int bandCount)
+	{
+		std::vector<RenderCommand>& commands = buffer.commands;
+		const TileValueType* tileValues = buffer.tileValues.empty() ? 0 : &buffer.tileValues[0];
+		int blender = SPRITE_BATCH_NO_BLENDER;
+		
+		unsigned int index = 0;
+		while (index < commands.size())
+		{
+			// the longest run of commands that can be split into bands
+			unsigned int first = index;
+			while ((index < commands.size()) && IsBandSafeInternal(commands[index], target))
+			{
+				index++;
+			}
+			
+			if (index > first)
+			{
+				// a callback may have changed the clipping rectangle since the last run
+				PrepareBandsInternal(target, bandCount);
+				RasterizeBandsInternal(&commands[0] + first, &commands[0] + index, tileValues, target);
+			}
+			
+			if (index >= commands.size())
+			{
+				break;
+			}
+			
+			// the rest are drawn by this thread alone
+			RenderCommand& command = commands[index++];
+			if (RenderCommand_Sprite == command.type)
+			{
+				int clipX1 = 0, clipY1 = 0, clipX2 = 0, clipY2 = 0;
+				target->GetClipRect(clipX1, clipY1, clipX2, clipY2);
+				
+				SpriteDrawCommand sprite = command.sprite;
+				sprite.destination = target;
+				if (SpriteBatchSingleton::ClipSprite(sprite, clipX1, clipY1, clipX2, clipY2))
+				{
+					SpriteBatchSingleton::DrawClippedSprite(sprite, blender);
+				}
+			}
+			else if (RenderCommand_Call == command.type)
+			{
+				command.call.function(target, command.call.data);
+			}
+		}
+		
+		SpriteBatchSingleton::RestoreBlender(blender);
+	}
+	
+	/**************************************************************************/
+	
+	bool RenderQueueSingleton::IsBandSafeInternal(const RenderCommand& command, ImageResource* target)
+	{
+		switch(command.type)
+		{
+			case RenderCommand_Sprite:
+			{
+				// the Allegro blender is shared by every thread, so only the pixel kernels can blend in bands
+				if (SpriteBlend_Trans == command.sprite.blendMode)
+				{
+					return PixelKernelsSingleton::CanBlendBlit(command.sprite.source->GetBitmap(), target->GetBitmap());
+				}
+				if (SpriteBlend_Alpha == command.sprite.blendMode)
+				{
+					return PixelKernelsSingleton::CanAlphaBlendBlit(command.sprite.source->GetBitmap(), target->GetBitmap());
+				}
+				return true;
+			} break;
+			
+			case RenderCommand_Rect:
+			case RenderCommand_Line:
+			case RenderCommand_TileMap:
+			{
+				return true;
+			} break;
+			
+			default: break;
+		}
+		
+		// nobody knows what a callback draws
+		return false;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::PrepareBandsInternal(ImageResource* target, int bandCount)
+	{
+		BITMAP* parent = target->GetBitmap();
+		
+		int clip[4] = { 0, 0, 0, 0 };
+		target->GetClipRect(clip[0], clip[1], clip[2], clip[3]);
+		
+		int rowCount = 1 + clip[3] - clip[1];
+		bandCount = (bandCount > rowCount) ? rowCount : bandCount;
+		bandCount = (bandCount < 1) ? 1 : bandCount;
+		
+		if ((parent == bandParent_) && (static_cast<int>(bandBitmaps_.size()) == bandCount) &&
+			(clip[0] == bandClip_[0]) && (clip[1] == bandClip_[1]) && (clip[2] == bandClip_[2]) && (clip[3] == bandClip_[3]))
+		{
+			return;
+		}
+		
+		DestroyBandsInternal();
+		
+		bandParent_ = parent;
+		for (int index = 0; index < 4; index++)
+		{
+			bandClip_[index] = clip[index];
+		}
+		
+		if ((rowCount <= 0) || (clip[0] > clip[2]))
+		{
+			// nothing can be drawn, so there are no bands
+			return;
+		}
+		
+		int bandHeight = (rowCount + bandCount - 1) / bandCount;
+		for (int top = clip[1]; top <= clip[3]; top += bandHeight)
+		{
+			int height = (top + bandHeight - 1 > clip[3]) ? 1 + clip[3] - top : bandHeight;
+			
+			// the sub-bitmap spans the whole width, so the band draws with the same X coordinates as the target
+			BITMAP* band = create_sub_bitmap(parent, 0, top, parent->w, height);
+			if (0 == band)
+			{
+				LogFatal("Could not create the bitmap of a band!");
+				return;
+			}
+			set_clip_rect(band, clip[0], 0, clip[2], height - 1);
+			
+			bandBitmaps_.push_back(band);
+			bandTops_.push_back(top);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::DestroyBandsInternal()
+	{
+		std::vector<BITMAP*>::iterator iter;
+		for (iter = bandBitmaps_.begin(); iter != bandBitmaps_.end(); iter++)
+		{
+			destroy_bitmap(*iter);
+		}
+		bandBitmaps_.clear();
+		bandTops_.clear();
+		bandParent_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::RasterizeBandsInternal(const RenderCommand* begin, const RenderCommand* end, const TileValueType* tileValues, ImageResource* target)
+	{
+		if (bandBitmaps_.empty())
+		{
+			return;
+		}
+		
+		// the dirty rectangle list cannot be shared by several threads, so it is filled in afterwards
+		DirtyRectList* dirtyRects = target->GetDirtyRectList();
+		target->SetDirtyRectList(0);
+		
+		bandJob_.begin 		= begin;
+		bandJob_.end 		= end;
+		bandJob_.target 	= target;
+		bandJob_.tileValues = tileValues;
+		bandJob_.bandCount 	= static_cast<int>(bandBitmaps_.size());
+		bandJob_.clipX1 	= bandClip_[0];
+		bandJob_.clipX2 	= bandClip_[2];
+		
+		// one band to a job, so that a thread that finishes early takes another
+		JobSystem->ParallelFor(0, bandJob_.bandCount, 1, RenderQueueSingleton::BandJobInternal, this);
+		
+		target->SetDirtyRectList(dirtyRects);
+		if (0 != dirtyRects)
+		{
+			for (const RenderCommand* command = begin; command != end; command++)
+			{
+				MarkCommandDirty(*command, target, bandClip_[0], bandClip_[1], bandClip_[2], bandClip_[3]);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::BandJobInternal(int begin, int end, void* data)
+	{
+		RenderQueueSingleton* queue = reinterpret_cast<RenderQueueSingleton*>(data);
+		
+		TraceZone traceZone("RenderQueue::Bands");
+		
+		for (int band = begin; band < end; band++)
+		{
+			queue->RasterizeBandInternal(band);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::RasterizeBandInternal(int band)
+	{
+		BITMAP* bandBitmap = bandBitmaps_[band];
+		int top = bandTops_[band];
+		int bottom = top + bandBitmap->h - 1;
+		
+		ImageResource* target = bandJob_.target;
+		int clipX1 = bandJob_.clipX1;
+		int clipX2 = bandJob_.clipX2;
+		
+		for (const RenderCommand* command = bandJob_.begin; command != bandJob_.end; command++)
+		{
+			switch(command->type)
+			{
+				case RenderCommand_Sprite:
+				{
+					SpriteDrawCommand sprite = command->sprite;
+					sprite.destination = target;
+					if (SpriteBatchSingleton::ClipSprite(sprite, clipX1, top, clipX2, bottom))
+					{
+						// only sprites that the pixel kernels can draw get here, so the blender is never set
+						int blender = SPRITE_BATCH_NO_BLENDER;
+						SpriteBatchSingleton::DrawClippedSprite(sprite, blender);
+					}
+				} break;
+				
+				case RenderCommand_Rect:
+				{
+					const RenderShapeCommand& shape = command->shape;
+					if (shape.filled)
+					{
+						rectfill(bandBitmap, shape.x1, shape.y1 - top, shape.x2, shape.y2 - top, shape.color);
+					}
+					else
+					{
+						rect(bandBitmap, shape.x1, shape.y1 - top, shape.x2, shape.y2 - top, shape.color);
+					}
+				} break;
+				
+				case RenderCommand_Line:
+				{
+					// line() moves the ends of a line that it clips, which would bend it differently in every band,
+					// so every pixel of the whole line is worked out and clipped one at a time instead
+					const RenderShapeCommand& shape = command->shape;
+					do_line(bandBitmap, shape.x1, shape.y1 - top, shape.x2, shape.y2 - top, shape.color, PutBandPixel);
+				} break;
+				
+				case RenderCommand_TileMap:
+				{
+					const RenderTileMapCommand& tileMap = command->tileMap;
+					TileMapViewTiles tiles;
+					tiles.firstColumn 	= tileMap.firstColumn;
+					tiles.firstRow 		= tileMap.firstRow;
+					tiles.columnCount 	= tileMap.columnCount;
+					tiles.rowCount 		= tileMap.rowCount;
+					tiles.values 		= bandJob_.tileValues + tileMap.firstValue;
+					tileMap.renderer->RenderView(target, tileMap.view, tiles, clipX1, top, clipX2, bottom);
+				} break;
+				
+				default: break;
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	int RenderQueueSingleton::CompareImagesInternal(ImageResource* lhs, ImageResource* rhs)
+	{
+		BITMAP* lhsBitmap = lhs->GetBitmap();
+		BITMAP* rhsBitmap = rhs->GetBitmap();
+		
+		int rowSize = lhsBitmap->w * ((bitmap_color_depth(lhsBitmap) + 7) / 8);
+		int rowsDiffering = 0;
+		for (int row = 0; row < lhsBitmap->h; row++)
+		{
+			if (0 != memcmp(lhsBitmap->line[row], rhsBitmap->line[row], rowSize))
+			{
+				rowsDiffering++;
+			}
+		}
+		return rowsDiffering;
+	}
+	
+	/**************************************************************************/
+	
+	void RenderQueueSingleton::RenderThreadInternal(void* data)
+	{
+		RenderQueueSingleton* queue = reinterpret_cast<RenderQueueSingleton*>(data);
+		
+		TraceCapture->SetThreadName("render");
+		
+		while (true)
+		{
+			queue->frameReady_.Wait();
+			if (queue->stopping_)
+			{
+				break;
+			}
+			
+			queue->ExecuteInternal(queue->buffers_[queue->executeIndex_]);
+			queue->frameDone_.Signal();
+		}
+	}
+	
+	/**************************************************************************/
+	
+	RenderQueueSingleton::RenderQueueSingleton() :
+		recordIndex_(0),
+		executeIndex_(1),
+		frameInFlight_(false),
+		stopping_(false),
+		bandCount_(1),
+		bandParent_(0),
+		verifyBands_(false),
+		framesVerified_(0),
+		framesDiffered_(0)
+	{
+		// implement class constructor here
+		for (int index = 0; index < 2; index++)
+		{
+			buffers_[index].sceneBegun = false;
+			buffers_[index].clearColor = 0;
+			buffers_[index].hasCalls = false;
+		}
+		
+		for (int index = 0; index < 4; index++)
+		{
+			bandClip_[index] = 0;
+		}
+		
+		bandJob_.begin 			= 0;
+		bandJob_.end 			= 0;
+		bandJob_.target 		= 0;
+		bandJob_.tileValues 	= 0;
+		bandJob_.bandCount 		= 0;
+		bandJob_.clipX1 		= 0;
+		bandJob_.clipX2 		= 0;
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	RenderQueueSingleton::~RenderQueueSingleton()
+	{
+		// implement class destructor here
+		StopThread();
+	} // end destructor
+
+} // end namespace
+
+
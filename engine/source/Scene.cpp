@@ -50,7 +50,16 @@ namespace ENGINE
 	
 	SceneLayer* SceneSingleton::GetLayer(const char* layerName)
 	{
-		return layers_->Get(names_->Get(layerName));
+		unsigned int layerID = 0;
+		return (names_->TryGet(layerName, layerID)) ? layers_->Get(layerID) : 0;
+	}
+	
+	/**************************************************************************/
+	
+	SceneLayer* SceneSingleton::GetLayer(NameID layerName)
+	{
+		unsigned int layerID = 0;
+		return (names_->TryGet(layerName, layerID)) ? layers_->Get(layerID) : 0;
 	}
 	
 	/**************************************************************************/
@@ -69,6 +78,13 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	void SceneSingleton::QueueRender()
+	{
+		layers_->QueueRender();
+	}
+	
+	/**************************************************************************/
+	
 	void SceneSingleton::Destroy()
 	{
 		if (0 != layers_)
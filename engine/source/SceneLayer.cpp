@@ -19,8 +19,24 @@
 // include the image resource header
 #include "ImageResource.h"
 
+// include the image cache header
+#include "ImageCache.h"
+
+// include the render queue header
+#include "RenderQueue.h"
+
 namespace ENGINE
 {
+	/**
+	 * renders a scene layer from the render queue
+	 */
+	static void RenderSceneLayer(ImageResource* target, void* data)
+	{
+		reinterpret_cast<SceneLayer*>(data)->Render(target);
+	}
+	
+	/**************************************************************************/
+	
 	SceneLayer::SceneLayer() :
 		drawingSurface_(0)
 	{
@@ -32,11 +48,22 @@ namespace ENGINE
 	{
 		if (0 != drawingSurface_)
 		{
-			delete drawingSurface_;
+			// images that were loaded by file name belong to the image cache
+			if (!ImageCache->Release(drawingSurface_))
+			{
+				delete drawingSurface_;
+			}
 			drawingSurface_ = 0;
 		}
 	}
 	
+	/**************************************************************************/
+	
+	void SceneLayer::QueueRender()
+	{
+		RenderQueue->Call(RenderSceneLayer, this);
+	}
+	
 } // end namespace
 
 
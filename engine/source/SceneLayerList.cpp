@@ -16,6 +16,9 @@
 // include the complementing header
 #include "SceneLayerList.h"
 
+// include the profiler header
+#include "Profiler.h"
+
 // include the scene layer header
 #include "SceneLayer.h"
 
@@ -64,6 +67,8 @@ namespace ENGINE
 	
 	void SceneLayerList::Update(float deltaTime)
 	{
+		ProfileScope("SceneLayerList::Update");
+		
 		unsigned int index = 0;
 		for (index = 0; index < layers_.size(); index++)
 		{
@@ -78,6 +83,8 @@ namespace ENGINE
 	
 	void SceneLayerList::Render(ImageResource* target)
 	{
+		ProfileScope("SceneLayerList::Render");
+		
 		unsigned int index = 0;
 		for (index = 0; index < layers_.size(); index++)
 		{
@@ -88,6 +95,20 @@ namespace ENGINE
 		}
 	}
 	
+	/**************************************************************************/
+	
+	void SceneLayerList::QueueRender()
+	{
+		unsigned int index = 0;
+		for (index = 0; index < layers_.size(); index++)
+		{
+			if (0 != layers_[index])
+			{
+				layers_[index]->QueueRender();
+			}
+		}
+	}
+	
 	/**************************************************************************/
 		
 	void SceneLayerList::Destroy()
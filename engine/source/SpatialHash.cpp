@@ -0,0 +1,561 @@
+// CODESTYLE: v2.0
+
+// SpatialHash.cpp
+// Project: Game Engine Design 101 Project (ENGINE)
+// Author: Richard Marks
+// Purpose: finds the game objects whose boxes overlap, by sorting the boxes into the cells of a hashed grid
+
+/**
+ * \file SpatialHash.cpp
+ * \brief Game Object Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cmath>
+
+// include the complementing header
+#include "SpatialHash.h"
+
+// include the game object header
+#include "GameObject.h"
+
+// include the game object group header
+#include "GameObjectGroup.h"
+
+// include the game timer header
+#include "GameTimer.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	SpatialHash::SpatialHash(float cellSize) :
+		cellSize_(cellSize),
+		inverseCellSize_(1.0f / cellSize),
+		buckets_(SPATIAL_HASH_MIN_BUCKETS),
+		proxyCount_(0),
+		searchStamp_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	SpatialHash::~SpatialHash()
+	{
+		// implement class destructor here
+		proxies_.clear();
+		freeProxies_.clear();
+		buckets_.clear();
+		movedProxies_.clear();
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	SpatialProxyID SpatialHash::Insert(GameObject* object, GameObjectGroup* group, const SpatialBox& box)
+	{
+		// use the proxy of a removed box if there is one
+		unsigned int proxyIndex = 0;
+		if (!freeProxies_.empty())
+		{
+			proxyIndex = freeProxies_.back();
+			freeProxies_.pop_back();
+		}
+		else
+		{
+			proxyIndex = static_cast<unsigned int>(proxies_.size());
+			proxies_.push_back(Proxy());
+		}
+		
+		Proxy& proxy = proxies_[proxyIndex];
+		proxy.object = object;
+		proxy.group = group;
+		proxy.box = box;
+		proxy.searchStamp = 0;
+		proxy.alive = true;
+		proxy.moved = false;
+		GetCellsInternal(box, proxy.cellLeft, proxy.cellTop, proxy.cellRight, proxy.cellBottom);
+		proxyCount_++;
+		
+		// the buckets are kept at least as many as the boxes, so that the cells seldom share a bucket
+		if (proxyCount_ > buckets_.size())
+		{
+			RebuildInternal(static_cast<unsigned int>(buckets_.size() * 2));
+		}
+		else
+		{
+			AddToCellsInternal(proxyIndex);
+		}
+		
+		return proxyIndex;
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::Move(SpatialProxyID proxyID, const SpatialBox& box)
+	{
+		// a box that was removed must not be put back into the cells by UpdateCells()
+		if ((proxyID >= proxies_.size()) || (!proxies_[proxyID].alive))
+		{
+			LogWarning("The spatial hash was asked to move the box %u, which it does not have!", proxyID);
+			return;
+		}
+		
+		Proxy& proxy = proxies_[proxyID];
+		proxy.box = box;
+		
+		if (proxy.moved)
+		{
+			return;
+		}
+		
+		// most moves stay inside the same cells, and then the buckets do not change
+		int cellLeft = 0;
+		int cellTop = 0;
+		int cellRight = 0;
+		int cellBottom = 0;
+		GetCellsInternal(box, cellLeft, cellTop, cellRight, cellBottom);
+		if ((cellLeft == proxy.cellLeft) && (cellTop == proxy.cellTop) && (cellRight == proxy.cellRight) && (cellBottom == proxy.cellBottom))
+		{
+			return;
+		}
+		
+		proxy.moved = true;
+		
+		MutexLock lock(movedMutex_);
+		movedProxies_.push_back(proxyID);
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::Remove(SpatialProxyID proxyID)
+	{
+		if ((proxyID >= proxies_.size()) || (!proxies_[proxyID].alive))
+		{
+			LogWarning("The spatial hash was asked to remove the box %u, which it does not have!", proxyID);
+			return;
+		}
+		
+		// a box that is waiting to move is still in its old cells
+		RemoveFromCellsInternal(proxyID);
+		
+		Proxy& proxy = proxies_[proxyID];
+		proxy.object = 0;
+		proxy.group = 0;
+		proxy.alive = false;
+		proxy.moved = false;
+		freeProxies_.push_back(proxyID);
+		proxyCount_--;
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::UpdateCells()
+	{
+		std::vector<unsigned int>::iterator iter;
+		for (iter = movedProxies_.begin(); iter != movedProxies_.end(); iter++)
+		{
+			// a box that was removed after it moved is skipped
+			Proxy& proxy = proxies_[*iter];
+			if ((!proxy.alive) || (!proxy.moved))
+			{
+				continue;
+			}
+			
+			RemoveFromCellsInternal(*iter);
+			GetCellsInternal(proxy.box, proxy.cellLeft, proxy.cellTop, proxy.cellRight, proxy.cellBottom);
+			AddToCellsInternal(*iter);
+			proxy.moved = false;
+		}
+		movedProxies_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::Query(const SpatialBox& region, std::vector<GameObject*>& objects, GameObjectGroup* group)
+	{
+		int cellLeft = 0;
+		int cellTop = 0;
+		int cellRight = 0;
+		int cellBottom = 0;
+		GetCellsInternal(region, cellLeft, cellTop, cellRight, cellBottom);
+		
+		unsigned int searchStamp = NextSearchInternal();
+		
+		for (int row = cellTop; row <= cellBottom; row++)
+		{
+			for (int column = cellLeft; column <= cellRight; column++)
+			{
+				std::vector<unsigned int>& bucket = GetBucketInternal(column, row);
+				std::vector<unsigned int>::iterator iter;
+				for (iter = bucket.begin(); iter != bucket.end(); iter++)
+				{
+					Proxy& proxy = proxies_[*iter];
+					if ((searchStamp == proxy.searchStamp) || ((0 != group) && (group != proxy.group)))
+					{
+						continue;
+					}
+					proxy.searchStamp = searchStamp;
+					
+					if ((proxy.box.left < region.right) && (region.left < proxy.box.right) &&
+						(proxy.box.top < region.bottom) && (region.top < proxy.box.bottom))
+					{
+						objects.push_back(proxy.object);
+					}
+				}
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::FindPairs(GameObjectGroup* firstGroup, GameObjectGroup* secondGroup, std::vector<SpatialPair>& pairs)
+	{
+		bool sameGroup = (firstGroup == secondGroup);
+		
+		unsigned int proxyIndex = 0;
+		for (proxyIndex = 0; proxyIndex < proxies_.size(); proxyIndex++)
+		{
+			if ((!proxies_[proxyIndex].alive) || (firstGroup != proxies_[proxyIndex].group))
+			{
+				continue;
+			}
+			
+			// the box is only checked against the boxes that share a cell with it
+			const Proxy& first = proxies_[proxyIndex];
+			unsigned int searchStamp = NextSearchInternal();
+			
+			for (int row = first.cellTop; row <= first.cellBottom; row++)
+			{
+				for (int column = first.cellLeft; column <= first.cellRight; column++)
+				{
+					std::vector<unsigned int>& bucket = GetBucketInternal(column, row);
+					std::vector<unsigned int>::iterator iter;
+					for (iter = bucket.begin(); iter != bucket.end(); iter++)
+					{
+						// the pairs of a group with itself are found from the box with the lower ID
+						Proxy& second = proxies_[*iter];
+						if ((searchStamp == second.searchStamp) || (secondGroup != second.group) || (sameGroup && (*iter <= proxyIndex)))
+						{
+							continue;
+						}
+						second.searchStamp = searchStamp;
+						
+						if ((first.box.left < second.box.right) && (second.box.left < first.box.right) &&
+							(first.box.top < second.box.bottom) && (second.box.top < first.box.bottom))
+						{
+							SpatialPair pair;
+							pair.first = first.object;
+							pair.second = second.object;
+							pairs.push_back(pair);
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::SetCellSize(float cellSize)
+	{
+		cellSize_ = cellSize;
+		inverseCellSize_ = 1.0f / cellSize;
+		
+		// the moved boxes are sorted into their new cells along with the rest
+		unsigned int proxyIndex = 0;
+		for (proxyIndex = 0; proxyIndex < proxies_.size(); proxyIndex++)
+		{
+			Proxy& proxy = proxies_[proxyIndex];
+			if (proxy.alive)
+			{
+				GetCellsInternal(proxy.box, proxy.cellLeft, proxy.cellTop, proxy.cellRight, proxy.cellBottom);
+				proxy.moved = false;
+			}
+		}
+		movedProxies_.clear();
+		
+		RebuildInternal(static_cast<unsigned int>(buckets_.size()));
+	}
+	
+	/**************************************************************************/
+	
+	float SpatialHash::GetCellSize()
+	{
+		return cellSize_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int SpatialHash::GetProxyCount()
+	{
+		return proxyCount_;
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::GetCellsInternal(const SpatialBox& box, int& cellLeft, int& cellTop, int& cellRight, int& cellBottom)
+	{
+		cellLeft = static_cast<int>(floorf(box.left * inverseCellSize_));
+		cellTop = static_cast<int>(floorf(box.top * inverseCellSize_));
+		cellRight = static_cast<int>(floorf(box.right * inverseCellSize_));
+		cellBottom = static_cast<int>(floorf(box.bottom * inverseCellSize_));
+	}
+	
+	/**************************************************************************/
+	
+	std::vector<unsigned int>& SpatialHash::GetBucketInternal(int column, int row)
+	{
+		unsigned int hash = (static_cast<unsigned int>(column) * 73856093u) ^ (static_cast<unsigned int>(row) * 19349663u);
+		return buckets_[hash & static_cast<unsigned int>(buckets_.size() - 1)];
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::AddToCellsInternal(unsigned int proxyIndex)
+	{
+		const Proxy& proxy = proxies_[proxyIndex];
+		for (int row = proxy.cellTop; row <= proxy.cellBottom; row++)
+		{
+			for (int column = proxy.cellLeft; column <= proxy.cellRight; column++)
+			{
+				GetBucketInternal(column, row).push_back(proxyIndex);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::RemoveFromCellsInternal(unsigned int proxyIndex)
+	{
+		const Proxy& proxy = proxies_[proxyIndex];
+		for (int row = proxy.cellTop; row <= proxy.cellBottom; row++)
+		{
+			for (int column = proxy.cellLeft; column <= proxy.cellRight; column++)
+			{
+				// the order of a bucket does not matter, so the last ID takes the place of the removed one
+				std::vector<unsigned int>& bucket = GetBucketInternal(column, row);
+				unsigned int index = 0;
+				for (index = 0; index < bucket.size(); index++)
+				{
+					if (proxyIndex == bucket[index])
+					{
+						bucket[index] = bucket.back();
+						bucket.pop_back();
+						break;
+					}
+				}
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int SpatialHash::NextSearchInternal()
+	{
+		// once the count wraps around, the old stamps could match again, so they are cleared
+		searchStamp_++;
+		if (0 == searchStamp_)
+		{
+			std::vector<Proxy>::iterator iter;
+			for (iter = proxies_.begin(); iter != proxies_.end(); iter++)
+			{
+				iter->searchStamp = 0;
+			}
+			searchStamp_ = 1;
+		}
+		return searchStamp_;
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::RebuildInternal(unsigned int bucketCount)
+	{
+		buckets_.clear();
+		buckets_.resize(bucketCount);
+		
+		unsigned int proxyIndex = 0;
+		for (proxyIndex = 0; proxyIndex < proxies_.size(); proxyIndex++)
+		{
+			if (proxies_[proxyIndex].alive)
+			{
+				AddToCellsInternal(proxyIndex);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	SpatialHash* SpatialHash::Create(float cellSize)
+	{
+		return new SpatialHash(cellSize);
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::Destroy(SpatialHash* hashInstance)
+	{
+		if (0 != hashInstance)
+		{
+			delete hashInstance;
+			hashInstance = 0;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * \class SpatialBenchmarkObject
+	 * \brief a game object that does nothing, for the benchmark to put boxes into the spatial hash for
+	 */
+	class SpatialBenchmarkObject : public GameObject
+	{
+	public:
+		void Create() {}
+		void Update() {}
+		void Render() {}
+		void Destroy() {}
+		
+		//! where the object is
+		SpatialBox box;
+		//! how far the object moves each frame
+		float speedX;
+		//! how far the object moves each frame
+		float speedY;
+		//! the ID of the box of the object
+		SpatialProxyID proxyID;
+	};
+	
+	/**************************************************************************/
+	
+	/**
+	 * \return a random number from 0 up to 1, from a generator that gives the same numbers every run
+	 */
+	static float BenchmarkRandom(unsigned int& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>(seed >> 8) / 16777216.0f;
+	}
+	
+	/**************************************************************************/
+	
+	void SpatialHash::RunBenchmark()
+	{
+		// the world grows with the number of objects, so that every object has about as many neighbors at every size
+		const int objectCounts[] = { 1000, 10000, 100000 };
+		const int sizeCount = sizeof(objectCounts) / sizeof(objectCounts[0]);
+		const int frames = 10;
+		const float objectSize = 16.0f;
+		const float spacePerObject = 48.0f * 48.0f;
+		const int bruteForceLimit = 10000;
+		
+		LogMessage("Spatial hash benchmark: two groups of %.0fx%.0f objects moving for %d frames, in milliseconds per frame", objectSize, objectSize, frames);
+		
+		for (int sizeIndex = 0; sizeIndex < sizeCount; sizeIndex++)
+		{
+			int objectCount = objectCounts[sizeIndex];
+			float worldSize = sqrtf(spacePerObject * objectCount);
+			unsigned int seed = 12345;
+			
+			// the groups are only used to tell the objects apart, so they stay empty
+			GameObjectGroup* firstGroup = GameObjectGroup::Create();
+			GameObjectGroup* secondGroup = GameObjectGroup::Create();
+			
+			std::vector<SpatialBenchmarkObject> objects(objectCount);
+			SpatialHash* hash = SpatialHash::Create(objectSize * 2.0f);
+			
+			GameTimerTicks start = GameTimer->GetTicks();
+			for (int index = 0; index < objectCount; index++)
+			{
+				SpatialBenchmarkObject& object = objects[index];
+				object.box.left = BenchmarkRandom(seed) * worldSize;
+				object.box.top = BenchmarkRandom(seed) * worldSize;
+				object.box.right = object.box.left + objectSize;
+				object.box.bottom = object.box.top + objectSize;
+				object.speedX = BenchmarkRandom(seed) * 4.0f - 2.0f;
+				object.speedY = BenchmarkRandom(seed) * 4.0f - 2.0f;
+				object.proxyID = hash->Insert(&object, (index & 1) ? secondGroup : firstGroup, object.box);
+			}
+			double insertTime = static_cast<double>(GameTimer->GetTicks() - start) / GAMETIMER_TICKS_PER_MILLISECOND;
+			
+			GameTimerTicks moveTicks = 0;
+			GameTimerTicks pairTicks = 0;
+			std::vector<SpatialPair> pairs;
+			for (int frame = 0; frame < frames; frame++)
+			{
+				start = GameTimer->GetTicks();
+				for (int index = 0; index < objectCount; index++)
+				{
+					// the objects bounce off the edges of the world
+					SpatialBenchmarkObject& object = objects[index];
+					if ((object.box.left + object.speedX < 0.0f) || (object.box.right + object.speedX > worldSize))
+					{
+						object.speedX = -object.speedX;
+					}
+					if ((object.box.top + object.speedY < 0.0f) || (object.box.bottom + object.speedY > worldSize))
+					{
+						object.speedY = -object.speedY;
+					}
+					object.box.left += object.speedX;
+					object.box.right += object.speedX;
+					object.box.top += object.speedY;
+					object.box.bottom += object.speedY;
+					hash->Move(object.proxyID, object.box);
+				}
+				hash->UpdateCells();
+				moveTicks += GameTimer->GetTicks() - start;
+				
+				pairs.clear();
+				start = GameTimer->GetTicks();
+				hash->FindPairs(firstGroup, secondGroup, pairs);
+				pairTicks += GameTimer->GetTicks() - start;
+			}
+			
+			// checking every object against every other object gives the pairs that the hash must have found
+			char bruteForceText[64];
+			snprintf(bruteForceText, 64, "skipped");
+			if (objectCount <= bruteForceLimit)
+			{
+				start = GameTimer->GetTicks();
+				unsigned int bruteForcePairs = 0;
+				for (int first = 0; first < objectCount; first += 2)
+				{
+					const SpatialBox& a = objects[first].box;
+					for (int second = 1; second < objectCount; second += 2)
+					{
+						const SpatialBox& b = objects[second].box;
+						if ((a.left < b.right) && (b.left < a.right) && (a.top < b.bottom) && (b.top < a.bottom))
+						{
+							bruteForcePairs++;
+						}
+					}
+				}
+				double bruteForceTime = static_cast<double>(GameTimer->GetTicks() - start) / GAMETIMER_TICKS_PER_MILLISECOND;
+				snprintf(bruteForceText, 64, "%10.3f", bruteForceTime);
+				
+				if (bruteForcePairs != pairs.size())
+				{
+					LogError("The spatial hash found %u pairs of %d objects, but there are %u!", static_cast<unsigned int>(pairs.size()), objectCount, bruteForcePairs);
+				}
+			}
+			
+			LogMessage("%6d objects  insert %8.3f  move %8.3f  pairs %8.3f  (%6u pairs)  every pair %s",
+				objectCount,
+				insertTime,
+				static_cast<double>(moveTicks) / GAMETIMER_TICKS_PER_MILLISECOND / frames,
+				static_cast<double>(pairTicks) / GAMETIMER_TICKS_PER_MILLISECOND / frames,
+				static_cast<unsigned int>(pairs.size()),
+				bruteForceText);
+			
+			SpatialHash::Destroy(hash);
+			GameObjectGroup::Destroy(firstGroup);
+			GameObjectGroup::Destroy(secondGroup);
+		}
+	}
+
+} // end namespace
+
+
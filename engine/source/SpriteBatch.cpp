@@ -0,0 +1,483 @@
+// CODESTYLE: v2.0
+
+// SpriteBatch.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Collects the sprites drawn during a frame, and draws them sorted by layer and source image
+
+/**
+ * \file SpriteBatch.cpp
+ * \brief Sprite Batch Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <algorithm>
+
+// include Allegro
+#include <allegro.h>
+
+// include the complementing header
+#include "SpriteBatch.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the pixel kernels header
+#include "PixelKernels.h"
+
+// include the profiler header
+#include "Profiler.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	/**
+	 * orders the sprites by destination, layer, and then the order that they were drawn in
+	 */
+	static bool CompareSpriteDrawOrder(const SpriteDrawCommand& lhs, const SpriteDrawCommand& rhs)
+	{
+		if (lhs.destination != rhs.destination)
+		{
+			return lhs.destination < rhs.destination;
+		}
+		if (lhs.layer != rhs.layer)
+		{
+			return lhs.layer < rhs.layer;
+		}
+		return lhs.order < rhs.order;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * orders the sprites by destination, layer, group, and then the order that they were drawn in
+	 */
+	static bool CompareSpriteDrawCommands(const SpriteDrawCommand& lhs, const SpriteDrawCommand& rhs)
+	{
+		if (lhs.destination != rhs.destination)
+		{
+			return lhs.destination < rhs.destination;
+		}
+		if (lhs.layer != rhs.layer)
+		{
+			return lhs.layer < rhs.layer;
+		}
+		if (lhs.group != rhs.group)
+		{
+			return lhs.group < rhs.group;
+		}
+		return lhs.order < rhs.order;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * Draws a rectangle of a bitmap with the current Allegro blender.
+	 * draw_trans_sprite() only draws whole bitmaps, so anything less is drawn through a sub-bitmap.
+	 */
+	static void DrawTransRect(BITMAP* source, BITMAP* destination, int srcX, int srcY, int destX, int destY, int width, int height)
+	{
+		if ((0 == srcX) && (0 == srcY) && (source->w == width) && (source->h == height))
+		{
+			draw_trans_sprite(destination, source, destX, destY);
+			return;
+		}
+		
+		BITMAP* part = create_sub_bitmap(source, srcX, srcY, width, height);
+		if (0 != part)
+		{
+			draw_trans_sprite(destination, part, destX, destY);
+			destroy_bitmap(part);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	SpriteBatchSingleton* SpriteBatchSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static SpriteBatchSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::Begin()
+	{
+		depth_++;
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::End()
+	{
+		if (depth_ <= 0)
+		{
+			LogWarning("SpriteBatch End() was called without a Begin()!");
+			return;
+		}
+		
+		// only the outermost batch draws
+		if (--depth_ > 0)
+		{
+			return;
+		}
+		
+		ProfileScope("SpriteBatchSingleton::End");
+		
+		spritesDrawn_ = 0;
+		spritesCulled_ = 0;
+		sourceSwitches_ = 0;
+		
+		// the sprites of each layer are grouped by source image in the order that they were drawn in, and then drawn group by group
+		std::sort(commands_.begin(), commands_.end(), CompareSpriteDrawOrder);
+		GroupSpritesInternal();
+		std::sort(commands_.begin(), commands_.end(), CompareSpriteDrawCommands);
+		
+		ImageResource* destination = 0;
+		ImageResource* source = 0;
+		int clipX1 = 0;
+		int clipY1 = 0;
+		int clipX2 = 0;
+		int clipY2 = 0;
+		
+		std::vector<SpriteDrawCommand>::iterator iter;
+		for (iter = commands_.begin(); iter != commands_.end(); iter++)
+		{
+			// the sprites of a destination are together, so its clipping rectangle is only read once
+			if (iter->destination != destination)
+			{
+				destination = iter->destination;
+				destination->GetClipRect(clipX1, clipY1, clipX2, clipY2);
+			}
+			
+			if (!ClipSprite(*iter, clipX1, clipY1, clipX2, clipY2))
+			{
+				spritesCulled_++;
+				continue;
+			}
+			
+			if (iter->source != source)
+			{
+				source = iter->source;
+				sourceSwitches_++;
+			}
+			
+			DrawClippedSprite(*iter, blender_);
+			spritesDrawn_++;
+		}
+		
+		// the vector keeps its memory for the next frame
+		commands_.clear();
+		
+		RestoreBlender(blender_);
+	}
+	
+	/**************************************************************************/
+	
+	bool SpriteBatchSingleton::IsBatching()
+	{
+		return depth_ > 0;
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::Draw(
+		ImageResource* source,
+		ImageResource* destination,
+		int destX, int destY,
+		int layer,
+		SpriteBlendMode blendMode,
+		float alpha)
+	{
+		Draw(source, 0, 0, source->GetWidth(), source->GetHeight(), destination, destX, destY, layer, blendMode, alpha);
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::Draw(
+		ImageResource* source,
+		int srcX, int srcY,
+		int width, int height,
+		ImageResource* destination,
+		int destX, int destY,
+		int layer,
+		SpriteBlendMode blendMode,
+		float alpha)
+	{
+		if ((0 == source) || (0 == destination))
+		{
+			LogError("Cannot draw a sprite without a source and a destination image!");
+			return;
+		}
+		
+		int alphaValue = static_cast<int>(255 * alpha);
+		
+		SpriteDrawCommand command;
+		command.source 		= source;
+		command.destination = destination;
+		command.srcX 		= srcX;
+		command.srcY 		= srcY;
+		command.width 		= width;
+		command.height 		= height;
+		command.destX 		= destX;
+		command.destY 		= destY;
+		command.layer 		= layer;
+		command.blendMode 	= blendMode;
+		command.alpha 		= (alphaValue < 0) ? 0 : ((alphaValue > 255) ? 255 : alphaValue);
+		command.order 		= static_cast<unsigned int>(commands_.size());
+		command.group 		= 0;
+		
+		if (IsBatching())
+		{
+			commands_.push_back(command);
+			return;
+		}
+		
+		// outside of a batch the sprite is drawn straight away
+		int clipX1 = 0;
+		int clipY1 = 0;
+		int clipX2 = 0;
+		int clipY2 = 0;
+		destination->GetClipRect(clipX1, clipY1, clipX2, clipY2);
+		if (ClipSprite(command, clipX1, clipY1, clipX2, clipY2))
+		{
+			DrawClippedSprite(command, blender_);
+		}
+		
+		RestoreBlender(blender_);
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int SpriteBatchSingleton::GetSpritesDrawn()
+	{
+		return spritesDrawn_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int SpriteBatchSingleton::GetSpritesCulled()
+	{
+		return spritesCulled_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int SpriteBatchSingleton::GetSourceSwitches()
+	{
+		return sourceSwitches_;
+	}
+	
+	/**************************************************************************/
+	
+	bool SpriteBatchSingleton::ClipSprite(SpriteDrawCommand& command, int clipX1, int clipY1, int clipX2, int clipY2)
+	{
+		// clip to the source image
+		if (command.srcX < 0)
+		{
+			command.width += command.srcX;
+			command.destX -= command.srcX;
+			command.srcX = 0;
+		}
+		if (command.srcY < 0)
+		{
+			command.height += command.srcY;
+			command.destY -= command.srcY;
+			command.srcY = 0;
+		}
+		if (command.srcX + command.width > command.source->GetWidth())
+		{
+			command.width = command.source->GetWidth() - command.srcX;
+		}
+		if (command.srcY + command.height > command.source->GetHeight())
+		{
+			command.height = command.source->GetHeight() - command.srcY;
+		}
+		
+		// clip to the clipping rectangle of the destination
+		if (command.destX < clipX1)
+		{
+			command.width -= clipX1 - command.destX;
+			command.srcX += clipX1 - command.destX;
+			command.destX = clipX1;
+		}
+		if (command.destY < clipY1)
+		{
+			command.height -= clipY1 - command.destY;
+			command.srcY += clipY1 - command.destY;
+			command.destY = clipY1;
+		}
+		if (command.destX + command.width > clipX2 + 1)
+		{
+			command.width = clipX2 + 1 - command.destX;
+		}
+		if (command.destY + command.height > clipY2 + 1)
+		{
+			command.height = clipY2 + 1 - command.destY;
+		}
+		
+		return (command.width > 0) && (command.height > 0);
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::DrawClippedSprite(const SpriteDrawCommand& command, int& blender)
+	{
+		BITMAP* source = command.source->GetBitmap();
+		BITMAP* destination = command.destination->GetBitmap();
+		
+		switch(command.blendMode)
+		{
+			case SpriteBlend_Solid:
+			{
+				blit(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height);
+			} break;
+			
+			case SpriteBlend_Masked:
+			{
+				if (!PixelKernels->MaskedBlit(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height))
+				{
+					masked_blit(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height);
+				}
+			} break;
+			
+			case SpriteBlend_Trans:
+			{
+				if (!PixelKernels->BlendBlit(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height, command.alpha))
+				{
+					// the sprites are sorted by image, so the blender rarely changes
+					if (command.alpha != blender)
+					{
+						set_trans_blender(0, 0, 0, command.alpha);
+						blender = command.alpha;
+					}
+					DrawTransRect(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height);
+				}
+			} break;
+			
+			case SpriteBlend_Alpha:
+			{
+				if (!PixelKernels->AlphaBlendBlit(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height))
+				{
+					if (SPRITE_BATCH_ALPHA_BLENDER != blender)
+					{
+						set_alpha_blender();
+						blender = SPRITE_BATCH_ALPHA_BLENDER;
+					}
+					DrawTransRect(source, destination, command.srcX, command.srcY, command.destX, command.destY, command.width, command.height);
+				}
+			} break;
+			
+			default: break;
+		}
+		
+		command.destination->MarkDirty(command.destX, command.destY, command.width, command.height);
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::RestoreBlender(int& blender)
+	{
+		if (SPRITE_BATCH_NO_BLENDER != blender)
+		{
+			set_trans_blender(0, 0, 0, 255);
+			blender = SPRITE_BATCH_NO_BLENDER;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void SpriteBatchSingleton::GroupSpritesInternal()
+	{
+		groups_.clear();
+		
+		ImageResource* destination = 0;
+		int layer = 0;
+		unsigned int firstGroup = 0;
+		
+		std::vector<SpriteDrawCommand>::iterator iter;
+		for (iter = commands_.begin(); iter != commands_.end(); iter++)
+		{
+			// the groups of one layer of one destination are never mixed with the groups of another
+			if ((commands_.begin() == iter) || (iter->destination != destination) || (iter->layer != layer))
+			{
+				destination = iter->destination;
+				layer = iter->layer;
+				firstGroup = static_cast<unsigned int>(groups_.size());
+			}
+			
+			int left = iter->destX;
+			int top = iter->destY;
+			int right = iter->destX + iter->width;
+			int bottom = iter->destY + iter->height;
+			
+			// look back for the latest group with the same image; a group of another image that the sprite overlaps
+			// has to be drawn before the sprite, so the sprite cannot join a group from before it
+			unsigned int groupCount = static_cast<unsigned int>(groups_.size());
+			unsigned int searchEnd = (groupCount - firstGroup > SPRITE_BATCH_MAX_GROUP_SEARCH) ? 
+				groupCount - SPRITE_BATCH_MAX_GROUP_SEARCH : firstGroup;
+			unsigned int joined = groupCount;
+			for (unsigned int index = groupCount; index > searchEnd; index--)
+			{
+				SpriteGroup& group = groups_[index - 1];
+				if (group.source == iter->source)
+				{
+					joined = index - 1;
+					break;
+				}
+				
+				if ((left < group.right) && (group.left < right) && (top < group.bottom) && (group.top < bottom))
+				{
+					break;
+				}
+			}
+			
+			if (groupCount == joined)
+			{
+				SpriteGroup group;
+				group.source = iter->source;
+				group.left = left;
+				group.top = top;
+				group.right = right;
+				group.bottom = bottom;
+				groups_.push_back(group);
+			}
+			else
+			{
+				SpriteGroup& group = groups_[joined];
+				group.left = (left < group.left) ? left : group.left;
+				group.top = (top < group.top) ? top : group.top;
+				group.right = (right > group.right) ? right : group.right;
+				group.bottom = (bottom > group.bottom) ? bottom : group.bottom;
+			}
+			
+			iter->group = joined;
+		}
+	}
+	
+	/**************************************************************************/
+	
+	SpriteBatchSingleton::SpriteBatchSingleton() :
+		depth_(0),
+		blender_(SPRITE_BATCH_NO_BLENDER),
+		spritesDrawn_(0),
+		spritesCulled_(0),
+		sourceSwitches_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	SpriteBatchSingleton::~SpriteBatchSingleton()
+	{
+		// implement class destructor here
+	} // end destructor
+
+} // end namespace
+
+
@@ -0,0 +1,435 @@
+
+// CODESTYLE: v2.0
+
+// Threading.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Cross-platform threading primitives
+
+/**
+ * \file Threading.cpp
+ * \brief Cross-platform threading primitives - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <ctime>
+
+// only non-windows platforms use this
+#if !defined(WIN32)
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#else
+// this is for the windows platform
+#include <windows.h>
+#endif
+
+// include the complementing header
+#include "Threading.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	unsigned int GetProcessorCount()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+// this is for the windows platform
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		long count = static_cast<long>(systemInfo.dwNumberOfProcessors);
+#endif
+		return (count > 0) ? static_cast<unsigned int>(count) : 1;
+	}
+	
+	/**************************************************************************/
+	
+	void YieldThread()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		sched_yield();
+#else
+// this is for the windows platform
+		Sleep(0);
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	Mutex::Mutex()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_mutex_t* mutex = new pthread_mutex_t;
+		pthread_mutex_init(mutex, 0);
+		handle_ = mutex;
+#else
+// this is for the windows platform
+		CRITICAL_SECTION* section = new CRITICAL_SECTION;
+		InitializeCriticalSection(section);
+		handle_ = section;
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	Mutex::~Mutex()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_mutex_t* mutex = static_cast<pthread_mutex_t*>(handle_);
+		pthread_mutex_destroy(mutex);
+		delete mutex;
+#else
+// this is for the windows platform
+		CRITICAL_SECTION* section = static_cast<CRITICAL_SECTION*>(handle_);
+		DeleteCriticalSection(section);
+		delete section;
+#endif
+		handle_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	void Mutex::Lock()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_mutex_lock(static_cast<pthread_mutex_t*>(handle_));
+#else
+// this is for the windows platform
+		EnterCriticalSection(static_cast<CRITICAL_SECTION*>(handle_));
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	void Mutex::Unlock()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_mutex_unlock(static_cast<pthread_mutex_t*>(handle_));
+#else
+// this is for the windows platform
+		LeaveCriticalSection(static_cast<CRITICAL_SECTION*>(handle_));
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	void* Mutex::GetHandle()
+	{
+		return handle_;
+	}
+	
+	/**************************************************************************/
+	
+	MutexLock::MutexLock(Mutex& mutex) :
+		mutex_(mutex)
+	{
+		mutex_.Lock();
+	}
+	
+	/**************************************************************************/
+	
+	MutexLock::~MutexLock()
+	{
+		mutex_.Unlock();
+	}
+	
+	/**************************************************************************/
+	
+// only non-windows platforms use this
+#if !defined(WIN32)
+	/**
+	 * \struct ThreadEventData
+	 * \brief the platform event object of a ThreadEvent on non-windows platforms
+	 */
+	struct ThreadEventData
+	{
+		pthread_mutex_t mutex;
+		pthread_cond_t condition;
+		bool signaled;
+	};
+#endif
+	
+	/**************************************************************************/
+	
+	ThreadEvent::ThreadEvent()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		ThreadEventData* event = new ThreadEventData;
+		pthread_mutex_init(&event->mutex, 0);
+		pthread_cond_init(&event->condition, 0);
+		event->signaled = false;
+		handle_ = event;
+#else
+// this is for the windows platform
+		handle_ = CreateEvent(0, FALSE, FALSE, 0);
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	ThreadEvent::~ThreadEvent()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		ThreadEventData* event = static_cast<ThreadEventData*>(handle_);
+		pthread_cond_destroy(&event->condition);
+		pthread_mutex_destroy(&event->mutex);
+		delete event;
+#else
+// this is for the windows platform
+		CloseHandle(static_cast<HANDLE>(handle_));
+#endif
+		handle_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	void ThreadEvent::Signal()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		ThreadEventData* event = static_cast<ThreadEventData*>(handle_);
+		pthread_mutex_lock(&event->mutex);
+		event->signaled = true;
+		pthread_cond_signal(&event->condition);
+		pthread_mutex_unlock(&event->mutex);
+#else
+// this is for the windows platform
+		SetEvent(static_cast<HANDLE>(handle_));
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	void ThreadEvent::Wait()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		ThreadEventData* event = static_cast<ThreadEventData*>(handle_);
+		pthread_mutex_lock(&event->mutex);
+		while (!event->signaled)
+		{
+			pthread_cond_wait(&event->condition, &event->mutex);
+		}
+		event->signaled = false;
+		pthread_mutex_unlock(&event->mutex);
+#else
+// this is for the windows platform
+		WaitForSingleObject(static_cast<HANDLE>(handle_), INFINITE);
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	bool ThreadEvent::WaitFor(unsigned int milliseconds)
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		ThreadEventData* event = static_cast<ThreadEventData*>(handle_);
+		
+		// the condition wait takes an absolute time on the realtime clock
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += milliseconds / 1000;
+		deadline.tv_nsec += static_cast<long>(milliseconds % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		
+		pthread_mutex_lock(&event->mutex);
+		int result = 0;
+		while (!event->signaled && (0 == result))
+		{
+			result = pthread_cond_timedwait(&event->condition, &event->mutex, &deadline);
+		}
+		bool signaled = event->signaled;
+		event->signaled = false;
+		pthread_mutex_unlock(&event->mutex);
+		return signaled;
+#else
+// this is for the windows platform
+		return (WAIT_OBJECT_0 == WaitForSingleObject(static_cast<HANDLE>(handle_), milliseconds));
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	Thread::Thread() :
+		handle_(0),
+		function_(0),
+		data_(0)
+	{
+	}
+	
+	/**************************************************************************/
+	
+	Thread::~Thread()
+	{
+		Join();
+	}
+	
+	/**************************************************************************/
+	
+	bool Thread::Start(ThreadFunction function, void* data)
+	{
+		if ((0 != handle_) || (0 == function))
+		{
+			return false;
+		}
+		
+		function_ 	= function;
+		data_ 		= data;
+		
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_t* thread = new pthread_t;
+		if (0 != pthread_create(thread, 0, &Thread::Run, this))
+		{
+			delete thread;
+			return false;
+		}
+		handle_ = thread;
+#else
+// this is for the windows platform
+		handle_ = CreateThread(0, 0, &Thread::Run, this, 0, 0);
+		if (0 == handle_)
+		{
+			return false;
+		}
+#endif
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void Thread::Join()
+	{
+		if (0 == handle_)
+		{
+			return;
+		}
+		
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_t* thread = static_cast<pthread_t*>(handle_);
+		pthread_join(*thread, 0);
+		delete thread;
+#else
+// this is for the windows platform
+		WaitForSingleObject(static_cast<HANDLE>(handle_), INFINITE);
+		CloseHandle(static_cast<HANDLE>(handle_));
+#endif
+		handle_ = 0;
+	}
+	
+	/**************************************************************************/
+	
+	bool Thread::IsRunning()
+	{
+		return (0 != handle_);
+	}
+	
+	/**************************************************************************/
+	
+// only non-windows platforms use this
+#if !defined(WIN32)
+	void* Thread::Run(void* thread)
+	{
+		Thread* self = static_cast<Thread*>(thread);
+		self->function_(self->data_);
+		return 0;
+	}
+#else
+// this is for the windows platform
+	unsigned long __stdcall Thread::Run(void* thread)
+	{
+		Thread* self = static_cast<Thread*>(thread);
+		self->function_(self->data_);
+		return 0;
+	}
+#endif
+	
+	/**************************************************************************/
+	
+	ThreadLocalPointer::ThreadLocalPointer() :
+		key_(0)
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_key_t key;
+		if (0 != pthread_key_create(&key, 0))
+		{
+			LogFatal("Could not create a thread local storage key!");
+		}
+		key_ = static_cast<unsigned long>(key);
+#else
+// this is for the windows platform
+		DWORD index = TlsAlloc();
+		if (TLS_OUT_OF_INDEXES == index)
+		{
+			LogFatal("Could not create a thread local storage key!");
+		}
+		key_ = static_cast<unsigned long>(index);
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	ThreadLocalPointer::~ThreadLocalPointer()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_key_delete(static_cast<pthread_key_t>(key_));
+#else
+// this is for the windows platform
+		TlsFree(static_cast<DWORD>(key_));
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	void* ThreadLocalPointer::Get()
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		return pthread_getspecific(static_cast<pthread_key_t>(key_));
+#else
+// this is for the windows platform
+		return TlsGetValue(static_cast<DWORD>(key_));
+#endif
+	}
+	
+	/**************************************************************************/
+	
+	void ThreadLocalPointer::Set(void* value)
+	{
+// only non-windows platforms use this
+#if !defined(WIN32)
+		pthread_setspecific(static_cast<pthread_key_t>(key_), value);
+#else
+// this is for the windows platform
+		TlsSetValue(static_cast<DWORD>(key_), value);
+#endif
+	}
+
+} // end namespace
+
+
+
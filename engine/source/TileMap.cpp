@@ -17,6 +17,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdarg>
+#include <algorithm>
 
 // include the complementing header
 #include "TileMap.h"
@@ -29,8 +30,14 @@
 
 namespace ENGINE
 {
+	//! the number of tiles that share a byte of the solidity bitset
+	static const int TILEMAP_TILES_PER_SOLIDITY_BYTE = 8;
+	
+	/**************************************************************************/
+	
 	TileMap::TileMap() :
-		tiles_(0),
+		values_(0),
+		solidity_(0),
 		mapWidth_(0),
 		mapHeight_(0)
 	{
@@ -39,9 +46,12 @@ namespace ENGINE
 
 	/**************************************************************************/
 	
-	TileMap::TileMap(int width, int height)
+	TileMap::TileMap(int width, int height) :
+		values_(0),
+		solidity_(0),
+		mapWidth_(0),
+		mapHeight_(0)
 	{
-		tiles_ = 0;
 		SetSize(width, height);
 	}
 	
@@ -57,17 +67,16 @@ namespace ENGINE
 	
 	void TileMap::SetTile(int x, int y, Tile* tile)
 	{
-		int index = x + (y * mapWidth_);
-		
-		if (index > (mapWidth_ * mapHeight_))
+		if (!IsValidCoordinate(x, y))
 		{
-			LogWarning("Tile Index out of bounds: (%d, %d) = Index %d", x, y, index);
+			LogWarning("Tile Index out of bounds: (%d, %d)", x, y);
 			return;
 		}
 		
-		if (0 != tiles_[index])
+		if (0 != tile)
 		{
-			tiles_[index]->Clone(tile);
+			SetValue(x, y, tile->GetValue());
+			SetSolid(x, y, tile->IsSolid());
 		}
 	}
 	
@@ -78,34 +87,213 @@ namespace ENGINE
 		// wipe out the existing tile map
 		Destroy();
 		
+		if ((width <= 0) || (height <= 0))
+		{
+			return;
+		}
+		
 		mapWidth_ = width;
 		mapHeight_ = height;
 		
 		int tileCount = (mapWidth_ * mapHeight_);
+		int solidityBytes = (tileCount + TILEMAP_TILES_PER_SOLIDITY_BYTE - 1) / TILEMAP_TILES_PER_SOLIDITY_BYTE;
+		
+		// two allocations for the whole map, instead of one per tile
+		values_ = new TileValueType [tileCount];
+		solidity_ = new unsigned char [solidityBytes];
+		
+		memset(values_, 0, sizeof(TileValueType) * tileCount);
+		memset(solidity_, 0, solidityBytes);
 		
-		tiles_ = new Tile* [tileCount];
+		NotifyChanged(0, 0, mapWidth_, mapHeight_);
+	}
+	
+	/**************************************************************************/
+	
+	TileView TileMap::GetTile(int x, int y)
+	{
+		TileView view;
+		view.value = 0;
+		view.solid = false;
 		
-		for (int index = 0; index < tileCount; index++)
+		if (!IsValidCoordinate(x, y))
 		{
-			tiles_[index] = new Tile(0, false);
+			LogWarning("Tile Index out of bounds: (%d, %d)", x, y);
+			return view;
 		}
+		
+		view.value = GetValue(x, y);
+		view.solid = IsSolid(x, y);
+		return view;
 	}
 	
 	/**************************************************************************/
 	
-	Tile* TileMap::GetTile(int x, int y)
+	void TileMap::SetValue(int x, int y, unsigned int value)
 	{
-		int index = x + (y * mapWidth_);
+		if (value > TILEMAP_MAX_TILE_VALUE)
+		{
+			LogWarning("Tile value %u is larger than %u and was not set at (%d, %d)", value, TILEMAP_MAX_TILE_VALUE, x, y);
+			return;
+		}
 		
-		if (index > (mapWidth_ * mapHeight_))
+		if (IsValidCoordinate(x, y))
+		{
+			values_[x + (y * mapWidth_)] = static_cast<TileValueType>(value);
+			NotifyChanged(x, y, 1, 1);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int TileMap::GetValue(int x, int y)
+	{
+		if (IsValidCoordinate(x, y))
+		{
+			return static_cast<unsigned int>(values_[x + (y * mapWidth_)]);
+		}
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::SetSolid(int x, int y, bool isSolid)
+	{
+		if (IsValidCoordinate(x, y))
+		{
+			int index = x + (y * mapWidth_);
+			unsigned char mask = static_cast<unsigned char>(1 << (index % TILEMAP_TILES_PER_SOLIDITY_BYTE));
+			
+			if (isSolid)
+			{
+				solidity_[index / TILEMAP_TILES_PER_SOLIDITY_BYTE] |= mask;
+			}
+			else
+			{
+				solidity_[index / TILEMAP_TILES_PER_SOLIDITY_BYTE] &= ~mask;
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool TileMap::IsSolid(int x, int y)
+	{
+		if (IsValidCoordinate(x, y))
+		{
+			int index = x + (y * mapWidth_);
+			return 0 != (solidity_[index / TILEMAP_TILES_PER_SOLIDITY_BYTE] & (1 << (index % TILEMAP_TILES_PER_SOLIDITY_BYTE)));
+		}
+		return false;
+	}
+	
+	/**************************************************************************/
+	
+	TileValueType* TileMap::GetRow(int y)
+	{
+		if ((0 == values_) || (y < 0) || (y >= mapHeight_))
 		{
-			LogWarning("Tile Index out of bounds: (%d, %d) = Index %d", x, y, index);
 			return 0;
 		}
+		return values_ + (y * mapWidth_);
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::Fill(int x, int y, int width, int height, unsigned int value, bool isSolid)
+	{
+		if (value > TILEMAP_MAX_TILE_VALUE)
+		{
+			LogWarning("Tile value %u is larger than %u and was not filled in", value, TILEMAP_MAX_TILE_VALUE);
+			return;
+		}
+		
+		// clip the rectangle to the map
+		int x2 = x + width;
+		int y2 = y + height;
+		x = (x < 0) ? 0 : x;
+		y = (y < 0) ? 0 : y;
+		x2 = (x2 > mapWidth_) ? mapWidth_ : x2;
+		y2 = (y2 > mapHeight_) ? mapHeight_ : y2;
+		
+		if ((x >= x2) || (y >= y2))
+		{
+			return;
+		}
+		
+		TileValueType packedValue = static_cast<TileValueType>(value);
+		
+		for (int row = y; row < y2; row++)
+		{
+			TileValueType* rowValues = values_ + (row * mapWidth_);
+			for (int column = x; column < x2; column++)
+			{
+				rowValues[column] = packedValue;
+				SetSolid(column, row, isSolid);
+			}
+		}
+		
+		NotifyChanged(x, y, x2 - x, y2 - y);
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::CopyValuesIn(int x, int y, int width, int height, const TileValueType* values)
+	{
+		if ((0 == values) || !IsValidRect(x, y, width, height))
+		{
+			LogWarning("Tile rectangle out of bounds: (%d, %d) %d x %d", x, y, width, height);
+			return;
+		}
+		
+		for (int row = 0; row < height; row++)
+		{
+			memcpy(values_ + x + ((y + row) * mapWidth_), values + (row * width), sizeof(TileValueType) * width);
+		}
+		
+		NotifyChanged(x, y, width, height);
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::CopyValuesOut(int x, int y, int width, int height, TileValueType* values)
+	{
+		if ((0 == values) || !IsValidRect(x, y, width, height))
+		{
+			LogWarning("Tile rectangle out of bounds: (%d, %d) %d x %d", x, y, width, height);
+			return;
+		}
 		
-		if (0 != tiles_[index])
+		for (int row = 0; row < height; row++)
+		{
+			memcpy(values + (row * width), values_ + x + ((y + row) * mapWidth_), sizeof(TileValueType) * width);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::AddListener(TileMapListener* listener)
+	{
+		if ((0 != listener) && (listeners_.end() == std::find(listeners_.begin(), listeners_.end(), listener)))
+		{
+			listeners_.push_back(listener);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::RemoveListener(TileMapListener* listener)
+	{
+		listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), listener), listeners_.end());
+	}
+	
+	/**************************************************************************/
+	
+	void TileMap::NotifyChanged(int x, int y, int width, int height)
+	{
+		for (unsigned int index = 0; index < listeners_.size(); index++)
 		{
-			return tiles_[index];
+			listeners_[index]->OnTilesChanged(this, x, y, width, height);
 		}
 	}
 	
@@ -125,27 +313,40 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	bool TileMap::IsValidCoordinate(int x, int y)
+	{
+		return (0 != values_) && (x >= 0) && (y >= 0) && (x < mapWidth_) && (y < mapHeight_);
+	}
+	
+	/**************************************************************************/
+	
+	bool TileMap::IsValidRect(int x, int y, int width, int height)
+	{
+		return (0 != values_) && (x >= 0) && (y >= 0) && (width >= 0) && (height >= 0) && 
+			((x + width) <= mapWidth_) && ((y + height) <= mapHeight_);
+	}
+	
+	/**************************************************************************/
+	
 	void TileMap::Destroy()
 	{
-		if (0 != tiles_)
+		if (0 != values_)
 		{
-			int tileCount = (mapWidth_ * mapHeight_);
+			delete [] values_;
+			values_ = 0;
+		}
 		
-			for (int index = 0; index < tileCount; index++)
-			{
-				if (0 != tiles_[index])
-				{
-					delete tiles_[index];
-					tiles_[index] = 0;
-				}
-			}
-			delete [] tiles_;
-			tiles_ = 0;
-			mapWidth_ = 0;
-			mapHeight_ = 0;
+		if (0 != solidity_)
+		{
+			delete [] solidity_;
+			solidity_ = 0;
 		}
+		
+		mapWidth_ = 0;
+		mapHeight_ = 0;
 	}
 
 } // end namespace
 
 
+
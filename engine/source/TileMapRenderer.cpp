@@ -18,9 +18,15 @@
 #include <cstring>
 #include <cstdarg>
 
+// include Allegro
+#include <allegro.h>
+
 // include the complementing header
 #include "TileMapRenderer.h"
 
+// include the profiler header
+#include "Profiler.h"
+
 // include the tileset header
 #include "Tileset.h"
 
@@ -38,7 +44,76 @@
 
 namespace ENGINE
 {
+	/**
+	 * divides rounding towards negative infinity so that negative camera coordinates
+	 * still land on the correct tile
+	 */
+	static int FloorDivide(int numerator, int denominator)
+	{
+		int quotient = numerator / denominator;
+		if ((numerator % denominator != 0) && ((numerator < 0) != (denominator < 0)))
+		{
+			quotient--;
+		}
+		return quotient;
+	}
+	
+	/**************************************************************************/
+	
+	/**
+	 * copies a rectangle of a tile onto the target, clipped to a rectangle instead of the clipping rectangle of the target
+	 */
+	static void BlitClipped(
+		ImageResource* source, ImageResource* target, 
+		int srcX, int srcY, int destX, int destY, int width, int height, 
+		int clipX1, int clipY1, int clipX2, int clipY2)
+	{
+		// blit() would not read past the edges of the source either
+		if (srcX + width > source->GetWidth())
+		{
+			width = source->GetWidth() - srcX;
+		}
+		if (srcY + height > source->GetHeight())
+		{
+			height = source->GetHeight() - srcY;
+		}
+		
+		if (destX < clipX1)
+		{
+			width -= clipX1 - destX;
+			srcX += clipX1 - destX;
+			destX = clipX1;
+		}
+		if (destY < clipY1)
+		{
+			height -= clipY1 - destY;
+			srcY += clipY1 - destY;
+			destY = clipY1;
+		}
+		if (destX + width > clipX2 + 1)
+		{
+			width = clipX2 + 1 - destX;
+		}
+		if (destY + height > clipY2 + 1)
+		{
+			height = clipY2 + 1 - destY;
+		}
+		
+		if ((width > 0) && (height > 0))
+		{
+			blit(source->GetBitmap(), target->GetBitmap(), srcX, srcY, destX, destY, width, height);
+		}
+	}
+	
+	/**************************************************************************/
+	
 	TileMapRenderer::TileMapRenderer() :
+		cameraX_(0),
+		cameraY_(0),
+		viewportX_(0),
+		viewportY_(0),
+		viewportWidth_(0),
+		viewportHeight_(0),
 		tileMap_(0),
 		tileSet_(0),
 		renderTarget_(0)
@@ -47,30 +122,20 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
-	TileMapRenderer::TileMapRenderer(TileMap* tileMap, Tileset* tileSet, ImageResource* target)
+	TileMapRenderer::TileMapRenderer(TileMap* tileMap, Tileset* tileSet, ImageResource* target) :
+		cameraX_(0),
+		cameraY_(0),
+		viewportX_(0),
+		viewportY_(0),
+		viewportWidth_(0),
+		viewportHeight_(0),
+		tileMap_(0),
+		tileSet_(0),
+		renderTarget_(0)
 	{
 		SetTileMap(tileMap);
 		SetTileset(tileSet);
 		SetRenderTarget(target);
-		
-		int targetWidth 	= renderTarget_->GetWidth();
-		int targetHeight 	= renderTarget_->GetHeight();
-		
-		int mapWidth 		= tileMap_->GetWidth();
-		int mapHeight 		= tileMap_->GetHeight();
-		
-		int tileWidth 		= tileSet_->Get(static_cast<unsigned int>(0))->GetWidth();
-		int tileHeight 		= tileSet_->Get(static_cast<unsigned int>(0))->GetHeight();
-		
-		if ((targetWidth < (mapWidth * tileWidth)) || (targetHeight < (mapHeight * tileHeight)))
-		{
-			LogWarning(
-				"The render target is not large enough to contain the entire tile map!\n"
-				"Render Target is %d x %d\n"
-				"Tile Map is %d x %d\n"
-				"Tile size is %d x %d\n", 
-				targetWidth, targetHeight, mapWidth, mapHeight, tileWidth, tileHeight);
-		}
 	}
 	
 	/**************************************************************************/
@@ -94,6 +159,8 @@ namespace ENGINE
 		tileSet_ = tileSet;
 	}
 	
+	/**************************************************************************/
+	
 	void TileMapRenderer::SetRenderTarget(ImageResource* target)
 	{
 		renderTarget_ = target;
@@ -101,29 +168,365 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
-	void TileMapRenderer::Render()
+	void TileMapRenderer::SetCamera(int x, int y)
+	{
+		cameraX_ = x;
+		cameraY_ = y;
+	}
+	
+	/**************************************************************************/
+	
+	void TileMapRenderer::ScrollCamera(int deltaX, int deltaY)
+	{
+		cameraX_ += deltaX;
+		cameraY_ += deltaY;
+	}
+	
+	/**************************************************************************/
+	
+	void TileMapRenderer::SetViewport(int x, int y, int width, int height)
+	{
+		viewportX_ 		= x;
+		viewportY_ 		= y;
+		viewportWidth_ 	= (width < 0) ? 0 : width;
+		viewportHeight_ = (height < 0) ? 0 : height;
+	}
+	
+	/**************************************************************************/
+	
+	int TileMapRenderer::GetCameraX()
+	{
+		return cameraX_;
+	}
+	
+	/**************************************************************************/
+	
+	int TileMapRenderer::GetCameraY()
+	{
+		return cameraY_;
+	}
+	
+	/**************************************************************************/
+	
+	int TileMapRenderer::GetViewportX()
+	{
+		return viewportX_;
+	}
+	
+	/**************************************************************************/
+	
+	int TileMapRenderer::GetViewportY()
+	{
+		return viewportY_;
+	}
+	
+	/**************************************************************************/
+	
+	int TileMapRenderer::GetViewportWidth()
+	{
+		if ((0 == viewportWidth_) && (0 != renderTarget_))
+		{
+			return renderTarget_->GetWidth() - viewportX_;
+		}
+		return viewportWidth_;
+	}
+	
+	/**************************************************************************/
+	
+	int TileMapRenderer::GetViewportHeight()
+	{
+		if ((0 == viewportHeight_) && (0 != renderTarget_))
+		{
+			return renderTarget_->GetHeight() - viewportY_;
+		}
+		return viewportHeight_;
+	}
+	
+	/**************************************************************************/
+	
+	TileMapView TileMapRenderer::GetView()
+	{
+		TileMapView view;
+		view.cameraX 		= cameraX_;
+		view.cameraY 		= cameraY_;
+		view.viewportX 		= viewportX_;
+		view.viewportY 		= viewportY_;
+		view.viewportWidth 	= GetViewportWidth();
+		view.viewportHeight = GetViewportHeight();
+		return view;
+	}
+	
+	/**************************************************************************/
+	
+	bool TileMapRenderer::GetVisibleTileRange(int& firstColumn, int& firstRow, int& lastColumn, int& lastRow)
 	{
+		return GetVisibleTileRange(GetView(), firstColumn, firstRow, lastColumn, lastRow);
+	}
+	
+	/**************************************************************************/
+	
+	bool TileMapRenderer::GetVisibleTileRange(const TileMapView& view, int& firstColumn, int& firstRow, int& lastColumn, int& lastRow)
+	{
+		ImageResource* firstTile = tileSet_->Get(static_cast<unsigned int>(0));
+		if (0 == firstTile)
+		{
+			return false;
+		}
+		
+		int tileWidth 		= firstTile->GetWidth();
+		int tileHeight 		= firstTile->GetHeight();
+		int viewWidth 		= view.viewportWidth;
+		int viewHeight 		= view.viewportHeight;
+		
+		if ((tileWidth <= 0) || (tileHeight <= 0) || (viewWidth <= 0) || (viewHeight <= 0))
+		{
+			return false;
+		}
+		
+		firstColumn 	= FloorDivide(view.cameraX, tileWidth);
+		firstRow 		= FloorDivide(view.cameraY, tileHeight);
+		lastColumn 		= FloorDivide(view.cameraX + viewWidth - 1, tileWidth) + 1;
+		lastRow 		= FloorDivide(view.cameraY + viewHeight - 1, tileHeight) + 1;
+		
+		// clip the range to the bounds of the map
 		int mapWidth 	= tileMap_->GetWidth();
 		int mapHeight 	= tileMap_->GetHeight();
+		
+		firstColumn 	= (firstColumn < 0) ? 0 : firstColumn;
+		firstRow 		= (firstRow < 0) ? 0 : firstRow;
+		lastColumn 		= (lastColumn > mapWidth) ? mapWidth : lastColumn;
+		lastRow 		= (lastRow > mapHeight) ? mapHeight : lastRow;
+		
+		return (firstColumn < lastColumn) && (firstRow < lastRow);
+	}
+	
+	/**************************************************************************/
+	
+	void TileMapRenderer::Render()
+	{
+		ProfileScope("TileMapRenderer::Render");
+		
+		if ((0 == tileMap_) || (0 == tileSet_) || (0 == renderTarget_))
+		{
+			LogWarning("Attempted to render with an incomplete TileMapRenderer!");
+			return;
+		}
+		
+		int firstColumn = 0;
+		int firstRow 	= 0;
+		int lastColumn 	= 0;
+		int lastRow 	= 0;
+		
+		if (!GetVisibleTileRange(firstColumn, firstRow, lastColumn, lastRow))
+		{
+			// nothing is visible
+			return;
+		}
+		
+		int tileWidth 	= tileSet_->Get(static_cast<unsigned int>(0))->GetWidth();
+		int tileHeight 	= tileSet_->Get(static_cast<unsigned int>(0))->GetHeight();
+		
+		int oldClipX1 = 0, oldClipY1 = 0, oldClipX2 = 0, oldClipY2 = 0;
+		if (!ClipToViewport(oldClipX1, oldClipY1, oldClipX2, oldClipY2))
+		{
+			return;
+		}
+		
+		// the screen position of the first visible tile includes the sub-tile scroll offset
+		DrawTiles(renderTarget_, firstColumn, firstRow, lastColumn, lastRow, 
+			viewportX_ + (firstColumn * tileWidth) - cameraX_,
+			viewportY_ + (firstRow * tileHeight) - cameraY_);
+		
+		renderTarget_->SetClipRect(oldClipX1, oldClipY1, oldClipX2, oldClipY2);
+	}
+	
+	/**************************************************************************/
+	
+	bool TileMapRenderer::CopyViewTiles(const TileMapView& view, std::vector<TileValueType>& values, TileMapViewTiles& tiles)
+	{
+		tiles.firstColumn 	= 0;
+		tiles.firstRow 		= 0;
+		tiles.columnCount 	= 0;
+		tiles.rowCount 		= 0;
+		tiles.values 		= 0;
+		
+		if ((0 == tileMap_) || (0 == tileSet_))
+		{
+			return false;
+		}
+		
+		int firstColumn = 0;
+		int firstRow 	= 0;
+		int lastColumn 	= 0;
+		int lastRow 	= 0;
+		
+		if (!GetVisibleTileRange(view, firstColumn, firstRow, lastColumn, lastRow))
+		{
+			// nothing is visible
+			return false;
+		}
+		
+		tiles.firstColumn 	= firstColumn;
+		tiles.firstRow 		= firstRow;
+		tiles.columnCount 	= lastColumn - firstColumn;
+		tiles.rowCount 		= lastRow - firstRow;
+		
+		// only the visible part of each row is copied, which is about a screenful of tiles
+		for (int row = firstRow; row < lastRow; row++)
+		{
+			TileValueType* rowValues = tileMap_->GetRow(row);
+			values.insert(values.end(), rowValues + firstColumn, rowValues + lastColumn);
+		}
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void TileMapRenderer::RenderView(ImageResource* target, const TileMapView& view, const TileMapViewTiles& tiles, int clipX1, int clipY1, int clipX2, int clipY2)
+	{
+		if ((0 == tileSet_) || (0 == target) || (0 == tiles.values))
+		{
+			return;
+		}
+		
+		int firstColumn = tiles.firstColumn;
+		int firstRow 	= tiles.firstRow;
+		int lastColumn 	= tiles.firstColumn + tiles.columnCount;
+		int lastRow 	= tiles.firstRow + tiles.rowCount;
+		
+		// the tiles are clipped to the viewport, like ClipToViewport() does
+		clipX1 = (clipX1 < view.viewportX) ? view.viewportX : clipX1;
+		clipY1 = (clipY1 < view.viewportY) ? view.viewportY : clipY1;
+		clipX2 = (clipX2 > view.viewportX + view.viewportWidth - 1) ? view.viewportX + view.viewportWidth - 1 : clipX2;
+		clipY2 = (clipY2 > view.viewportY + view.viewportHeight - 1) ? view.viewportY + view.viewportHeight - 1 : clipY2;
+		
+		if ((clipX1 > clipX2) || (clipY1 > clipY2))
+		{
+			return;
+		}
+		
 		int tileWidth 	= tileSet_->Get(static_cast<unsigned int>(0))->GetWidth();
 		int tileHeight 	= tileSet_->Get(static_cast<unsigned int>(0))->GetHeight();
 		
-		for (int row = 0; row < mapHeight; row++)
+		ImageResource* atlas = tileSet_->GetAtlas();
+		
+		int startX = view.viewportX + (firstColumn * tileWidth) - view.cameraX;
+		int y = view.viewportY + (firstRow * tileHeight) - view.cameraY;
+		
+		for (int row = firstRow; row < lastRow; row++, y += tileHeight)
 		{
-			for (int column = 0; column < mapWidth; column++)
+			// rows outside of the clipping rectangle are skipped without looking at their tiles
+			if ((y + tileHeight <= clipY1) || (y > clipY2))
+			{
+				continue;
+			}
+			
+			int x = startX;
+			const TileValueType* rowValues = tiles.values + ((row - firstRow) * tiles.columnCount);
+			
+			for (int column = firstColumn; column < lastColumn; column++, x += tileWidth)
 			{
-				int x = column * tileWidth;
-				int y = row * tileHeight;
+				unsigned int tileValue = static_cast<unsigned int>(rowValues[column - firstColumn]);
 				
-				Tile* tile = tileMap_->GetTile(column, row);
+				if (0 != atlas)
+				{
+					TilesetAtlasRect* rect = tileSet_->GetAtlasRect(tileValue);
+					
+					if (0 != rect)
+					{
+						BlitClipped(atlas, target, rect->x, rect->y, x, y, tileWidth, tileHeight, clipX1, clipY1, clipX2, clipY2);
+					}
+				}
+				else
+				{
+					ImageResource* tileImage = tileSet_->Get(tileValue);
+					
+					if (0 != tileImage)
+					{
+						BlitClipped(tileImage, target, 0, 0, x, y, tileWidth, tileHeight, clipX1, clipY1, clipX2, clipY2);
+					}
+				}
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	bool TileMapRenderer::ClipToViewport(int& oldClipX1, int& oldClipY1, int& oldClipX2, int& oldClipY2)
+	{
+		// clip the render target to the viewport so that partially visible tiles
+		// along the edges do not spill outside of it
+		renderTarget_->GetClipRect(oldClipX1, oldClipY1, oldClipX2, oldClipY2);
+		
+		int clipX1 = viewportX_;
+		int clipY1 = viewportY_;
+		int clipX2 = viewportX_ + GetViewportWidth() - 1;
+		int clipY2 = viewportY_ + GetViewportHeight() - 1;
+		
+		clipX1 = (clipX1 < oldClipX1) ? oldClipX1 : clipX1;
+		clipY1 = (clipY1 < oldClipY1) ? oldClipY1 : clipY1;
+		clipX2 = (clipX2 > oldClipX2) ? oldClipX2 : clipX2;
+		clipY2 = (clipY2 > oldClipY2) ? oldClipY2 : clipY2;
+		
+		if ((clipX1 > clipX2) || (clipY1 > clipY2))
+		{
+			return false;
+		}
+		
+		renderTarget_->SetClipRect(clipX1, clipY1, clipX2, clipY2);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void TileMapRenderer::DrawTiles(ImageResource* target, int firstColumn, int firstRow, int lastColumn, int lastRow, int startX, int startY)
+	{
+		int tileWidth 	= tileSet_->Get(static_cast<unsigned int>(0))->GetWidth();
+		int tileHeight 	= tileSet_->Get(static_cast<unsigned int>(0))->GetHeight();
+		
+		// when the tileset has been packed into an atlas, every tile is drawn from that single image
+		ImageResource* atlas = tileSet_->GetAtlas();
+		
+		int y = startY;
+		
+		for (int row = firstRow; row < lastRow; row++)
+		{
+			int x = startX;
+			
+			// sweep the packed row of tile values in order
+			TileValueType* rowValues = tileMap_->GetRow(row);
+			
+			for (int column = firstColumn; column < lastColumn; column++)
+			{
+				unsigned int tileValue = static_cast<unsigned int>(rowValues[column]);
 				
-				unsigned int tileValue = tile->GetValue();
+				if (0 != atlas)
+				{
+					TilesetAtlasRect* rect = tileSet_->GetAtlasRect(tileValue);
+					
+					if (0 != rect)
+					{
+						atlas->Blit(target, rect->x, rect->y, x, y, tileWidth, tileHeight);
+					}
+				}
+				else
+				{
+					ImageResource* tileImage = tileSet_->Get(tileValue);
+					
+					if (0 != tileImage)
+					{
+						tileImage->Blit(target, 0, 0, x, y, tileWidth, tileHeight);
+					}
+				}
 				
-				tileSet_->Get(tileValue)->Blit(renderTarget_, 0, 0, x, y, tileWidth, tileHeight);
+				x += tileWidth;
 			}
-		} 
+			
+			y += tileHeight;
+		}
 	}
 	
 } // end namespace
 
 
+
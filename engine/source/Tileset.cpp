@@ -17,6 +17,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdarg>
+#include <algorithm>
+#include <utility>
 
 // include the complementing header
 #include "Tileset.h"
@@ -24,6 +26,9 @@
 // include the image resource header
 #include "ImageResource.h"
 
+// include the image cache header
+#include "ImageCache.h"
+
 // include the image list header
 #include "ImageList.h"
 
@@ -35,7 +40,8 @@
 
 namespace ENGINE
 {
-	Tileset::Tileset()
+	Tileset::Tileset() :
+		atlas_(0)
 	{
 		names_ = new NameDirectory();
 		images_ = new ImageList();
@@ -52,6 +58,9 @@ namespace ENGINE
 		
 	void Tileset::Add(const char* tileName, ImageResource* image)
 	{
+		// the atlas no longer holds every tile
+		DestroyAtlas();
+		
 		images_->Add(image);
 		
 		unsigned int count = static_cast<unsigned int>(images_->GetCount() - 1);
@@ -62,6 +71,9 @@ namespace ENGINE
 	
 	void Tileset::AddRange(const char* tileNamePrefix, unsigned int count, ...)
 	{
+		// the atlas no longer holds every tile
+		DestroyAtlas();
+		
 		va_list va;
 		va_start(va, count);
 		
@@ -84,9 +96,61 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	unsigned int Tileset::AddSheet(const char* tileNamePrefix, const char* fileName, int tileWidth, int tileHeight)
+	{
+		if ((tileWidth <= 0) || (tileHeight <= 0))
+		{
+			LogError("Invalid tile size %d x %d for the sheet %s!", tileWidth, tileHeight, fileName);
+			return 0;
+		}
+		
+		ImageResource* sheet = ImageCache->Acquire(fileName);
+		if (0 == sheet)
+		{
+			return 0;
+		}
+		
+		int columns = sheet->GetWidth() / tileWidth;
+		int rows = sheet->GetHeight() / tileHeight;
+		unsigned int added = 0;
+		
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				// the tiles are cut out of the sheet by the image cache, so that every tileset using the sheet shares them
+				ImageResource* image = ImageCache->Acquire(fileName, column * tileWidth, row * tileHeight, tileWidth, tileHeight);
+				if (0 == image)
+				{
+					continue;
+				}
+				
+				char tileName[1024];
+				snprintf(tileName, 1024, "%s%d", tileNamePrefix, added);
+				Add(tileName, image);
+				added++;
+			}
+		}
+		
+		ImageCache->Release(sheet);
+		
+		return added;
+	}
+	
+	/**************************************************************************/
+	
 	ImageResource* Tileset::Get(const char* tileName)
 	{
-		return images_->Get(names_->Get(tileName));
+		unsigned int tileID = 0;
+		return (names_->TryGet(tileName, tileID)) ? images_->Get(tileID) : 0;
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* Tileset::Get(NameID tileName)
+	{
+		unsigned int tileID = 0;
+		return (names_->TryGet(tileName, tileID)) ? images_->Get(tileID) : 0;
 	}
 	
 	/**************************************************************************/
@@ -105,15 +169,162 @@ namespace ENGINE
 	
 	/**************************************************************************/
 	
+	unsigned int Tileset::GetIndex(NameID tileName)
+	{
+		return names_->Get(tileName);
+	}
+	
+	/**************************************************************************/
+	
 	unsigned int Tileset::GetCount()
 	{
 		return images_->GetCount();
 	}
 	
+	/**************************************************************************/
+	
+	bool Tileset::BuildAtlas(int maxAtlasWidth)
+	{
+		DestroyAtlas();
+		
+		unsigned int tileCount = images_->GetCount();
+		if (0 == tileCount)
+		{
+			LogWarning("Cannot build an atlas for an empty tileset!");
+			return false;
+		}
+		
+		// sort the tiles from tallest to shortest so that each shelf wastes as little height as possible
+		std::vector<std::pair<int, unsigned int> > order;
+		for (unsigned int index = 0; index < tileCount; index++)
+		{
+			ImageResource* image = images_->Get(index);
+			int height = (0 != image && 0 != image->GetBitmap()) ? image->GetHeight() : 0;
+			order.push_back(std::make_pair(-height, index));
+		}
+		std::sort(order.begin(), order.end());
+		
+		// place the tiles on shelves from left to right
+		TilesetAtlasRect emptyRect = { 0, 0, 0, 0 };
+		atlasRects_.assign(tileCount, emptyRect);
+		
+		int atlasWidth = 0;
+		int shelfX = 0;
+		int shelfY = 0;
+		int shelfHeight = 0;
+		
+		for (unsigned int index = 0; index < tileCount; index++)
+		{
+			ImageResource* image = images_->Get(order[index].second);
+			if ((0 == image) || (0 == image->GetBitmap()))
+			{
+				continue;
+			}
+			
+			int width = image->GetWidth();
+			int height = image->GetHeight();
+			
+			if ((shelfX > 0) && ((shelfX + width) > maxAtlasWidth))
+			{
+				// start a new shelf
+				shelfY += shelfHeight;
+				shelfX = 0;
+				shelfHeight = 0;
+			}
+			
+			TilesetAtlasRect& rect = atlasRects_[order[index].second];
+			rect.x = shelfX;
+			rect.y = shelfY;
+			rect.width = width;
+			rect.height = height;
+			
+			shelfX += width;
+			shelfHeight = (height > shelfHeight) ? height : shelfHeight;
+			atlasWidth = (shelfX > atlasWidth) ? shelfX : atlasWidth;
+		}
+		
+		int atlasHeight = shelfY + shelfHeight;
+		if ((0 == atlasWidth) || (0 == atlasHeight))
+		{
+			atlasRects_.clear();
+			LogWarning("Cannot build an atlas for a tileset with no valid images!");
+			return false;
+		}
+		
+		// copy the tiles into the atlas
+		atlas_ = new ImageResource(atlasWidth, atlasHeight);
+		if (0 == atlas_->GetBitmap())
+		{
+			DestroyAtlas();
+			return false;
+		}
+		
+		for (unsigned int index = 0; index < tileCount; index++)
+		{
+			TilesetAtlasRect& rect = atlasRects_[index];
+			if (rect.width > 0)
+			{
+				images_->Get(index)->Blit(atlas_, 0, 0, rect.x, rect.y, rect.width, rect.height);
+			}
+		}
+		
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void Tileset::DestroyAtlas()
+	{
+		if (0 != atlas_)
+		{
+			delete atlas_;
+			atlas_ = 0;
+		}
+		atlasRects_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	ImageResource* Tileset::GetAtlas()
+	{
+		return atlas_;
+	}
+	
+	/**************************************************************************/
+	
+	TilesetAtlasRect* Tileset::GetAtlasRect(unsigned int tileID)
+	{
+		if ((0 == atlas_) || (tileID >= atlasRects_.size()) || (0 == atlasRects_[tileID].width))
+		{
+			return 0;
+		}
+		return &atlasRects_[tileID];
+	}
+	
+	/**************************************************************************/
+	
+	void Tileset::BlitTile(unsigned int tileID, ImageResource* destination, int destX, int destY)
+	{
+		TilesetAtlasRect* rect = GetAtlasRect(tileID);
+		if (0 != rect)
+		{
+			atlas_->Blit(destination, rect->x, rect->y, destX, destY, rect->width, rect->height);
+			return;
+		}
+		
+		ImageResource* image = images_->Get(tileID);
+		if (0 != image)
+		{
+			image->Blit(destination, 0, 0, destX, destY, image->GetWidth(), image->GetHeight());
+		}
+	}
+	
 	/**************************************************************************/
 
 	void Tileset::Destroy()
 	{
+		DestroyAtlas();
+		
 		if (0 != names_)
 		{
 			delete names_;
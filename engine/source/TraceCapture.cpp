@@ -0,0 +1,332 @@
+
+// CODESTYLE: v2.0
+
+// TraceCapture.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Records a timeline of engine events and saves it as a Chrome trace file
+
+/**
+ * \file TraceCapture.cpp
+ * \brief Trace Capture Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+
+// include the complementing header
+#include "TraceCapture.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	/**
+	 * writes a string to a file as the contents of a JSON string, escaping the characters that need it
+	 */
+	static void WriteJSONString(FILE* fp, const char* text)
+	{
+		for (const char* cursor = text; '\0' != *cursor; cursor++)
+		{
+			unsigned char letter = static_cast<unsigned char>(*cursor);
+			
+			if (('"' == letter) || ('\\' == letter))
+			{
+				fputc('\\', fp);
+				fputc(letter, fp);
+			}
+			else if (letter < 0x20)
+			{
+				fprintf(fp, "\\u%04x", letter);
+			}
+			else
+			{
+				fputc(letter, fp);
+			}
+		}
+	}
+	
+	/**************************************************************************/
+	
+	TraceCaptureSingleton* TraceCaptureSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static TraceCaptureSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	TraceCaptureSingleton::TraceCaptureSingleton() :
+		capturing_(0),
+		eventsPerThread_(TRACE_CAPTURE_DEFAULT_EVENTS_PER_THREAD)
+	{
+		strncpy(fileName_, TRACE_CAPTURE_DEFAULT_FILE_NAME, TRACE_CAPTURE_MAX_FILE_NAME_LENGTH - 1);
+		fileName_[TRACE_CAPTURE_MAX_FILE_NAME_LENGTH - 1] = '\0';
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	TraceCaptureSingleton::~TraceCaptureSingleton()
+	{
+		if (0 != capturing_)
+		{
+			StopCapture();
+		}
+		
+		for (unsigned int index = 0; index < buffers_.size(); index++)
+		{
+			delete [] buffers_[index]->events;
+			delete [] buffers_[index]->details;
+			delete buffers_[index];
+		}
+		buffers_.clear();
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	void TraceCaptureSingleton::StartCapture(const char* fileName)
+	{
+		MutexLock lock(buffersLock_);
+		
+		strncpy(fileName_, fileName, TRACE_CAPTURE_MAX_FILE_NAME_LENGTH - 1);
+		fileName_[TRACE_CAPTURE_MAX_FILE_NAME_LENGTH - 1] = '\0';
+		
+		for (unsigned int index = 0; index < buffers_.size(); index++)
+		{
+			buffers_[index]->count 			= 0;
+			buffers_[index]->dropped 		= 0;
+			buffers_[index]->detailsUsed 	= 0;
+		}
+		
+		AtomicMemoryBarrier();
+		capturing_ = 1;
+		
+		LogMessage("Trace capture started. The trace will be saved to %s", fileName_);
+	}
+	
+	/**************************************************************************/
+	
+	bool TraceCaptureSingleton::StopCapture()
+	{
+		if (!AtomicCompareAndSwap(&capturing_, 1, 0))
+		{
+			return false;
+		}
+		
+		return WriteTrace();
+	}
+	
+	/**************************************************************************/
+	
+	bool TraceCaptureSingleton::IsCapturing()
+	{
+		return (0 != capturing_);
+	}
+	
+	/**************************************************************************/
+	
+	void TraceCaptureSingleton::SetEventsPerThread(unsigned int eventsPerThread)
+	{
+		eventsPerThread_ = (0 == eventsPerThread) ? 1 : eventsPerThread;
+	}
+	
+	/**************************************************************************/
+	
+	void TraceCaptureSingleton::SetThreadName(const char* threadName)
+	{
+		TraceThreadBuffer* buffer = GetThreadBuffer();
+		strncpy(buffer->threadName, threadName, TRACE_CAPTURE_MAX_THREAD_NAME_LENGTH - 1);
+		buffer->threadName[TRACE_CAPTURE_MAX_THREAD_NAME_LENGTH - 1] = '\0';
+	}
+	
+	/**************************************************************************/
+	
+	void TraceCaptureSingleton::BeginEvent(const char* name, const char* category, const char* detail)
+	{
+		if (0 != capturing_)
+		{
+			RecordEvent('B', name, category, detail);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	void TraceCaptureSingleton::EndEvent(const char* name, const char* category)
+	{
+		if (0 != capturing_)
+		{
+			RecordEvent('E', name, category, 0);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	TraceThreadBuffer* TraceCaptureSingleton::GetThreadBuffer()
+	{
+		TraceThreadBuffer* buffer = static_cast<TraceThreadBuffer*>(threadBuffer_.Get());
+		
+		if (0 == buffer)
+		{
+			// the first event on this thread, so give it a buffer of its own
+			buffer = new TraceThreadBuffer;
+			buffer->events 		= new TraceEvent [eventsPerThread_];
+			buffer->capacity 	= eventsPerThread_;
+			buffer->count 		= 0;
+			buffer->dropped 	= 0;
+			buffer->details 	= new char [TRACE_CAPTURE_DETAIL_BYTES_PER_THREAD];
+			buffer->detailsUsed = 0;
+			
+			MutexLock lock(buffersLock_);
+			buffers_.push_back(buffer);
+			buffer->threadID = static_cast<unsigned int>(buffers_.size());
+			sprintf(buffer->threadName, "thread %u", buffer->threadID);
+			
+			threadBuffer_.Set(buffer);
+		}
+		
+		return buffer;
+	}
+	
+	/**************************************************************************/
+	
+	void TraceCaptureSingleton::RecordEvent(char phase, const char* name, const char* category, const char* detail)
+	{
+		TraceThreadBuffer* buffer = GetThreadBuffer();
+		
+		unsigned int count = static_cast<unsigned int>(buffer->count);
+		if (count >= buffer->capacity)
+		{
+			buffer->dropped++;
+			return;
+		}
+		
+		TraceEvent& event 	= buffer->events[count];
+		event.name 			= name;
+		event.category 		= category;
+		event.timestamp 	= GameTimer->GetTicks();
+		event.phase 		= phase;
+		event.detailOffset 	= -1;
+		
+		if (0 != detail)
+		{
+			unsigned int length = static_cast<unsigned int>(strlen(detail)) + 1;
+			if (buffer->detailsUsed + length <= TRACE_CAPTURE_DETAIL_BYTES_PER_THREAD)
+			{
+				memcpy(buffer->details + buffer->detailsUsed, detail, length);
+				event.detailOffset = static_cast<int>(buffer->detailsUsed);
+				buffer->detailsUsed += length;
+			}
+		}
+		
+		// publish the event only after it has been completely written
+		AtomicMemoryBarrier();
+		buffer->count = static_cast<int>(count + 1);
+	}
+	
+	/**************************************************************************/
+	
+	bool TraceCaptureSingleton::WriteTrace()
+	{
+		MutexLock lock(buffersLock_);
+		
+		FILE* fp = fopen(fileName_, "w");
+		if (0 == fp)
+		{
+			LogError("Could not open %s to save the trace!", fileName_);
+			return false;
+		}
+		
+		fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		
+		bool firstEvent = true;
+		unsigned int totalEvents = 0;
+		unsigned int totalDropped = 0;
+		
+		for (unsigned int bufferIndex = 0; bufferIndex < buffers_.size(); bufferIndex++)
+		{
+			TraceThreadBuffer* buffer = buffers_[bufferIndex];
+			
+			AtomicMemoryBarrier();
+			unsigned int count = static_cast<unsigned int>(buffer->count);
+			
+			// name the thread
+			fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", 
+				(firstEvent) ? "" : ",\n", buffer->threadID);
+			WriteJSONString(fp, buffer->threadName);
+			fprintf(fp, "\"}}");
+			firstEvent = false;
+			
+			for (unsigned int index = 0; index < count; index++)
+			{
+				TraceEvent& event = buffer->events[index];
+				
+				fprintf(fp, ",\n{\"name\":\"");
+				WriteJSONString(fp, event.name);
+				fprintf(fp, "\",\"cat\":\"");
+				WriteJSONString(fp, event.category);
+				fprintf(fp, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u", 
+					event.phase, 
+					static_cast<double>(event.timestamp) / static_cast<double>(GAMETIMER_TICKS_PER_MICROSECOND),
+					buffer->threadID);
+				
+				if (event.detailOffset >= 0)
+				{
+					fprintf(fp, ",\"args\":{\"detail\":\"");
+					WriteJSONString(fp, buffer->details + event.detailOffset);
+					fprintf(fp, "\"}");
+				}
+				
+				fprintf(fp, "}");
+			}
+			
+			totalEvents += count;
+			totalDropped += buffer->dropped;
+		}
+		
+		fprintf(fp, "\n]}\n");
+		fclose(fp);
+		
+		if (totalDropped > 0)
+		{
+			LogWarning("The trace buffers were full, and %u events were dropped!", totalDropped);
+		}
+		
+		LogMessage("Saved %u trace events from %u threads to %s", 
+			totalEvents, static_cast<unsigned int>(buffers_.size()), fileName_);
+		
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	TraceZone::TraceZone(const char* name, const char* category, const char* detail) :
+		name_(0),
+		category_(category)
+	{
+		if (TraceCapture->IsCapturing())
+		{
+			name_ = name;
+			TraceCapture->BeginEvent(name, category, detail);
+		}
+	}
+	
+	/**************************************************************************/
+	
+	TraceZone::~TraceZone()
+	{
+		if (0 != name_)
+		{
+			TraceCapture->EndEvent(name_, category_);
+		}
+	}
+
+} // end namespace
+
+
+
@@ -0,0 +1,644 @@
+
+// CODESTYLE: v2.0
+
+// VirtualFileSystem.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Reads the asset files out of memory-mapped ged101 pack archives, or from loose files on disk
+
+/**
+ * \file VirtualFileSystem.cpp
+ * \brief Virtual File System Module - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+// only non-windows platforms use this
+#if !defined(WIN32)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+// this is for the windows platform
+#include <windows.h>
+#endif
+
+// include the complementing header
+#include "VirtualFileSystem.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+// include the trace capture header
+#include "TraceCapture.h"
+
+// include the error reporting header
+#include "DebugReport.h"
+
+namespace ENGINE
+{
+	AssetArchive::AssetArchive() :
+		data_(0),
+		size_(0),
+		header_(0),
+		entries_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	AssetArchive::~AssetArchive()
+	{
+		// implement class destructor here
+		Close();
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	bool AssetArchive::Open(const char* fileName)
+	{
+		TraceZone traceZone("AssetArchive::Open", "asset", fileName);
+		
+		Close();
+
+// only non-windows platforms use this
+#if !defined(WIN32)
+		int fd = open(fileName, O_RDONLY);
+		if (fd < 0)
+		{
+			LogError("Could not open the archive %s!", fileName);
+			return false;
+		}
+		
+		struct stat fileInfo;
+		if ((0 != fstat(fd, &fileInfo)) || (fileInfo.st_size <= 0))
+		{
+			close(fd);
+			LogError("Could not read the size of the archive %s!", fileName);
+			return false;
+		}
+		size_ = static_cast<unsigned long>(fileInfo.st_size);
+		
+		void* mapping = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		
+		// the mapping stays valid after the file is closed
+		close(fd);
+		
+		if (MAP_FAILED == mapping)
+		{
+			size_ = 0;
+			LogError("Could not map the archive %s!", fileName);
+			return false;
+		}
+		data_ = static_cast<const unsigned char*>(mapping);
+#else
+// this is for the windows platform
+		HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+		if (INVALID_HANDLE_VALUE == file)
+		{
+			LogError("Could not open the archive %s!", fileName);
+			return false;
+		}
+		
+		DWORD fileSize = GetFileSize(file, 0);
+		if ((INVALID_FILE_SIZE == fileSize) || (0 == fileSize))
+		{
+			CloseHandle(file);
+			LogError("Could not read the size of the archive %s!", fileName);
+			return false;
+		}
+		size_ = static_cast<unsigned long>(fileSize);
+		
+		HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+		void* view = (0 != mapping) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+		
+		// the view stays valid after the handles are closed
+		if (0 != mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		
+		if (0 == view)
+		{
+			size_ = 0;
+			LogError("Could not map the archive %s!", fileName);
+			return false;
+		}
+		data_ = static_cast<const unsigned char*>(view);
+#endif
+
+		fileName_ = fileName;
+		header_ = reinterpret_cast<const AssetArchiveHeader*>(data_);
+		
+		if (!Validate())
+		{
+			LogError("%s is not a ged101 pack archive, or it is damaged!", fileName);
+			Close();
+			return false;
+		}
+		
+		entries_ = reinterpret_cast<const AssetArchiveEntry*>(data_ + header_->tocOffset);
+		
+		LogMessage("Mounted the archive %s with %u files", fileName, header_->entryCount);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void AssetArchive::Close()
+	{
+		if (0 != data_)
+		{
+// only non-windows platforms use this
+#if !defined(WIN32)
+			munmap(const_cast<unsigned char*>(data_), size_);
+#else
+// this is for the windows platform
+			UnmapViewOfFile(data_);
+#endif
+		}
+		
+		data_ 		= 0;
+		size_ 		= 0;
+		header_ 	= 0;
+		entries_ 	= 0;
+		fileName_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	const AssetArchiveEntry* AssetArchive::Find(const char* name) const
+	{
+		if (0 == entries_)
+		{
+			return 0;
+		}
+		
+		// the table of contents is sorted by name
+		unsigned int low = 0;
+		unsigned int high = header_->entryCount;
+		while (low < high)
+		{
+			unsigned int middle = low + ((high - low) / 2);
+			int order = strcmp(entries_[middle].name, name);
+			if (0 == order)
+			{
+				return &entries_[middle];
+			}
+			else if (order < 0)
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+		
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	const unsigned char* AssetArchive::GetData(const AssetArchiveEntry* entry) const
+	{
+		return data_ + entry->offset;
+	}
+	
+	/**************************************************************************/
+	
+	const char* AssetArchive::GetFileName() const
+	{
+		return fileName_.c_str();
+	}
+	
+	/**************************************************************************/
+	
+	unsigned int AssetArchive::GetEntryCount() const
+	{
+		return (0 != header_) ? header_->entryCount : 0;
+	}
+	
+	/**************************************************************************/
+	
+	bool AssetArchive::Validate() const
+	{
+		if (size_ < sizeof(AssetArchiveHeader))
+		{
+			return false;
+		}
+		
+		if ((0 != memcmp(header_->magic, ASSET_ARCHIVE_MAGIC, 8)) || (ASSET_ARCHIVE_VERSION != header_->version))
+		{
+			return false;
+		}
+		
+		// the sizes are checked with division, so that a damaged count cannot overflow the checks
+		if ((header_->tocOffset > size_) || (header_->tocOffset % ASSET_ARCHIVE_ALIGNMENT) ||
+			(header_->entryCount > (size_ - header_->tocOffset) / sizeof(AssetArchiveEntry)))
+		{
+			return false;
+		}
+		
+		const AssetArchiveEntry* entries = reinterpret_cast<const AssetArchiveEntry*>(data_ + header_->tocOffset);
+		for (unsigned int index = 0; index < header_->entryCount; index++)
+		{
+			const AssetArchiveEntry& entry = entries[index];
+			
+			if ('\0' != entry.name[ASSET_ARCHIVE_NAME_LENGTH - 1])
+			{
+				return false;
+			}
+			
+			if ((entry.offset > size_) || (entry.size > size_ - entry.offset))
+			{
+				return false;
+			}
+			
+			if ((index > 0) && (strcmp(entries[index - 1].name, entry.name) >= 0))
+			{
+				return false;
+			}
+			
+			if (AssetArchiveEntry_Pixels == entry.type)
+			{
+				bool validDepth = (8 == entry.bitsPerPixel) || (24 == entry.bitsPerPixel) || (32 == entry.bitsPerPixel);
+				if (!validDepth || (0 == entry.width) || (entry.width > entry.size / (entry.bitsPerPixel / 8)))
+				{
+					return false;
+				}
+				
+				// the pixels must be exactly the rows of the image
+				unsigned int bytesPerRow = entry.width * (entry.bitsPerPixel / 8);
+				if ((entry.height != entry.size / bytesPerRow) || (0 != entry.size % bytesPerRow))
+				{
+					return false;
+				}
+			}
+			else if (AssetArchiveEntry_File != entry.type)
+			{
+				return false;
+			}
+		}
+		
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	VirtualFile::VirtualFile(const unsigned char* data, unsigned long size) :
+		fp_(0),
+		data_(data),
+		size_(size),
+		position_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	VirtualFile::VirtualFile(FILE* fp, unsigned long size) :
+		fp_(fp),
+		data_(0),
+		size_(size),
+		position_(0)
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	VirtualFile::~VirtualFile()
+	{
+		// implement class destructor here
+		if (0 != fp_)
+		{
+			fclose(fp_);
+			fp_ = 0;
+		}
+	} // end destructor
+	
+	/**************************************************************************/
+	
+	unsigned long VirtualFile::Read(void* buffer, unsigned long size)
+	{
+		if (0 != fp_)
+		{
+			return static_cast<unsigned long>(fread(buffer, 1, size, fp_));
+		}
+		
+		if (size > size_ - position_)
+		{
+			size = size_ - position_;
+		}
+		
+		memcpy(buffer, data_ + position_, size);
+		position_ += size;
+		return size;
+	}
+	
+	/**************************************************************************/
+	
+	bool VirtualFile::Seek(long offset, int origin)
+	{
+		if (0 != fp_)
+		{
+			return (0 == fseek(fp_, offset, origin));
+		}
+		
+		long base = 0;
+		switch(origin)
+		{
+			case SEEK_SET: { base = 0; } break;
+			case SEEK_CUR: { base = static_cast<long>(position_); } break;
+			case SEEK_END: { base = static_cast<long>(size_); } break;
+			default: { return false; } break;
+		}
+		
+		long position = base + offset;
+		if ((position < 0) || (static_cast<unsigned long>(position) > size_))
+		{
+			return false;
+		}
+		
+		position_ = static_cast<unsigned long>(position);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned long VirtualFile::Tell() const
+	{
+		if (0 != fp_)
+		{
+			return static_cast<unsigned long>(ftell(fp_));
+		}
+		return position_;
+	}
+	
+	/**************************************************************************/
+	
+	unsigned long VirtualFile::GetSize() const
+	{
+		return size_;
+	}
+	
+	/**************************************************************************/
+	
+	const unsigned char* VirtualFile::GetData() const
+	{
+		return data_;
+	}
+	
+	/**************************************************************************/
+	
+	bool VirtualFile::IsPacked() const
+	{
+		return (0 != data_);
+	}
+	
+	/**************************************************************************/
+	
+	VirtualFileSystemSingleton* VirtualFileSystemSingleton::GetInstance()
+	{
+		// return the singleton instance
+		static VirtualFileSystemSingleton instance;
+		return &instance;
+	}
+	
+	/**************************************************************************/
+	
+	bool VirtualFileSystemSingleton::Mount(const char* fileName)
+	{
+		AssetArchive* archive = new AssetArchive();
+		if (!archive->Open(fileName))
+		{
+			delete archive;
+			return false;
+		}
+		
+		MutexLock lock(mutex_);
+		archives_.push_back(archive);
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	void VirtualFileSystemSingleton::UnmountAll()
+	{
+		MutexLock lock(mutex_);
+		for (unsigned int index = 0; index < archives_.size(); index++)
+		{
+			delete archives_[index];
+		}
+		archives_.clear();
+	}
+	
+	/**************************************************************************/
+	
+	VirtualFile* VirtualFileSystemSingleton::Open(const char* fileName)
+	{
+		AssetArchive* archive = 0;
+		const AssetArchiveEntry* entry = Find(fileName, &archive);
+		if (0 != entry)
+		{
+			if (AssetArchiveEntry_File == entry->type)
+			{
+				return new VirtualFile(archive->GetData(entry), entry->size);
+			}
+			
+			// the bytes of the file were not kept when the packer decoded it
+			LogError("%s was packed into %s as pixels, and cannot be opened as a file!", fileName, archive->GetFileName());
+			return 0;
+		}
+		
+		FILE* fp = fopen(fileName, "rb");
+		if (0 == fp)
+		{
+			return 0;
+		}
+		
+		long size = 0;
+		if ((0 == fseek(fp, 0, SEEK_END)) && ((size = ftell(fp)) >= 0))
+		{
+			fseek(fp, 0, SEEK_SET);
+			return new VirtualFile(fp, static_cast<unsigned long>(size));
+		}
+		
+		fclose(fp);
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	bool VirtualFileSystemSingleton::Exists(const char* fileName)
+	{
+		AssetArchive* archive = 0;
+		if (0 != Find(fileName, &archive))
+		{
+			return true;
+		}
+		
+		FILE* fp = fopen(fileName, "rb");
+		if (0 != fp)
+		{
+			fclose(fp);
+			return true;
+		}
+		return false;
+	}
+	
+	/**************************************************************************/
+	
+	bool VirtualFileSystemSingleton::IsPacked(const char* fileName)
+	{
+		AssetArchive* archive = 0;
+		return (0 != Find(fileName, &archive));
+	}
+	
+	/**************************************************************************/
+	
+	bool VirtualFileSystemSingleton::GetPixels(const char* fileName, ImagePixelData& pixels)
+	{
+		AssetArchive* archive = 0;
+		const AssetArchiveEntry* entry = Find(fileName, &archive);
+		if ((0 == entry) || (AssetArchiveEntry_Pixels != entry->type))
+		{
+			return false;
+		}
+		
+		pixels.width 			= static_cast<int>(entry->width);
+		pixels.height 			= static_cast<int>(entry->height);
+		pixels.bitsPerPixel 	= static_cast<int>(entry->bitsPerPixel);
+		pixels.pixels 			= const_cast<unsigned char*>(archive->GetData(entry));
+		return true;
+	}
+	
+	/**************************************************************************/
+	
+	std::string VirtualFileSystemSingleton::CanonicalizePath(const char* fileName)
+	{
+		std::string path(fileName);
+		
+		// use forward slashes everywhere
+		for (unsigned int index = 0; index < path.size(); index++)
+		{
+			if ('\\' == path[index])
+			{
+				path[index] = '/';
+			}
+// this is for the windows platform
+#if defined(WIN32)
+			path[index] = static_cast<char>(tolower(static_cast<unsigned char>(path[index])));
+#endif
+		}
+		
+		bool absolute = (!path.empty() && ('/' == path[0]));
+		
+		// split the path into its parts, dropping the empty and "." parts, and resolving the ".." parts
+		std::vector<std::string> parts;
+		unsigned int start = 0;
+		while (start <= path.size())
+		{
+			std::string::size_type end = path.find('/', start);
+			if (std::string::npos == end)
+			{
+				end = path.size();
+			}
+			
+			std::string part = path.substr(start, end - start);
+			if (part.empty() || ("." == part))
+			{
+				// nothing to keep
+			}
+			else if ((".." == part) && !parts.empty() && (".." != parts.back()))
+			{
+				parts.pop_back();
+			}
+			else
+			{
+				parts.push_back(part);
+			}
+			
+			start = static_cast<unsigned int>(end) + 1;
+		}
+		
+		std::string canonical = absolute ? "/" : "";
+		for (unsigned int index = 0; index < parts.size(); index++)
+		{
+			if (index > 0)
+			{
+				canonical += "/";
+			}
+			canonical += parts[index];
+		}
+		
+		return canonical;
+	}
+	
+	/**************************************************************************/
+	
+	std::string VirtualFileSystemSingleton::GetArchiveName(const char* fileName)
+	{
+		std::string name = CanonicalizePath(fileName);
+		for (unsigned int index = 0; index < name.size(); index++)
+		{
+			name[index] = static_cast<char>(tolower(static_cast<unsigned char>(name[index])));
+		}
+		return name;
+	}
+	
+	/**************************************************************************/
+	
+	const AssetArchiveEntry* VirtualFileSystemSingleton::Find(const char* fileName, AssetArchive** archive)
+	{
+		MutexLock lock(mutex_);
+		
+		if (archives_.empty())
+		{
+			return 0;
+		}
+		
+		std::string name = GetArchiveName(fileName);
+		
+		// the newest archive shadows the older ones
+		for (unsigned int index = archives_.size(); index > 0; index--)
+		{
+			const AssetArchiveEntry* entry = archives_[index - 1]->Find(name.c_str());
+			if (0 != entry)
+			{
+				*archive = archives_[index - 1];
+				return entry;
+			}
+		}
+		
+		return 0;
+	}
+	
+	/**************************************************************************/
+	
+	VirtualFileSystemSingleton::VirtualFileSystemSingleton()
+	{
+		// implement class constructor here
+	} // end constructor
+	
+	/**************************************************************************/
+	
+	VirtualFileSystemSingleton::~VirtualFileSystemSingleton()
+	{
+		// implement class destructor here
+		UnmountAll();
+	} // end destructor
+
+} // end namespace
+
+
@@ -0,0 +1,256 @@
+
+// CODESTYLE: v2.0
+
+// ged101pack.cpp
+// Project: Game Engine Design 101 (ENGINE)
+// Author: Richard Marks
+// Purpose: Host-side tool that packs the asset files of a game into a ged101 pack archive
+
+/**
+ * \file ged101pack.cpp
+ * \brief ged101 Pack Archive Packer - Implementation
+ * \author Richard Marks <ccpsceo@gmail.com>
+ *
+ * Usage: ged101pack [-r|--raw] archive file...\n
+ * The files are stored under the names that they are given by, so run the tool from the directory that the game
+ * runs from. With --raw every PNG file is decoded, and its pixels are stored instead of the file, so the game
+ * only has to convert them to the screen depth.\n
+ * The tool prints its own errors to stderr. The engine code that it shares reports through the DebugReport logging
+ * like it does in a game, so the details of a file that cannot be read or decoded are also written to errors.txt
+ * and the other log files in the directory that the tool runs from.
+ */
+
+// include the common headers
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// include the virtual file system header
+#include "VirtualFileSystem.h"
+
+// include the image resource header
+#include "ImageResource.h"
+
+using namespace ENGINE;
+
+/**
+ * \struct PackedFile
+ * \brief a file that is going into the archive
+ */
+struct PackedFile
+{
+	//! the name of the file on disk
+	std::string fileName;
+	//! the entry of the file in the table of contents
+	AssetArchiveEntry entry;
+	//! the data of the file
+	std::vector<unsigned char> data;
+};
+
+/**
+ * orders the files by their names in the archive, which is the order of the table of contents
+ */
+static bool ComparePackedFiles(const PackedFile* lhs, const PackedFile* rhs)
+{
+	return strcmp(lhs->entry.name, rhs->entry.name) < 0;
+}
+
+/**
+ * \return offset moved forward to the next multiple of ASSET_ARCHIVE_ALIGNMENT
+ */
+static unsigned long AlignOffset(unsigned long offset)
+{
+	return (offset + ASSET_ARCHIVE_ALIGNMENT - 1) & ~static_cast<unsigned long>(ASSET_ARCHIVE_ALIGNMENT - 1);
+}
+
+/**
+ * Reads a whole file into memory
+ * \return true if the file was read
+ */
+static bool ReadWholeFile(const char* fileName, std::vector<unsigned char>& data)
+{
+	FILE* fp = fopen(fileName, "rb");
+	if (0 == fp)
+	{
+		return false;
+	}
+	
+	unsigned char buffer[0x10000];
+	size_t bytesRead = 0;
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + bytesRead);
+	}
+	
+	bool readError = (0 != ferror(fp));
+	fclose(fp);
+	return !readError;
+}
+
+/**
+ * Writes zeros until the archive is at an offset
+ * \return true if the zeros were written
+ */
+static bool WritePadding(FILE* fp, unsigned long& offset, unsigned long targetOffset)
+{
+	static const unsigned char zeros[ASSET_ARCHIVE_ALIGNMENT] = { 0 };
+	while (offset < targetOffset)
+	{
+		unsigned long count = targetOffset - offset;
+		count = (count > ASSET_ARCHIVE_ALIGNMENT) ? ASSET_ARCHIVE_ALIGNMENT : count;
+		if (count != fwrite(zeros, 1, count, fp))
+		{
+			return false;
+		}
+		offset += count;
+	}
+	return true;
+}
+
+/**
+ * Entry Point of the packer
+ */
+int main(int argc, char* argv[])
+{
+	bool rawPixels = false;
+	int firstArgument = 1;
+	if ((argc > 1) && (!strcmp(argv[1], "-r") || !strcmp(argv[1], "--raw")))
+	{
+		rawPixels = true;
+		firstArgument = 2;
+	}
+	
+	if (argc - firstArgument < 2)
+	{
+		fprintf(stderr,
+			"Usage: %s [-r|--raw] archive file...\n\n"
+			"\tpacks the files into a ged101 pack archive\n"
+			"\tspecify -r or --raw to store the decoded pixels of the PNG files instead of the files\n",
+			argv[0]);
+		return 1;
+	}
+	
+	const char* archiveFileName = argv[firstArgument];
+	
+	std::vector<PackedFile*> files;
+	for (int index = firstArgument + 1; index < argc; index++)
+	{
+		PackedFile* file = new PackedFile;
+		file->fileName = argv[index];
+		memset(&file->entry, 0, sizeof(AssetArchiveEntry));
+		files.push_back(file);
+		
+		std::string name = VirtualFileSystemSingleton::GetArchiveName(argv[index]);
+		if (name.size() >= ASSET_ARCHIVE_NAME_LENGTH)
+		{
+			fprintf(stderr, "%s: the name is longer than %u characters\n", argv[index], ASSET_ARCHIVE_NAME_LENGTH - 1);
+			return 1;
+		}
+		strcpy(file->entry.name, name.c_str());
+		
+		unsigned int nameLength = name.size();
+		bool isPNG = (nameLength > 4) && (0 == strcmp(name.c_str() + nameLength - 4, ".png"));
+		if (rawPixels && isPNG)
+		{
+			ImagePixelData pixels;
+			if (!ImageResource::DecodePNG(argv[index], pixels))
+			{
+				fprintf(stderr, "%s: could not decode the PNG file\n", argv[index]);
+				return 1;
+			}
+			
+			unsigned int byteCount = pixels.width * pixels.height * (pixels.bitsPerPixel / 8);
+			file->data.assign(pixels.pixels, pixels.pixels + byteCount);
+			delete [] pixels.pixels;
+			
+			file->entry.type 			= AssetArchiveEntry_Pixels;
+			file->entry.width 			= static_cast<unsigned int>(pixels.width);
+			file->entry.height 			= static_cast<unsigned int>(pixels.height);
+			file->entry.bitsPerPixel 	= static_cast<unsigned int>(pixels.bitsPerPixel);
+		}
+		else
+		{
+			if (!ReadWholeFile(argv[index], file->data))
+			{
+				fprintf(stderr, "%s: could not read the file\n", argv[index]);
+				return 1;
+			}
+			file->entry.type = AssetArchiveEntry_File;
+		}
+		file->entry.size = static_cast<unsigned int>(file->data.size());
+	}
+	
+	// the engine finds the files with a binary search of the table of contents
+	std::sort(files.begin(), files.end(), ComparePackedFiles);
+	for (unsigned int index = 1; index < files.size(); index++)
+	{
+		if (0 == strcmp(files[index - 1]->entry.name, files[index]->entry.name))
+		{
+			fprintf(stderr, "%s and %s are the same file\n", files[index - 1]->fileName.c_str(), files[index]->fileName.c_str());
+			return 1;
+		}
+	}
+	
+	// lay the archive out; the header, the table of contents, and then the data of each file
+	AssetArchiveHeader header;
+	memset(&header, 0, sizeof(AssetArchiveHeader));
+	memcpy(header.magic, ASSET_ARCHIVE_MAGIC, 8);
+	header.version 		= ASSET_ARCHIVE_VERSION;
+	header.entryCount 	= static_cast<unsigned int>(files.size());
+	header.tocOffset 	= static_cast<unsigned int>(AlignOffset(sizeof(AssetArchiveHeader)));
+	
+	unsigned long offset = header.tocOffset + (files.size() * sizeof(AssetArchiveEntry));
+	for (unsigned int index = 0; index < files.size(); index++)
+	{
+		offset = AlignOffset(offset);
+		files[index]->entry.offset = static_cast<unsigned int>(offset);
+		offset += files[index]->entry.size;
+	}
+	
+	FILE* fp = fopen(archiveFileName, "wb");
+	if (0 == fp)
+	{
+		fprintf(stderr, "%s: could not create the archive\n", archiveFileName);
+		return 1;
+	}
+	
+	bool written = (1 == fwrite(&header, sizeof(AssetArchiveHeader), 1, fp));
+	offset = sizeof(AssetArchiveHeader);
+	written = written && WritePadding(fp, offset, header.tocOffset);
+	for (unsigned int index = 0; written && (index < files.size()); index++)
+	{
+		written = (1 == fwrite(&files[index]->entry, sizeof(AssetArchiveEntry), 1, fp));
+		offset += sizeof(AssetArchiveEntry);
+	}
+	for (unsigned int index = 0; written && (index < files.size()); index++)
+	{
+		PackedFile* file = files[index];
+		written = WritePadding(fp, offset, file->entry.offset);
+		if (written && !file->data.empty())
+		{
+			written = (file->data.size() == fwrite(&file->data[0], 1, file->data.size(), fp));
+		}
+		offset += file->data.size();
+	}
+	written = (0 == fclose(fp)) && written;
+	
+	if (!written)
+	{
+		fprintf(stderr, "%s: could not write the archive\n", archiveFileName);
+		remove(archiveFileName);
+		return 1;
+	}
+	
+	printf("packed %u files into %s (%lu bytes)\n", static_cast<unsigned int>(files.size()), archiveFileName, offset);
+	
+	for (unsigned int index = 0; index < files.size(); index++)
+	{
+		delete files[index];
+	}
+	return 0;
+}
+
+